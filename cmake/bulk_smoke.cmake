@@ -0,0 +1,58 @@
+# Round trip through mlkem_bulk (cmake -P, see CMakeLists.txt).
+#   BULK  path to mlkem_bulk
+#   DIR   scratch directory
+#
+# Generates keys, encapsulates to them and decapsulates the ciphertexts,
+# the last step in two runs (--count, then --resume) with small windows,
+# and fails unless both sides derived the same shared secrets. Then reruns
+# encapsulation and decapsulation over a shorter input into the same files,
+# which must come out the new length with no stale records.
+
+file(REMOVE_RECURSE ${DIR})
+file(MAKE_DIRECTORY ${DIR})
+
+function(bulk)
+    execute_process(COMMAND ${BULK} ${ARGN} --quiet --threads 3 --window 7 --chunk 2
+                    RESULT_VARIABLE rc OUTPUT_VARIABLE out ERROR_VARIABLE err)
+    if(NOT rc EQUAL 0)
+        message(FATAL_ERROR "mlkem_bulk ${ARGN} exited with ${rc}\n${out}${err}")
+    endif()
+    message(STATUS "${ARGV0}: ${out}")
+endfunction()
+
+bulk(keygen --count 40 --ek ${DIR}/ek.bin --dk ${DIR}/dk.bin)
+bulk(encaps --in ${DIR}/ek.bin --ct ${DIR}/ct.bin --ss ${DIR}/ss_encaps.bin)
+bulk(decaps --keys ${DIR}/dk.bin --in ${DIR}/ct.bin --ss ${DIR}/ss_decaps.bin --count 17)
+bulk(decaps --keys ${DIR}/dk.bin --in ${DIR}/ct.bin --ss ${DIR}/ss_decaps.bin --resume)
+
+file(SIZE ${DIR}/ss_encaps.bin encaps_size)
+if(NOT encaps_size EQUAL 1280)
+    message(FATAL_ERROR "expected 40 shared secrets, got ${encaps_size} bytes")
+endif()
+file(SHA256 ${DIR}/ss_encaps.bin encaps_hash)
+file(SHA256 ${DIR}/ss_decaps.bin decaps_hash)
+if(NOT encaps_hash STREQUAL decaps_hash)
+    message(FATAL_ERROR "decapsulated shared secrets differ from the encapsulated ones")
+endif()
+message(STATUS "40 records round-tripped")
+
+# 3 keys into the 40-record outputs: a run from record 0 replaces them, a
+# --resume drops the records past the end of its input
+bulk(keygen --count 3 --ek ${DIR}/ek3.bin --dk ${DIR}/dk3.bin)
+bulk(encaps --in ${DIR}/ek3.bin --ct ${DIR}/ct.bin --ss ${DIR}/ss_encaps.bin)
+bulk(decaps --keys ${DIR}/dk3.bin --in ${DIR}/ct.bin --ss ${DIR}/ss_decaps.bin --resume)
+foreach(f ss_encaps ss_decaps)
+    file(SIZE ${DIR}/${f}.bin size)
+    if(NOT size EQUAL 96)
+        message(FATAL_ERROR "${f}.bin holds ${size} bytes after a 3-record run, expected 96")
+    endif()
+endforeach()
+bulk(decaps --keys ${DIR}/dk3.bin --in ${DIR}/ct.bin --ss ${DIR}/ss_decaps.bin --count 1)
+bulk(decaps --keys ${DIR}/dk3.bin --in ${DIR}/ct.bin --ss ${DIR}/ss_decaps.bin --resume)
+file(SHA256 ${DIR}/ss_encaps.bin encaps_hash)
+file(SHA256 ${DIR}/ss_decaps.bin decaps_hash)
+if(NOT encaps_hash STREQUAL decaps_hash)
+    message(FATAL_ERROR "shared secrets differ after the shorter rerun")
+endif()
+message(STATUS "3-record rerun replaced the 40-record outputs")
+
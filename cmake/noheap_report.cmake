@@ -0,0 +1,74 @@
+# Checks and reports on the heap-free library (cmake -P, see CMakeLists.txt).
+#   LIB     path to libmlkem_noheap.a
+#   SU_DIR  directory searched for the -fstack-usage (.su) files
+#   NM      nm binary
+#
+# Fails if the archive references an allocator, then prints the static
+# frame size of every function in the heap-free API and the kernels.
+# Frame sizes do not include callees; stack_test.exe measures the whole
+# call depth of each operation.
+
+if(NOT NM)
+    set(NM nm)
+endif()
+
+execute_process(COMMAND ${NM} -u -C ${LIB}
+                OUTPUT_VARIABLE undefined RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "nm failed on ${LIB}")
+endif()
+
+set(allocators "operator new" "operator delete" "malloc" "calloc" "realloc"
+               "free" "aligned_alloc" "posix_memalign")
+set(found "")
+string(REPLACE "\n" ";" undefined_lines "${undefined}")
+foreach(line ${undefined_lines})
+    string(STRIP "${line}" sym)
+    string(REGEX REPLACE "^U " "" sym "${sym}")
+    foreach(a ${allocators})
+        if(sym STREQUAL a OR sym MATCHES "^${a}\\(")
+            list(APPEND found "${sym}")
+        endif()
+    endforeach()
+endforeach()
+if(found)
+    list(REMOVE_DUPLICATES found)
+    message(FATAL_ERROR "libmlkem_noheap references the heap: ${found}")
+endif()
+message("libmlkem_noheap: no allocator references")
+
+file(GLOB_RECURSE su_files ${SU_DIR}/mlkem_noheap_common.dir/*.su
+                           ${SU_DIR}/mlkem_ref.dir/*.su
+                           ${SU_DIR}/mlkem_portable.dir/*.su
+                           ${SU_DIR}/mlkem_avx2.dir/*.su
+                           ${SU_DIR}/mlkem_avx512.dir/*.su)
+if(NOT su_files)
+    message(FATAL_ERROR "no .su files under ${SU_DIR}; was the library built with -fstack-usage?")
+endif()
+
+message("")
+message("frame bytes  object: function (kind)")
+foreach(f ${su_files})
+    get_filename_component(dir ${f} DIRECTORY)
+    string(REGEX MATCH "[^/]+\\.dir" target "${dir}")
+    string(REPLACE ".dir" "" target "${target}")
+    file(STRINGS ${f} lines)
+    foreach(line ${lines})
+        # <file>:<line>:<col>:<function>\t<bytes>\t<static|dynamic|bounded>
+        if(line MATCHES "^[^:]*:[0-9]+:[0-9]+:([^\t]+)\t([0-9]+)\t([a-z,]+)")
+            set(fn "${CMAKE_MATCH_1}")
+            set(bytes "${CMAKE_MATCH_2}")
+            set(kind "${CMAKE_MATCH_3}")
+            if(fn STREQUAL "cpp)")
+                set(fn "(static initializers)")
+            endif()
+            if(kind MATCHES "dynamic" AND NOT kind MATCHES "bounded")
+                message(FATAL_ERROR "${target}: ${fn} has an unbounded (dynamic) frame")
+            endif()
+            string(LENGTH "${bytes}" len)
+            math(EXPR pad "11 - ${len}")
+            string(REPEAT " " ${pad} spaces)
+            message("${spaces}${bytes}  ${target}: ${fn} (${kind})")
+        endif()
+    endforeach()
+endforeach()
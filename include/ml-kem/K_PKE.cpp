@@ -1,4 +1,6 @@
 #include "K_PKE.hpp"
+#include "poly_bound.hpp"
+#include "trace.hpp"
 
 #include <cstring>
 
@@ -18,6 +20,7 @@
 * Returns:     - pair of (private_key, public_key)
 **************************************************/
 pair<vector<ui8>, vector<ui8>> K_PKE_KeyGen(vector<ui8>& seed) {
+    MLKEM_TRACE_SCOPE("K_PKE_KeyGen");
     if (seed.size() != 32) {
 
         return {};
@@ -25,8 +28,11 @@ pair<vector<ui8>, vector<ui8>> K_PKE_KeyGen(vector<ui8>& seed) {
 
     // Step 1: seed expansion
     ui8 in[32], out[64];
-    memcpy(in, seed.data(), 32);
-    FIPS202_SHA3_512(in, 32, out);
+    {
+        MLKEM_TRACE_SCOPE("seed_expansion");
+        memcpy(in, seed.data(), 32);
+        FIPS202_SHA3_512(in, 32, out);
+    }
 
     vector<ui8> a_seed(32), s_seed(32);
     memcpy(a_seed.data(), out, 32);
@@ -74,13 +80,16 @@ pair<vector<ui8>, vector<ui8>> K_PKE_KeyGen(vector<ui8>& seed) {
 
     // Step 5: Compute t = As + e
     vector<vector<i16>> t_ntt(Kyber_k, vector<i16>(Kyber_N, 0));
-    for (int i = 0; i < Kyber_k; i++) {
-        for (int j = 0; j < Kyber_k; j++) {
-            vector<i16> temp = poly_multiply_pointwise_mont(A[i][j], s[j]);
-            t_ntt[i] = poly_add(t_ntt[i], temp);
+    {
+        MLKEM_TRACE_SCOPE("basemul_acc");
+        for (int i = 0; i < Kyber_k; i++) {
+            for (int j = 0; j < Kyber_k; j++) {
+                vector<i16> temp = poly_multiply_pointwise_mont(A[i][j], s[j]);
+                t_ntt[i] = poly_add(t_ntt[i], temp);
+            }
+            poly_reduce(t_ntt[i]);
+            poly_tomont(t_ntt[i]);
         }
-        poly_reduce(t_ntt[i]);
-        poly_tomont(t_ntt[i]);
     }
 
 
@@ -116,7 +125,8 @@ pair<vector<ui8>, vector<ui8>> K_PKE_KeyGen(vector<ui8>& seed) {
 *              - Samples short vector y and noise vectors e1, e2.
 *              - Computes u = A*y + e1 and v = t*y + e2 + m (all mod q).
 *              - Applies NTT and inverse NTT where required.
-*              - Compresses and encodes u and v to form ciphertext.
+*              - Compresses and encodes u and v to form ciphertext, fused
+*                with the last inverse-NTT layer.
 *
 * Arguments:   - vector<ui8>& public_key: public key bytes
 *              - vector<ui8>& msg: message (32 bytes)
@@ -125,6 +135,7 @@ pair<vector<ui8>, vector<ui8>> K_PKE_KeyGen(vector<ui8>& seed) {
 * Returns:     - vector<ui8>: ciphertext
 **************************************************/
 vector<ui8> K_PKE_Encrypt(vector<ui8> &public_key, vector<ui8> &msg, vector<ui8> &random) {
+    MLKEM_TRACE_SCOPE("K_PKE_Encrypt");
     vector<vector<ui8>> t_part(Kyber_k, vector<ui8>(384, 0));
     vector<ui8> a_seed(32, 0);
 
@@ -133,17 +144,17 @@ vector<ui8> K_PKE_Encrypt(vector<ui8> &public_key, vector<ui8> &msg, vector<ui8>
     for (int i = 0; i < Kyber_k; i++) {
         memcpy(t_part[i].data(), public_key.data() + i * 384, 384);
     }
-    // Decode t to get t_cap ∈ Z_q^Kyber_k x Kyber_N
-    vector<vector<i16>> t_cap(Kyber_k, vector<i16>(Kyber_N, 0));
+    // Decode t: ByteDecode12 yields coefficients in [0,q)
+    vector<reduced_ntt_poly> t_cap(Kyber_k);
     for (int i = 0; i < Kyber_k; i++) {
-        t_cap[i] = ByteDecode(t_part[i], 12);
+        t_cap[i] = reduced_ntt_poly(ByteDecode(t_part[i], 12));
     }
 
     // Generate matrix A ∈ Z_q^{Kyber_k x Kyber_k}
-    vector<vector<vector<i16>>> A(Kyber_k, vector<vector<i16>>(Kyber_k, vector<i16>(Kyber_N, 0)));
+    vector<vector<reduced_ntt_poly>> A(Kyber_k, vector<reduced_ntt_poly>(Kyber_k));
     for (int i = 0; i < Kyber_k; i++) {
         for (int j = 0; j < Kyber_k; j++) {
-            A[i][j] = NTT_sample(a_seed, static_cast<ui8>(i), static_cast<ui8>(j));
+            A[i][j] = reduced_ntt_poly(NTT_sample(a_seed, static_cast<ui8>(i), static_cast<ui8>(j)));
         }
     }
 
@@ -180,57 +191,34 @@ vector<ui8> K_PKE_Encrypt(vector<ui8> &public_key, vector<ui8> &msg, vector<ui8>
     FIPS202_SHAKE256(y_in, 33, y_out, 64 * eta2);
     e2 = Binomial_sample(sample, eta2);
 
-    // Apply NTT to y
+    // Apply NTT to y; the result (< 8q) is small enough to multiply by
+    // the [0,q) entries of A and t without reducing
+    typedef decltype(ntt(reduced_poly())) y_hat_poly;
+    vector<y_hat_poly> y_hat;
     for (int i = 0; i < Kyber_k; i++) {
-        ntt(y[i]);
-        poly_reduce(y[i]);
+        y_hat.push_back(ntt(reduced_poly(std::move(y[i]))));
     }
 
-    // Compute u = InvNTT(A^T * y), v = InvNTT(t^T * y)
-    vector<vector<i16>> u(Kyber_k, vector<i16>(Kyber_N, 0));
-    vector<i16> v(Kyber_N, 0);
+    // Compute u = InvNTT(A^T * y) + e1 and v = InvNTT(t^T * y) + e2 + mu;
+    // reduce_to only emits a reduction when the bound requires one. The
+    // last invNTT layer, the error addition, Compress and ByteEncode run
+    // as one pass straight into the ciphertext.
+    vector<ui8> c(32 * (Kyber_k * du + dv), 0); 
     for (int i = 0; i < Kyber_k; i++) {
-        for (int j = 0; j < Kyber_k; j++) {
-            vector<i16> temp_u = poly_multiply_pointwise_mont(A[i][j], y[j]);
-            u[i] = poly_add(u[i], temp_u);
-        }
-        poly_reduce(u[i]);
-        invntt(u[i]);
-        vector<i16> temp_v = poly_multiply_pointwise_mont(t_cap[i], y[i]);
-        v = poly_add(v, temp_v);
+        reduced_poly e1_i(std::move(e1[i]));
+        invntt_compress(c.data() + i * 32 * du,
+                        reduce_to<INVNTT_MAX_INPUT>(poly_inner_product_mont<Kyber_k>(A[i].data(), y_hat.data())),
+                        e1_i, du, false);
     }
-    poly_reduce(v);
-    invntt(v);
+
     // Encode message into mu ∈ Z_q^Kyber_N
     vector<i16> m_intermediate = ByteDecode(msg, 1);
-    vector<i16> mu = Decompress(m_intermediate, 1);
-    // Add errors
-    for (int i = 0; i < Kyber_k; i++) {
-        u[i] = poly_add(u[i], e1[i]);
-        poly_reduce(u[i]);
-    }
-    v = poly_add(v, e2);
-    v = poly_add(v, mu);
-    poly_reduce(v);
-    // Compress u and v, encode into ciphertext
-    vector<ui8> c(32 * (Kyber_k * du + dv), 0); 
-    vector<vector<ui8>> c1(Kyber_k, vector<ui8>(32 * du, 0));
-    vector<ui8> c2(32 * dv, 0);
+    reduced_poly mu(Decompress(m_intermediate, 1));
 
-    for (int i = 0; i < Kyber_k; i++) {
-        vector<i16> comp_u = Compress(u[i], du);
-        c1[i] = ByteEncode(comp_u, du); 
-    }
-    vector<i16> comp_v = Compress(v, dv);
-    c2 = ByteEncode(comp_v, dv);
-    for (int i = 0; i < Kyber_k; i++) {
-        for (int j = 0; j < 32 * du; j++) {
-            c[i * 32 * du + j] = c1[i][j];
-        }
-    }
-    for (int j = 0; j < 32 * dv; j++) {
-        c[Kyber_k * 32 * du + j] = c2[j];
-    }
+    auto e2_mu = poly_add(reduced_poly(std::move(e2)), mu);
+    invntt_compress(c.data() + Kyber_k * 32 * du,
+                    reduce_to<INVNTT_MAX_INPUT>(poly_inner_product_mont<Kyber_k>(t_cap.data(), y_hat.data())),
+                    e2_mu, dv, false);
     return c;
 }
 
@@ -239,7 +227,8 @@ vector<ui8> K_PKE_Encrypt(vector<ui8> &public_key, vector<ui8> &msg, vector<ui8>
 * Name:        K_PKE_Decrypt
 *
 * Description: Decrypts a ciphertext using the Kyber private key.
-*              - Decompresses and decodes ciphertext into vectors u and v.
+*              - Decodes and decompresses ciphertext into vectors u and v
+*                (u directly into the NTT domain).
 *              - Decodes secret key s from byte format.
 *              - Computes v - <s, u> to recover w.
 *              - Compresses w to extract the original message.
@@ -250,57 +239,34 @@ vector<ui8> K_PKE_Encrypt(vector<ui8> &public_key, vector<ui8> &msg, vector<ui8>
 * Returns:     - vector<ui8>: decrypted message
 **************************************************/
 vector<ui8> K_PKE_Decrypt(vector<ui8> &secret_key, vector<ui8> &c){
-    // step 1: extracting c1,c2 from cipher_text
-    vector<vector<ui8>> c1(Kyber_k, vector<ui8>(32 * du, 0));
-    vector<ui8> c2(32 * dv, 0);
-    for (int i = 0; i < Kyber_k; i++) {
-        for (int j = 0; j < 32 * du; j++) {
-            c1[i][j] = c[i * 32 * du + j] ;
-        }
-    }
-    for (int j = 0; j < 32 * dv; j++) {
-        c2[j] = c[Kyber_k * 32 * du + j] ;
-    }
-
-    // step 2: extracting v and u also computing ntt(u) for w  
-    vector<i16> v(Kyber_N,0);
-    vector<vector<i16>> u(Kyber_k,vector<i16>(Kyber_N,0));
-    for (int i = 0; i < Kyber_k; i++) {
-        vector<i16> decode_u = ByteDecode(c1[i], du);
-        u[i] = Decompress(decode_u, du);
-        ntt(u[i]);
-        poly_reduce(u[i]);
-    }
+    MLKEM_TRACE_SCOPE("K_PKE_Decrypt");
+    // step 1: extracting v from c2
+    vector<ui8> c2(c.begin() + Kyber_k * 32 * du, c.begin() + Kyber_k * 32 * du + 32 * dv);
     vector<i16> decode_v = ByteDecode(c2, dv);
-    v = Decompress(decode_v, dv);
+    reduced_poly v(Decompress(decode_v, dv));
 
-    // step 3: decode secret_key
-    vector<vector<i16>> s(Kyber_k,vector<i16>(Kyber_N,0));
+    // step 2: ntt(u) for w, decoded and decompressed from c1 in the same
+    // pass; Decompress yields [0,q] and the NTT of that (< 8q) can go
+    // straight into basemul
+    typedef decltype(ntt_decompress(c.data(), du)) u_hat_poly;
+    vector<u_hat_poly> u_hat;
     for (int i = 0; i < Kyber_k; i++) {
-        vector<ui8> temp(secret_key.begin() + i * 384, secret_key.begin() + (i + 1) * 384);
-        s[i] = ByteDecode(temp, 12);  // Corrected
+        u_hat.push_back(ntt_decompress(c.data() + i * 32 * du, du));
     }
 
-// Step 4: Compute inner product of s^T * u
-vector<i16> acc(Kyber_N, 0);
+    // step 3: decode secret_key (ByteDecode12 yields [0,q))
+    vector<reduced_ntt_poly> s(Kyber_k);
     for (int i = 0; i < Kyber_k; i++) {
-        vector<i16> temp = poly_multiply_pointwise_mont(s[i],u[i]);
-        acc = poly_add(acc,temp);
+        vector<ui8> temp(secret_key.begin() + i * 384, secret_key.begin() + (i + 1) * 384);
+        s[i] = reduced_ntt_poly(ByteDecode(temp, 12));
     }
-    poly_reduce(acc);
-
-    // Reduce modulo Q and apply InvNTT
-    invntt(acc); 
-
-    // Now subtract from v to get w
-    vector<i16> w(Kyber_N);
-    for (int i = 0; i < Kyber_N; i++)
-        w[i] = v[i] - acc[i] ;
-    poly_reduce(w);
 
-    // step 5: extracting msg
-    vector<i16> comp_w = Compress(w, 1);
-    vector<ui8> msg = ByteEncode(comp_w, 1);
+    // step 4 and 5: w = v - InvNTT(s^T * u), compressed to one bit per
+    // coefficient and packed into the message in one pass
+    vector<ui8> msg(32);
+    invntt_compress(msg.data(),
+                    reduce_to<INVNTT_MAX_INPUT>(poly_inner_product_mont<Kyber_k>(s.data(), u_hat.data())),
+                    v, 1, true);
 
     return msg;
 }
\ No newline at end of file
@@ -1,6 +1,12 @@
 #include "ML-KEM.hpp"
+#include "hash_multi.hpp"
+#include "alloc_track.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+#include "dispatch.hpp"
+#include "context.hpp"
+#include "selftest.hpp"
 #include<cstring> 
-#include <random>
 #include<iomanip>
 
 /*************************************************
@@ -15,6 +21,7 @@
 * Returns:     - pair of vectors: (public key ek, secret key decaps)
 **************************************************/
 pair<vector<ui8>,vector<ui8>> ML_KEM_KeyGen_internal(vector<ui8> &seed,vector<ui8> &z){
+    MLKEM_TRACE_SCOPE("ML_KEM_KeyGen");
     auto [dk, ek] = K_PKE_KeyGen(seed);
 
     ui8 out[32];
@@ -41,6 +48,7 @@ pair<vector<ui8>,vector<ui8>> ML_KEM_KeyGen_internal(vector<ui8> &seed,vector<ui
 * Returns:     - pair of vectors: (shared secret K, ciphertext c)
 **************************************************/
 pair<vector<ui8>,vector<ui8>> ML_KEM_Encaps_internal(vector<ui8> &public_key ,vector<ui8> &msg){
+    MLKEM_TRACE_SCOPE("ML_KEM_Encaps");
     
     ui8 in[64],out[64];
     vector<ui8> hash(32);
@@ -75,6 +83,7 @@ pair<vector<ui8>,vector<ui8>> ML_KEM_Encaps_internal(vector<ui8> &public_key ,ve
 * Returns:     - vector<ui8>: shared secret K
 **************************************************/
 vector<ui8> ML_KEM_Decaps_internal(vector<ui8> &decaps, vector<ui8> &c) {
+    MLKEM_TRACE_SCOPE("ML_KEM_Decaps");
     vector<ui8> dk(384 * Kyber_k), ek(384 * Kyber_k + 32), hash_ek(32), z(32);
 
     memcpy(dk.data(), decaps.data(), 384 * Kyber_k);
@@ -94,93 +103,410 @@ vector<ui8> ML_KEM_Decaps_internal(vector<ui8> &decaps, vector<ui8> &c) {
 
     vector<ui8> c_dash = K_PKE_Encrypt(ek, extracted_msg, r_dash);
 
-    bool flag = (c.size() == c_dash.size());
-    for (size_t i = 0; i < c.size() && flag; i++) {
-        if (c[i] != c_dash[i]) {
-            flag = false;
-            break;
+    // Compare without an early exit and always derive the rejection key,
+    // so the time taken does not depend on whether or where c and c' differ
+    ui8 diff = (c.size() == c_dash.size()) ? 0 : 1;
+    for (size_t i = 0; i < c.size() && i < c_dash.size(); i++) diff |= c[i] ^ c_dash[i];
+
+    vector<ui8> random_k(32);
+    vector<ui8> in_random(32 + c.size());
+    memcpy(in_random.data(), z.data(), 32);
+    memcpy(in_random.data() + 32, c.data(), c.size());
+    FIPS202_SHAKE128(in_random.data(), in_random.size(), random_k.data(), 32);
+
+    // mask = 0xFF when the re-encryption matched
+    ui8 mask = (ui8)(((unsigned)diff - 1) >> 8);
+    for (int i = 0; i < 32; i++) k_dash[i] = (k_dash[i] & mask) | (random_k[i] & ~mask);
+    mlkem_metrics_add(MLKEM_METRIC_IMPLICIT_REJECTS, (ui8)~mask & 1);
+    return k_dash;
+}
+
+/*************************************************
+* Name:        ML_KEM_Encaps_internal_batch
+*
+* Description: Encapsulates to many public keys at once. H(ek) and
+*              G(m || H(ek)) are computed with the multi-buffer SHA3
+*              entry points, four or eight keys per pass depending on
+*              the active backend; K-PKE encryption runs per key.
+*
+* Arguments:   - vector<vector<ui8>> &public_keys: recipients' public keys
+*              - vector<vector<ui8>> &msgs: one 32-byte message per key
+*
+* Returns:     - vector of pairs: (shared secret K, ciphertext c) per key,
+*                empty if the inputs are malformed
+**************************************************/
+vector<pair<vector<ui8>,vector<ui8>>> ML_KEM_Encaps_internal_batch(vector<vector<ui8>> &public_keys, vector<vector<ui8>> &msgs){
+    MLKEM_TRACE_SCOPE("ML_KEM_Encaps_batch");
+    size_t n = public_keys.size();
+    const size_t ek_len = 384*Kyber_k+32;
+    if (msgs.size() != n) {
+        cerr<<"Encaps batch: one message per public key required"<<endl;
+        return {};
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (public_keys[i].size() != ek_len || msgs[i].size() != 32) {
+            cerr<<"Encaps batch: malformed input at index "<<i<<endl;
+            return {};
         }
     }
 
-    if(flag==false){
-        vector<ui8> random_k(32);
-        vector<ui8> in_random(32 + c.size());
-        memcpy(in_random.data(), z.data(), 32);
-        memcpy(in_random.data() + 32, c.data(), c.size());
-        
-        FIPS202_SHAKE128(in_random.data(), in_random.size(), random_k.data(), 32);
-        return random_k;
-    }else{
-        return k_dash;
+    vector<ui8> g_in(64*n), g_out(64*n);
+    vector<ui8*> in(n), out(n);
+
+    // H(ek) lands directly behind m in each G input
+    for (size_t i = 0; i < n; i++) {
+        memcpy(g_in.data()+64*i,msgs[i].data(),32);
+        in[i] = public_keys[i].data();
+        out[i] = g_in.data()+64*i+32;
+    }
+    FIPS202_SHA3_256_batch(n,in.data(),ek_len,out.data());
+
+    for (size_t i = 0; i < n; i++) {
+        in[i] = g_in.data()+64*i;
+        out[i] = g_out.data()+64*i;
     }
+    FIPS202_SHA3_512_batch(n,in.data(),64,out.data());
+
+    vector<pair<vector<ui8>,vector<ui8>>> result(n);
+    vector<ui8> r(32);
+    for (size_t i = 0; i < n; i++) {
+        result[i].first.assign(g_out.begin()+64*i,g_out.begin()+64*i+32);
+        memcpy(r.data(),g_out.data()+64*i+32,32);
+        result[i].second = K_PKE_Encrypt(public_keys[i],msgs[i],r);
+    }
+    return result;
+}
+
+/*************************************************
+* Name:        ML_KEM_Decaps_internal_batch
+*
+* Description: Decapsulates many ciphertexts at once. G(m' || h) and the
+*              implicit-rejection key are computed with the multi-buffer
+*              SHA3/SHAKE entry points; decryption and re-encryption run
+*              per ciphertext. Both candidate keys are always computed and
+*              the comparison does not exit early.
+*
+* Arguments:   - vector<vector<ui8>> &decaps: decapsulation keys
+*              - vector<vector<ui8>> &c: one ciphertext per key
+*
+* Returns:     - vector<vector<ui8>>: shared secret per ciphertext,
+*                empty if the inputs are malformed
+**************************************************/
+vector<vector<ui8>> ML_KEM_Decaps_internal_batch(vector<vector<ui8>> &decaps, vector<vector<ui8>> &c){
+    MLKEM_TRACE_SCOPE("ML_KEM_Decaps_batch");
+    size_t n = decaps.size();
+    const size_t dk_len = 768*Kyber_k+96, c_len = 32*(Kyber_k*du+dv);
+    if (c.size() != n) {
+        cerr<<"Decaps batch: one ciphertext per key required"<<endl;
+        return {};
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (decaps[i].size() != dk_len || c[i].size() != c_len) {
+            cerr<<"Decaps batch: malformed input at index "<<i<<endl;
+            return {};
+        }
+    }
+
+    vector<ui8> g_in(64*n), g_out(64*n), j_in((32+c_len)*n), j_out(32*n);
+    vector<ui8*> in(n), out(n);
+    vector<vector<ui8>> msgs(n);
+    vector<ui8> dk(384*Kyber_k);
+
+    for (size_t i = 0; i < n; i++) {
+        memcpy(dk.data(),decaps[i].data(),384*Kyber_k);
+        msgs[i] = K_PKE_Decrypt(dk,c[i]);
+        memcpy(g_in.data()+64*i,msgs[i].data(),32);
+        memcpy(g_in.data()+64*i+32,decaps[i].data()+768*Kyber_k+32,32);
+        in[i] = g_in.data()+64*i;
+        out[i] = g_out.data()+64*i;
+    }
+    FIPS202_SHA3_512_batch(n,in.data(),64,out.data());
+
+    for (size_t i = 0; i < n; i++) {
+        memcpy(j_in.data()+(32+c_len)*i,decaps[i].data()+768*Kyber_k+64,32);
+        memcpy(j_in.data()+(32+c_len)*i+32,c[i].data(),c_len);
+        in[i] = j_in.data()+(32+c_len)*i;
+        out[i] = j_out.data()+32*i;
+    }
+    FIPS202_SHAKE128_batch(n,in.data(),32+c_len,out.data(),32);
+
+    vector<vector<ui8>> result(n, vector<ui8>(32));
+    vector<ui8> ek(384*Kyber_k+32), r_dash(32);
+    u64 rejects = 0;
+    for (size_t i = 0; i < n; i++) {
+        memcpy(ek.data(),decaps[i].data()+384*Kyber_k,384*Kyber_k+32);
+        memcpy(r_dash.data(),g_out.data()+64*i+32,32);
+        vector<ui8> c_dash = K_PKE_Encrypt(ek,msgs[i],r_dash);
+
+        ui8 diff = 0;
+        for (size_t j = 0; j < c_len; j++) diff |= c[i][j] ^ c_dash[j];
+        // mask = 0xFF when the re-encryption matched
+        ui8 mask = (ui8)(((unsigned)diff - 1) >> 8);
+        for (int j = 0; j < 32; j++)
+            result[i][j] = (g_out[64*i+j] & mask) | (j_out[32*i+j] & ~mask);
+        rejects += (ui8)~mask & 1;
+    }
+    mlkem_metrics_add(MLKEM_METRIC_IMPLICIT_REJECTS, rejects);
+    return result;
+}
+
+/*************************************************
+* Name:        ML_KEM_check_encaps_key
+*
+* Description: FIPS 203 encapsulation key check: the key has the right
+*              length and every 12-bit coefficient of t is below q, i.e.
+*              ByteEncode(ByteDecode(ek)) == ek.
+*
+* Arguments:   - vector<ui8> &public_key: encapsulation key
+*
+* Returns:     - bool: true if the key is well formed
+**************************************************/
+bool ML_KEM_check_encaps_key(vector<ui8> &public_key){
+    if (public_key.size() != 384*Kyber_k+32) return false;
+    const mlkem_backend &b = mlkem_dispatch();
+    unsigned bad = 0;
+    for (int i = 0; i < Kyber_k; i++)
+        bad |= b.byte_check12(public_key.data()+384*i);
+    return bad == 0;
+}
+
+/*************************************************
+* Name:        ML_KEM_check_decaps_key
+*
+* Description: FIPS 203 decapsulation key check: the key has the right
+*              length and the stored h equals H(ek) of the embedded
+*              encapsulation key.
+*
+* Arguments:   - vector<ui8> &decaps: decapsulation key
+*
+* Returns:     - bool: true if the key is well formed
+**************************************************/
+bool ML_KEM_check_decaps_key(vector<ui8> &decaps){
+    if (decaps.size() != 768*Kyber_k+96) return false;
+    ui8 h[32], diff = 0;
+    FIPS202_SHA3_256(decaps.data()+384*Kyber_k,384*Kyber_k+32,h);
+    for (int i = 0; i < 32; i++) diff |= h[i] ^ decaps[768*Kyber_k+32+i];
+    return diff == 0;
 }
 
 /*************************************************
 * Name:        ML_KEM_KEYGEN
 *
-* Description: Generates public and secret key pair for ML-KEM using RNG.
+* Description: Generates public and secret key pair for ML-KEM, with d
+*              and z from the context's DRBG (the calling thread's
+*              context if none is given).
 *
-* Arguments:   None
+* Arguments:   - MLKEM_Context &ctx: context (optional)
 *
 * Returns:     - pair of vectors: (ek, decaps)
 **************************************************/
-pair<vector<ui8>,vector<ui8>> ML_KEM_KEYGEN(){
-    vector<ui8> seed(64),d(32),z(32);
-    random_device rd;
-    mt19937 gen(rd());
-    uniform_int_distribution<> dis(0, 255);
-    for (int i = 0; i < 64; i++) {
-        seed[i] = dis(gen);
-    }
-    FIPS202_SHAKE128(seed.data(),32,d.data(),32);
-    FIPS202_SHAKE128(seed.data()+32,32,z.data(),32);
-    if (d.empty() || z.empty()) {
-        cerr<<"RNG FAILED "<<endl;
-        return {}; 
+pair<vector<ui8>,vector<ui8>> ML_KEM_KEYGEN(MLKEM_Context &ctx){
+    if (!mlkem_selftest_passed()) {
+        cerr<<"ML_KEM_KEYGEN: self-test failed"<<endl;
+        return {};
     }
+    MLKEM_ALLOC_SCOPE(MLKEM_OP_KEYGEN);
+    MetricsScope metrics(MLKEM_OP_KEYGEN, 1);
+    vector<ui8> d(32),z(32);
+    ctx.random(d.data(),32);
+    ctx.random(z.data(),32);
+    ctx.stats.keygen++;
     auto [ek,dk] = ML_KEM_KeyGen_internal(d,z);
     return {ek,dk};
 }
 
+pair<vector<ui8>,vector<ui8>> ML_KEM_KEYGEN(){
+    return ML_KEM_KEYGEN(mlkem_thread_context());
+}
+
 /*************************************************
 * Name:        ML_KEM_ENCAPSULATION
 *
 * Description: High-level encapsulation API for ML-KEM.
 *              Takes public key and returns ciphertext and shared secret.
+*              The key must pass ML_KEM_check_encaps_key. m is drawn
+*              from the context's DRBG.
 *
-* Arguments:   - vector<ui8> &public_key: recipient's public key
+* Arguments:   - MLKEM_Context &ctx: context (optional)
+*              - vector<ui8> &public_key: recipient's public key
 *
 * Returns:     - pair of vectors: (shared secret K, ciphertext c)
 **************************************************/
-pair<vector<ui8>,vector<ui8>> ML_KEM_ENCAPSULATION(vector<ui8> &public_key){
-    vector<ui8> seed(64),m(32);
-    random_device rd;
-    mt19937 gen(rd());
-    uniform_int_distribution<> dis(0, 255);
-    for (int i = 0; i < 64; i++) {
-        seed[i] = dis(gen);
-    }
-    FIPS202_SHAKE128(seed.data(),32,m.data(),32);
-      if (m.empty()) {
-        cerr<<"RNG FAILED to process msg"<<endl;
-        return {}; 
+pair<vector<ui8>,vector<ui8>> ML_KEM_ENCAPSULATION(MLKEM_Context &ctx, vector<ui8> &public_key){
+    if (!mlkem_selftest_passed()) {
+        cerr<<"ML_KEM_ENCAPSULATION: self-test failed"<<endl;
+        return {};
+    }
+    MLKEM_ALLOC_SCOPE(MLKEM_OP_ENCAPS);
+    MetricsScope metrics(MLKEM_OP_ENCAPS, 1);
+    if (!ML_KEM_check_encaps_key(public_key)) {
+        cerr<<"Encapsulation key check failed"<<endl;
+        ctx.stats.rejected++;
+        metrics.reject();
+        return {};
     }
+    vector<ui8> m(32);
+    ctx.random(m.data(),32);
+    ctx.stats.encaps++;
     auto[K,c] = ML_KEM_Encaps_internal(public_key,m);
     return {K, c};
 }
 
+pair<vector<ui8>,vector<ui8>> ML_KEM_ENCAPSULATION(vector<ui8> &public_key){
+    return ML_KEM_ENCAPSULATION(mlkem_thread_context(),public_key);
+}
+
 /*************************************************
 * Name:        ML_KEM_DECAPSULATION
 *
 * Description: High-level decapsulation API for ML-KEM.
 *              Takes secret key and ciphertext, returns shared secret.
+*              The key must pass ML_KEM_check_decaps_key and the
+*              ciphertext must have the right length.
 *
-* Arguments:   - vector<ui8> &decaps: private key
+* Arguments:   - MLKEM_Context &ctx: context, for its stats (optional)
+*              - vector<ui8> &decaps: private key
 *              - vector<ui8> &c: ciphertext
 *
 * Returns:     - vector<ui8>: shared secret K
 **************************************************/
-vector<ui8> ML_KEM_DECAPSULATION(vector<ui8> &decaps, vector<ui8> &c){
+vector<ui8> ML_KEM_DECAPSULATION(MLKEM_Context &ctx, vector<ui8> &decaps, vector<ui8> &c){
+    if (!mlkem_selftest_passed()) {
+        cerr<<"ML_KEM_DECAPSULATION: self-test failed"<<endl;
+        return {};
+    }
+    MLKEM_ALLOC_SCOPE(MLKEM_OP_DECAPS);
+    MetricsScope metrics(MLKEM_OP_DECAPS, 1);
+    if (c.size() != 32*(Kyber_k*du+dv)) {
+        cerr<<"Decapsulation: malformed ciphertext"<<endl;
+        ctx.stats.rejected++;
+        metrics.reject();
+        return {};
+    }
+    if (!ML_KEM_check_decaps_key(decaps)) {
+        cerr<<"Decapsulation key check failed"<<endl;
+        ctx.stats.rejected++;
+        metrics.reject();
+        return {};
+    }
+    ctx.stats.decaps++;
     vector <ui8> K = ML_KEM_Decaps_internal(decaps,c);
     return K;
+}
+
+vector<ui8> ML_KEM_DECAPSULATION(vector<ui8> &decaps, vector<ui8> &c){
+    return ML_KEM_DECAPSULATION(mlkem_thread_context(),decaps,c);
+}
+
+/*************************************************
+* Name:        ML_KEM_ENCAPSULATION_BATCH
+*
+* Description: High-level batch encapsulation; checks every public key,
+*              draws a random message per key from the context's DRBG
+*              and runs the multi-buffer path.
+*
+* Arguments:   - MLKEM_Context &ctx: context (optional)
+*              - vector<vector<ui8>> &public_keys: recipients' public keys
+*
+* Returns:     - vector of pairs: (shared secret K, ciphertext c) per key
+**************************************************/
+vector<pair<vector<ui8>,vector<ui8>>> ML_KEM_ENCAPSULATION_BATCH(MLKEM_Context &ctx, vector<vector<ui8>> &public_keys){
+    if (!mlkem_selftest_passed()) {
+        cerr<<"ML_KEM_ENCAPSULATION_BATCH: self-test failed"<<endl;
+        return {};
+    }
+    MLKEM_ALLOC_SCOPE(MLKEM_OP_ENCAPS_BATCH);
+    MetricsScope metrics(MLKEM_OP_ENCAPS_BATCH, public_keys.size());
+    for (size_t i = 0; i < public_keys.size(); i++) {
+        if (!ML_KEM_check_encaps_key(public_keys[i])) {
+            cerr<<"Encaps batch: key check failed at index "<<i<<endl;
+            ctx.stats.rejected++;
+            metrics.reject();
+            return {};
+        }
+    }
+    vector<vector<ui8>> msgs(public_keys.size(), vector<ui8>(32));
+    for (auto &m : msgs) ctx.random(m.data(),32);
+    ctx.stats.encaps += public_keys.size();
+    return ML_KEM_Encaps_internal_batch(public_keys,msgs);
+}
+
+vector<pair<vector<ui8>,vector<ui8>>> ML_KEM_ENCAPSULATION_BATCH(vector<vector<ui8>> &public_keys){
+    return ML_KEM_ENCAPSULATION_BATCH(mlkem_thread_context(),public_keys);
+}
+
+/*************************************************
+* Name:        decaps_keys_check_batch
+*
+* Description: ML_KEM_check_decaps_key over many keys, hashing the
+*              embedded encapsulation keys with the multi-buffer
+*              SHA3-256.
+*
+* Arguments:   - vector<vector<ui8>> &decaps: decapsulation keys
+*
+* Returns:     - bool: true if every key is well formed
+**************************************************/
+static bool decaps_keys_check_batch(vector<vector<ui8>> &decaps){
+    size_t n = decaps.size();
+    for (size_t i = 0; i < n; i++) {
+        if (decaps[i].size() != 768*Kyber_k+96) {
+            cerr<<"Decaps batch: malformed key at index "<<i<<endl;
+            return false;
+        }
+    }
+    vector<ui8> h(32*n);
+    vector<ui8*> in(n), out(n);
+    for (size_t i = 0; i < n; i++) {
+        in[i] = decaps[i].data()+384*Kyber_k;
+        out[i] = h.data()+32*i;
+    }
+    FIPS202_SHA3_256_batch(n,in.data(),384*Kyber_k+32,out.data());
+    for (size_t i = 0; i < n; i++) {
+        ui8 diff = 0;
+        for (int j = 0; j < 32; j++) diff |= h[32*i+j] ^ decaps[i][768*Kyber_k+32+j];
+        if (diff != 0) {
+            cerr<<"Decaps batch: key check failed at index "<<i<<endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*************************************************
+* Name:        ML_KEM_DECAPSULATION_BATCH
+*
+* Description: High-level batch decapsulation. The H(ek) of every key
+*              is recomputed with the multi-buffer SHA3-256 and compared
+*              with the stored h before any ciphertext is processed.
+*
+* Arguments:   - MLKEM_Context &ctx: context, for its stats (optional)
+*              - vector<vector<ui8>> &decaps: private keys
+*              - vector<vector<ui8>> &c: one ciphertext per key
+*
+* Returns:     - vector<vector<ui8>>: shared secret per ciphertext
+**************************************************/
+vector<vector<ui8>> ML_KEM_DECAPSULATION_BATCH(MLKEM_Context &ctx, vector<vector<ui8>> &decaps, vector<vector<ui8>> &c){
+    if (!mlkem_selftest_passed()) {
+        cerr<<"ML_KEM_DECAPSULATION_BATCH: self-test failed"<<endl;
+        return {};
+    }
+    MLKEM_ALLOC_SCOPE(MLKEM_OP_DECAPS_BATCH);
+    MetricsScope metrics(MLKEM_OP_DECAPS_BATCH, 0);
+    if (!decaps_keys_check_batch(decaps)) {
+        ctx.stats.rejected++;
+        metrics.reject();
+        return {};
+    }
+    vector<vector<ui8>> K = ML_KEM_Decaps_internal_batch(decaps,c);
+    if (K.empty() && !c.empty()) {
+        ctx.stats.rejected++;
+        metrics.reject();
+    }
+    ctx.stats.decaps += K.size();
+    metrics.items = K.size();
+    return K;
+}
+
+vector<vector<ui8>> ML_KEM_DECAPSULATION_BATCH(vector<vector<ui8>> &decaps, vector<vector<ui8>> &c){
+    return ML_KEM_DECAPSULATION_BATCH(mlkem_thread_context(),decaps,c);
 }
\ No newline at end of file
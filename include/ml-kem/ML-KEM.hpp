@@ -2,8 +2,39 @@
 
 #include "K_PKE.hpp"
 
+// Each call optionally takes the MLKEM_Context (context.hpp) whose DRBG
+// and stats it uses; without one it uses the calling thread's context.
+class MLKEM_Context;
+
 pair<vector<ui8>,vector<ui8>> ML_KEM_KEYGEN();
+pair<vector<ui8>,vector<ui8>> ML_KEM_KEYGEN(MLKEM_Context &ctx);
 
 pair<vector<ui8>,vector<ui8>> ML_KEM_ENCAPSULATION(vector<ui8> &public_key); 
+pair<vector<ui8>,vector<ui8>> ML_KEM_ENCAPSULATION(MLKEM_Context &ctx, vector<ui8> &public_key);
+
+vector<ui8> ML_KEM_DECAPSULATION(vector<ui8> &decaps, vector<ui8> &c);
+vector<ui8> ML_KEM_DECAPSULATION(MLKEM_Context &ctx, vector<ui8> &decaps, vector<ui8> &c);
+
+vector<pair<vector<ui8>,vector<ui8>>> ML_KEM_ENCAPSULATION_BATCH(vector<vector<ui8>> &public_keys);
+vector<pair<vector<ui8>,vector<ui8>>> ML_KEM_ENCAPSULATION_BATCH(MLKEM_Context &ctx, vector<vector<ui8>> &public_keys);
+
+vector<vector<ui8>> ML_KEM_DECAPSULATION_BATCH(vector<vector<ui8>> &decaps, vector<vector<ui8>> &c);
+vector<vector<ui8>> ML_KEM_DECAPSULATION_BATCH(MLKEM_Context &ctx, vector<vector<ui8>> &decaps, vector<vector<ui8>> &c);
+
+// FIPS 203 input checks (sections 7.2 and 7.3), run by the public
+// encapsulation and decapsulation calls above; the _internal functions
+// below do not check their inputs.
+bool ML_KEM_check_encaps_key(vector<ui8> &public_key);
+
+bool ML_KEM_check_decaps_key(vector<ui8> &decaps);
+
+// Derandomized internals (FIPS 203 section 6)
+pair<vector<ui8>,vector<ui8>> ML_KEM_KeyGen_internal(vector<ui8> &seed,vector<ui8> &z);
+
+pair<vector<ui8>,vector<ui8>> ML_KEM_Encaps_internal(vector<ui8> &public_key ,vector<ui8> &msg);
+
+vector<ui8> ML_KEM_Decaps_internal(vector<ui8> &decaps, vector<ui8> &c);
+
+vector<pair<vector<ui8>,vector<ui8>>> ML_KEM_Encaps_internal_batch(vector<vector<ui8>> &public_keys, vector<vector<ui8>> &msgs);
 
-vector<ui8> ML_KEM_DECAPSULATION(vector<ui8> &decaps, vector<ui8> &c);
\ No newline at end of file
+vector<vector<ui8>> ML_KEM_Decaps_internal_batch(vector<vector<ui8>> &decaps, vector<vector<ui8>> &c);
\ No newline at end of file
@@ -0,0 +1,163 @@
+// alloc_track.cpp
+//
+// With MLKEM_TRACK_ALLOC defined this file replaces the global operator
+// new/delete with versions that count allocations per thread. Without it
+// only the query functions are built and they report zeros.
+#include "alloc_track.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+struct thread_alloc_counters{
+    u64 allocations;
+    u64 bytes;
+    long long live;
+    long long peak;
+};
+
+static thread_local thread_alloc_counters counters;
+static thread_local mlkem_alloc_stats last_stats[MLKEM_OP_COUNT];
+static thread_local mlkem_alloc_stats total_stats[MLKEM_OP_COUNT];
+
+#ifdef MLKEM_TRACK_ALLOC
+
+// Every block carries a header in front of the returned pointer that
+// holds its size; aligned blocks use a header as large as the alignment.
+static const size_t header_bytes = 16;
+
+static void *tracked_alloc(size_t size, size_t align) {
+    size_t header = align > header_bytes ? align : header_bytes;
+    void *base = align > header_bytes ? aligned_alloc(align, (size + header + align - 1) / align * align)
+                                      : malloc(size + header);
+    if (base == nullptr) return nullptr;
+    ui8 *p = (ui8 *)base + header;
+    memcpy(p - sizeof(size_t), &size, sizeof(size_t));
+
+    counters.allocations++;
+    counters.bytes += size;
+    counters.live += size;
+    if (counters.live > counters.peak) counters.peak = counters.live;
+    return p;
+}
+
+static void tracked_free(void *ptr, size_t align) {
+    if (ptr == nullptr) return;
+    size_t header = align > header_bytes ? align : header_bytes;
+    size_t size;
+    memcpy(&size, (ui8 *)ptr - sizeof(size_t), sizeof(size_t));
+    // blocks freed on another thread are credited to the freeing thread
+    counters.live -= size;
+    free((ui8 *)ptr - header);
+}
+
+static void *tracked_new(size_t size, size_t align) {
+    void *p = tracked_alloc(size ? size : 1, align);
+    if (p == nullptr) throw bad_alloc();
+    return p;
+}
+
+void *operator new(size_t size) { return tracked_new(size, 0); }
+void *operator new[](size_t size) { return tracked_new(size, 0); }
+void *operator new(size_t size, const nothrow_t &) noexcept { return tracked_alloc(size ? size : 1, 0); }
+void *operator new[](size_t size, const nothrow_t &) noexcept { return tracked_alloc(size ? size : 1, 0); }
+void *operator new(size_t size, align_val_t al) { return tracked_new(size, (size_t)al); }
+void *operator new[](size_t size, align_val_t al) { return tracked_new(size, (size_t)al); }
+
+void operator delete(void *p) noexcept { tracked_free(p, 0); }
+void operator delete[](void *p) noexcept { tracked_free(p, 0); }
+void operator delete(void *p, size_t) noexcept { tracked_free(p, 0); }
+void operator delete[](void *p, size_t) noexcept { tracked_free(p, 0); }
+void operator delete(void *p, const nothrow_t &) noexcept { tracked_free(p, 0); }
+void operator delete[](void *p, const nothrow_t &) noexcept { tracked_free(p, 0); }
+void operator delete(void *p, align_val_t al) noexcept { tracked_free(p, (size_t)al); }
+void operator delete[](void *p, align_val_t al) noexcept { tracked_free(p, (size_t)al); }
+void operator delete(void *p, size_t, align_val_t al) noexcept { tracked_free(p, (size_t)al); }
+void operator delete[](void *p, size_t, align_val_t al) noexcept { tracked_free(p, (size_t)al); }
+
+/*************************************************
+* Name:        AllocScope::AllocScope
+*
+* Description: Opens an allocation scope for one public API call on the
+*              calling thread. Scopes may nest; the thread peak is
+*              restarted from the current live bytes and restored on exit.
+*
+* Arguments:   - mlkem_op op: API call being measured
+**************************************************/
+AllocScope::AllocScope(mlkem_op op) : op(op) {
+    allocs0 = counters.allocations;
+    bytes0 = counters.bytes;
+    live0 = counters.live;
+    outer_peak = counters.peak;
+    counters.peak = counters.live;
+}
+
+/*************************************************
+* Name:        AllocScope::~AllocScope
+*
+* Description: Closes the scope and records its allocation count, bytes
+*              and peak live bytes as the last and cumulative figures
+*              for the operation.
+**************************************************/
+AllocScope::~AllocScope() {
+    mlkem_alloc_stats s;
+    s.calls = 1;
+    s.allocations = counters.allocations - allocs0;
+    s.bytes = counters.bytes - bytes0;
+    s.peak_live_bytes = counters.peak > live0 ? counters.peak - live0 : 0;
+    if (outer_peak > counters.peak) counters.peak = outer_peak;
+
+    last_stats[op] = s;
+    mlkem_alloc_stats &t = total_stats[op];
+    t.calls++;
+    t.allocations += s.allocations;
+    t.bytes += s.bytes;
+    if (s.peak_live_bytes > t.peak_live_bytes) t.peak_live_bytes = s.peak_live_bytes;
+}
+
+bool mlkem_alloc_tracking_enabled() { return true; }
+
+#else
+
+bool mlkem_alloc_tracking_enabled() { return false; }
+
+#endif
+
+/*************************************************
+* Name:        mlkem_op_name
+*
+* Description: Printable name of a public API call.
+*
+* Arguments:   - mlkem_op op: operation
+*
+* Returns:     - const char*: name
+**************************************************/
+const char *mlkem_op_name(mlkem_op op) {
+    static const char *names[MLKEM_OP_COUNT] = {
+        "keygen", "encaps", "decaps", "encaps_batch", "decaps_batch",
+        "decaps_many"
+    };
+    return op < MLKEM_OP_COUNT ? names[op] : "unknown";
+}
+
+mlkem_alloc_stats mlkem_alloc_last(mlkem_op op) {
+    return last_stats[op];
+}
+
+mlkem_alloc_stats mlkem_alloc_total(mlkem_op op) {
+    return total_stats[op];
+}
+
+void mlkem_alloc_reset() {
+    memset(last_stats, 0, sizeof(last_stats));
+    memset(total_stats, 0, sizeof(total_stats));
+}
+
+mlkem_alloc_stats mlkem_alloc_thread() {
+    mlkem_alloc_stats s;
+    s.calls = 0;
+    s.allocations = counters.allocations;
+    s.bytes = counters.bytes;
+    s.peak_live_bytes = counters.peak > 0 ? counters.peak : 0;
+    return s;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "param.hpp"
+
+// Public API calls that open an allocation scope.
+typedef enum{
+    MLKEM_OP_KEYGEN,
+    MLKEM_OP_ENCAPS,
+    MLKEM_OP_DECAPS,
+    MLKEM_OP_ENCAPS_BATCH,
+    MLKEM_OP_DECAPS_BATCH,
+    MLKEM_OP_DECAPS_MANY,
+    MLKEM_OP_COUNT
+} mlkem_op;
+
+typedef struct{
+    u64 calls;
+    u64 allocations;
+    u64 bytes;
+    u64 peak_live_bytes;
+} mlkem_alloc_stats;
+
+bool mlkem_alloc_tracking_enabled();
+
+const char *mlkem_op_name(mlkem_op op);
+
+// Per-thread figures: the last call of op, and all calls since the last
+// reset (peak is the maximum over those calls).
+mlkem_alloc_stats mlkem_alloc_last(mlkem_op op);
+mlkem_alloc_stats mlkem_alloc_total(mlkem_op op);
+void mlkem_alloc_reset();
+
+// Running totals of the calling thread (calls is always 0; peak is the
+// thread's peak live bytes).
+mlkem_alloc_stats mlkem_alloc_thread();
+
+#ifdef MLKEM_TRACK_ALLOC
+class AllocScope{
+public:
+    explicit AllocScope(mlkem_op op);
+    ~AllocScope();
+private:
+    mlkem_op op;
+    u64 allocs0, bytes0;
+    long long live0, outer_peak;
+};
+#define MLKEM_ALLOC_SCOPE(op) AllocScope mlkem_alloc_scope_(op)
+#else
+#define MLKEM_ALLOC_SCOPE(op) ((void)0)
+#endif
@@ -0,0 +1,317 @@
+// async.cpp
+//
+// One aggregator thread owns the queues: one for encapsulations, one for
+// decapsulations with serialized keys and one per expanded key. It sleeps
+// until a queue fills or the oldest deadline passes, takes every batch
+// that is ready, and hands them to the executor, one batch per task. Once
+// the executor is done with them, it passes each coroutine to its Resumer
+// or to the resume threads, so no coroutine continues inside a task.
+#include "async.hpp"
+
+#include <cstring>
+
+namespace mlkem {
+
+typedef std::chrono::steady_clock Clock;
+
+EncapsAwaitable::EncapsAwaitable(Aggregator &agg, vector<ui8> ek, Resumer on) : agg(agg) {
+    req.kind = AsyncRequest::ENCAPS;
+    req.in = std::move(ek);
+    req.resume_on = std::move(on);
+}
+
+void EncapsAwaitable::await_suspend(std::coroutine_handle<> h) {
+    req.handle = h;
+    agg.submit(&req);   // the request may complete before this returns
+}
+
+DecapsAwaitable::DecapsAwaitable(Aggregator &agg, const vector<ui8> &dk, vector<ui8> c, Resumer on) : agg(agg) {
+    req.kind = AsyncRequest::DECAPS;
+    req.in = std::move(c);
+    req.dk = &dk;
+    req.resume_on = std::move(on);
+}
+
+DecapsAwaitable::DecapsAwaitable(Aggregator &agg, const mlkem_expanded_dk &key, vector<ui8> c, Resumer on)
+    : agg(agg) {
+    req.kind = AsyncRequest::DECAPS_EXPANDED;
+    req.in = std::move(c);
+    req.key = &key;
+    req.resume_on = std::move(on);
+}
+
+void DecapsAwaitable::await_suspend(std::coroutine_handle<> h) {
+    req.handle = h;
+    agg.submit(&req);
+}
+
+/*************************************************
+* Name:        Aggregator::Aggregator
+*
+* Description: Starts the aggregator thread and the resume threads.
+*
+* Arguments:   - const AggregatorConfig &cfg: batch size, deadline,
+*                executor and resume threads
+**************************************************/
+Aggregator::Aggregator(const AggregatorConfig &cfg)
+    : cfg(cfg), ex(cfg.executor ? *cfg.executor : default_executor()), stopping(false), resuming(0),
+      resume_stopping(false) {
+    if (this->cfg.max_batch == 0) this->cfg.max_batch = 1;
+    if (this->cfg.resume_threads == 0) this->cfg.resume_threads = 1;
+    memset(&counts, 0, sizeof(counts));
+    for (unsigned i = 0; i < this->cfg.resume_threads; i++) resumers.emplace_back([this]{ resume_loop(); });
+    th = thread([this]{ loop(); });
+}
+
+Aggregator::~Aggregator() {
+    {
+        lock_guard<mutex> lk(m);
+        stopping = true;
+    }
+    cv.notify_all();
+    th.join();
+    {
+        lock_guard<mutex> lk(resume_m);
+        resume_stopping = true;
+    }
+    resume_cv.notify_all();
+    for (thread &t : resumers) t.join();
+}
+
+EncapsAwaitable Aggregator::encaps(vector<ui8> ek, Resumer on) {
+    return EncapsAwaitable(*this, std::move(ek), std::move(on));
+}
+
+DecapsAwaitable Aggregator::decaps(const vector<ui8> &dk, vector<ui8> c, Resumer on) {
+    return DecapsAwaitable(*this, dk, std::move(c), std::move(on));
+}
+
+DecapsAwaitable Aggregator::decaps(const mlkem_expanded_dk &key, vector<ui8> c, Resumer on) {
+    return DecapsAwaitable(*this, key, std::move(c), std::move(on));
+}
+
+AggregatorStats Aggregator::stats() const {
+    lock_guard<mutex> lk(m);
+    return counts;
+}
+
+Aggregator::Queue &Aggregator::queue_for(const AsyncRequest *r) {
+    const void *key = r->kind == AsyncRequest::DECAPS_EXPANDED ? (const void *)r->key : nullptr;
+    for (Queue &q : queues)
+        if (q.kind == r->kind && q.key == key) return q;
+    queues.push_back({r->kind, key, {}});
+    return queues.back();
+}
+
+/*************************************************
+* Name:        Aggregator::submit
+*
+* Description: Queues a suspended request. The aggregator thread is woken
+*              when the queue fills or gets its first request (and so a
+*              new deadline).
+*
+* Arguments:   - AsyncRequest *r: request, valid until it is resumed
+**************************************************/
+void Aggregator::submit(AsyncRequest *r) {
+    bool wake;
+    {
+        lock_guard<mutex> lk(m);
+        r->queued = Clock::now();
+        Queue &q = queue_for(r);
+        q.pending.push_back(r);
+        counts.requests++;
+        wake = q.pending.size() == 1 || q.pending.size() >= cfg.max_batch;
+    }
+    if (wake) cv.notify_one();
+}
+
+/*************************************************
+* Name:        Aggregator::take_ready
+*
+* Description: Moves every full batch, and every partial batch whose
+*              oldest request is past its deadline (all of them when
+*              stopping), out of the queues. Called with the lock held.
+*
+* Arguments:   - vector<Batch> &out: batches taken
+*              - time_point now: current time
+*              - time_point &next: earliest deadline still pending
+*
+* Returns:     - bool: true if any batch was taken
+**************************************************/
+bool Aggregator::take_ready(vector<Batch> &out, Clock::time_point now, Clock::time_point &next) {
+    for (Queue &q : queues) {
+        while (q.pending.size() >= cfg.max_batch) {
+            out.push_back({q.kind, vector<AsyncRequest *>(q.pending.begin(), q.pending.begin() + cfg.max_batch)});
+            q.pending.erase(q.pending.begin(), q.pending.begin() + cfg.max_batch);
+            counts.full_flushes++;
+        }
+        if (q.pending.empty()) continue;
+        Clock::time_point deadline = q.pending[0]->queued + cfg.max_delay;
+        if (stopping || deadline <= now) {
+            out.push_back({q.kind, std::move(q.pending)});
+            q.pending.clear();
+            counts.deadline_flushes++;
+        } else {
+            next = min(next, deadline);
+        }
+    }
+    // per-key queues come and go with the keys in use
+    for (size_t i = queues.size(); i-- > 0; )
+        if (queues[i].kind == AsyncRequest::DECAPS_EXPANDED && queues[i].pending.empty())
+            queues.erase(queues.begin() + i);
+    counts.batches += out.size();
+    return !out.empty();
+}
+
+/*************************************************
+* Name:        Aggregator::run
+*
+* Description: Runs one batch through the matching batch call and stores
+*              the results in the requests. If the batch call refuses the
+*              batch (one bad key), its requests are redone one by one so
+*              only the bad ones fail.
+*
+* Arguments:   - Batch &b: requests of one kind (and one expanded key)
+*              - MLKEM_Context &ctx: the executor worker's context
+**************************************************/
+void Aggregator::run(Batch &b, MLKEM_Context &ctx) {
+    size_t n = b.items.size();
+    vector<vector<ui8>> in(n);
+    for (size_t i = 0; i < n; i++) in[i] = std::move(b.items[i]->in);
+
+    size_t retried = 0;
+    if (b.kind == AsyncRequest::ENCAPS) {
+        vector<pair<vector<ui8>,vector<ui8>>> out = ML_KEM_ENCAPSULATION_BATCH(ctx, in);
+        if (out.size() != n) {
+            out.clear();
+            for (size_t i = 0; i < n; i++) out.push_back(ML_KEM_ENCAPSULATION(ctx, in[i]));
+            retried = n;
+        }
+        for (size_t i = 0; i < n; i++) {
+            b.items[i]->K = std::move(out[i].first);
+            b.items[i]->c = std::move(out[i].second);
+        }
+    } else if (b.kind == AsyncRequest::DECAPS) {
+        vector<vector<ui8>> dks(n);
+        for (size_t i = 0; i < n; i++) dks[i] = *b.items[i]->dk;
+        vector<vector<ui8>> out = ML_KEM_DECAPSULATION_BATCH(ctx, dks, in);
+        if (out.size() != n) {
+            out.clear();
+            for (size_t i = 0; i < n; i++) out.push_back(ML_KEM_DECAPSULATION(ctx, dks[i], in[i]));
+            retried = n;
+        }
+        for (size_t i = 0; i < n; i++) b.items[i]->K = std::move(out[i]);
+    } else {
+        vector<vector<ui8>> out = ML_KEM_decaps_many(*b.items[0]->key, in);
+        for (size_t i = 0; i < n && out.size() == n; i++) b.items[i]->K = std::move(out[i]);
+    }
+
+    if (retried) {
+        lock_guard<mutex> lk(m);
+        counts.retried += retried;
+    }
+}
+
+/*************************************************
+* Name:        Aggregator::finish
+*
+* Description: Hands the coroutines of a finished batch to their Resumer,
+*              or to the resume threads. A request is not touched after
+*              its handle is passed on, since it lives in the coroutine's
+*              frame.
+*
+* Arguments:   - Batch &b: batch whose results are stored
+**************************************************/
+void Aggregator::finish(Batch &b) {
+    size_t queued = 0;
+    for (AsyncRequest *r : b.items) {
+        std::coroutine_handle<> h = r->handle;
+        Resumer on = std::move(r->resume_on);
+        if (on) {
+            on(h);
+        } else {
+            lock_guard<mutex> lk(resume_m);
+            resumable.push_back(h);
+            resuming++;
+            queued++;
+        }
+    }
+    if (queued == 1) resume_cv.notify_one();
+    else if (queued > 1) resume_cv.notify_all();
+}
+
+/*************************************************
+* Name:        Aggregator::loop
+*
+* Description: The aggregator thread: waits for a full queue or the next
+*              deadline, runs the ready batches across the executor, waits
+*              for them and passes their coroutines on to be resumed. On
+*              shutdown it flushes what is queued, including requests
+*              made by coroutines the resume threads are still running.
+**************************************************/
+void Aggregator::loop() {
+    unique_lock<mutex> lk(m);
+    for (;;) {
+        vector<Batch> ready;
+        Clock::time_point next = Clock::time_point::max();
+        if (!take_ready(ready, Clock::now(), next)) {
+            if (stopping) {
+                // a coroutine still being resumed may submit again
+                unique_lock<mutex> rl(resume_m);
+                if (resuming == 0) break;
+                rl.unlock();
+                cv.wait_for(lk, std::chrono::milliseconds(1));
+                continue;
+            }
+            if (next == Clock::time_point::max()) cv.wait(lk);
+            else cv.wait_until(lk, next);
+            continue;
+        }
+        lk.unlock();
+        ex.parallel_for(ready.size(), 1, [&](ExecutorWorker &w, size_t b, size_t e){
+            for (size_t i = b; i < e; i++) run(ready[i], w);
+        });
+        for (Batch &b : ready) finish(b);
+        lk.lock();
+    }
+}
+
+/*************************************************
+* Name:        Aggregator::resume_loop
+*
+* Description: A resume thread: resumes finished coroutines that were
+*              submitted without a Resumer, each until its next
+*              suspension point. On shutdown it drains what is left.
+**************************************************/
+void Aggregator::resume_loop() {
+    unique_lock<mutex> lk(resume_m);
+    for (;;) {
+        resume_cv.wait(lk, [this]{ return resume_stopping || !resumable.empty(); });
+        if (resumable.empty()) return;
+        std::coroutine_handle<> h = resumable.front();
+        resumable.pop_front();
+        lk.unlock();
+        h.resume();
+        lk.lock();
+        resuming--;
+    }
+}
+
+Aggregator &default_aggregator() {
+    static Aggregator agg;
+    return agg;
+}
+
+EncapsAwaitable async_encaps(vector<ui8> ek, Resumer on) {
+    return default_aggregator().encaps(std::move(ek), std::move(on));
+}
+
+DecapsAwaitable async_decaps(const vector<ui8> &dk, vector<ui8> c, Resumer on) {
+    return default_aggregator().decaps(dk, std::move(c), std::move(on));
+}
+
+DecapsAwaitable async_decaps(const mlkem_expanded_dk &key, vector<ui8> c, Resumer on) {
+    return default_aggregator().decaps(key, std::move(c), std::move(on));
+}
+
+}
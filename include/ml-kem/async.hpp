@@ -0,0 +1,157 @@
+#pragma once
+
+// C++20 coroutine API (libmlkem_async; the rest of the library is C++17).
+//
+//     auto [K, c] = co_await mlkem::async_encaps(ek);
+//     vector<ui8> K = co_await mlkem::async_decaps(key, c);
+//
+// Each call suspends the coroutine and queues the request with an
+// Aggregator. The aggregator thread collects concurrent requests from any
+// number of coroutines into batches: encapsulations for any keys run
+// through ML_KEM_ENCAPSULATION_BATCH, decapsulations under different keys
+// through ML_KEM_DECAPSULATION_BATCH, and decapsulations under one
+// expanded key through ML_KEM_decaps_many. A batch is flushed when it
+// holds max_batch requests or when its oldest request has waited
+// max_delay, and the batches of one flush run across the executor.
+// Results are the single-call results: a request with a bad key or
+// ciphertext gets an empty result and does not fail its batch.
+//
+// A finished request resumes its coroutine through the Resumer it was
+// submitted with, so the caller continues on its own executor; without
+// one it resumes on one of the aggregator's resume threads. Either way the
+// coroutine never continues inside an executor task, so it may call the
+// parallel_* helpers, and a slow continuation does not hold up batching.
+// A Resumer is called from the aggregator thread and should only post the
+// handle somewhere.
+
+#include "decaps_many.hpp"
+#include "executor.hpp"
+
+#include <chrono>
+#include <coroutine>
+#include <functional>
+
+namespace mlkem {
+
+typedef std::function<void(std::coroutine_handle<>)> Resumer;
+
+struct AggregatorConfig{
+    size_t max_batch = 8;                           // the widest multi-buffer Keccak group
+    std::chrono::microseconds max_delay{200};       // longest wait for a batch to fill
+    Executor *executor = nullptr;                   // runs the batches; nullptr = default_executor()
+    unsigned resume_threads = 1;                    // resume coroutines submitted without a Resumer
+};
+
+struct AggregatorStats{
+    u64 requests;
+    u64 batches;
+    u64 full_flushes;       // batches flushed because they reached max_batch
+    u64 deadline_flushes;   // batches flushed by max_delay (or at shutdown)
+    u64 retried;            // requests redone one by one after their batch was refused
+};
+
+// A queued request; lives in the awaiting coroutine's frame.
+struct AsyncRequest{
+    enum Kind{ ENCAPS, DECAPS, DECAPS_EXPANDED } kind;
+    vector<ui8> in;                         // ek, or the ciphertext
+    const vector<ui8> *dk = nullptr;
+    const mlkem_expanded_dk *key = nullptr;
+    vector<ui8> K, c;
+    std::coroutine_handle<> handle;
+    Resumer resume_on;
+    std::chrono::steady_clock::time_point queued;
+};
+
+class Aggregator;
+
+class EncapsAwaitable{
+public:
+    EncapsAwaitable(Aggregator &agg, vector<ui8> ek, Resumer on);
+    EncapsAwaitable(const EncapsAwaitable &) = delete;
+    EncapsAwaitable &operator=(const EncapsAwaitable &) = delete;
+
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> h);
+    pair<vector<ui8>,vector<ui8>> await_resume() { return {std::move(req.K), std::move(req.c)}; }
+
+private:
+    Aggregator &agg;
+    AsyncRequest req;
+};
+
+class DecapsAwaitable{
+public:
+    DecapsAwaitable(Aggregator &agg, const vector<ui8> &dk, vector<ui8> c, Resumer on);
+    DecapsAwaitable(Aggregator &agg, const mlkem_expanded_dk &key, vector<ui8> c, Resumer on);
+    DecapsAwaitable(const DecapsAwaitable &) = delete;
+    DecapsAwaitable &operator=(const DecapsAwaitable &) = delete;
+
+    // a ciphertext of the wrong length completes at once, empty
+    bool await_ready() const { return req.in.size() != 32 * (Kyber_k * du + dv); }
+    void await_suspend(std::coroutine_handle<> h);
+    vector<ui8> await_resume() { return std::move(req.K); }
+
+private:
+    Aggregator &agg;
+    AsyncRequest req;
+};
+
+class Aggregator{
+public:
+    explicit Aggregator(const AggregatorConfig &cfg = AggregatorConfig());
+    ~Aggregator();      // runs what is still queued, then stops the threads
+    Aggregator(const Aggregator &) = delete;
+    Aggregator &operator=(const Aggregator &) = delete;
+
+    EncapsAwaitable encaps(vector<ui8> ek, Resumer on = {});
+    DecapsAwaitable decaps(const vector<ui8> &dk, vector<ui8> c, Resumer on = {});
+    DecapsAwaitable decaps(const mlkem_expanded_dk &key, vector<ui8> c, Resumer on = {});
+
+    void submit(AsyncRequest *r);
+    AggregatorStats stats() const;
+
+private:
+    struct Queue{
+        AsyncRequest::Kind kind;
+        const void *key;                    // the expanded key for DECAPS_EXPANDED
+        vector<AsyncRequest *> pending;
+    };
+    struct Batch{
+        AsyncRequest::Kind kind;
+        vector<AsyncRequest *> items;
+    };
+
+    Queue &queue_for(const AsyncRequest *r);
+    bool take_ready(vector<Batch> &out, std::chrono::steady_clock::time_point now,
+                    std::chrono::steady_clock::time_point &next);
+    void run(Batch &b, MLKEM_Context &ctx);
+    void finish(Batch &b);
+    void loop();
+    void resume_loop();
+
+    AggregatorConfig cfg;
+    Executor &ex;
+    mutable mutex m;
+    condition_variable cv;
+    vector<Queue> queues;
+    AggregatorStats counts;
+    bool stopping;
+    thread th;
+
+    mutex resume_m;
+    condition_variable resume_cv;
+    deque<std::coroutine_handle<>> resumable;
+    size_t resuming;        // handed to the resume threads, not yet suspended again
+    bool resume_stopping;
+    vector<thread> resumers;
+};
+
+// Process-wide aggregator behind the free functions, with the default
+// configuration.
+Aggregator &default_aggregator();
+
+EncapsAwaitable async_encaps(vector<ui8> ek, Resumer on = {});
+DecapsAwaitable async_decaps(const vector<ui8> &dk, vector<ui8> c, Resumer on = {});
+DecapsAwaitable async_decaps(const mlkem_expanded_dk &key, vector<ui8> c, Resumer on = {});
+
+}
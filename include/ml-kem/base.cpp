@@ -1,5 +1,7 @@
 // base.cpp
 #include "ml-kem/base.hpp"
+#include "ml-kem/dispatch.hpp"
+#include "ml-kem/trace.hpp"
 #include <cmath>
 
 /*************************************************
@@ -56,16 +58,10 @@ vector<bool> ByteToBit( vector<ui8> &a) {
 * Returns:     - vector<ui8>: encoded byte array
 **************************************************/
 vector<ui8> ByteEncode(vector<i16> &f, int d) {
-    vector<bool> b(256 * d, 0);
-    for (int i = 0; i < 256; i++) {
-        i16 a = f[i];
-        if (a < 0) a += Kyber_Q;
-        for (int j = 0; j < d; j++) {
-            b[i * d + j] = a % 2;
-            a /= 2;
-        }
-    }
-    return BitToByte(b);
+    MLKEM_TRACE_SCOPE("ByteEncode");
+    vector<ui8> b(32 * d);
+    mlkem_dispatch().byte_encode(b.data(), f.data(), d);
+    return b;
 }
 
 /*************************************************
@@ -81,17 +77,16 @@ vector<ui8> ByteEncode(vector<i16> &f, int d) {
 * Returns:     - vector<i16>: decoded polynomial in Z_m^256
 **************************************************/
 vector<i16> ByteDecode(vector<ui8> &b, int d) {
-    vector<bool> bit = ByteToBit(b);
-    if (bit.size() != 256 * d) bit.resize(256 * d, 0);
-
+    MLKEM_TRACE_SCOPE("ByteDecode");
     vector<i16> f(256, 0);
-    int m = (d < 12) ? (1 << d) : Kyber_Q;
-    for (int i = 0; i < 256; i++) {
-        for (int j = 0; j < d; j++) {
-            f[i] |= (bit[i * d + j] << j);
-        }
-        f[i] %= m;
+    if (b.size() != 32 * (size_t)d) {
+        // short inputs are zero-padded, long ones truncated
+        vector<ui8> padded(b);
+        padded.resize(32 * d, 0);
+        mlkem_dispatch().byte_decode(f.data(), padded.data(), d);
+        return f;
     }
+    mlkem_dispatch().byte_decode(f.data(), b.data(), d);
     return f;
 }
 
@@ -107,16 +102,18 @@ vector<i16> ByteDecode(vector<ui8> &b, int d) {
 * Returns:     - vector<i16>: compressed coefficients
 **************************************************/
 vector<i16> Compress(vector<i16>& a, int d) {
+    MLKEM_TRACE_SCOPE("Compress");
     int factor = 1 << d;  // 2^d
     vector<i16> result(a.size());
     for (int i = 0; i < a.size(); i++) {
         int x = a[i];
-        if (x < 0) x += Kyber_Q; // Ensure x ∈ [0, q)
-        
-        // Nearest integer: round((x * 2^d) / q)
-        int64_t scaled = static_cast<int64_t>(x) * factor;
-        int rounded = (scaled + Kyber_Q / 2) / Kyber_Q;
-        result[i] = rounded % factor;  // mod 2^d
+        x += (x >> 31) & Kyber_Q; // Ensure x ∈ [0, q) without a branch
+
+        // Nearest integer: round((x * 2^d) / q); the division by the
+        // constant q compiles to a multiplication
+        uint32_t scaled = (uint32_t)x << d;
+        uint32_t rounded = (scaled + Kyber_Q / 2) / Kyber_Q;
+        result[i] = rounded & (factor - 1);  // mod 2^d
     }
     return result;
 }
@@ -133,6 +130,7 @@ vector<i16> Compress(vector<i16>& a, int d) {
 * Returns:     - vector<i16>: decompressed coefficients in [0, Q)
 **************************************************/
 vector<i16> Decompress( vector<i16>& a, int d) {
+    MLKEM_TRACE_SCOPE("Decompress");
     int result_size = a.size();
     vector<i16> result(result_size);
     int shift = 1 << (d - 1);  // for rounding
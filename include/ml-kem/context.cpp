@@ -0,0 +1,142 @@
+#include "context.hpp"
+#include "metrics.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <random>
+
+#include <pthread.h>
+
+// bumped in the child of every fork(); a generator that sees a new value
+// has been copied into another process and must not continue its stream
+static atomic<ui> fork_epoch(0);
+
+static void on_fork_child(){
+    fork_epoch.fetch_add(1, memory_order_relaxed);
+}
+
+void mlkem_wipe(void *p, size_t n){
+    static void *(*const volatile wipe_memset)(void *, int, size_t) = memset;
+    if (n > 0) wipe_memset(p, 0, n);
+}
+
+/*************************************************
+* Name:        MLKEM_Drbg::seed
+*
+* Description: Seeds the generator with 256 bits from random_device, or
+*              with the given 32 bytes. Only the first form is reseeded
+*              after fork().
+*
+* Arguments:   - const ui8 *seed32: 32-byte seed (second form)
+**************************************************/
+void MLKEM_Drbg::seed(){
+    static const int registered = pthread_atfork(nullptr, nullptr, on_fork_child);
+    (void)registered;
+    fork_reseed = true;
+    fork_epoch = ::fork_epoch.load(memory_order_relaxed);
+    random_device rd;
+    for (int i = 0; i < 32; i += 4) {
+        ui v = rd();
+        memcpy(key + i, &v, 4);
+    }
+    counter = 0;
+    mlkem_wipe(buf, sizeof(buf));
+    pos = sizeof(buf);
+    mlkem_metrics_add(MLKEM_METRIC_RNG_SEEDS, 1);
+}
+
+void MLKEM_Drbg::seed(const ui8 *seed32){
+    memcpy(key, seed32, 32);
+    fork_reseed = false;
+    fork_epoch = 0;
+    counter = 0;
+    mlkem_wipe(buf, sizeof(buf));
+    pos = sizeof(buf);
+    mlkem_metrics_add(MLKEM_METRIC_RNG_SEEDS, 1);
+}
+
+/*************************************************
+* Name:        MLKEM_Drbg::generate
+*
+* Description: Produces n bytes; refills the buffer with
+*              SHAKE256(key || counter) when it runs dry, taking the first
+*              32 bytes as the next key (fast key erasure). Bytes are
+*              wiped from the buffer as they are copied out. Reseeds
+*              first if the process has forked since the last seed.
+*
+* Arguments:   - ui8 *out: output buffer
+*              - size_t n: number of bytes
+**************************************************/
+void MLKEM_Drbg::generate(ui8 *out, size_t n){
+    if (fork_reseed && fork_epoch != ::fork_epoch.load(memory_order_relaxed)) seed();
+    while (n > 0) {
+        if (pos == sizeof(buf)) {
+            for (int i = 0; i < 8; i++) key[32 + i] = (ui8)(counter >> (8 * i));
+            FIPS202_SHAKE256(key, sizeof(key), buf, sizeof(buf));
+            memcpy(key, buf, 32);
+            mlkem_wipe(buf, 32);
+            counter++;
+            pos = 32;
+        }
+        size_t take = min(n, sizeof(buf) - pos);
+        memcpy(out, buf + pos, take);
+        mlkem_wipe(buf + pos, take);
+        pos += take;
+        out += take;
+        n -= take;
+    }
+}
+
+/*************************************************
+* Name:        MLKEM_Context::MLKEM_Context
+*
+* Description: Creates a context whose DRBG is seeded from random_device,
+*              or deterministically from seed32 (tests, known answers).
+*
+* Arguments:   - const ui8 *seed32: 32-byte DRBG seed (second form)
+**************************************************/
+MLKEM_Context::MLKEM_Context() : stats(){
+    rng.seed();
+}
+
+MLKEM_Context::MLKEM_Context(const ui8 *seed32) : stats(){
+    rng.seed(seed32);
+}
+
+MLKEM_Drbg::~MLKEM_Drbg(){
+    mlkem_wipe(key, sizeof(key));
+    mlkem_wipe(buf, sizeof(buf));
+}
+
+MLKEM_Context::~MLKEM_Context(){
+    mlkem_wipe(scratch.data(), scratch.size());
+}
+
+void MLKEM_Context::random(ui8 *out, size_t n){
+    rng.generate(out, n);
+    stats.random_bytes += n;
+}
+
+ui8 *MLKEM_Context::scratch_bytes(size_t n){
+    if (scratch.size() < n) {
+        // a new arena rather than resize(), which would free the old one unwiped
+        vector<ui8> bigger(n);
+        mlkem_wipe(scratch.data(), scratch.size());
+        scratch.swap(bigger);
+    }
+    return scratch.data();
+}
+
+/*************************************************
+* Name:        mlkem_thread_context
+*
+* Description: The calling thread's default context, created (and its
+*              DRBG seeded) on first use and reused by every later call
+*              on that thread; its DRBG reseeds in a forked child.
+*
+* Returns:     - MLKEM_Context&: this thread's context
+**************************************************/
+MLKEM_Context &mlkem_thread_context(){
+    static thread_local MLKEM_Context ctx;
+    return ctx;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ML-KEM.hpp"
+
+// Zeroes n bytes in a way the compiler cannot drop as a dead store.
+void mlkem_wipe(void *p, size_t n);
+
+// SHAKE256-based generator: seeded with 256 bits, then expanded in 1 KiB
+// blocks of SHAKE256(key || counter). The first 32 bytes of every block
+// replace the key and bytes are wiped as they are handed out, so the state
+// never holds what it has already produced. A generator seeded from
+// random_device reseeds itself in the child after fork(), so parent and
+// children never share a stream; a fixed seed stays deterministic.
+struct MLKEM_Drbg{
+    ui8 key[40];
+    u64 counter;
+    ui8 buf[1024];
+    size_t pos;
+    bool fork_reseed;   // seeded from random_device
+    ui fork_epoch;      // fork count seen at seed time
+
+    void seed();                    // from random_device
+    void seed(const ui8 *seed32);   // fixed seed, for tests and KATs
+    void generate(ui8 *out, size_t n);
+
+    ~MLKEM_Drbg();
+};
+
+// Per-context counters; batch calls count every item.
+typedef struct{
+    u64 keygen;
+    u64 encaps;
+    u64 decaps;
+    u64 rejected;       // calls that failed an input check
+    u64 random_bytes;   // drawn from the DRBG
+} mlkem_context_stats;
+
+// State for one thread or one connection: the DRBG behind the randomized
+// API, a scratch arena reused across calls, and statistics. A context is
+// not locked; it may move between threads but must not be used by two
+// threads at once. The API overloads without a context use the calling
+// thread's mlkem_thread_context().
+class MLKEM_Context{
+public:
+    MLKEM_Context();
+    explicit MLKEM_Context(const ui8 *seed32);
+    ~MLKEM_Context();   // wipes the scratch arena
+
+    // n bytes from the DRBG
+    void random(ui8 *out, size_t n);
+
+    // scratch arena of at least n bytes; valid until the next call
+    ui8 *scratch_bytes(size_t n);
+
+    MLKEM_Drbg rng;
+    vector<ui8> scratch;
+    mlkem_context_stats stats;
+};
+
+MLKEM_Context &mlkem_thread_context();
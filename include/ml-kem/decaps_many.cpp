@@ -0,0 +1,247 @@
+#include "decaps_many.hpp"
+#include "hash_multi.hpp"
+#include "dispatch.hpp"
+#include "poly_bound.hpp"
+#include "trace.hpp"
+#include "alloc_track.hpp"
+#include "metrics.hpp"
+#include "context.hpp"
+#include "selftest.hpp"
+
+#include <cstring>
+
+static const size_t ct_len = 32 * (Kyber_k * du + dv);
+static const bool reduce_before_invntt = Kyber_k * 2 * Kyber_Q > INVNTT_MAX_INPUT;
+
+// Most ciphertexts handled per group: the widest multi-buffer Keccak.
+static const size_t max_group = 8;
+
+// acc = sum_j a[j] o b[j], each product in the Montgomery domain
+static void inner_product(i16 *acc, const i16 (*a)[Kyber_N], const i16 (*b)[Kyber_N]) {
+    const mlkem_backend &be = mlkem_dispatch();
+    i16 t[Kyber_N];
+    be.basemul(acc, a[0], b[0]);
+    for (int j = 1; j < Kyber_k; j++) {
+        be.basemul(t, a[j], b[j]);
+        for (int i = 0; i < Kyber_N; i++) acc[i] += t[i];
+    }
+    if (reduce_before_invntt) be.poly_reduce(acc);
+}
+
+/*************************************************
+* Name:        ML_KEM_expand_decaps_key
+*
+* Description: Checks the decapsulation key and precomputes the parts of
+*              decapsulation that only depend on it: s_hat and t_hat are
+*              decoded and the matrix A is sampled once.
+*
+* Arguments:   - mlkem_expanded_dk &out: expanded key
+*              - vector<ui8> &decaps: decapsulation key
+*
+* Returns:     - bool: false if the key fails ML_KEM_check_decaps_key
+**************************************************/
+bool ML_KEM_expand_decaps_key(mlkem_expanded_dk &out, vector<ui8> &decaps) {
+    if (!mlkem_selftest_passed()) {
+        cerr<<"ML_KEM_expand_decaps_key: self-test failed"<<endl;
+        return false;
+    }
+    MLKEM_TRACE_SCOPE("expand_decaps_key");
+    if (!ML_KEM_check_decaps_key(decaps)) return false;
+    const mlkem_backend &b = mlkem_dispatch();
+    const ui8 *ek = decaps.data() + 384 * Kyber_k;
+
+    for (int i = 0; i < Kyber_k; i++) {
+        b.byte_decode(out.s_hat[i], decaps.data() + 384 * i, 12);
+        b.byte_decode(out.t_hat[i], ek + 384 * i, 12);
+    }
+    vector<ui8> rho(ek + 384 * Kyber_k, ek + 384 * Kyber_k + 32);
+    for (int i = 0; i < Kyber_k; i++) {
+        for (int j = 0; j < Kyber_k; j++) {
+            vector<i16> a = NTT_sample(rho, (ui8)i, (ui8)j);
+            memcpy(out.A_hat[i][j], a.data(), sizeof(out.A_hat[i][j]));
+        }
+    }
+    memcpy(out.h, decaps.data() + 768 * Kyber_k + 32, 32);
+    memcpy(out.z, decaps.data() + 768 * Kyber_k + 64, 32);
+    return true;
+}
+
+/*************************************************
+* Name:        decrypt_expanded
+*
+* Description: K_PKE_Decrypt with the secret key already decoded.
+*
+* Arguments:   - ui8 *m: 32-byte output
+*              - const mlkem_expanded_dk &key: expanded key
+*              - const ui8 *c: ciphertext
+**************************************************/
+static void decrypt_expanded(ui8 *m, const mlkem_expanded_dk &key, const ui8 *c) {
+    const mlkem_backend &b = mlkem_dispatch();
+    i16 u_hat[Kyber_k][Kyber_N], acc[Kyber_N], v[Kyber_N];
+
+    for (int i = 0; i < Kyber_k; i++) b.decompress_ntt(u_hat[i], c + i * 32 * du, du);
+    inner_product(acc, key.s_hat, u_hat);
+
+    b.byte_decode(v, c + Kyber_k * 32 * du, dv);
+    for (int i = 0; i < Kyber_N; i++) v[i] = (v[i] * Kyber_Q + (1 << (dv - 1))) >> dv;
+    b.invntt_add_compress(m, acc, v, 1, 1);
+}
+
+/*************************************************
+* Name:        encrypt_expanded
+*
+* Description: K_PKE_Encrypt with A and t_hat taken from the expanded key
+*              and the y noise already squeezed by the caller.
+*
+* Arguments:   - ui8 *c: ciphertext output
+*              - const mlkem_expanded_dk &key: expanded key
+*              - const ui8 *m: 32-byte message
+*              - const ui8 (*prf)[64*eta1]: PRF_eta1(r, 0..k-1)
+**************************************************/
+static void encrypt_expanded(ui8 *c, const mlkem_expanded_dk &key, const ui8 *m, const ui8 (*prf)[64 * eta1]) {
+    const mlkem_backend &b = mlkem_dispatch();
+    i16 y_hat[Kyber_k][Kyber_N], acc[Kyber_N], e[Kyber_N], mu[Kyber_N];
+
+    for (int i = 0; i < Kyber_k; i++) {
+        b.cbd(y_hat[i], prf[i], eta1);
+        b.ntt(y_hat[i]);
+    }
+    // e1 and e2 come from the last y sample, as in K_PKE_Encrypt
+    b.cbd(e, prf[Kyber_k - 1], eta2);
+
+    for (int i = 0; i < Kyber_k; i++) {
+        inner_product(acc, key.A_hat[i], y_hat);
+        b.invntt_add_compress(c + i * 32 * du, acc, e, du, 0);
+    }
+
+    inner_product(acc, key.t_hat, y_hat);
+    b.byte_decode(mu, m, 1);
+    for (int i = 0; i < Kyber_N; i++) e[i] += mu[i] * ((Kyber_Q + 1) / 2);
+    b.invntt_add_compress(c + Kyber_k * 32 * du, acc, e, dv, 0);
+}
+
+/*************************************************
+* Name:        ML_KEM_decaps_many
+*
+* Description: Decapsulates many ciphertexts under one expanded key, a
+*              group of up to eight at a time. Per group, G(m' || h), the
+*              k PRF calls per ciphertext and J(z || c) each go through
+*              one multi-buffer Keccak batch; decryption and
+*              re-encryption reuse the key's A, s_hat and t_hat. Both
+*              candidate keys are always computed and the comparison does
+*              not exit early.
+*
+* Arguments:   - const mlkem_expanded_dk &key: expanded decapsulation key
+*              - vector<vector<ui8>> &c: ciphertexts
+*
+* Returns:     - vector<vector<ui8>>: shared secret per ciphertext, empty
+*                if any ciphertext is malformed
+**************************************************/
+vector<vector<ui8>> ML_KEM_decaps_many(const mlkem_expanded_dk &key, vector<vector<ui8>> &c) {
+    MLKEM_TRACE_SCOPE("ML_KEM_decaps_many");
+    size_t n = c.size();
+    for (size_t i = 0; i < n; i++) {
+        if (c[i].size() != ct_len) {
+            cerr<<"decaps_many: malformed ciphertext at index "<<i<<endl;
+            return {};
+        }
+    }
+
+    vector<vector<ui8>> result(n, vector<ui8>(32));
+    vector<ui8> j_in(max_group * (32 + ct_len)), c_dash(ct_len);
+    ui8 g_in[max_group][64], g_out[max_group][64], j_out[max_group][32];
+    ui8 prf_in[max_group * Kyber_k][33], prf_out[max_group * Kyber_k][64 * eta1];
+    ui8 *in[max_group * Kyber_k], *out[max_group * Kyber_k];
+    u64 rejects = 0;
+
+    for (size_t g0 = 0; g0 < n; g0 += max_group) {
+        size_t gn = min(max_group, n - g0);
+
+        // m' = Decrypt(c); (K', r') = G(m' || h)
+        for (size_t l = 0; l < gn; l++) {
+            decrypt_expanded(g_in[l], key, c[g0 + l].data());
+            memcpy(g_in[l] + 32, key.h, 32);
+            in[l] = g_in[l];
+            out[l] = g_out[l];
+        }
+        FIPS202_SHA3_512_batch(gn, in, 64, out);
+
+        // PRF_eta1(r', 0..k-1) for every ciphertext of the group
+        for (size_t l = 0; l < gn; l++) {
+            for (int i = 0; i < Kyber_k; i++) {
+                ui8 *p = prf_in[l * Kyber_k + i];
+                memcpy(p, g_out[l] + 32, 32);
+                p[32] = (ui8)i;
+                in[l * Kyber_k + i] = p;
+                out[l * Kyber_k + i] = prf_out[l * Kyber_k + i];
+            }
+        }
+        FIPS202_SHAKE256_batch(gn * Kyber_k, in, 33, out, 64 * eta1);
+
+        // K_bar = J(z || c)
+        for (size_t l = 0; l < gn; l++) {
+            ui8 *p = j_in.data() + l * (32 + ct_len);
+            memcpy(p, key.z, 32);
+            memcpy(p + 32, c[g0 + l].data(), ct_len);
+            in[l] = p;
+            out[l] = j_out[l];
+        }
+        FIPS202_SHAKE128_batch(gn, in, 32 + ct_len, out, 32);
+
+        for (size_t l = 0; l < gn; l++) {
+            const ui8 *ct = c[g0 + l].data();
+            encrypt_expanded(c_dash.data(), key, g_in[l], prf_out + l * Kyber_k);
+
+            ui8 diff = 0;
+            for (size_t j = 0; j < ct_len; j++) diff |= ct[j] ^ c_dash[j];
+            // mask = 0xFF when the re-encryption matched
+            ui8 mask = (ui8)(((unsigned)diff - 1) >> 8);
+            for (int j = 0; j < 32; j++)
+                result[g0 + l][j] = (g_out[l][j] & mask) | (j_out[l][j] & ~mask);
+            rejects += (ui8)~mask & 1;
+        }
+    }
+    mlkem_metrics_add(MLKEM_METRIC_IMPLICIT_REJECTS, rejects);
+    return result;
+}
+
+/*************************************************
+* Name:        ML_KEM_DECAPSULATION_MANY
+*
+* Description: Decapsulates a set of ciphertexts sent to one key: the key
+*              is checked and expanded once, then ML_KEM_decaps_many.
+*
+* Arguments:   - MLKEM_Context &ctx: context, for its stats (optional)
+*              - vector<ui8> &decaps: decapsulation key
+*              - vector<vector<ui8>> &c: ciphertexts
+*
+* Returns:     - vector<vector<ui8>>: shared secret per ciphertext, empty
+*                if the key fails its check or a ciphertext is malformed
+**************************************************/
+vector<vector<ui8>> ML_KEM_DECAPSULATION_MANY(MLKEM_Context &ctx, vector<ui8> &decaps, vector<vector<ui8>> &c) {
+    if (!mlkem_selftest_passed()) {
+        cerr<<"ML_KEM_DECAPSULATION_MANY: self-test failed"<<endl;
+        return {};
+    }
+    MLKEM_ALLOC_SCOPE(MLKEM_OP_DECAPS_MANY);
+    MetricsScope metrics(MLKEM_OP_DECAPS_MANY, 0);
+    mlkem_expanded_dk key;
+    if (!ML_KEM_expand_decaps_key(key, decaps)) {
+        cerr<<"decaps_many: decapsulation key check failed"<<endl;
+        ctx.stats.rejected++;
+        metrics.reject();
+        return {};
+    }
+    vector<vector<ui8>> K = ML_KEM_decaps_many(key, c);
+    if (K.empty() && !c.empty()) {
+        ctx.stats.rejected++;
+        metrics.reject();
+    }
+    ctx.stats.decaps += K.size();
+    metrics.items = K.size();
+    return K;
+}
+
+vector<vector<ui8>> ML_KEM_DECAPSULATION_MANY(vector<ui8> &decaps, vector<vector<ui8>> &c) {
+    return ML_KEM_DECAPSULATION_MANY(mlkem_thread_context(), decaps, c);
+}
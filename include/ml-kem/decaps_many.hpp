@@ -0,0 +1,27 @@
+#pragma once
+
+#include "ML-KEM.hpp"
+
+// A decapsulation key with everything that does not depend on the
+// ciphertext precomputed: s and t decoded, A sampled (in the orientation
+// K_PKE_Encrypt uses), h and z split out. Plain data, so it can be copied
+// or stored as is.
+typedef struct{
+    i16 s_hat[Kyber_k][Kyber_N];
+    i16 t_hat[Kyber_k][Kyber_N];
+    i16 A_hat[Kyber_k][Kyber_k][Kyber_N];
+    ui8 h[32];
+    ui8 z[32];
+} mlkem_expanded_dk;
+
+// Runs ML_KEM_check_decaps_key once; false if the key fails it.
+bool ML_KEM_expand_decaps_key(mlkem_expanded_dk &out, vector<ui8> &decaps);
+
+// ML_KEM_Decaps_internal for every ciphertext under one expanded key,
+// hashing a group of ciphertexts per multi-buffer Keccak call. Empty if a
+// ciphertext is malformed.
+vector<vector<ui8>> ML_KEM_decaps_many(const mlkem_expanded_dk &key, vector<vector<ui8>> &c);
+
+// Expands the key and runs ML_KEM_decaps_many; empty if either fails.
+vector<vector<ui8>> ML_KEM_DECAPSULATION_MANY(vector<ui8> &decaps, vector<vector<ui8>> &c);
+vector<vector<ui8>> ML_KEM_DECAPSULATION_MANY(MLKEM_Context &ctx, vector<ui8> &decaps, vector<vector<ui8>> &c);
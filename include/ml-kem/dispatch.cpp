@@ -0,0 +1,196 @@
+#include "dispatch.hpp"
+#include "kernels.hpp"
+#include "hash.hpp"
+#include "selftest.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#define MLKEM_BACKEND_ENTRY(ns, label, lanes) {                             \
+    label, ns::keccak_f1600, ns::keccak_f1600_x4, ns::keccak_f1600_x8,      \
+    lanes, ns::ntt, ns::invntt, ns::decompress_ntt,                         \
+    ns::invntt_add_compress, ns::basemul,                                   \
+    ns::poly_reduce, ns::poly_tomont, ns::rej_uniform, ns::cbd,             \
+    ns::byte_encode, ns::byte_decode, ns::byte_check12 }
+
+static const mlkem_backend backend_ref = MLKEM_BACKEND_ENTRY(mlkem_ref, "ref", 4);
+static const mlkem_backend backend_portable = {
+    "portable", mlkem_ref::keccak_f1600, mlkem_ref::keccak_f1600_x4, mlkem_ref::keccak_f1600_x8,
+    4, mlkem_portable::ntt, mlkem_portable::invntt, mlkem_portable::decompress_ntt,
+    mlkem_portable::invntt_add_compress, mlkem_portable::basemul,
+    mlkem_portable::poly_reduce, mlkem_portable::poly_tomont, mlkem_ref::rej_uniform, mlkem_portable::cbd,
+    mlkem_ref::byte_encode, mlkem_ref::byte_decode, mlkem_ref::byte_check12 };
+#ifdef MLKEM_HAVE_AVX2
+static const mlkem_backend backend_avx2 = MLKEM_BACKEND_ENTRY(mlkem_avx2, "avx2", 4);
+#endif
+#ifdef MLKEM_HAVE_AVX512
+static const mlkem_backend backend_avx512 = MLKEM_BACKEND_ENTRY(mlkem_avx512, "avx512", 8);
+#endif
+
+static atomic<const mlkem_backend *> active_backend(nullptr);
+
+/*************************************************
+* Name:        cpu_has_avx2 / cpu_has_avx512
+*
+* Description: CPUID feature checks (via the compiler's cpu model
+*              builtins, which also verify OS support for the wider
+*              register state).
+*
+* Returns:     - bool: true if the backend's instructions can run here
+**************************************************/
+static bool cpu_has_avx2() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2")
+        && __builtin_cpu_supports("popcnt");
+#else
+    return false;
+#endif
+}
+
+static bool cpu_has_avx512() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return cpu_has_avx2() && __builtin_cpu_supports("avx512f")
+        && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl");
+#else
+    return false;
+#endif
+}
+
+/*************************************************
+* Name:        usable_backends
+*
+* Description: Fills list with the backends compiled into this build that
+*              the running CPU supports, fastest first. The reference
+*              backend comes last, after the portable one when that is
+*              built on vector extensions; on SWAR words the portable
+*              kernels are slower than the reference ones compiled as
+*              plain scalar code and go after them. Needs no heap, so it
+*              is also used by the heap-free build.
+*
+* Arguments:   - const mlkem_backend *list[4]: output
+*
+* Returns:     - int: number of entries written
+**************************************************/
+static int usable_backends(const mlkem_backend *list[4]) {
+    int n = 0;
+#ifdef MLKEM_HAVE_AVX512
+    if (cpu_has_avx512()) list[n++] = &backend_avx512;
+#endif
+#ifdef MLKEM_HAVE_AVX2
+    if (cpu_has_avx2()) list[n++] = &backend_avx2;
+#endif
+#ifdef MLKEM_PORTABLE_VECTOR
+    list[n++] = &backend_portable;
+    list[n++] = &backend_ref;
+#else
+    list[n++] = &backend_ref;
+    list[n++] = &backend_portable;
+#endif
+    return n;
+}
+
+#ifndef MLKEM_NO_HEAP
+/*************************************************
+* Name:        mlkem_available_backends
+*
+* Description: Lists the usable backends, fastest first.
+*
+* Returns:     - vector<const mlkem_backend*>: usable backends
+**************************************************/
+vector<const mlkem_backend *> mlkem_available_backends() {
+    const mlkem_backend *list[4];
+    int n = usable_backends(list);
+    return vector<const mlkem_backend *>(list, list + n);
+}
+#endif
+
+/*************************************************
+* Name:        bind_backend
+*
+* Description: Makes b the active backend and points the Keccak sponge
+*              in simple_fips_202.c at its permutation.
+*
+* Arguments:   - const mlkem_backend *b: backend to activate
+*
+* Returns:     - const mlkem_backend*: b
+**************************************************/
+static const mlkem_backend *bind_backend(const mlkem_backend *b) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    KeccakF1600_permute = b->keccak_f1600;
+#endif
+    active_backend.store(b, memory_order_release);
+    return b;
+}
+
+/*************************************************
+* Name:        select_initial_backend
+*
+* Description: Picks the fastest usable backend, unless the MLKEM_BACKEND
+*              environment variable names another one (used by the tests
+*              to force each backend on the same machine).
+*
+* Returns:     - const mlkem_backend*: backend to bind at load
+**************************************************/
+static const mlkem_backend *select_initial_backend() {
+    const mlkem_backend *list[4];
+    int n = usable_backends(list);
+    const char *forced = getenv("MLKEM_BACKEND");
+    if (forced != nullptr && forced[0] != '\0') {
+        for (int i = 0; i < n; i++) {
+            if (strcmp(list[i]->name, forced) == 0) return list[i];
+        }
+        cerr << "MLKEM_BACKEND=" << forced << " is not available, using "
+             << list[0]->name << endl;
+    }
+    return list[0];
+}
+
+/*************************************************
+* Name:        mlkem_dispatch
+*
+* Description: Returns the active kernel table. The first call (made at
+*              library load, see bound_at_load below) runs the CPUID
+*              probe; later calls are a single atomic load.
+*
+* Returns:     - const mlkem_backend&: active backend
+**************************************************/
+const mlkem_backend &mlkem_dispatch() {
+    const mlkem_backend *b = active_backend.load(memory_order_acquire);
+    if (b == nullptr) {
+        static const mlkem_backend *initial = bind_backend(select_initial_backend());
+        b = initial;
+    }
+    return *b;
+}
+
+/*************************************************
+* Name:        mlkem_select_backend
+*
+* Description: Rebinds the kernels to the named backend and runs the
+*              self-test on it, so no kernel runs untested. If that fails,
+*              the gated KEM calls refuse to run until a backend that
+*              passes is selected. Meant for tests and tools; it must not
+*              race with operations in flight.
+*
+* Arguments:   - const char *name: "ref", "portable", "avx2", "avx512"
+*
+* Returns:     - bool: false if the backend is unknown or unsupported here,
+*                or fails its self-test
+**************************************************/
+bool mlkem_select_backend(const char *name) {
+    const mlkem_backend *list[4];
+    int n = usable_backends(list);
+    mlkem_dispatch();
+    for (int i = 0; i < n; i++) {
+        if (strcmp(list[i]->name, name) == 0) {
+            bind_backend(list[i]);
+            return mlkem_selftest_rerun();
+        }
+    }
+    return false;
+}
+
+static const mlkem_backend &bound_at_load = mlkem_dispatch();
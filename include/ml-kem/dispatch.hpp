@@ -0,0 +1,29 @@
+#pragma once
+
+#include "param.hpp"
+
+typedef struct{
+    const char *name;
+    void (*keccak_f1600)(void *state);
+    void (*keccak_f1600_x4)(void *state);
+    void (*keccak_f1600_x8)(void *state);
+    int hash_lanes;
+    void (*ntt)(i16 *r);
+    void (*invntt)(i16 *r);
+    void (*decompress_ntt)(i16 *r, const ui8 *a, int d);
+    void (*invntt_add_compress)(ui8 *r, i16 *a, const i16 *b, int d, int negate);
+    void (*basemul)(i16 *r, const i16 *a, const i16 *b);
+    void (*poly_reduce)(i16 *r);
+    void (*poly_tomont)(i16 *r);
+    unsigned (*rej_uniform)(i16 *r, unsigned len, const ui8 *buf, unsigned buflen);
+    void (*cbd)(i16 *r, const ui8 *buf, int eta);
+    void (*byte_encode)(ui8 *r, const i16 *a, int d);
+    void (*byte_decode)(i16 *r, const ui8 *a, int d);
+    unsigned (*byte_check12)(const ui8 *a);
+} mlkem_backend;
+
+const mlkem_backend &mlkem_dispatch();
+
+bool mlkem_select_backend(const char *name);
+
+vector<const mlkem_backend *> mlkem_available_backends();
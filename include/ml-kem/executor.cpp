@@ -0,0 +1,376 @@
+#include "executor.hpp"
+#include "decaps_many.hpp"
+#include "dispatch.hpp"
+#include "trace.hpp"
+#include "selftest.hpp"
+
+#include <cstring>
+#include <string>
+#include <cstdlib>
+#include <exception>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+// the executor and worker context of the calling thread, if it is a worker
+static thread_local const Executor *current_executor = nullptr;
+static thread_local ExecutorWorker *current_worker = nullptr;
+
+struct Executor::Job{
+    const RangeFn *fn;
+    atomic<size_t> remaining;
+    mutex m;
+    condition_variable cv;
+    bool done;
+    exception_ptr error;
+};
+
+/*************************************************
+* Name:        Executor::Executor
+*
+* Description: Starts the worker threads, each with its own task deque,
+*              context (scratch arena and DRBG).
+*
+* Arguments:   - unsigned threads: worker count, 0 = hardware concurrency
+*              - bool pin_threads: pin worker i to CPU i (mod CPU count)
+**************************************************/
+Executor::Executor(unsigned threads, bool pin_threads) : queued(0), stopping(false){
+    if (threads == 0) threads = thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+
+    for (unsigned i = 0; i < threads; i++) {
+        workers.push_back(new Worker());
+        workers[i]->ctx.id = i;
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        Worker &w = *workers[i];
+        w.th = thread([this, &w]{ run(w); });
+#ifdef __linux__
+        if (pin_threads) {
+            unsigned ncpu = thread::hardware_concurrency();
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(i % (ncpu ? ncpu : 1), &set);
+            pthread_setaffinity_np(w.th.native_handle(), sizeof(set), &set);
+        }
+#else
+        (void)pin_threads;
+#endif
+    }
+}
+
+/*************************************************
+* Name:        Executor::~Executor
+*
+* Description: Lets the workers drain their queues, then joins them.
+**************************************************/
+Executor::~Executor(){
+    {
+        lock_guard<mutex> lk(idle_m);
+        stopping = true;
+    }
+    idle_cv.notify_all();
+    for (Worker *w : workers) {
+        w->th.join();
+        delete w;
+    }
+}
+
+/*************************************************
+* Name:        Executor::pop_local / Executor::steal
+*
+* Description: Owners take from the back of their own deque (most
+*              recently dealt, still warm); thieves take from the front
+*              of the next non-empty deque after their own.
+*
+* Returns:     - bool: true if a task was taken
+**************************************************/
+bool Executor::pop_local(Worker &w, Task &t){
+    lock_guard<mutex> lk(w.m);
+    if (w.tasks.empty()) return false;
+    t = w.tasks.back();
+    w.tasks.pop_back();
+    return true;
+}
+
+bool Executor::steal(unsigned thief, Task &t){
+    size_t n = workers.size();
+    for (size_t k = 1; k < n; k++) {
+        Worker &v = *workers[(thief + k) % n];
+        lock_guard<mutex> lk(v.m);
+        if (!v.tasks.empty()) {
+            t = v.tasks.front();
+            v.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+/*************************************************
+* Name:        Executor::run
+*
+* Description: Worker loop: run local tasks, steal when empty, sleep
+*              when nothing is queued anywhere.
+*
+* Arguments:   - Worker &w: this thread's worker
+**************************************************/
+void Executor::run(Worker &w){
+    string label = "executor worker " + to_string(w.ctx.id);
+    mlkem_trace_thread_name(label.c_str());
+    current_executor = this;
+    current_worker = &w.ctx;
+    Task t;
+    for (;;) {
+        if (pop_local(w, t) || steal(w.ctx.id, t)) {
+            queued.fetch_sub(1);
+            Job *job = t.job;
+            {
+                // closed before the job is signalled so the caller sees it
+                MLKEM_TRACE_SCOPE("executor_task");
+                try {
+                    (*job->fn)(w.ctx, t.begin, t.end);
+                } catch (...) {
+                    lock_guard<mutex> lk(job->m);
+                    if (!job->error) job->error = current_exception();
+                }
+            }
+            if (job->remaining.fetch_sub(1) == 1) {
+                lock_guard<mutex> lk(job->m);
+                job->done = true;
+                job->cv.notify_all();
+            }
+            continue;
+        }
+        MLKEM_TRACE_SCOPE("executor_idle");
+        unique_lock<mutex> lk(idle_m);
+        idle_cv.wait(lk, [this]{ return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) return;
+    }
+}
+
+/*************************************************
+* Name:        Executor::parallel_for
+*
+* Description: Splits [0, n) into chunks, deals them round-robin onto
+*              the worker deques and blocks until all have run. The
+*              first exception thrown by a task is rethrown here. Called
+*              from inside one of this executor's tasks, it runs the
+*              chunks inline on the calling worker instead of waiting
+*              on workers that may all be busy waiting themselves.
+*
+* Arguments:   - size_t n: number of items
+*              - size_t chunk: items per task
+*              - const RangeFn &fn: fn(worker, begin, end)
+**************************************************/
+void Executor::parallel_for(size_t n, size_t chunk, const RangeFn &fn){
+    if (n == 0) return;
+    if (chunk == 0) chunk = 1;
+    if (current_executor == this) {
+        for (size_t b = 0; b < n; b += chunk) fn(*current_worker, b, min(n, b + chunk));
+        return;
+    }
+
+    Job job;
+    job.fn = &fn;
+    job.remaining = (n + chunk - 1) / chunk;
+    job.done = false;
+    size_t count = job.remaining;
+
+    // counted before the tasks are visible, so a worker that takes one
+    // at once cannot bring the count below zero
+    {
+        lock_guard<mutex> lk(idle_m);
+        queued.fetch_add(count);
+    }
+    size_t i = 0;
+    for (size_t b = 0; b < n; b += chunk, i++) {
+        Worker &w = *workers[i % workers.size()];
+        lock_guard<mutex> lk(w.m);
+        w.tasks.push_back({&job, b, min(n, b + chunk)});
+    }
+    idle_cv.notify_all();
+
+    MLKEM_TRACE_SCOPE("executor_join");
+    unique_lock<mutex> lk(job.m);
+    job.cv.wait(lk, [&job]{ return job.done; });
+    if (job.error) rethrow_exception(job.error);
+}
+
+/*************************************************
+* Name:        default_executor
+*
+* Description: Process-wide executor used by the parallel_* helpers
+*              without an explicit executor. MLKEM_THREADS sets the
+*              worker count, MLKEM_PIN_THREADS=1 enables pinning.
+*
+* Returns:     - Executor&: shared executor
+**************************************************/
+Executor &default_executor(){
+    static Executor ex(getenv("MLKEM_THREADS") ? atoi(getenv("MLKEM_THREADS")) : 0,
+                       getenv("MLKEM_PIN_THREADS") && atoi(getenv("MLKEM_PIN_THREADS")) != 0);
+    return ex;
+}
+
+/*************************************************
+* Name:        executor_chunk_size
+*
+* Description: Items per task: enough that a task's inputs and outputs
+*              fill about half of L2, no more than a quarter of a
+*              worker's share (so stealing can balance the tail), and a
+*              whole number of multi-buffer hash groups.
+*
+* Arguments:   - size_t n: total items
+*              - size_t item_bytes: bytes read and written per item
+*              - unsigned threads: worker count
+*
+* Returns:     - size_t: chunk size
+**************************************************/
+size_t executor_chunk_size(size_t n, size_t item_bytes, unsigned threads){
+    long l2 = 0;
+#if defined(__linux__) && defined(_SC_LEVEL2_CACHE_SIZE)
+    l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+    if (l2 <= 0) l2 = 256 * 1024;
+
+    size_t lanes = mlkem_dispatch().hash_lanes;
+    size_t chunk = (size_t)l2 / 2 / max<size_t>(item_bytes, 1);
+    size_t balanced = (n + 4 * (size_t)threads - 1) / (4 * (size_t)threads);
+    chunk = min(chunk, balanced);
+    return max(lanes, chunk / lanes * lanes);
+}
+
+static const size_t ek_bytes = 384*Kyber_k+32;
+static const size_t dk_bytes = 768*Kyber_k+96;
+static const size_t ct_bytes = 32*(Kyber_k*du+dv);
+
+/*************************************************
+* Name:        parallel_keygen
+*
+* Description: Generates n key pairs across the executor's workers,
+*              drawing d and z from each worker's own RNG.
+*
+* Arguments:   - Executor &ex: executor (default_executor() if omitted)
+*              - size_t n: number of key pairs
+*
+* Returns:     - vector of pairs: (ek, decaps) per key
+**************************************************/
+vector<pair<vector<ui8>,vector<ui8>>> parallel_keygen(Executor &ex, size_t n){
+    if (!mlkem_selftest_passed()) {
+        cerr<<"parallel_keygen: self-test failed"<<endl;
+        return {};
+    }
+    vector<pair<vector<ui8>,vector<ui8>>> result(n);
+    size_t chunk = executor_chunk_size(n, ek_bytes + dk_bytes, ex.size());
+
+    ex.parallel_for(n, chunk, [&result](ExecutorWorker &w, size_t b, size_t e){
+        vector<ui8> d(32), z(32);
+        ui8 *seeds = w.scratch_bytes(64 * (e - b));
+        w.random(seeds, 64 * (e - b));
+        for (size_t i = b; i < e; i++) {
+            memcpy(d.data(), seeds + 64 * (i - b), 32);
+            memcpy(z.data(), seeds + 64 * (i - b) + 32, 32);
+            result[i] = ML_KEM_KeyGen_internal(d, z);
+        }
+    });
+    return result;
+}
+
+vector<pair<vector<ui8>,vector<ui8>>> parallel_keygen(size_t n){
+    return parallel_keygen(default_executor(), n);
+}
+
+/*************************************************
+* Name:        parallel_encaps
+*
+* Description: Encapsulates to every key across the executor's workers;
+*              each task runs the multi-buffer batch path on its chunk
+*              with messages from the worker's RNG.
+*
+* Arguments:   - Executor &ex: executor (default_executor() if omitted)
+*              - vector<vector<ui8>> &keys: public keys
+*
+* Returns:     - vector of pairs: (shared secret K, ciphertext c) per key,
+*                empty if any key fails ML_KEM_check_encaps_key
+**************************************************/
+vector<pair<vector<ui8>,vector<ui8>>> parallel_encaps(Executor &ex, vector<vector<ui8>> &keys){
+    if (!mlkem_selftest_passed()) {
+        cerr<<"parallel_encaps: self-test failed"<<endl;
+        return {};
+    }
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (!ML_KEM_check_encaps_key(keys[i])) {
+            cerr<<"parallel_encaps: public key check failed at index "<<i<<endl;
+            return {};
+        }
+    }
+    size_t n = keys.size();
+    vector<pair<vector<ui8>,vector<ui8>>> result(n);
+    size_t chunk = executor_chunk_size(n, ek_bytes + ct_bytes + 32, ex.size());
+
+    ex.parallel_for(n, chunk, [&](ExecutorWorker &w, size_t b, size_t e){
+        vector<vector<ui8>> sub(keys.begin() + b, keys.begin() + e);
+        vector<vector<ui8>> msgs(e - b, vector<ui8>(32));
+        ui8 *m = w.scratch_bytes(32 * (e - b));
+        w.random(m, 32 * (e - b));
+        for (size_t i = 0; i < e - b; i++)
+            memcpy(msgs[i].data(), m + 32 * i, 32);
+
+        auto out = ML_KEM_Encaps_internal_batch(sub, msgs);
+        for (size_t i = 0; i < out.size(); i++)
+            result[b + i] = move(out[i]);
+    });
+    return result;
+}
+
+vector<pair<vector<ui8>,vector<ui8>>> parallel_encaps(vector<vector<ui8>> &keys){
+    return parallel_encaps(default_executor(), keys);
+}
+
+/*************************************************
+* Name:        parallel_decaps
+*
+* Description: Decapsulates every ciphertext under one key across the
+*              executor's workers. The key is checked and expanded once
+*              and shared; each chunk goes through ML_KEM_decaps_many.
+*
+* Arguments:   - Executor &ex: executor (default_executor() if omitted)
+*              - vector<ui8> &key: decapsulation key
+*              - vector<vector<ui8>> &ciphertexts: ciphertexts
+*
+* Returns:     - vector<vector<ui8>>: shared secret per ciphertext,
+*                empty if the key fails ML_KEM_check_decaps_key or any
+*                ciphertext is malformed
+**************************************************/
+vector<vector<ui8>> parallel_decaps(Executor &ex, vector<ui8> &key, vector<vector<ui8>> &ciphertexts){
+    mlkem_expanded_dk expanded;
+    if (!ML_KEM_expand_decaps_key(expanded, key)) {
+        cerr<<"parallel_decaps: decapsulation key check failed"<<endl;
+        return {};
+    }
+    for (size_t i = 0; i < ciphertexts.size(); i++) {
+        if (ciphertexts[i].size() != ct_bytes) {
+            cerr<<"parallel_decaps: malformed ciphertext at index "<<i<<endl;
+            return {};
+        }
+    }
+    size_t n = ciphertexts.size();
+    vector<vector<ui8>> result(n);
+    size_t chunk = executor_chunk_size(n, ct_bytes + 32, ex.size());
+
+    ex.parallel_for(n, chunk, [&](ExecutorWorker &w, size_t b, size_t e){
+        (void)w;
+        vector<vector<ui8>> sub(ciphertexts.begin() + b, ciphertexts.begin() + e);
+        auto out = ML_KEM_decaps_many(expanded, sub);
+        for (size_t i = 0; i < out.size(); i++)
+            result[b + i] = move(out[i]);
+    });
+    return result;
+}
+
+vector<vector<ui8>> parallel_decaps(vector<ui8> &key, vector<vector<ui8>> &ciphertexts){
+    return parallel_decaps(default_executor(), key, ciphertexts);
+}
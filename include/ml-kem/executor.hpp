@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ML-KEM.hpp"
+#include "context.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Each worker owns a context (DRBG, scratch arena reused across tasks,
+// stats), so tasks can pass it to the context overloads of the API.
+struct ExecutorWorker : MLKEM_Context{
+    unsigned id;
+};
+
+class Executor{
+public:
+    typedef function<void(ExecutorWorker &, size_t, size_t)> RangeFn;
+
+    explicit Executor(unsigned threads = 0, bool pin_threads = false);
+    ~Executor();
+
+    unsigned size() const { return (unsigned)workers.size(); }
+
+    void parallel_for(size_t n, size_t chunk, const RangeFn &fn);
+
+private:
+    struct Job;
+    struct Task{
+        Job *job;
+        size_t begin, end;
+    };
+    struct Worker{
+        ExecutorWorker ctx;
+        mutex m;
+        deque<Task> tasks;
+        thread th;
+    };
+
+    bool pop_local(Worker &w, Task &t);
+    bool steal(unsigned thief, Task &t);
+    void run(Worker &w);
+
+    vector<Worker *> workers;
+    mutex idle_m;
+    condition_variable idle_cv;
+    atomic<size_t> queued;
+    bool stopping;
+};
+
+Executor &default_executor();
+
+size_t executor_chunk_size(size_t n, size_t item_bytes, unsigned threads);
+
+vector<pair<vector<ui8>,vector<ui8>>> parallel_keygen(size_t n);
+vector<pair<vector<ui8>,vector<ui8>>> parallel_keygen(Executor &ex, size_t n);
+
+vector<pair<vector<ui8>,vector<ui8>>> parallel_encaps(vector<vector<ui8>> &keys);
+vector<pair<vector<ui8>,vector<ui8>>> parallel_encaps(Executor &ex, vector<vector<ui8>> &keys);
+
+vector<vector<ui8>> parallel_decaps(vector<ui8> &key, vector<vector<ui8>> &ciphertexts);
+vector<vector<ui8>> parallel_decaps(Executor &ex, vector<ui8> &key, vector<vector<ui8>> &ciphertexts);
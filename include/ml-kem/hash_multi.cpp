@@ -0,0 +1,127 @@
+#include "hash_multi.hpp"
+#include "dispatch.hpp"
+#include "trace.hpp"
+
+#include <cstring>
+
+/*************************************************
+* Name:        keccak_multi
+*
+* Description: Sponge over `lanes` interleaved Keccak states, mirroring
+*              Keccak() in simple_fips_202.c lane by lane. Word i of
+*              lane l lives at st[i*lanes + l].
+*
+* Arguments:   - int lanes: 4 or 8
+*              - void (*permute)(void*): matching xN permutation
+*              - ui r: rate in bits
+*              - ui8 **in: lanes input pointers of inLen bytes each
+*              - u64 inLen: common input length
+*              - ui8 sfx: domain separation suffix
+*              - ui8 **out: lanes output pointers of outLen bytes each
+*              - u64 outLen: common output length
+**************************************************/
+static void keccak_multi(int lanes, void (*permute)(void *), ui r,
+                         ui8 **in, u64 inLen, ui8 sfx, ui8 **out, u64 outLen) {
+    alignas(64) u64 st[25 * 8];
+    const ui R = r / 8;
+    u64 off = 0, w;
+    ui i, b;
+    int l;
+
+    memset(st, 0, sizeof(st));
+
+    // absorb full blocks a word at a time
+    while (inLen - off >= R) {
+        for (l = 0; l < lanes; l++) {
+            for (i = 0; i < R / 8; i++) {
+                memcpy(&w, in[l] + off + 8 * i, 8);
+                st[i * lanes + l] ^= w;
+            }
+        }
+        permute(st);
+        off += R;
+    }
+
+    // last partial block and padding
+    b = inLen - off;
+    for (l = 0; l < lanes; l++) {
+        for (i = 0; i < b; i++)
+            st[(i / 8) * lanes + l] ^= (u64)in[l][off + i] << (8 * (i % 8));
+        st[(b / 8) * lanes + l] ^= (u64)sfx << (8 * (b % 8));
+        st[((R - 1) / 8) * lanes + l] ^= (u64)0x80 << (8 * ((R - 1) % 8));
+    }
+    permute(st);
+
+    // squeeze
+    off = 0;
+    while (outLen - off > 0) {
+        b = (outLen - off < R) ? outLen - off : R;
+        for (l = 0; l < lanes; l++) {
+            for (i = 0; i < b; i++)
+                out[l][off + i] = st[(i / 8) * lanes + l] >> (8 * (i % 8));
+        }
+        off += b;
+        if (outLen - off > 0) permute(st);
+    }
+}
+
+void Keccak_x4(ui r, ui c, ui8 *in[4], u64 inLen, ui8 sfx, ui8 *out[4], u64 outLen) {
+    (void)c;
+    keccak_multi(4, mlkem_dispatch().keccak_f1600_x4, r, in, inLen, sfx, out, outLen);
+}
+
+void Keccak_x8(ui r, ui c, ui8 *in[8], u64 inLen, ui8 sfx, ui8 *out[8], u64 outLen) {
+    (void)c;
+    keccak_multi(8, mlkem_dispatch().keccak_f1600_x8, r, in, inLen, sfx, out, outLen);
+}
+
+void FIPS202_SHAKE128_x4(ui8 *in[4], u64 inLen, ui8 *out[4], u64 outLen) { MLKEM_TRACE_SCOPE("FIPS202_SHAKE128_x4"); Keccak_x4(1344, 256, in, inLen, 0x1F, out, outLen); }
+void FIPS202_SHAKE256_x4(ui8 *in[4], u64 inLen, ui8 *out[4], u64 outLen) { MLKEM_TRACE_SCOPE("FIPS202_SHAKE256_x4"); Keccak_x4(1088, 512, in, inLen, 0x1F, out, outLen); }
+void FIPS202_SHA3_256_x4(ui8 *in[4], u64 inLen, ui8 *out[4]) { MLKEM_TRACE_SCOPE("FIPS202_SHA3_256_x4"); Keccak_x4(1088, 512, in, inLen, 0x06, out, 32); }
+void FIPS202_SHA3_512_x4(ui8 *in[4], u64 inLen, ui8 *out[4]) { MLKEM_TRACE_SCOPE("FIPS202_SHA3_512_x4"); Keccak_x4(576, 1024, in, inLen, 0x06, out, 64); }
+
+void FIPS202_SHAKE128_x8(ui8 *in[8], u64 inLen, ui8 *out[8], u64 outLen) { MLKEM_TRACE_SCOPE("FIPS202_SHAKE128_x8"); Keccak_x8(1344, 256, in, inLen, 0x1F, out, outLen); }
+void FIPS202_SHAKE256_x8(ui8 *in[8], u64 inLen, ui8 *out[8], u64 outLen) { MLKEM_TRACE_SCOPE("FIPS202_SHAKE256_x8"); Keccak_x8(1088, 512, in, inLen, 0x1F, out, outLen); }
+void FIPS202_SHA3_256_x8(ui8 *in[8], u64 inLen, ui8 *out[8]) { MLKEM_TRACE_SCOPE("FIPS202_SHA3_256_x8"); Keccak_x8(1088, 512, in, inLen, 0x06, out, 32); }
+void FIPS202_SHA3_512_x8(ui8 *in[8], u64 inLen, ui8 *out[8]) { MLKEM_TRACE_SCOPE("FIPS202_SHA3_512_x8"); Keccak_x8(576, 1024, in, inLen, 0x06, out, 64); }
+
+/*************************************************
+* Name:        keccak_batch
+*
+* Description: Hashes n equal-length messages in groups of the active
+*              backend's lane count. A short final group is filled by
+*              repeating its last message into a scratch output.
+*
+* Arguments:   - size_t n: number of messages
+*              - ui r, ui8 sfx: sponge rate in bits and suffix
+*              - ui8 **in, u64 inLen: inputs
+*              - ui8 **out, u64 outLen: outputs
+**************************************************/
+static void keccak_batch(size_t n, ui r, ui8 **in, u64 inLen, ui8 sfx, ui8 **out, u64 outLen) {
+    const mlkem_backend &b = mlkem_dispatch();
+    const int lanes = b.hash_lanes;
+    ui8 *lin[8], *lout[8];
+    vector<ui8> spare;
+
+    for (size_t base = 0; base < n; base += lanes) {
+        for (int l = 0; l < lanes; l++) {
+            if (base + l < n) {
+                lin[l] = in[base + l];
+                lout[l] = out[base + l];
+            } else {
+                if (spare.empty()) spare.resize(outLen);
+                lin[l] = in[n - 1];
+                lout[l] = spare.data();
+            }
+        }
+        if (lanes == 8)
+            keccak_multi(8, b.keccak_f1600_x8, r, lin, inLen, sfx, lout, outLen);
+        else
+            keccak_multi(4, b.keccak_f1600_x4, r, lin, inLen, sfx, lout, outLen);
+    }
+}
+
+void FIPS202_SHAKE128_batch(size_t n, ui8 **in, u64 inLen, ui8 **out, u64 outLen) { MLKEM_TRACE_SCOPE("FIPS202_SHAKE128_batch"); keccak_batch(n, 1344, in, inLen, 0x1F, out, outLen); }
+void FIPS202_SHAKE256_batch(size_t n, ui8 **in, u64 inLen, ui8 **out, u64 outLen) { MLKEM_TRACE_SCOPE("FIPS202_SHAKE256_batch"); keccak_batch(n, 1088, in, inLen, 0x1F, out, outLen); }
+void FIPS202_SHA3_256_batch(size_t n, ui8 **in, u64 inLen, ui8 **out) { MLKEM_TRACE_SCOPE("FIPS202_SHA3_256_batch"); keccak_batch(n, 1088, in, inLen, 0x06, out, 32); }
+void FIPS202_SHA3_512_batch(size_t n, ui8 **in, u64 inLen, ui8 **out) { MLKEM_TRACE_SCOPE("FIPS202_SHA3_512_batch"); keccak_batch(n, 576, in, inLen, 0x06, out, 64); }
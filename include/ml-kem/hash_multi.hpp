@@ -0,0 +1,25 @@
+#pragma once
+
+#include "param.hpp"
+#include "hash.hpp"
+
+// Multi-buffer sponges: lane l absorbs in[l] and squeezes into out[l]; all
+// lanes share one message length.
+void Keccak_x4(ui r, ui c, ui8 *in[4], u64 inLen, ui8 sfx, ui8 *out[4], u64 outLen);
+void Keccak_x8(ui r, ui c, ui8 *in[8], u64 inLen, ui8 sfx, ui8 *out[8], u64 outLen);
+
+void FIPS202_SHAKE128_x4(ui8 *in[4], u64 inLen, ui8 *out[4], u64 outLen);
+void FIPS202_SHAKE256_x4(ui8 *in[4], u64 inLen, ui8 *out[4], u64 outLen);
+void FIPS202_SHA3_256_x4(ui8 *in[4], u64 inLen, ui8 *out[4]);
+void FIPS202_SHA3_512_x4(ui8 *in[4], u64 inLen, ui8 *out[4]);
+
+void FIPS202_SHAKE128_x8(ui8 *in[8], u64 inLen, ui8 *out[8], u64 outLen);
+void FIPS202_SHAKE256_x8(ui8 *in[8], u64 inLen, ui8 *out[8], u64 outLen);
+void FIPS202_SHA3_256_x8(ui8 *in[8], u64 inLen, ui8 *out[8]);
+void FIPS202_SHA3_512_x8(ui8 *in[8], u64 inLen, ui8 *out[8]);
+
+// Any number of messages, grouped by the active backend's lane count.
+void FIPS202_SHAKE128_batch(size_t n, ui8 **in, u64 inLen, ui8 **out, u64 outLen);
+void FIPS202_SHAKE256_batch(size_t n, ui8 **in, u64 inLen, ui8 **out, u64 outLen);
+void FIPS202_SHA3_256_batch(size_t n, ui8 **in, u64 inLen, ui8 **out);
+void FIPS202_SHA3_512_batch(size_t n, ui8 **in, u64 inLen, ui8 **out);
@@ -0,0 +1,872 @@
+// kernels.cpp
+//
+// Compiled once per backend with MLKEM_ARCH naming the namespace and the
+// matching -m flags, so everything here must stay self-contained: only
+// static helpers and plain loops, no inline functions shared with the
+// baseline objects.
+#include "kernels.hpp"
+#include "ntt.hpp"
+
+#include <string.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#ifndef MLKEM_ARCH
+#define MLKEM_ARCH mlkem_ref
+#endif
+
+namespace MLKEM_ARCH {
+
+static const u64 keccakf_rndc[24] = {
+  0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
+  0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
+  0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
+  0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+  0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
+  0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+  0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
+  0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+static inline int16_t k_montgomery_reduce(int32_t a) {
+  int16_t u = a*QINV;
+  int32_t t = (int32_t)u*Kyber_Q;
+  t = a - t;
+  t >>= 16;
+  return t;
+}
+
+// Barrett reduction and Montgomery multiplication written as 16x16-bit
+// high/low products, so the vectorizer maps them to pmulhw/pmullw instead
+// of widening to 32-bit lanes. Both give exactly the results of the
+// 32-bit forms: the low halves of a*b and u*q are equal, so the high
+// halves differ by (a*b - u*q) >> 16.
+static inline int16_t k_barrett_reduce(int16_t a) {
+  const int16_t v = ((1U << 26) + Kyber_Q/2)/Kyber_Q;
+  int16_t t = (int16_t)(((int32_t)v*a) >> 16) >> 10;
+  t *= Kyber_Q;
+  return a - t;
+}
+
+static inline int16_t k_fqmul(int16_t a, int16_t b) {
+  int16_t u = (int16_t)(a*b)*QINV;
+  return (int16_t)(((int32_t)a*b) >> 16) - (int16_t)(((int32_t)u*Kyber_Q) >> 16);
+}
+
+// Twiddle factors of the transforms. By default a twiddle is a zeta in
+// Montgomery form and multiplying by it is an fqmul. With MLKEM_SHOUP_NTT
+// it is a Shoup pair {w, round(w*2^15/q)} (see ntt.cpp): the quotient
+// round(x*w/q) comes from one rounded high product and x*w mod q from two
+// low products, with no Montgomery reduction. Either way the result is
+// congruent to the same value and lies in (-q,q) for any int16 x, so the
+// bounds in the kernel descriptions hold in both builds.
+#ifdef MLKEM_SHOUP_NTT
+struct k_twiddle{ int16_t w, wq; };
+
+static inline k_twiddle k_zeta(unsigned i) { return {zetas_shoup[i][0], zetas_shoup[i][1]}; }
+static inline k_twiddle k_zeta_inv(unsigned i) { return {zetas_inv_shoup[i][0], zetas_inv_shoup[i][1]}; }
+static inline k_twiddle k_twneg(k_twiddle z) { return {(int16_t)-z.w, (int16_t)-z.wq}; }
+
+static inline int16_t k_twmul(int16_t x, k_twiddle z) {
+  int16_t quot = ((int32_t)x*z.wq + (1 << 14)) >> 15;
+  return (int16_t)(x*z.w) - (int16_t)(quot*Kyber_Q);
+}
+
+// The final invNTT scaling and the last layer's zeta times it; the
+// table stores both folded.
+static inline k_twiddle k_invntt_scale() { return k_zeta_inv(127); }
+static inline k_twiddle k_invntt_scaled_zeta() { return k_zeta_inv(126); }
+#else
+typedef int16_t k_twiddle;
+
+static inline k_twiddle k_zeta(unsigned i) { return zetas[i]; }
+static inline k_twiddle k_zeta_inv(unsigned i) { return zetas_inv[i]; }
+static inline k_twiddle k_twneg(k_twiddle z) { return -z; }
+
+static inline int16_t k_twmul(int16_t x, k_twiddle z) {
+  return k_fqmul(z, x);
+}
+
+static inline k_twiddle k_invntt_scale() { return zetas_inv[127]; }
+static inline k_twiddle k_invntt_scaled_zeta() { return k_fqmul(zetas_inv[126], zetas_inv[127]); }
+#endif
+
+typedef u64 v4u64 __attribute__((vector_size(32)));
+typedef u64 v8u64 __attribute__((vector_size(64)));
+
+#define ROLV(a, o) (((a) << (o)) | ((a) >> (64 - (o))))
+
+/*************************************************
+* Name:        keccak_f1600_xN
+*
+* Description: N independent Keccak-f[1600] permutations on a
+*              lane-interleaved state (word i of instance l at
+*              st[i*N + l]). V is a single word (N = 1) or a vector of N
+*              words, so every step of the unrolled round is one SIMD
+*              operation on the AVX2 (N = 4) and AVX-512 (N = 8) builds,
+*              and pairs of SSE2 operations on the baseline build.
+*
+* Arguments:   - u64 *st: 25*N words
+**************************************************/
+template<typename V>
+static void keccak_f1600_xN(u64 *st) {
+  V A[25], B[25], C0, C1, C2, C3, C4, D0, D1, D2, D3, D4;
+  int r, y;
+
+  memcpy(A, st, sizeof(A));
+  for(r = 0; r < 24; r++) {
+    C0 = A[0] ^ A[5] ^ A[10] ^ A[15] ^ A[20];
+    C1 = A[1] ^ A[6] ^ A[11] ^ A[16] ^ A[21];
+    C2 = A[2] ^ A[7] ^ A[12] ^ A[17] ^ A[22];
+    C3 = A[3] ^ A[8] ^ A[13] ^ A[18] ^ A[23];
+    C4 = A[4] ^ A[9] ^ A[14] ^ A[19] ^ A[24];
+    D0 = C4 ^ ROLV(C1, 1);
+    D1 = C0 ^ ROLV(C2, 1);
+    D2 = C1 ^ ROLV(C3, 1);
+    D3 = C2 ^ ROLV(C4, 1);
+    D4 = C3 ^ ROLV(C0, 1);
+
+    // theta, rho and pi: B[5y + x] is the lane moved to (x, y)
+    B[0]  = A[0] ^ D0;
+    B[1]  = ROLV(A[6] ^ D1, 44);
+    B[2]  = ROLV(A[12] ^ D2, 43);
+    B[3]  = ROLV(A[18] ^ D3, 21);
+    B[4]  = ROLV(A[24] ^ D4, 14);
+    B[5]  = ROLV(A[3] ^ D3, 28);
+    B[6]  = ROLV(A[9] ^ D4, 20);
+    B[7]  = ROLV(A[10] ^ D0, 3);
+    B[8]  = ROLV(A[16] ^ D1, 45);
+    B[9]  = ROLV(A[22] ^ D2, 61);
+    B[10] = ROLV(A[1] ^ D1, 1);
+    B[11] = ROLV(A[7] ^ D2, 6);
+    B[12] = ROLV(A[13] ^ D3, 25);
+    B[13] = ROLV(A[19] ^ D4, 8);
+    B[14] = ROLV(A[20] ^ D0, 18);
+    B[15] = ROLV(A[4] ^ D4, 27);
+    B[16] = ROLV(A[5] ^ D0, 36);
+    B[17] = ROLV(A[11] ^ D1, 10);
+    B[18] = ROLV(A[17] ^ D2, 15);
+    B[19] = ROLV(A[23] ^ D3, 56);
+    B[20] = ROLV(A[2] ^ D2, 62);
+    B[21] = ROLV(A[8] ^ D3, 55);
+    B[22] = ROLV(A[14] ^ D4, 39);
+    B[23] = ROLV(A[15] ^ D0, 41);
+    B[24] = ROLV(A[21] ^ D1, 2);
+
+    // chi
+    for(y = 0; y < 25; y += 5) {
+      A[y + 0] = B[y + 0] ^ (~B[y + 1] & B[y + 2]);
+      A[y + 1] = B[y + 1] ^ (~B[y + 2] & B[y + 3]);
+      A[y + 2] = B[y + 2] ^ (~B[y + 3] & B[y + 4]);
+      A[y + 3] = B[y + 3] ^ (~B[y + 4] & B[y + 0]);
+      A[y + 4] = B[y + 4] ^ (~B[y + 0] & B[y + 1]);
+    }
+
+    // iota
+    A[0] ^= keccakf_rndc[r];
+  }
+  memcpy(st, A, sizeof(A));
+}
+
+/*************************************************
+* Name:        keccak_f1600
+*
+* Description: Keccak-f[1600] permutation on a 25-lane state held as
+*              little-endian 64-bit words (the byte layout used by
+*              simple_fips_202.c on little-endian hosts).
+*
+* Arguments:   - void *state: pointer to 200-byte state
+**************************************************/
+void keccak_f1600(void *state) {
+  keccak_f1600_xN<u64>((u64 *)state);
+}
+
+void keccak_f1600_x4(void *state) {
+  keccak_f1600_xN<v4u64>((u64 *)state);
+}
+
+void keccak_f1600_x8(void *state) {
+  keccak_f1600_xN<v8u64>((u64 *)state);
+}
+
+/*************************************************
+* Name:        ntt_pass
+*
+* Description: L consecutive forward NTT layers, the first with butterfly
+*              length LEN, in one sweep over r. Each block of 2*LEN
+*              coefficients splits into LEN >> (L-1) groups of 2^L
+*              coefficients at stride LEN >> (L-1); a group goes through
+*              all L layers in registers with the block's 2^L - 1 zetas
+*              loaded once. The layer with length len uses zetas
+*              128/len .. 256/len - 1, so the zetas of a block form a
+*              binary heap rooted at 128/LEN + block. All bounds are
+*              compile-time constants and the loops over one group
+*              unroll completely; the loop over the groups of a block
+*              (stride 1) is the one the compiler vectorizes.
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+**************************************************/
+template<unsigned LEN, unsigned L>
+static inline void ntt_pass(int16_t *r) {
+  constexpr unsigned B = 1u << L, S = LEN >> (L - 1);
+  k_twiddle z[B];
+  int16_t v[B], t;
+
+  for(unsigned blk = 0; blk < 128 / LEN; blk++) {
+    int16_t *p = r + 2 * LEN * blk;
+    #pragma GCC unroll 16
+    for(unsigned l = 0; l < L; l++)
+      #pragma GCC unroll 16
+      for(unsigned s = 0; s < (1u << l); s++)
+        z[(1u << l) + s] = k_zeta(((128 / LEN + blk) << l) + s);
+    for(unsigned j = 0; j < S; j++) {
+      #pragma GCC unroll 16
+      for(unsigned i = 0; i < B; i++) v[i] = p[j + i * S];
+      #pragma GCC unroll 16
+      for(unsigned l = 0; l < L; l++) {
+        const unsigned half = B >> (l + 1);
+        #pragma GCC unroll 16
+        for(unsigned s = 0; s < (1u << l); s++) {
+          #pragma GCC unroll 16
+          for(unsigned i = 2 * half * s; i < 2 * half * s + half; i++) {
+            t = k_twmul(v[i + half], z[(1u << l) + s]);
+            v[i + half] = v[i] - t;
+            v[i] = v[i] + t;
+          }
+        }
+      }
+      #pragma GCC unroll 16
+      for(unsigned i = 0; i < B; i++) p[j + i * S] = v[i];
+    }
+  }
+}
+
+/*************************************************
+* Name:        ntt_from64
+*
+* Description: Forward NTT layers 2..7 (lengths 64 down to 2) in three
+*              passes: lengths 64/32/16, 8, then 4/2. Used after the
+*              first layer has been fused into decompression.
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+**************************************************/
+static inline void ntt_from64(int16_t *r) {
+  ntt_pass<64, 3>(r);
+  ntt_pass<8, 1>(r);
+  ntt_pass<4, 2>(r);
+}
+
+/*************************************************
+* Name:        ntt
+*
+* Description: Inplace number-theoretic transform (NTT) in Rq.
+*              input is in standard order, output is in bitreversed order
+*
+*              Three passes over r (lengths 128/64/32, 16/8, 4/2; see
+*              ntt_pass) instead of one per layer.
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+**************************************************/
+void ntt(i16 *r) {
+  ntt_pass<128, 3>(r);
+  ntt_pass<16, 2>(r);
+  ntt_pass<4, 2>(r);
+}
+
+/*************************************************
+* Name:        invntt_pass
+*
+* Description: L consecutive inverse NTT layers, the first with butterfly
+*              length LEN, in one sweep over r: groups of 2^L
+*              coefficients at stride LEN stay in registers across the
+*              layers. The layer with length len uses zetas_inv
+*              128 - 256/len onwards, one per block of 2*len. Bit l of
+*              REDUCE Barrett-reduces the sums of the pass's layer l.
+*              SCALE (for the pass ending with the length-128 layer)
+*              folds the final invNTT factor into that layer: its sums
+*              are multiplied by the factor and its zeta is replaced by
+*              zeta times the factor.
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+**************************************************/
+template<unsigned LEN, unsigned L, unsigned REDUCE, bool SCALE = false>
+static inline void invntt_pass(int16_t *r) {
+  constexpr unsigned B = 1u << L;
+  const k_twiddle f = k_invntt_scale();
+  k_twiddle z[B];
+  int16_t v[B], t;
+
+  for(unsigned blk = 0; blk < 256 / (LEN * B); blk++) {
+    int16_t *p = r + LEN * B * blk;
+    #pragma GCC unroll 16
+    for(unsigned l = 0; l < L; l++)
+      #pragma GCC unroll 16
+      for(unsigned s = 0; s < (B >> (l + 1)); s++)
+        z[(B >> (l + 1)) + s] = k_zeta_inv(128 - 256 / (LEN << l) + blk * (B >> (l + 1)) + s);
+    if(SCALE) z[1] = k_invntt_scaled_zeta();
+    for(unsigned j = 0; j < LEN; j++) {
+      #pragma GCC unroll 16
+      for(unsigned i = 0; i < B; i++) v[i] = p[j + i * LEN];
+      #pragma GCC unroll 16
+      for(unsigned l = 0; l < L; l++) {
+        const unsigned half = 1u << l;
+        #pragma GCC unroll 16
+        for(unsigned s = 0; s < (B >> (l + 1)); s++) {
+          #pragma GCC unroll 16
+          for(unsigned i = 2 * half * s; i < 2 * half * s + half; i++) {
+            t = v[i];
+            if(SCALE && l == L - 1)
+              v[i] = k_twmul(t + v[i + half], f);
+            else
+              v[i] = ((REDUCE >> l) & 1) ? k_barrett_reduce(t + v[i + half]) : t + v[i + half];
+            v[i + half] = k_twmul(t - v[i + half], z[(B >> (l + 1)) + s]);
+          }
+        }
+      }
+      #pragma GCC unroll 16
+      for(unsigned i = 0; i < B; i++) p[j + i * LEN] = v[i];
+    }
+  }
+}
+
+/*************************************************
+* Name:        invntt_to64
+*
+* Description: Inverse NTT layers 1..6 (lengths 2 up to 64) in three
+*              passes of two layers each. Sums are Barrett-reduced only in
+*              layers 1 and 4: a reduced sum is in [0,q] and the other
+*              half leaves every layer as an fqmul result in (-q,q), so
+*              after two more unreduced layers no coefficient exceeds 4q.
+*              Inputs must satisfy |a| < 2^14 so that the first-layer
+*              sums fit in int16.
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+**************************************************/
+static inline void invntt_to64(int16_t *r) {
+  invntt_pass<2, 2, 1>(r);
+  invntt_pass<8, 2, 2>(r);
+  invntt_pass<32, 2, 0>(r);
+}
+
+/*************************************************
+* Name:        invntt
+*
+* Description: Inplace inverse number-theoretic transform in Rq and
+*              multiplication by Montgomery factor 2^16.
+*              Input is in bitreversed order, output is in standard order
+*
+*              Three passes over r (lengths 2/4, 8/16, 32/64/128; see
+*              invntt_pass), the last with the final scaling folded in.
+*              Reductions are placed as in invntt_to64, so after the
+*              unreduced layer 7 no coefficient exceeds 8q; the output
+*              is in (-q,q).
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+**************************************************/
+void invntt(i16 *r) {
+  invntt_pass<2, 2, 1>(r);
+  invntt_pass<8, 2, 2>(r);
+  invntt_pass<32, 3, 0, true>(r);
+}
+
+/*************************************************
+* Name:        unpack8 / pack8
+*
+* Description: Eight D-bit values to and from the D bytes that hold them,
+*              LSB first. D is a compile-time constant, so every shift
+*              and byte offset is fixed and the loops unroll.
+*
+* Arguments:   - uint32_t v[8]: values
+*              - ui8 *p: D bytes
+**************************************************/
+template<int D>
+static inline void unpack8(uint32_t *v, const ui8 *p) {
+  for(int i = 0; i < 8; i++) {
+    const int off = (D*i) >> 3, sh = (D*i) & 7;
+    uint32_t w = p[off];
+    if(sh + D > 8) w |= (uint32_t)p[off+1] << 8;
+    if(sh + D > 16) w |= (uint32_t)p[off+2] << 16;
+    v[i] = (w >> sh) & ((1U << D) - 1);
+  }
+}
+
+template<int D>
+static inline void pack8(ui8 *p, const uint32_t *v) {
+  unsigned __int128 w = 0;
+  for(int i = 0; i < 8; i++)
+    w |= (unsigned __int128)v[i] << (D*i);
+  for(int i = 0; i < D; i++)
+    p[i] = (ui8)(w >> (8*i));
+}
+
+template<int D>
+static void decompress_ntt_d(int16_t *r, const ui8 *a) {
+  const k_twiddle zeta = k_zeta(1);
+  uint32_t x[8], y[8];
+  int16_t t, u;
+
+  for(int g = 0; g < 16; g++) {
+    unpack8<D>(x, a + D*g);
+    unpack8<D>(y, a + D*(g + 16));
+    for(int i = 0; i < 8; i++) {
+      u = (x[i] * Kyber_Q + (1U << (D - 1))) >> D;
+      t = k_twmul((int16_t)((y[i] * Kyber_Q + (1U << (D - 1))) >> D), zeta);
+      r[8*g + i + 128] = u - t;
+      r[8*g + i] = u + t;
+    }
+  }
+  ntt_from64(r);
+}
+
+/*************************************************
+* Name:        decompress_ntt
+*
+* Description: ByteDecode_d, Decompress_d and ntt in one pass. Eight
+*              d-bit values are unpacked from each half of the input and
+*              decompressed into [0,q] in registers, where they meet as
+*              the operands of the first NTT layer's butterflies; only
+*              that layer's outputs are stored. The widths ML-KEM uses
+*              (1, 4, 5, 10, 11) have unrolled paths; others decode
+*              first. Output matches ntt() of the decompressed polynomial.
+*
+* Arguments:   - int16_t r[256]: output polynomial (NTT domain)
+*              - const ui8 *a: input buffer of 32*d bytes
+*              - int d: bits per coefficient (1..11)
+**************************************************/
+void byte_decode(i16 *r, const ui8 *a, int d);
+
+void decompress_ntt(i16 *r, const ui8 *a, int d) {
+  unsigned int i;
+
+  switch(d) {
+    case 1: decompress_ntt_d<1>(r, a); return;
+    case 4: decompress_ntt_d<4>(r, a); return;
+    case 5: decompress_ntt_d<5>(r, a); return;
+    case 10: decompress_ntt_d<10>(r, a); return;
+    case 11: decompress_ntt_d<11>(r, a); return;
+  }
+  byte_decode(r, a, d);
+  for(i = 0; i < Kyber_N; i++)
+    r[i] = ((uint32_t)r[i] * Kyber_Q + (1U << (d - 1))) >> d;
+  ntt(r);
+}
+
+template<int D>
+static void add_compress_d(ui8 *r, const int16_t *a, const int16_t *b, k_twiddle f, k_twiddle zf) {
+  uint32_t x[8], y[8];
+  int16_t t, u, w;
+
+  for(int g = 0; g < 16; g++) {
+    for(int i = 0; i < 8; i++) {
+      t = a[8*g + i];
+      u = a[8*g + i + 128];
+      w = k_barrett_reduce(b[8*g + i] + k_twmul(t + u, f));
+      x[i] = ((((uint32_t)w << D) + Kyber_Q/2) / Kyber_Q) & ((1U << D) - 1);
+      w = k_barrett_reduce(b[8*g + i + 128] + k_twmul(t - u, zf));
+      y[i] = ((((uint32_t)w << D) + Kyber_Q/2) / Kyber_Q) & ((1U << D) - 1);
+    }
+    pack8<D>(r + D*g, x);
+    pack8<D>(r + D*(g + 16), y);
+  }
+}
+
+/*************************************************
+* Name:        invntt_add_compress
+*
+* Description: Last invNTT layer, error addition, Compress_d and
+*              ByteEncode_d in one pass: computes
+*              ByteEncode_d(Compress_d(b + s*invntt(a))) with s = 1, or
+*              s = -1 when negate is set. The sign and the invNTT scaling
+*              are folded into the constants of the last layer, whose
+*              outputs are Barrett-reduced, compressed and packed in
+*              registers, eight per half, straight into r. Widths other
+*              than 1, 4, 5, 10 and 11 go back through a for packing.
+*
+* Arguments:   - ui8 *r: output buffer of 32*d bytes
+*              - int16_t a[256]: NTT-domain input, |a| < 2^14; clobbered
+*              - const int16_t b[256]: polynomial to add, |b| < 2^15 - q
+*              - int d: bits per coefficient (1..11)
+*              - int negate: subtract invntt(a) from b instead of adding
+**************************************************/
+void byte_encode(ui8 *r, const i16 *a, int d);
+
+void invntt_add_compress(ui8 *r, i16 *a, const i16 *b, int d, int negate) {
+  const k_twiddle f = negate ? k_twneg(k_invntt_scale()) : k_invntt_scale();
+  const k_twiddle zf = negate ? k_twneg(k_invntt_scaled_zeta()) : k_invntt_scaled_zeta();
+  const uint32_t mask = (1U << d) - 1;
+  int16_t t, u, w0, w1;
+  unsigned int j;
+
+  invntt_to64(a);
+  switch(d) {
+    case 1: add_compress_d<1>(r, a, b, f, zf); return;
+    case 4: add_compress_d<4>(r, a, b, f, zf); return;
+    case 5: add_compress_d<5>(r, a, b, f, zf); return;
+    case 10: add_compress_d<10>(r, a, b, f, zf); return;
+    case 11: add_compress_d<11>(r, a, b, f, zf); return;
+  }
+  for(j = 0; j < 128; j++) {
+    t = a[j];
+    u = a[j + 128];
+    w0 = k_barrett_reduce(b[j] + k_twmul(t + u, f));
+    w1 = k_barrett_reduce(b[j + 128] + k_twmul(t - u, zf));
+    a[j] = ((((uint32_t)w0 << d) + Kyber_Q/2) / Kyber_Q) & mask;
+    a[j + 128] = ((((uint32_t)w1 << d) + Kyber_Q/2) / Kyber_Q) & mask;
+  }
+  byte_encode(r, a, d);
+}
+
+/*************************************************
+* Name:        basemul
+*
+* Description: Pointwise multiplication of two polynomials in NTT domain,
+*              i.e. 128 multiplications in Zq[X]/(X^2-zeta).
+*
+* Arguments:   - int16_t r[256]: output polynomial
+*              - const int16_t a[256]: first factor
+*              - const int16_t b[256]: second factor
+**************************************************/
+void basemul(i16 *r, const i16 *a, const i16 *b) {
+  unsigned int i;
+  int16_t zeta, r0, r1, r2, r3;
+
+  for(i = 0; i < Kyber_N/4; i++) {
+    zeta = zetas[64 + i];
+    r0  = k_fqmul(a[4*i+1], b[4*i+1]);
+    r0  = k_fqmul(r0, zeta);
+    r0 += k_fqmul(a[4*i], b[4*i]);
+    r1  = k_fqmul(a[4*i], b[4*i+1]);
+    r1 += k_fqmul(a[4*i+1], b[4*i]);
+
+    r2  = k_fqmul(a[4*i+3], b[4*i+3]);
+    r2  = k_fqmul(r2, -zeta);
+    r2 += k_fqmul(a[4*i+2], b[4*i+2]);
+    r3  = k_fqmul(a[4*i+2], b[4*i+3]);
+    r3 += k_fqmul(a[4*i+3], b[4*i+2]);
+
+    r[4*i] = r0; r[4*i+1] = r1; r[4*i+2] = r2; r[4*i+3] = r3;
+  }
+}
+
+/*************************************************
+* Name:        poly_reduce
+*
+* Description: Applies Barrett reduction to all coefficients
+*
+* Arguments:   - int16_t r[256]: input/output polynomial
+**************************************************/
+void poly_reduce(i16 *r) {
+  unsigned int i;
+  for(i = 0; i < Kyber_N; i++)
+    r[i] = k_barrett_reduce(r[i]);
+}
+
+/*************************************************
+* Name:        poly_tomont
+*
+* Description: Inplace conversion of all coefficients of a polynomial
+*              from normal domain to Montgomery domain
+*
+* Arguments:   - int16_t r[256]: input/output polynomial
+**************************************************/
+void poly_tomont(i16 *r) {
+  unsigned int i;
+  const int16_t f = (1ULL << 32) % Kyber_Q;
+  for(i = 0; i < Kyber_N; i++)
+    r[i] = k_montgomery_reduce((int32_t)r[i]*f);
+}
+
+#ifdef __AVX2__
+/*************************************************
+* Name:        rej_lut
+*
+* Description: pshufb controls that move the accepted 16-bit lanes of an
+*              eight-lane vector to the front, in order, one per 8-bit
+*              accept mask. Built at compile time (4 KiB).
+**************************************************/
+struct rej_lut{
+  alignas(16) uint8_t idx[256][16];
+
+  constexpr rej_lut() : idx() {
+    for(unsigned m = 0; m < 256; m++) {
+      unsigned n = 0;
+      for(unsigned i = 0; i < 8; i++) {
+        if(m >> i & 1) {
+          idx[m][2*n] = 2*i;
+          idx[m][2*n + 1] = 2*i + 1;
+          n++;
+        }
+      }
+      for(; n < 8; n++) idx[m][2*n] = idx[m][2*n + 1] = 0x80;
+    }
+  }
+};
+
+static constexpr rej_lut rej_shuffle;
+
+/*************************************************
+* Name:        rej_uniform16
+*
+* Description: Vector part of rej_uniform: 24 bytes give 16 candidates
+*              per step, eight per 128-bit half (each half loaded from
+*              its own 12 bytes and spread into 16-bit lanes by one
+*              pshufb; odd lanes are shifted down by 4 and all masked to
+*              12 bits). One compare against q and a movemask of the
+*              packed result give an 8-bit accept mask per half, which
+*              selects the pshufb that packs that half's accepted
+*              candidates into r. Each store writes eight lanes, so the
+*              loop stops while 16 free slots remain in r and 28 bytes in
+*              buf; the scalar loop finishes.
+*
+* Arguments:   - int16_t *r: output buffer
+*              - unsigned len: requested number of coefficients
+*              - const ui8 *buf: uniform random bytes
+*              - unsigned buflen: length of buf
+*              - unsigned *pos: bytes consumed (output)
+*
+* Returns:     number of coefficients written
+**************************************************/
+static unsigned rej_uniform16(int16_t *r, unsigned len, const ui8 *buf, unsigned buflen, unsigned *pos) {
+  const __m256i spread = _mm256_setr_epi8(0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11,
+                                          0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11);
+  const __m256i mask = _mm256_set1_epi16(0xFFF);
+  const __m256i bound = _mm256_set1_epi16(Kyber_Q);
+  unsigned ctr = 0, p = 0, good;
+  __m256i f, g;
+  __m128i lo, hi;
+
+  while(ctr + 16 <= len && p + 28 <= buflen) {
+    lo = _mm_loadu_si128((const __m128i *)(buf + p));
+    hi = _mm_loadu_si128((const __m128i *)(buf + p + 12));
+    p += 24;
+    f = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    f = _mm256_shuffle_epi8(f, spread);
+    g = _mm256_srli_epi16(f, 4);
+    f = _mm256_and_si256(_mm256_blend_epi16(f, g, 0xAA), mask);
+    g = _mm256_cmpgt_epi16(bound, f);
+    good = _mm_movemask_epi8(_mm_packs_epi16(_mm256_castsi256_si128(g), _mm256_extracti128_si256(g, 1)));
+
+    lo = _mm_shuffle_epi8(_mm256_castsi256_si128(f), _mm_load_si128((const __m128i *)rej_shuffle.idx[good & 0xFF]));
+    _mm_storeu_si128((__m128i *)(r + ctr), lo);
+    ctr += _mm_popcnt_u32(good & 0xFF);
+    hi = _mm_shuffle_epi8(_mm256_extracti128_si256(f, 1), _mm_load_si128((const __m128i *)rej_shuffle.idx[good >> 8]));
+    _mm_storeu_si128((__m128i *)(r + ctr), hi);
+    ctr += _mm_popcnt_u32(good >> 8);
+  }
+  *pos = p;
+  return ctr;
+}
+#endif
+
+/*************************************************
+* Name:        rej_uniform
+*
+* Description: Rejection sampling on uniform random bytes; every 3 bytes
+*              give two 12-bit candidates, kept if they are below q.
+*              The AVX2 builds take 16 candidates per step with a vector
+*              compare and a table-driven compaction (rej_uniform16);
+*              the scalar loop does the rest, and everything in the
+*              baseline build. It stores every candidate and advances
+*              the count by the comparison result, so there is no
+*              branch on the random data; slots past the returned count
+*              may be overwritten.
+*
+* Arguments:   - int16_t *r: output buffer
+*              - unsigned len: requested number of coefficients
+*              - const ui8 *buf: uniform random bytes
+*              - unsigned buflen: length of buf (multiple of 3 is used)
+*
+* Returns:     number of coefficients written (at most len)
+**************************************************/
+unsigned rej_uniform(i16 *r, unsigned len, const ui8 *buf, unsigned buflen) {
+  unsigned ctr = 0, pos = 0;
+  uint16_t d1, d2;
+
+#ifdef __AVX2__
+  ctr = rej_uniform16(r, len, buf, buflen, &pos);
+#endif
+  while(ctr < len && pos + 3 <= buflen) {
+    d1 = (buf[pos] | ((uint16_t)buf[pos + 1] << 8)) & 0xFFF;
+    d2 = ((buf[pos + 1] >> 4) | ((uint16_t)buf[pos + 2] << 4)) & 0xFFF;
+    pos += 3;
+
+    r[ctr] = d1;
+    ctr += d1 < Kyber_Q;
+    if(ctr < len) {
+      r[ctr] = d2;
+      ctr += d2 < Kyber_Q;
+    }
+  }
+  return ctr;
+}
+
+/*************************************************
+* Name:        cbd
+*
+* Description: Centered binomial distribution with parameter eta; each
+*              coefficient is (sum of eta bits) - (sum of next eta bits),
+*              mapped into [0, q).
+*
+* Arguments:   - int16_t r[256]: output polynomial
+*              - const ui8 *buf: 64*eta uniform random bytes
+*              - int eta: 2 or 3 use the bitsliced paths, others are generic
+**************************************************/
+void cbd(i16 *r, const ui8 *buf, int eta) {
+  unsigned int i, j;
+  uint32_t t, d;
+  int16_t a, b;
+
+  if(eta == 2) {
+    for(i = 0; i < Kyber_N/8; i++) {
+      t = (uint32_t)buf[4*i] | ((uint32_t)buf[4*i+1] << 8)
+        | ((uint32_t)buf[4*i+2] << 16) | ((uint32_t)buf[4*i+3] << 24);
+      d  = t & 0x55555555;
+      d += (t >> 1) & 0x55555555;
+      for(j = 0; j < 8; j++) {
+        a = (d >> (4*j)) & 0x3;
+        b = (d >> (4*j + 2)) & 0x3;
+        a -= b;
+        r[8*i+j] = a + ((a >> 15) & Kyber_Q);
+      }
+    }
+  } else if(eta == 3) {
+    for(i = 0; i < Kyber_N/4; i++) {
+      t = (uint32_t)buf[3*i] | ((uint32_t)buf[3*i+1] << 8)
+        | ((uint32_t)buf[3*i+2] << 16);
+      d  = t & 0x00249249;
+      d += (t >> 1) & 0x00249249;
+      d += (t >> 2) & 0x00249249;
+      for(j = 0; j < 4; j++) {
+        a = (d >> (6*j)) & 0x7;
+        b = (d >> (6*j + 3)) & 0x7;
+        a -= b;
+        r[4*i+j] = a + ((a >> 15) & Kyber_Q);
+      }
+    }
+  } else {
+    unsigned idx = 0;
+    for(i = 0; i < Kyber_N; i++) {
+      a = 0; b = 0;
+      for(j = 0; j < (unsigned)eta; j++, idx++)
+        a += (buf[idx >> 3] >> (idx & 7)) & 1;
+      for(j = 0; j < (unsigned)eta; j++, idx++)
+        b += (buf[idx >> 3] >> (idx & 7)) & 1;
+      a -= b;
+      r[i] = a + ((a >> 15) & Kyber_Q);
+    }
+  }
+}
+
+/*************************************************
+* Name:        byte_encode
+*
+* Description: Packs 256 coefficients into 32*d bytes, d bits each,
+*              LSB first. Inputs in (-q,q] are mapped to their canonical
+*              representative in [0,q), so a 12-bit encoding always
+*              passes the FIPS 203 modulus check.
+*
+* Arguments:   - ui8 *r: output buffer of 32*d bytes
+*              - const int16_t a[256]: input polynomial
+*              - int d: bits per coefficient (1..12)
+**************************************************/
+void byte_encode(ui8 *r, const i16 *a, int d) {
+  unsigned int i, bits = 0;
+  uint32_t acc = 0;
+  const uint32_t mask = (1U << d) - 1;
+  int16_t x;
+
+  for(i = 0; i < Kyber_N; i++) {
+    x = a[i] - Kyber_Q;
+    x += (x >> 15) & Kyber_Q;
+    x += (x >> 15) & Kyber_Q;
+    acc |= ((uint32_t)x & mask) << bits;
+    bits += d;
+    while(bits >= 8) {
+      *r++ = (ui8)acc;
+      acc >>= 8;
+      bits -= 8;
+    }
+  }
+}
+
+/*************************************************
+* Name:        byte_decode
+*
+* Description: Unpacks 32*d bytes into 256 coefficients of d bits each.
+*              For d < 12 the result is in [0, 2^d), for d = 12 it is
+*              reduced into [0, q).
+*
+* Arguments:   - int16_t r[256]: output polynomial
+*              - const ui8 *a: input buffer of 32*d bytes
+*              - int d: bits per coefficient (1..12)
+**************************************************/
+void byte_decode(i16 *r, const ui8 *a, int d) {
+  unsigned int i, bits = 0;
+  uint32_t acc = 0;
+  const uint32_t mask = (1U << d) - 1;
+  int16_t x;
+
+  for(i = 0; i < Kyber_N; i++) {
+    while(bits < (unsigned)d) {
+      acc |= (uint32_t)(*a++) << bits;
+      bits += 8;
+    }
+    x = acc & mask;
+    acc >>= d;
+    bits -= d;
+    if(d == 12)
+      x -= Kyber_Q & -(int16_t)(x >= Kyber_Q);
+    r[i] = x;
+  }
+}
+
+/*************************************************
+* Name:        byte_check12
+*
+* Description: FIPS 203 modulus check of one 12-bit encoded polynomial.
+*              2^15 - q is added to every coefficient, so bit 15 of the
+*              sum is set exactly when the coefficient is >= q; the sums
+*              are OR-ed together with no data-dependent branch.
+*              With AVX2 the plain per-pair loop is vectorised by the
+*              compiler. The baseline build reads 24 bytes as three words
+*              and checks four coefficients per 64-bit word, spread into
+*              16-bit lanes.
+*
+* Arguments:   - const ui8 *a: 384-byte encoded polynomial
+*
+* Returns:     - unsigned: 0 if every coefficient is below q
+**************************************************/
+unsigned byte_check12(const ui8 *a) {
+#ifdef __AVX2__
+  uint32_t x, y, acc = 0;
+  unsigned int i;
+
+  for(i = 0; i < Kyber_N/2; i++) {
+    x = a[3*i] | (uint32_t)(a[3*i+1] & 0xF) << 8;
+    y = a[3*i+1] >> 4 | (uint32_t)a[3*i+2] << 4;
+    acc |= (x + 0x8000 - Kyber_Q) | (y + 0x8000 - Kyber_Q);
+  }
+  return (acc >> 15) & 1;
+#else
+  const u64 offset = 0x8000 - Kyber_Q;
+  const u64 add = offset | offset << 16 | offset << 32 | offset << 48;
+  u64 w[3], g[4], acc = 0;
+  unsigned int i, j;
+
+  for(i = 0; i < Kyber_N/16; i++) {
+    memcpy(w, a + 24*i, 24);
+    g[0] = w[0];
+    g[1] = w[0] >> 48 | w[1] << 16;
+    g[2] = w[1] >> 32 | w[2] << 32;
+    g[3] = w[2] >> 16;
+    for(j = 0; j < 4; j++)
+      acc |= ((g[j] & 0xFFF) | ((g[j] << 4) & 0xFFF0000ULL)
+           | ((g[j] << 8) & 0xFFF00000000ULL) | ((g[j] << 12) & 0xFFF000000000000ULL)) + add;
+  }
+  return (unsigned)((acc & 0x8000800080008000ULL) != 0);
+#endif
+}
+
+} // namespace MLKEM_ARCH
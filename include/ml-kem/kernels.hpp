@@ -0,0 +1,53 @@
+#pragma once
+
+#include "param.hpp"
+
+/*
+ * Raw-pointer kernels behind the vector<> API. kernels.cpp is compiled once
+ * per instruction set (see CMakeLists.txt), each copy into its own
+ * namespace, and dispatch.cpp binds one set at load time.
+ */
+#define MLKEM_KERNEL_DECLS                                                   \
+    void keccak_f1600(void *state);                                          \
+    void keccak_f1600_x4(void *state);                                       \
+    void keccak_f1600_x8(void *state);                                       \
+    void ntt(i16 *r);                                                        \
+    void invntt(i16 *r);                                                     \
+    void decompress_ntt(i16 *r, const ui8 *a, int d);                        \
+    void invntt_add_compress(ui8 *r, i16 *a, const i16 *b, int d, int negate); \
+    void basemul(i16 *r, const i16 *a, const i16 *b);                        \
+    void poly_reduce(i16 *r);                                                \
+    void poly_tomont(i16 *r);                                                \
+    unsigned rej_uniform(i16 *r, unsigned len, const ui8 *buf, unsigned buflen); \
+    void cbd(i16 *r, const ui8 *buf, int eta);                               \
+    void byte_encode(ui8 *r, const i16 *a, int d);                           \
+    void byte_decode(i16 *r, const ui8 *a, int d);                           \
+    unsigned byte_check12(const ui8 *a);
+
+namespace mlkem_ref { MLKEM_KERNEL_DECLS }
+
+// kernels_portable.cpp: the polynomial arithmetic only, on compiler
+// vector extensions or (MLKEM_PORTABLE_SWAR, or no GCC/Clang) on SWAR
+// words; dispatch.cpp fills in the rest from mlkem_ref.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(MLKEM_PORTABLE_SWAR)
+#define MLKEM_PORTABLE_VECTOR
+#endif
+
+namespace mlkem_portable {
+    void ntt(i16 *r);
+    void invntt(i16 *r);
+    void decompress_ntt(i16 *r, const ui8 *a, int d);
+    void invntt_add_compress(ui8 *r, i16 *a, const i16 *b, int d, int negate);
+    void basemul(i16 *r, const i16 *a, const i16 *b);
+    void poly_reduce(i16 *r);
+    void poly_tomont(i16 *r);
+    void cbd(i16 *r, const ui8 *buf, int eta);
+}
+
+#ifdef MLKEM_HAVE_AVX2
+namespace mlkem_avx2 { MLKEM_KERNEL_DECLS }
+#endif
+
+#ifdef MLKEM_HAVE_AVX512
+namespace mlkem_avx512 { MLKEM_KERNEL_DECLS }
+#endif
@@ -0,0 +1,791 @@
+// kernels_portable.cpp
+//
+// The "portable" backend: the polynomial arithmetic kernels (ntt, invntt,
+// basemul, poly_reduce, poly_tomont, cbd and the fused (de)compression
+// kernels) written once against an eight-lane int16 vector type, pv.
+// With GCC or Clang pv is a vector_size(16) vector and the same source
+// becomes SSE2 on baseline x86-64, NEON on AArch64 and so on; without
+// vector extensions, or when built with MLKEM_PORTABLE_SWAR, pv is two
+// uint64_t words of four coefficients each with SWAR additions and
+// lane-wise multiplies. Every kernel gives exactly the results of the
+// reference kernels in kernels.cpp, whose arithmetic it mirrors
+// butterfly for butterfly. Keccak, rejection sampling and the byte
+// packing come from mlkem_ref (see dispatch.cpp).
+#include "kernels.hpp"
+#include "ntt.hpp"
+
+#include <string.h>
+
+#if defined(MLKEM_PORTABLE_VECTOR) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace mlkem_portable {
+
+#ifdef MLKEM_PORTABLE_VECTOR
+typedef int16_t pv __attribute__((vector_size(16)));
+typedef uint16_t pvu __attribute__((vector_size(16)));
+typedef int32_t pv32 __attribute__((vector_size(32)));
+typedef int32_t pvd __attribute__((vector_size(16)));
+typedef uint32_t pvu32 __attribute__((vector_size(32)));
+
+#if defined(__clang__) || __GNUC__ >= 12
+#define PV_SHUFFLE(a, b, ...) __builtin_shufflevector(a, b, __VA_ARGS__)
+#define PV_SHUFFLE32(a, b, ...) (pv)__builtin_shufflevector((pvd)a, (pvd)b, __VA_ARGS__)
+#else
+#define PV_SHUFFLE(a, b, ...) __builtin_shuffle(a, b, (pv){__VA_ARGS__})
+#define PV_SHUFFLE32(a, b, ...) (pv)__builtin_shuffle((pvd)a, (pvd)b, (pvd){__VA_ARGS__})
+#endif
+
+static inline pv pv_load(const int16_t *p) { pv v; memcpy(&v, p, sizeof v); return v; }
+static inline void pv_store(int16_t *p, pv v) { memcpy(p, &v, sizeof v); }
+static inline pv pv_set1(int16_t x) { return (pv){x, x, x, x, x, x, x, x}; }
+
+// Lane arithmetic wraps modulo 2^16, as the int16_t assignments in the
+// reference kernels do, so additions and low products are done unsigned.
+static inline pv pv_add(pv a, pv b) { return (pv)((pvu)a + (pvu)b); }
+static inline pv pv_sub(pv a, pv b) { return (pv)((pvu)a - (pvu)b); }
+static inline pv pv_mullo(pv a, pv b) { return (pv)((pvu)a * (pvu)b); }
+
+// The one operation vector extensions lack. Widening to 32-bit lanes
+// compiles to a long unpack/multiply/pack sequence, so SSE2 targets use
+// pmulhw; elsewhere the per-lane form is left to the vectorizer.
+static inline pv pv_mulhi(pv a, pv b) {
+#ifdef __SSE2__
+  return (pv)_mm_mulhi_epi16((__m128i)a, (__m128i)b);
+#else
+  pv r;
+  for(int i = 0; i < 8; i++) r[i] = (int16_t)(((int32_t)a[i] * b[i]) >> 16);
+  return r;
+#endif
+}
+
+template<int N>
+static inline pv pv_srai(pv a) { return a >> N; }
+
+// Permutations of lane pairs are written on 32-bit lanes, where the
+// compilers find two-instruction SSE2 sequences they miss for 16-bit ones.
+// Pairs 0-1 of a and b / pairs 2-3 of a and b
+static inline pv pv_lohalves(pv a, pv b) { return PV_SHUFFLE32(a, b, 0, 1, 4, 5); }
+static inline pv pv_hihalves(pv a, pv b) { return PV_SHUFFLE32(a, b, 2, 3, 6, 7); }
+// Pairs 0, 2 / 1, 3 of a then of b
+static inline pv pv_evenpairs(pv a, pv b) { return PV_SHUFFLE32(a, b, 0, 2, 4, 6); }
+static inline pv pv_oddpairs(pv a, pv b) { return PV_SHUFFLE32(a, b, 1, 3, 5, 7); }
+// Pairs of a and b interleaved, from pairs 0, 2 / 1, 3
+static inline pv pv_zippairs02(pv a, pv b) { return PV_SHUFFLE32(a, b, 0, 4, 2, 6); }
+static inline pv pv_zippairs13(pv a, pv b) { return PV_SHUFFLE32(a, b, 1, 5, 3, 7); }
+// Pairs of a and b interleaved, from pairs 0, 1 / 2, 3
+static inline pv pv_zippairs01(pv a, pv b) { return PV_SHUFFLE32(a, b, 0, 4, 1, 5); }
+static inline pv pv_zippairs23(pv a, pv b) { return PV_SHUFFLE32(a, b, 2, 6, 3, 7); }
+// Even / odd lanes of a then of b, and the inverse interleave
+static inline pv pv_even(pv a, pv b) { return PV_SHUFFLE(a, b, 0, 2, 4, 6, 8, 10, 12, 14); }
+static inline pv pv_odd(pv a, pv b) { return PV_SHUFFLE(a, b, 1, 3, 5, 7, 9, 11, 13, 15); }
+static inline pv pv_ziplo(pv e, pv o) { return PV_SHUFFLE(e, o, 0, 8, 1, 9, 2, 10, 3, 11); }
+static inline pv pv_ziphi(pv e, pv o) { return PV_SHUFFLE(e, o, 4, 12, 5, 13, 6, 14, 7, 15); }
+
+template<int D>
+static inline pv pv_decompress(pv x) {
+  return __builtin_convertvector((__builtin_convertvector(x, pv32) * Kyber_Q + (1 << (D - 1))) >> D, pv);
+}
+
+// ((w << d) + q/2) / q for w in [0,q] is ((w << d) + q/2) * M >> 29 with
+// M = ceil(2^29/q), exactly for every such w and d <= 11. The product
+// needs 41 bits, so it is taken apart at bit 29 - d of w*M: the high
+// part shifts down directly, and the low part shifted up by d plus
+// (q/2)*M stays below 2^30.
+static inline pv pv_compress(pv w, int d) {
+  const uint32_t M = ((1U << 29) + Kyber_Q - 1) / Kyber_Q;
+  const pvu32 a = __builtin_convertvector(w, pvu32) * M;
+  const pvu32 y = (a >> (29 - d)) + ((((a & ((1U << (29 - d)) - 1)) << d) + Kyber_Q/2 * M) >> 29);
+  return __builtin_convertvector(y, pv) & pv_set1((1 << d) - 1);
+}
+#else
+// Four 16-bit lanes per word, lane i at bits 16*i.
+struct pv{ u64 w[2]; };
+
+static const u64 PV_ONES = 0x0001000100010001ULL;
+static const u64 PV_HIGH = 0x8000800080008000ULL;
+
+static inline int16_t pv_lane(pv a, int i) { return (int16_t)(a.w[i >> 2] >> (16 * (i & 3))); }
+
+static inline pv pv_load(const int16_t *p) {
+  pv v;
+  for(int h = 0; h < 2; h++)
+    v.w[h] = (u64)(uint16_t)p[4*h] | (u64)(uint16_t)p[4*h+1] << 16
+           | (u64)(uint16_t)p[4*h+2] << 32 | (u64)(uint16_t)p[4*h+3] << 48;
+  return v;
+}
+
+static inline void pv_store(int16_t *p, pv v) {
+  for(int i = 0; i < 8; i++) p[i] = pv_lane(v, i);
+}
+
+static inline pv pv_set1(int16_t x) { return {{(uint16_t)x * PV_ONES, (uint16_t)x * PV_ONES}}; }
+
+static inline pv pv_add(pv a, pv b) {
+  pv r;
+  for(int h = 0; h < 2; h++)
+    r.w[h] = ((a.w[h] & ~PV_HIGH) + (b.w[h] & ~PV_HIGH)) ^ ((a.w[h] ^ b.w[h]) & PV_HIGH);
+  return r;
+}
+
+static inline pv pv_sub(pv a, pv b) {
+  pv r;
+  for(int h = 0; h < 2; h++)
+    r.w[h] = ((a.w[h] | PV_HIGH) - (b.w[h] & ~PV_HIGH)) ^ ((a.w[h] ^ ~b.w[h]) & PV_HIGH);
+  return r;
+}
+
+static inline pv pv_mullo(pv a, pv b) {
+  int16_t r[8];
+  for(int i = 0; i < 8; i++) r[i] = (int16_t)(pv_lane(a, i) * pv_lane(b, i));
+  return pv_load(r);
+}
+
+static inline pv pv_mulhi(pv a, pv b) {
+  int16_t r[8];
+  for(int i = 0; i < 8; i++) r[i] = (int16_t)(((int32_t)pv_lane(a, i) * pv_lane(b, i)) >> 16);
+  return pv_load(r);
+}
+
+// Logical shift, then sign extension as (t ^ s) - s on the moved sign bits
+template<int N>
+static inline pv pv_srai(pv a) {
+  const u64 keep = (u64)(0xFFFFu >> N) * PV_ONES;
+  pv t, s;
+  for(int h = 0; h < 2; h++) {
+    s.w[h] = (a.w[h] & PV_HIGH) >> N;
+    t.w[h] = ((a.w[h] >> N) & keep) ^ s.w[h];
+  }
+  return pv_sub(t, s);
+}
+
+static inline pv operator&(pv a, pv b) { return {{a.w[0] & b.w[0], a.w[1] & b.w[1]}}; }
+
+static inline u64 lo32(u64 x) { return x & 0xFFFFFFFFu; }
+static inline u64 hi32(u64 x) { return x >> 32; }
+
+static inline pv pv_lohalves(pv a, pv b) { return {{a.w[0], b.w[0]}}; }
+static inline pv pv_hihalves(pv a, pv b) { return {{a.w[1], b.w[1]}}; }
+static inline pv pv_evenpairs(pv a, pv b) {
+  return {{lo32(a.w[0]) | lo32(a.w[1]) << 32, lo32(b.w[0]) | lo32(b.w[1]) << 32}};
+}
+static inline pv pv_oddpairs(pv a, pv b) {
+  return {{hi32(a.w[0]) | hi32(a.w[1]) << 32, hi32(b.w[0]) | hi32(b.w[1]) << 32}};
+}
+static inline pv pv_zippairs02(pv a, pv b) {
+  return {{lo32(a.w[0]) | lo32(b.w[0]) << 32, lo32(a.w[1]) | lo32(b.w[1]) << 32}};
+}
+static inline pv pv_zippairs13(pv a, pv b) {
+  return {{hi32(a.w[0]) | hi32(b.w[0]) << 32, hi32(a.w[1]) | hi32(b.w[1]) << 32}};
+}
+static inline pv pv_zippairs01(pv a, pv b) {
+  return {{lo32(a.w[0]) | lo32(b.w[0]) << 32, hi32(a.w[0]) | hi32(b.w[0]) << 32}};
+}
+static inline pv pv_zippairs23(pv a, pv b) {
+  return {{lo32(a.w[1]) | lo32(b.w[1]) << 32, hi32(a.w[1]) | hi32(b.w[1]) << 32}};
+}
+
+// Lanes 0 and 2 / 1 and 3 of a word packed into 32 bits, and back
+static inline u64 even16(u64 x) { return (x & 0xFFFF) | ((x >> 16) & 0xFFFF0000u); }
+static inline u64 odd16(u64 x) { return ((x >> 16) & 0xFFFF) | ((x >> 32) & 0xFFFF0000u); }
+static inline u64 zip16(u64 e, u64 o) {
+  return (e & 0xFFFF) | (o & 0xFFFF) << 16 | (e >> 16) << 32 | (o >> 16) << 48;
+}
+
+static inline pv pv_even(pv a, pv b) {
+  return {{even16(a.w[0]) | even16(a.w[1]) << 32, even16(b.w[0]) | even16(b.w[1]) << 32}};
+}
+static inline pv pv_odd(pv a, pv b) {
+  return {{odd16(a.w[0]) | odd16(a.w[1]) << 32, odd16(b.w[0]) | odd16(b.w[1]) << 32}};
+}
+static inline pv pv_ziplo(pv e, pv o) {
+  return {{zip16(lo32(e.w[0]), lo32(o.w[0])), zip16(hi32(e.w[0]), hi32(o.w[0]))}};
+}
+static inline pv pv_ziphi(pv e, pv o) {
+  return {{zip16(lo32(e.w[1]), lo32(o.w[1])), zip16(hi32(e.w[1]), hi32(o.w[1]))}};
+}
+
+template<int D>
+static inline pv pv_decompress(pv x) {
+  int16_t r[8];
+  for(int i = 0; i < 8; i++) r[i] = ((uint32_t)pv_lane(x, i) * Kyber_Q + (1U << (D - 1))) >> D;
+  return pv_load(r);
+}
+
+static inline pv pv_compress(pv w, int d) {
+  int16_t r[8];
+  for(int i = 0; i < 8; i++)
+    r[i] = ((((uint32_t)pv_lane(w, i) << d) + Kyber_Q/2) / Kyber_Q) & ((1U << d) - 1);
+  return pv_load(r);
+}
+#endif
+
+// Montgomery multiplication and Barrett reduction in the 16-bit
+// high/low product form of kernels.cpp (k_fqmul, k_barrett_reduce).
+static inline int16_t fqmul(int16_t a, int16_t b) {
+  int16_t u = (int16_t)(a*b)*QINV;
+  return (int16_t)(((int32_t)a*b) >> 16) - (int16_t)(((int32_t)u*Kyber_Q) >> 16);
+}
+
+static inline int16_t barrett_reduce(int16_t a) {
+  const int16_t v = ((1U << 26) + Kyber_Q/2)/Kyber_Q;
+  int16_t t = (int16_t)(((int32_t)v*a) >> 16) >> 10;
+  return a - (int16_t)(t*Kyber_Q);
+}
+
+#ifdef MLKEM_PORTABLE_VECTOR
+static inline pv pv_fqmul(pv a, pv b) {
+  const pv u = pv_mullo(pv_mullo(a, b), pv_set1((int16_t)QINV));
+  return pv_sub(pv_mulhi(a, b), pv_mulhi(u, pv_set1(Kyber_Q)));
+}
+
+static inline pv pv_barrett(pv a) {
+  const pv t = pv_srai<10>(pv_mulhi(a, pv_set1(((1U << 26) + Kyber_Q/2)/Kyber_Q)));
+  return pv_sub(a, pv_mullo(t, pv_set1(Kyber_Q)));
+}
+
+// round(a*b / 2^15) = floor((floor(a*b / 2^14) + 1) / 2), with
+// floor(a*b / 2^14) from the high and the top two bits of the low
+// product. It fits in 16 bits for |a*b| < 2^29 - 2^14, which holds for
+// the Shoup quotients (|wq| <= 16379).
+static inline pv pv_mulhrs(pv a, pv b) {
+  const pv lo = pv_mullo(a, b), hi = pv_mulhi(a, b);
+  const pv top = pv_srai<14>(lo) & pv_set1(3);
+  return pv_srai<1>(pv_add(pv_add(pv_add(hi, hi), pv_add(hi, hi)), pv_add(top, pv_set1(1))));
+}
+#else
+// Every SWAR multiply splits the words into lanes and merges them back,
+// so whole formulas are applied per lane instead of composed from
+// pv_mullo and pv_mulhi.
+static inline pv pv_fqmul(pv a, pv b) {
+  int16_t r[8];
+  for(int i = 0; i < 8; i++) r[i] = fqmul(pv_lane(a, i), pv_lane(b, i));
+  return pv_load(r);
+}
+
+static inline pv pv_barrett(pv a) {
+  int16_t r[8];
+  for(int i = 0; i < 8; i++) r[i] = barrett_reduce(pv_lane(a, i));
+  return pv_load(r);
+}
+
+static inline pv pv_mulhrs(pv a, pv b) {
+  int16_t r[8];
+  for(int i = 0; i < 8; i++) r[i] = (int16_t)(((int32_t)pv_lane(a, i) * pv_lane(b, i) + (1 << 14)) >> 15);
+  return pv_load(r);
+}
+#endif
+
+// Twiddle vectors: Montgomery-form zetas, or with MLKEM_SHOUP_NTT the
+// Shoup pairs of ntt.cpp, as k_twiddle in kernels.cpp.
+#ifdef MLKEM_SHOUP_NTT
+struct pvtw{ pv w, wq; };
+
+static inline pvtw tw_fwd(unsigned i) { return {pv_set1(zetas_shoup[i][0]), pv_set1(zetas_shoup[i][1])}; }
+static inline pvtw tw_inv(unsigned i) { return {pv_set1(zetas_inv_shoup[i][0]), pv_set1(zetas_inv_shoup[i][1])}; }
+static inline pvtw tw_neg(pvtw z) { return {pv_sub(pv_set1(0), z.w), pv_sub(pv_set1(0), z.wq)}; }
+static inline pvtw tw_scale() { return tw_inv(127); }
+static inline pvtw tw_scaled_zeta() { return tw_inv(126); }
+
+static inline pvtw tw_gather(const int16_t (*tab)[2], const unsigned *idx) {
+  int16_t w[8], wq[8];
+  for(int i = 0; i < 8; i++) { w[i] = tab[idx[i]][0]; wq[i] = tab[idx[i]][1]; }
+  return {pv_load(w), pv_load(wq)};
+}
+
+static inline pv pv_twmul(pv x, pvtw z) {
+  return pv_sub(pv_mullo(x, z.w), pv_mullo(pv_mulhrs(x, z.wq), pv_set1(Kyber_Q)));
+}
+#define PV_ZETAS zetas_shoup
+#define PV_ZETAS_INV zetas_inv_shoup
+#else
+typedef pv pvtw;
+
+static inline pvtw tw_fwd(unsigned i) { return pv_set1(zetas[i]); }
+static inline pvtw tw_inv(unsigned i) { return pv_set1(zetas_inv[i]); }
+static inline pvtw tw_neg(pvtw z) { return pv_sub(pv_set1(0), z); }
+static inline pvtw tw_scale() { return tw_inv(127); }
+static inline pvtw tw_scaled_zeta() { return pv_set1(fqmul(zetas_inv[126], zetas_inv[127])); }
+
+static inline pvtw tw_gather(const int16_t *tab, const unsigned *idx) {
+  int16_t w[8];
+  for(int i = 0; i < 8; i++) w[i] = tab[idx[i]];
+  return pv_load(w);
+}
+
+static inline pv pv_twmul(pv x, pvtw z) { return pv_fqmul(z, x); }
+#define PV_ZETAS zetas
+#define PV_ZETAS_INV zetas_inv
+#endif
+
+/*************************************************
+* Name:        pv_tables
+*
+* Description: Per-lane twiddles of the two innermost NTT layers and of
+*              basemul, gathered once from the scalar tables. Entry n
+*              serves the vector pair holding coefficients 16n..16n+15,
+*              in the lane order the butterflies see them (see
+*              ntt_inner / invntt_inner).
+**************************************************/
+struct pv_tables{
+  pvtw fwd4[16], fwd2[16], inv4[16], inv2[16];
+  pv bm[16];
+
+  pv_tables() {
+    for(unsigned n = 0; n < 16; n++) {
+      const unsigned b = 4*n;
+      const unsigned l4[8] = {2*n, 2*n, 2*n, 2*n, 2*n+1, 2*n+1, 2*n+1, 2*n+1};
+      const unsigned l2[8] = {b, b, b+2, b+2, b+1, b+1, b+3, b+3};
+      unsigned f4[8], f2[8], i4[8];
+      int16_t z[8];
+      for(int i = 0; i < 8; i++) {
+        f4[i] = 32 + l4[i];
+        f2[i] = 64 + l2[i];
+        i4[i] = 64 + l4[i];
+        z[i] = (i & 1) ? -zetas[64 + 4*n + i/2] : zetas[64 + 4*n + i/2];
+      }
+      fwd4[n] = tw_gather(PV_ZETAS, f4);
+      fwd2[n] = tw_gather(PV_ZETAS, f2);
+      inv4[n] = tw_gather(PV_ZETAS_INV, i4);
+      inv2[n] = tw_gather(PV_ZETAS_INV, l2);
+      bm[n] = pv_load(z);
+    }
+  }
+};
+
+// Built on first use rather than at load, since the self-test and the
+// dispatcher can run kernels from other objects' static initializers.
+static const pv_tables &tables() {
+  static const pv_tables t;
+  return t;
+}
+
+static inline void fwd_butterfly(pv &a, pv &b, pvtw z) {
+  const pv t = pv_twmul(b, z);
+  b = pv_sub(a, t);
+  a = pv_add(a, t);
+}
+
+template<bool REDUCE>
+static inline void inv_butterfly(pv &a, pv &b, pvtw z) {
+  const pv t = a;
+  a = REDUCE ? pv_barrett(pv_add(t, b)) : pv_add(t, b);
+  b = pv_twmul(pv_sub(t, b), z);
+}
+
+/*************************************************
+* Name:        ntt_inner / invntt_inner
+*
+* Description: The length-4 and length-2 NTT layers on the sixteen
+*              coefficients in v0, v1 (vectors 2n and 2n+1). The
+*              partners of a butterfly sit in one vector, so each layer
+*              first regroups the lanes into two vectors holding the
+*              low and the high partners.
+*
+* Arguments:   - pv &v0, &v1: coefficients 16n..16n+15
+*              - unsigned n: index of the pair
+**************************************************/
+static inline void ntt_inner(pv &v0, pv &v1, const pv_tables &tab, unsigned n) {
+  pv x = pv_lohalves(v0, v1), y = pv_hihalves(v0, v1);
+  fwd_butterfly(x, y, tab.fwd4[n]);
+  pv x2 = pv_evenpairs(x, y), y2 = pv_oddpairs(x, y);
+  fwd_butterfly(x2, y2, tab.fwd2[n]);
+  v0 = pv_zippairs02(x2, y2);
+  v1 = pv_zippairs13(x2, y2);
+}
+
+static inline void invntt_inner(pv &v0, pv &v1, const pv_tables &tab, unsigned n) {
+  pv x2 = pv_zippairs02(v0, v1), y2 = pv_zippairs13(v0, v1);
+  inv_butterfly<true>(x2, y2, tab.inv2[n]);
+  pv x = pv_zippairs01(x2, y2), y = pv_zippairs23(x2, y2);
+  inv_butterfly<false>(x, y, tab.inv4[n]);
+  v0 = pv_lohalves(x, y);
+  v1 = pv_hihalves(x, y);
+}
+
+/*************************************************
+* Name:        ntt
+*
+* Description: Forward NTT in two passes, as the reference kernel's
+*              layer grouping with whole vectors for lanes: lengths
+*              128/64/32 on groups of eight vectors at stride four, then
+*              per block of 32 coefficients lengths 16/8 between its
+*              four vectors and 4/2 inside them (ntt_inner).
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+**************************************************/
+void ntt(i16 *r) {
+  const pv_tables &tab = tables();
+  pv v[8];
+
+  for(unsigned j = 0; j < 4; j++) {
+    for(unsigned i = 0; i < 8; i++) v[i] = pv_load(r + 8*(j + 4*i));
+    for(unsigned i = 0; i < 4; i++) fwd_butterfly(v[i], v[i + 4], tw_fwd(1));
+    for(unsigned i = 0; i < 2; i++) {
+      fwd_butterfly(v[i], v[i + 2], tw_fwd(2));
+      fwd_butterfly(v[i + 4], v[i + 6], tw_fwd(3));
+    }
+    for(unsigned i = 0; i < 8; i += 2) fwd_butterfly(v[i], v[i + 1], tw_fwd(4 + i/2));
+    for(unsigned i = 0; i < 8; i++) pv_store(r + 8*(j + 4*i), v[i]);
+  }
+  for(unsigned b = 0; b < 8; b++) {
+    for(unsigned i = 0; i < 4; i++) v[i] = pv_load(r + 32*b + 8*i);
+    fwd_butterfly(v[0], v[2], tw_fwd(8 + b));
+    fwd_butterfly(v[1], v[3], tw_fwd(8 + b));
+    fwd_butterfly(v[0], v[1], tw_fwd(16 + 2*b));
+    fwd_butterfly(v[2], v[3], tw_fwd(17 + 2*b));
+    ntt_inner(v[0], v[1], tab, 2*b);
+    ntt_inner(v[2], v[3], tab, 2*b + 1);
+    for(unsigned i = 0; i < 4; i++) pv_store(r + 32*b + 8*i, v[i]);
+  }
+}
+
+/*************************************************
+* Name:        invntt_to32
+*
+* Description: Inverse NTT layers 1..4 (lengths 2 up to 16) per block of
+*              32 coefficients, with the sums of layers 1 and 4
+*              Barrett-reduced as in the reference invntt_to64.
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+**************************************************/
+static inline void invntt_to32(int16_t *r) {
+  const pv_tables &tab = tables();
+  pv v[4];
+
+  for(unsigned b = 0; b < 8; b++) {
+    for(unsigned i = 0; i < 4; i++) v[i] = pv_load(r + 32*b + 8*i);
+    invntt_inner(v[0], v[1], tab, 2*b);
+    invntt_inner(v[2], v[3], tab, 2*b + 1);
+    inv_butterfly<false>(v[0], v[1], tw_inv(96 + 2*b));
+    inv_butterfly<false>(v[2], v[3], tw_inv(97 + 2*b));
+    inv_butterfly<true>(v[0], v[2], tw_inv(112 + b));
+    inv_butterfly<true>(v[1], v[3], tw_inv(112 + b));
+    for(unsigned i = 0; i < 4; i++) pv_store(r + 32*b + 8*i, v[i]);
+  }
+}
+
+// Lengths 32 and 64 on a group of eight vectors at stride four
+static inline void invntt_32_64(pv *v) {
+  for(unsigned i = 0; i < 8; i += 2) inv_butterfly<false>(v[i], v[i + 1], tw_inv(120 + i/2));
+  for(unsigned i = 0; i < 2; i++) {
+    inv_butterfly<false>(v[i], v[i + 2], tw_inv(124));
+    inv_butterfly<false>(v[i + 4], v[i + 6], tw_inv(125));
+  }
+}
+
+/*************************************************
+* Name:        invntt
+*
+* Description: Inplace inverse number-theoretic transform in Rq and
+*              multiplication by Montgomery factor 2^16, with the final
+*              scaling folded into the length-128 layer as in the
+*              reference kernel.
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+**************************************************/
+void invntt(i16 *r) {
+  const pvtw f = tw_scale(), zf = tw_scaled_zeta();
+  pv v[8], t;
+
+  invntt_to32(r);
+  for(unsigned j = 0; j < 4; j++) {
+    for(unsigned i = 0; i < 8; i++) v[i] = pv_load(r + 8*(j + 4*i));
+    invntt_32_64(v);
+    for(unsigned i = 0; i < 4; i++) {
+      t = v[i];
+      v[i] = pv_twmul(pv_add(t, v[i + 4]), f);
+      v[i + 4] = pv_twmul(pv_sub(t, v[i + 4]), zf);
+    }
+    for(unsigned i = 0; i < 8; i++) pv_store(r + 8*(j + 4*i), v[i]);
+  }
+}
+
+/*************************************************
+* Name:        unpack8 / pack8
+*
+* Description: Eight D-bit values to and from the D bytes that hold them,
+*              LSB first. pack8 builds two 4D-bit halves in 64-bit words
+*              rather than one 128-bit value as kernels.cpp does, which
+*              is about three times faster and needs no __int128.
+*
+* Arguments:   - uint32_t v[8]: values
+*              - ui8 *p: D bytes
+**************************************************/
+template<int D>
+static inline void unpack8(uint32_t *v, const ui8 *p) {
+  for(int i = 0; i < 8; i++) {
+    const int off = (D*i) >> 3, sh = (D*i) & 7;
+    uint32_t w = p[off];
+    if(sh + D > 8) w |= (uint32_t)p[off+1] << 8;
+    if(sh + D > 16) w |= (uint32_t)p[off+2] << 16;
+    v[i] = (w >> sh) & ((1U << D) - 1);
+  }
+}
+
+template<int D>
+static inline void pack8(ui8 *p, const uint32_t *v) {
+  u64 lo = 0, hi = 0;
+  for(int i = 0; i < 4; i++) {
+    lo |= (u64)v[i] << (D*i);
+    hi |= (u64)v[i + 4] << (D*i);
+  }
+  lo |= hi << (4*D);
+  for(int i = 0; i < D && i < 8; i++) p[i] = (ui8)(lo >> (8*i));
+  for(int i = 8; i < D; i++) p[i] = (ui8)(hi >> (8*i - 4*D));
+}
+
+template<int D>
+static void decompress_d(int16_t *r, const ui8 *a) {
+  uint32_t x[8];
+  int16_t t[8];
+
+  for(int g = 0; g < 32; g++) {
+    unpack8<D>(x, a + D*g);
+    for(int i = 0; i < 8; i++) t[i] = (int16_t)x[i];
+    pv_store(r + 8*g, pv_decompress<D>(pv_load(t)));
+  }
+}
+
+/*************************************************
+* Name:        decompress_ntt
+*
+* Description: ByteDecode_d and Decompress_d eight coefficients at a
+*              time, then ntt. Widths other than 1, 4, 5, 10 and 11 are
+*              decoded by the reference kernel.
+*
+* Arguments:   - int16_t r[256]: output polynomial (NTT domain)
+*              - const ui8 *a: input buffer of 32*d bytes
+*              - int d: bits per coefficient (1..11)
+**************************************************/
+void decompress_ntt(i16 *r, const ui8 *a, int d) {
+  unsigned int i;
+
+  switch(d) {
+    case 1: decompress_d<1>(r, a); break;
+    case 4: decompress_d<4>(r, a); break;
+    case 5: decompress_d<5>(r, a); break;
+    case 10: decompress_d<10>(r, a); break;
+    case 11: decompress_d<11>(r, a); break;
+    default:
+      mlkem_ref::byte_decode(r, a, d);
+      for(i = 0; i < Kyber_N; i++)
+        r[i] = ((uint32_t)r[i] * Kyber_Q + (1U << (d - 1))) >> d;
+  }
+  ntt(r);
+}
+
+template<int D>
+static inline void pack_compressed(ui8 *p, pv w) {
+  uint32_t x[8];
+  int16_t t[8];
+
+  pv_store(t, pv_compress(w, D));
+  for(int i = 0; i < 8; i++) x[i] = (uint16_t)t[i];
+  pack8<D>(p, x);
+}
+
+/*************************************************
+* Name:        add_compress
+*
+* Description: Body of invntt_add_compress after the first four layers:
+*              per group of eight vectors at stride four, layers 5 and 6,
+*              then the last layer, the addition of b, Barrett reduction
+*              and Compress_d. With D = 1, 4, 5, 10 or 11 the results are
+*              packed straight into r; with D = 0 they go back to a.
+**************************************************/
+template<int D>
+static void add_compress(ui8 *r, int16_t *a, const int16_t *b, int d, pvtw f, pvtw zf) {
+  pv v[8], w0, w1;
+
+  for(unsigned j = 0; j < 4; j++) {
+    for(unsigned i = 0; i < 8; i++) v[i] = pv_load(a + 8*(j + 4*i));
+    invntt_32_64(v);
+    for(unsigned i = 0; i < 4; i++) {
+      const unsigned g = j + 4*i;
+      w0 = pv_barrett(pv_add(pv_load(b + 8*g), pv_twmul(pv_add(v[i], v[i + 4]), f)));
+      w1 = pv_barrett(pv_add(pv_load(b + 8*g + 128), pv_twmul(pv_sub(v[i], v[i + 4]), zf)));
+      if(D) {
+        pack_compressed<D>(r + D*g, w0);
+        pack_compressed<D>(r + D*(g + 16), w1);
+      } else {
+        pv_store(a + 8*g, pv_compress(w0, d));
+        pv_store(a + 8*g + 128, pv_compress(w1, d));
+      }
+    }
+  }
+}
+
+/*************************************************
+* Name:        invntt_add_compress
+*
+* Description: Computes ByteEncode_d(Compress_d(b + s*invntt(a))), s = 1
+*              or -1 when negate is set, like the reference kernel: the
+*              last invNTT layer runs with the sign and scaling folded
+*              into its constants and its outputs are reduced, compressed
+*              and packed while the group is in registers (add_compress).
+*              Other widths are packed by the reference byte_encode.
+*
+* Arguments:   - ui8 *r: output buffer of 32*d bytes
+*              - int16_t a[256]: NTT-domain input, |a| < 2^14; clobbered
+*              - const int16_t b[256]: polynomial to add, |b| < 2^15 - q
+*              - int d: bits per coefficient (1..11)
+*              - int negate: subtract invntt(a) from b instead of adding
+**************************************************/
+void invntt_add_compress(ui8 *r, i16 *a, const i16 *b, int d, int negate) {
+  const pvtw f = negate ? tw_neg(tw_scale()) : tw_scale();
+  const pvtw zf = negate ? tw_neg(tw_scaled_zeta()) : tw_scaled_zeta();
+
+  invntt_to32(a);
+  switch(d) {
+    case 1: add_compress<1>(r, a, b, d, f, zf); return;
+    case 4: add_compress<4>(r, a, b, d, f, zf); return;
+    case 5: add_compress<5>(r, a, b, d, f, zf); return;
+    case 10: add_compress<10>(r, a, b, d, f, zf); return;
+    case 11: add_compress<11>(r, a, b, d, f, zf); return;
+  }
+  add_compress<0>(r, a, b, d, f, zf);
+  mlkem_ref::byte_encode(r, a, d);
+}
+
+/*************************************************
+* Name:        basemul
+*
+* Description: Pointwise multiplication of two polynomials in NTT domain,
+*              sixteen coefficients (eight products in Zq[X]/(X^2-zeta))
+*              at a time: even and odd coefficients are split into
+*              separate vectors, multiplied with the reference kernel's
+*              formulas and interleaved back.
+*
+* Arguments:   - int16_t r[256]: output polynomial
+*              - const int16_t a[256]: first factor
+*              - const int16_t b[256]: second factor
+**************************************************/
+void basemul(i16 *r, const i16 *a, const i16 *b) {
+  const pv_tables &tab = tables();
+
+  for(unsigned n = 0; n < 16; n++) {
+    const pv a0 = pv_load(a + 16*n), a1 = pv_load(a + 16*n + 8);
+    const pv b0 = pv_load(b + 16*n), b1 = pv_load(b + 16*n + 8);
+    const pv ae = pv_even(a0, a1), ao = pv_odd(a0, a1);
+    const pv be = pv_even(b0, b1), bo = pv_odd(b0, b1);
+    const pv re = pv_add(pv_fqmul(pv_fqmul(ao, bo), tab.bm[n]), pv_fqmul(ae, be));
+    const pv ro = pv_add(pv_fqmul(ae, bo), pv_fqmul(ao, be));
+    pv_store(r + 16*n, pv_ziplo(re, ro));
+    pv_store(r + 16*n + 8, pv_ziphi(re, ro));
+  }
+}
+
+/*************************************************
+* Name:        poly_reduce
+*
+* Description: Applies Barrett reduction to all coefficients
+*
+* Arguments:   - int16_t r[256]: input/output polynomial
+**************************************************/
+void poly_reduce(i16 *r) {
+  for(unsigned i = 0; i < Kyber_N; i += 8)
+    pv_store(r + i, pv_barrett(pv_load(r + i)));
+}
+
+/*************************************************
+* Name:        poly_tomont
+*
+* Description: Inplace conversion of all coefficients of a polynomial
+*              from normal domain to Montgomery domain
+*
+* Arguments:   - int16_t r[256]: input/output polynomial
+**************************************************/
+void poly_tomont(i16 *r) {
+  const pv f = pv_set1((1ULL << 32) % Kyber_Q);
+  for(unsigned i = 0; i < Kyber_N; i += 8)
+    pv_store(r + i, pv_fqmul(pv_load(r + i), f));
+}
+
+/*************************************************
+* Name:        cbd2
+*
+* Description: CBD_2 on 32 coefficients from 16 bytes. In each 16-bit
+*              lane the pairwise bit sums give four a - b values at
+*              nibble offsets; coefficient k of every lane is extracted
+*              across all lanes at once, and two rounds of interleaving
+*              put the four results back in coefficient order.
+*
+* Arguments:   - int16_t r[32]: output coefficients
+*              - const ui8 *buf: 16 bytes
+**************************************************/
+static inline void cbd2(int16_t *r, const ui8 *buf) {
+  const pv m1 = pv_set1(0x5555), m2 = pv_set1(3), q = pv_set1(Kyber_Q);
+  int16_t w[8];
+  pv c[4];
+
+  for(int i = 0; i < 8; i++) w[i] = (int16_t)(buf[2*i] | buf[2*i + 1] << 8);
+  const pv t = pv_load(w);
+  const pv d = pv_add(t & m1, pv_srai<1>(t) & m1);
+  c[0] = pv_sub(d & m2, pv_srai<2>(d) & m2);
+  c[1] = pv_sub(pv_srai<4>(d) & m2, pv_srai<6>(d) & m2);
+  c[2] = pv_sub(pv_srai<8>(d) & m2, pv_srai<10>(d) & m2);
+  c[3] = pv_sub(pv_srai<12>(d) & m2, pv_srai<14>(d) & m2);
+  for(int k = 0; k < 4; k++) c[k] = pv_add(c[k], pv_srai<15>(c[k]) & q);
+
+  const pv e0 = pv_ziplo(c[0], c[1]), e1 = pv_ziphi(c[0], c[1]);
+  const pv f0 = pv_ziplo(c[2], c[3]), f1 = pv_ziphi(c[2], c[3]);
+  pv_store(r, pv_zippairs01(e0, f0));
+  pv_store(r + 8, pv_zippairs23(e0, f0));
+  pv_store(r + 16, pv_zippairs01(e1, f1));
+  pv_store(r + 24, pv_zippairs23(e1, f1));
+}
+
+/*************************************************
+* Name:        cbd3
+*
+* Description: CBD_3 on eight coefficients from six bytes, on one 64-bit
+*              word: after the bit counting every 6-bit field holds
+*              a + 4 - b of one coefficient (the subtraction cannot
+*              borrow across fields), two shift-and-mask steps spread the
+*              fields into 16-bit lanes, and lanes below 4 get + q.
+*
+* Arguments:   - int16_t r[8]: output coefficients
+*              - const ui8 *buf: 6 bytes
+**************************************************/
+static inline void cbd3(int16_t *r, const ui8 *buf) {
+  const u64 ones = 0x0001000100010001ULL;
+  u64 t = 0, d, v, x;
+
+  for(int k = 0; k < 6; k++) t |= (u64)buf[k] << (8*k);
+  d = (t & 0x249249249249ULL) + ((t >> 1) & 0x249249249249ULL) + ((t >> 2) & 0x249249249249ULL);
+  v = ((d & 0x1C71C71C71C7ULL) | 0x104104104104ULL) - ((d >> 3) & 0x1C71C71C71C7ULL);
+  for(int h = 0; h < 2; h++) {
+    x = (v >> (24*h)) & 0xFFFFFF;
+    x = (x | x << 20) & 0x00000FFF00000FFFULL;
+    x = (x | x << 10) & (7 * ones);
+    x += (Kyber_Q - 4) * ones - ((x >> 2) & ones) * Kyber_Q;
+    for(int i = 0; i < 4; i++) r[4*h + i] = (int16_t)(x >> (16*i));
+  }
+}
+
+/*************************************************
+* Name:        cbd
+*
+* Description: Centered binomial sampling, CBD_2 on vectors and CBD_3 on
+*              64-bit words (see cbd2, cbd3). Other eta values go to the
+*              reference kernel.
+*
+* Arguments:   - int16_t r[256]: output polynomial
+*              - const ui8 *buf: 64*eta bytes
+*              - int eta: 2 or 3 (others: reference kernel)
+**************************************************/
+void cbd(i16 *r, const ui8 *buf, int eta) {
+  unsigned int i;
+
+  if(eta == 2) {
+    for(i = 0; i < Kyber_N/32; i++) cbd2(r + 32*i, buf + 16*i);
+  } else if(eta == 3) {
+    for(i = 0; i < Kyber_N/8; i++) cbd3(r + 8*i, buf + 6*i);
+  } else {
+    mlkem_ref::cbd(r, buf, eta);
+  }
+}
+
+}
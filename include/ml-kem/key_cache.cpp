@@ -0,0 +1,264 @@
+#include "key_cache.hpp"
+#include "trace.hpp"
+#include "metrics.hpp"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(atomic<u64>::is_always_lock_free && atomic<ui>::is_always_lock_free,
+              "key cache atomics must be lock-free to work across processes");
+
+static const ui cache_layout = (ui)sizeof(mlkem_key_cache_slot);
+
+static size_t segment_bytes(unsigned capacity) {
+    size_t slots = (sizeof(mlkem_key_cache_header) + 63) / 64 * 64;
+    return slots + (size_t)capacity * sizeof(mlkem_key_cache_slot);
+}
+
+MLKEM_KeyCache::MLKEM_KeyCache(int fd, void *base, size_t bytes, bool writable)
+    : segment_fd(fd), base(base), map_bytes(bytes), writable(writable) {
+    header = (mlkem_key_cache_header *)base;
+    slots = (mlkem_key_cache_slot *)((ui8 *)base + (sizeof(mlkem_key_cache_header) + 63) / 64 * 64);
+}
+
+#ifdef __linux__
+
+/*************************************************
+* Name:        MLKEM_KeyCache::create
+*
+* Description: Creates and maps a cache segment sized for capacity keys
+*              and writes its header. The pages are zero-filled, which is
+*              the empty state of every slot.
+*
+* Arguments:   - const char *name: shm_open name, or nullptr for a memfd
+*              - unsigned capacity: number of key slots
+*
+* Returns:     - MLKEM_KeyCache*: writable cache, nullptr on failure
+**************************************************/
+MLKEM_KeyCache *MLKEM_KeyCache::create(const char *name, unsigned capacity) {
+    if (capacity == 0) {
+        cerr<<"key cache: capacity must be positive"<<endl;
+        return nullptr;
+    }
+    int fd = name ? shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600)
+                  : memfd_create("mlkem_key_cache", MFD_CLOEXEC);
+    if (fd < 0) {
+        cerr<<"key cache: cannot create segment"<<endl;
+        return nullptr;
+    }
+    size_t bytes = segment_bytes(capacity);
+    if (ftruncate(fd, (off_t)bytes) != 0) {
+        cerr<<"key cache: cannot size segment"<<endl;
+        close(fd);
+        if (name) shm_unlink(name);
+        return nullptr;
+    }
+    void *base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        cerr<<"key cache: cannot map segment"<<endl;
+        close(fd);
+        if (name) shm_unlink(name);
+        return nullptr;
+    }
+
+    MLKEM_KeyCache *cache = new MLKEM_KeyCache(fd, base, bytes, true);
+    mlkem_key_cache_header *h = cache->header;
+    h->layout = cache_layout;
+    h->kyber_k = Kyber_k;
+    h->capacity = capacity;
+    h->generation.store(0, memory_order_relaxed);
+    h->reserved.store(0, memory_order_relaxed);
+    // the magic goes last: a concurrent attach sees a complete header or none
+    __atomic_store_n(&h->magic, MLKEM_KEY_CACHE_MAGIC, __ATOMIC_RELEASE);
+    return cache;
+}
+
+/*************************************************
+* Name:        MLKEM_KeyCache::map
+*
+* Description: Maps an existing segment and checks that it is a cache
+*              with this build's slot layout and parameter set.
+*
+* Arguments:   - int fd: segment file descriptor (owned by the cache)
+*              - bool writable: map for publishing as well
+*
+* Returns:     - MLKEM_KeyCache*: cache, nullptr on mismatch or failure
+**************************************************/
+MLKEM_KeyCache *MLKEM_KeyCache::map(int fd, bool writable) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < segment_bytes(1)) {
+        cerr<<"key cache: not a key cache segment"<<endl;
+        close(fd);
+        return nullptr;
+    }
+    size_t bytes = (size_t)st.st_size;
+    int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *base = mmap(nullptr, bytes, prot, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        cerr<<"key cache: cannot map segment"<<endl;
+        close(fd);
+        return nullptr;
+    }
+    const mlkem_key_cache_header *h = (const mlkem_key_cache_header *)base;
+    if (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != MLKEM_KEY_CACHE_MAGIC
+        || h->layout != cache_layout || h->kyber_k != Kyber_k
+        || segment_bytes(h->capacity) > bytes) {
+        cerr<<"key cache: segment layout does not match this build"<<endl;
+        munmap(base, bytes);
+        close(fd);
+        return nullptr;
+    }
+    return new MLKEM_KeyCache(fd, base, bytes, writable);
+}
+
+/*************************************************
+* Name:        MLKEM_KeyCache::attach_fd / attach
+*
+* Description: Maps an existing cache read-only for lookups. attach_fd
+*              duplicates fd, so the caller keeps its own descriptor.
+*
+* Arguments:   - int fd: segment file descriptor
+*              - const char *name: shm_open name
+*
+* Returns:     - MLKEM_KeyCache*: read-only cache, nullptr on failure
+**************************************************/
+MLKEM_KeyCache *MLKEM_KeyCache::attach_fd(int fd) {
+    int own = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (own < 0) {
+        cerr<<"key cache: bad file descriptor"<<endl;
+        return nullptr;
+    }
+    return map(own, false);
+}
+
+MLKEM_KeyCache *MLKEM_KeyCache::attach(const char *name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        cerr<<"key cache: no segment named "<<name<<endl;
+        return nullptr;
+    }
+    return map(fd, false);
+}
+
+MLKEM_KeyCache::~MLKEM_KeyCache() {
+    munmap(base, map_bytes);
+    close(segment_fd);
+}
+
+#else
+
+MLKEM_KeyCache *MLKEM_KeyCache::create(const char *, unsigned) {
+    cerr<<"key cache: shared memory segments need Linux"<<endl;
+    return nullptr;
+}
+
+MLKEM_KeyCache *MLKEM_KeyCache::map(int, bool) { return nullptr; }
+
+MLKEM_KeyCache *MLKEM_KeyCache::attach_fd(int fd) { return map(fd, false); }
+
+MLKEM_KeyCache *MLKEM_KeyCache::attach(const char *) { return map(-1, false); }
+
+MLKEM_KeyCache::~MLKEM_KeyCache() {}
+
+#endif
+
+/*************************************************
+* Name:        MLKEM_KeyCache::publish
+*
+* Description: Expands the key into a freshly claimed slot, then makes it
+*              visible by storing a new version with release ordering;
+*              readers load the version with acquire ordering before
+*              touching the slot. Older copies of the same key stay valid
+*              but find returns the newest.
+*
+* Arguments:   - vector<ui8> &decaps: decapsulation key
+*
+* Returns:     - bool: true once the key is published
+**************************************************/
+bool MLKEM_KeyCache::publish(vector<ui8> &decaps) {
+    MLKEM_TRACE_SCOPE("key_cache_publish");
+    if (!writable) {
+        cerr<<"key cache: attached read-only"<<endl;
+        return false;
+    }
+    mlkem_expanded_dk key;
+    if (!ML_KEM_expand_decaps_key(key, decaps)) {
+        cerr<<"key cache: decapsulation key check failed"<<endl;
+        return false;
+    }
+    ui i = header->reserved.fetch_add(1, memory_order_relaxed);
+    if (i >= header->capacity) {
+        header->reserved.fetch_sub(1, memory_order_relaxed);
+        cerr<<"key cache: full ("<<header->capacity<<" keys)"<<endl;
+        return false;
+    }
+    mlkem_key_cache_slot &s = slots[i];
+    memcpy(&s.key, &key, sizeof(key));
+    memcpy(s.h, key.h, 32);
+    s.revoked.store(0, memory_order_relaxed);
+    s.version.store(header->generation.fetch_add(1, memory_order_acq_rel) + 1, memory_order_release);
+    return true;
+}
+
+/*************************************************
+* Name:        MLKEM_KeyCache::revoke
+*
+* Description: Marks every copy of a key as revoked. Readers that already
+*              hold the key may finish with it; the slot is never reused.
+*
+* Arguments:   - const ui8 *h: H(ek) of the key
+*
+* Returns:     - bool: true if a published copy was found
+**************************************************/
+bool MLKEM_KeyCache::revoke(const ui8 *h) {
+    if (!writable) {
+        cerr<<"key cache: attached read-only"<<endl;
+        return false;
+    }
+    bool found = false;
+    ui n = min(header->reserved.load(memory_order_acquire), header->capacity);
+    for (ui i = 0; i < n; i++) {
+        if (slots[i].version.load(memory_order_acquire) != 0 && memcmp(slots[i].h, h, 32) == 0) {
+            slots[i].revoked.store(1, memory_order_release);
+            found = true;
+        }
+    }
+    if (found) header->generation.fetch_add(1, memory_order_acq_rel);
+    return found;
+}
+
+/*************************************************
+* Name:        MLKEM_KeyCache::find
+*
+* Description: Looks a key up by H(ek) (bytes 768k+32.. of its
+*              decapsulation key, or mlkem_expanded_dk::h).
+*
+* Arguments:   - const ui8 *h: 32-byte H(ek)
+*
+* Returns:     - const mlkem_expanded_dk*: the key inside the segment,
+*                nullptr if it is not published or revoked
+**************************************************/
+const mlkem_expanded_dk *MLKEM_KeyCache::find(const ui8 *h) const {
+    const mlkem_expanded_dk *best = nullptr;
+    u64 best_version = 0;
+    ui n = min(header->reserved.load(memory_order_acquire), header->capacity);
+    for (ui i = 0; i < n; i++) {
+        u64 v = slots[i].version.load(memory_order_acquire);
+        if (v > best_version && memcmp(slots[i].h, h, 32) == 0) {
+            best = slots[i].revoked.load(memory_order_acquire) ? nullptr : &slots[i].key;
+            best_version = v;
+        }
+    }
+    mlkem_metrics_add(best ? MLKEM_METRIC_KEY_CACHE_HITS : MLKEM_METRIC_KEY_CACHE_MISSES, 1);
+    return best;
+}
+
+u64 MLKEM_KeyCache::generation() const {
+    return header->generation.load(memory_order_acquire);
+}
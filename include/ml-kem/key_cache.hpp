@@ -0,0 +1,74 @@
+#pragma once
+
+#include "decaps_many.hpp"
+
+#include <atomic>
+
+// Expanded decapsulation keys in one shared memory segment (memfd or
+// shm_open), so every process of a prefork server decapsulates out of the
+// same physical copy. The layout holds no pointers: a header, then a fixed
+// array of slots. A slot is filled once and then published by storing its
+// version; it is never rewritten, so a key found by a reader stays valid
+// for as long as the segment is mapped. Replacing a key means publishing
+// the new one and revoking the old.
+
+#define MLKEM_KEY_CACHE_MAGIC 0x3143474b4d454b4dULL   // "MKEMKGC1"
+
+typedef struct{
+    u64 magic;
+    ui layout;                 // sizeof(mlkem_key_cache_slot), Kyber_k
+    ui kyber_k;
+    ui capacity;
+    ui reserved_pad;
+    atomic<u64> generation;     // last version handed out
+    atomic<ui> reserved;       // slots claimed by publishers
+} mlkem_key_cache_header;
+
+typedef struct{
+    alignas(64) atomic<u64> version;   // 0 = not yet published
+    atomic<ui> revoked;
+    ui8 h[32];                         // H(ek), the lookup key
+    mlkem_expanded_dk key;
+} mlkem_key_cache_slot;
+
+class MLKEM_KeyCache{
+public:
+    // Leader: new segment for capacity keys, anonymous (memfd) when name
+    // is nullptr, else shm_open(name). Child processes forked afterwards
+    // share the mapping. nullptr on failure.
+    static MLKEM_KeyCache *create(const char *name, unsigned capacity);
+
+    // Worker: maps an existing segment read-only, from a file descriptor
+    // (inherited or passed over a socket) or a shm_open name. nullptr if
+    // the segment is not a cache built for this parameter set.
+    static MLKEM_KeyCache *attach_fd(int fd);
+    static MLKEM_KeyCache *attach(const char *name);
+
+    ~MLKEM_KeyCache();
+
+    // Expands and publishes a key (runs ML_KEM_check_decaps_key); false if
+    // the key fails the check, the cache is full or is mapped read-only.
+    // Safe to call from several processes at once.
+    bool publish(vector<ui8> &decaps);
+
+    // Hides every published copy of the key with this H(ek) from find.
+    bool revoke(const ui8 *h);
+
+    // Newest live copy of the key with H(ek) == h, in place; nullptr if none.
+    const mlkem_expanded_dk *find(const ui8 *h) const;
+
+    int fd() const { return segment_fd; }
+    size_t bytes() const { return map_bytes; }
+    u64 generation() const;
+
+private:
+    MLKEM_KeyCache(int fd, void *base, size_t bytes, bool writable);
+    static MLKEM_KeyCache *map(int fd, bool writable);
+
+    int segment_fd;
+    void *base;
+    size_t map_bytes;
+    bool writable;
+    mlkem_key_cache_header *header;
+    mlkem_key_cache_slot *slots;
+};
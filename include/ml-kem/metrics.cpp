@@ -0,0 +1,205 @@
+// metrics.cpp
+//
+// The registry is a static array of shards, so it needs no allocation
+// and is also part of the heap-free library (without the text renderer).
+// A thread takes the next shard round-robin the first time it records;
+// beyond MLKEM_METRICS_SHARDS threads shards are shared, which the atomic
+// adds keep correct.
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+const u64 mlkem_metrics_bucket_ns[MLKEM_METRICS_BUCKETS - 1] = {
+    10000, 20000, 50000, 100000, 200000, 500000,
+    1000000, 2000000, 5000000, 10000000, 20000000, 50000000, 100000000
+};
+
+struct alignas(64) MetricsShard{
+    atomic<u64> items[MLKEM_OP_COUNT];
+    atomic<u64> rejected[MLKEM_OP_COUNT];
+    atomic<u64> buckets[MLKEM_OP_COUNT][MLKEM_METRICS_BUCKETS];
+    atomic<u64> sum_ns[MLKEM_OP_COUNT];
+    atomic<u64> counters[MLKEM_METRIC_COUNT];
+};
+
+static MetricsShard shards[MLKEM_METRICS_SHARDS];
+static atomic<unsigned> next_shard(0);
+static thread_local MetricsShard *thread_shard = nullptr;
+
+static bool metrics_env_default() {
+    const char *env = getenv("MLKEM_METRICS");
+    return !(env && strcmp(env, "0") == 0);
+}
+
+// constant-initialized and resolved on first use: the library may be
+// called from other translation units' static initializers (the
+// background self-test) before this one's dynamic initializers have run
+static atomic<int> metrics_on(-1);     // -1 until MLKEM_METRICS is read
+
+static MetricsShard &shard() {
+    if (thread_shard == nullptr)
+        thread_shard = &shards[next_shard.fetch_add(1, memory_order_relaxed) % MLKEM_METRICS_SHARDS];
+    return *thread_shard;
+}
+
+void mlkem_metrics_enable(bool on) {
+    metrics_on.store(on ? 1 : 0, memory_order_relaxed);
+}
+
+bool mlkem_metrics_enabled() {
+    int on = metrics_on.load(memory_order_relaxed);
+    if (on < 0) {
+        metrics_on.compare_exchange_strong(on, metrics_env_default() ? 1 : 0, memory_order_relaxed);
+        on = metrics_on.load(memory_order_relaxed);
+    }
+    return on != 0;
+}
+
+u64 mlkem_metrics_now_ns() {
+    return (u64)chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void mlkem_metrics_add(mlkem_metric m, u64 n) {
+    if (!mlkem_metrics_enabled()) return;
+    shard().counters[m].fetch_add(n, memory_order_relaxed);
+}
+
+/*************************************************
+* Name:        mlkem_metrics_observe
+*
+* Description: Records one call of op that handled items items in ns
+*              nanoseconds.
+*
+* Arguments:   - mlkem_op op: public API call
+*              - u64 items: keys, encapsulations or decapsulations done
+*              - u64 ns: wall time of the call
+**************************************************/
+void mlkem_metrics_observe(mlkem_op op, u64 items, u64 ns) {
+    MetricsShard &s = shard();
+    int b = 0;
+    while (b < MLKEM_METRICS_BUCKETS - 1 && ns > mlkem_metrics_bucket_ns[b]) b++;
+    s.items[op].fetch_add(items, memory_order_relaxed);
+    s.buckets[op][b].fetch_add(1, memory_order_relaxed);
+    s.sum_ns[op].fetch_add(ns, memory_order_relaxed);
+}
+
+void mlkem_metrics_reject(mlkem_op op) {
+    shard().rejected[op].fetch_add(1, memory_order_relaxed);
+}
+
+/*************************************************
+* Name:        mlkem_metrics_read
+*
+* Description: Sums the shards. Each value is read atomically, but the
+*              snapshot as a whole is not, so calls in flight may show in
+*              one field before another.
+*
+* Returns:     - mlkem_metrics_snapshot: totals since start or last reset
+**************************************************/
+mlkem_metrics_snapshot mlkem_metrics_read() {
+    mlkem_metrics_snapshot out;
+    memset(&out, 0, sizeof(out));
+    for (const MetricsShard &s : shards) {
+        for (int op = 0; op < MLKEM_OP_COUNT; op++) {
+            out.items[op] += s.items[op].load(memory_order_relaxed);
+            out.rejected[op] += s.rejected[op].load(memory_order_relaxed);
+            out.sum_ns[op] += s.sum_ns[op].load(memory_order_relaxed);
+            for (int b = 0; b < MLKEM_METRICS_BUCKETS; b++) {
+                u64 v = s.buckets[op][b].load(memory_order_relaxed);
+                out.buckets[op][b] += v;
+                out.calls[op] += v;
+            }
+        }
+        for (int m = 0; m < MLKEM_METRIC_COUNT; m++)
+            out.counters[m] += s.counters[m].load(memory_order_relaxed);
+    }
+    return out;
+}
+
+void mlkem_metrics_reset() {
+    for (MetricsShard &s : shards) {
+        for (int op = 0; op < MLKEM_OP_COUNT; op++) {
+            s.items[op].store(0, memory_order_relaxed);
+            s.rejected[op].store(0, memory_order_relaxed);
+            s.sum_ns[op].store(0, memory_order_relaxed);
+            for (int b = 0; b < MLKEM_METRICS_BUCKETS; b++) s.buckets[op][b].store(0, memory_order_relaxed);
+        }
+        for (int m = 0; m < MLKEM_METRIC_COUNT; m++) s.counters[m].store(0, memory_order_relaxed);
+    }
+}
+
+#ifndef MLKEM_NO_HEAP
+
+static void append(string &out, const char *fmt, ...) {
+    char line[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n > 0) out.append(line, min((size_t)n, sizeof(line) - 1));
+}
+
+/*************************************************
+* Name:        mlkem_metrics_prometheus
+*
+* Description: Renders the current totals in the Prometheus text format:
+*              per-op counters and a latency histogram (cumulative
+*              buckets, seconds), then the library-wide counters. Every
+*              series carries param="ML-KEM-<256k>".
+*
+* Returns:     - string: exposition text, ending in a newline
+**************************************************/
+string mlkem_metrics_prometheus() {
+    mlkem_metrics_snapshot s = mlkem_metrics_read();
+    char param[32];
+    snprintf(param, sizeof(param), "param=\"ML-KEM-%d\"", 256 * Kyber_k);
+    string out;
+
+    out += "# HELP mlkem_operations_total Keys generated, encapsulations and decapsulations done, by API call.\n"
+           "# TYPE mlkem_operations_total counter\n";
+    for (int op = 0; op < MLKEM_OP_COUNT; op++)
+        append(out, "mlkem_operations_total{%s,op=\"%s\"} %llu\n", param, mlkem_op_name((mlkem_op)op), s.items[op]);
+
+    out += "# HELP mlkem_rejected_inputs_total API calls refused by a FIPS 203 input check.\n"
+           "# TYPE mlkem_rejected_inputs_total counter\n";
+    for (int op = 0; op < MLKEM_OP_COUNT; op++)
+        append(out, "mlkem_rejected_inputs_total{%s,op=\"%s\"} %llu\n", param, mlkem_op_name((mlkem_op)op), s.rejected[op]);
+
+    out += "# HELP mlkem_call_duration_seconds Wall time of an API call.\n"
+           "# TYPE mlkem_call_duration_seconds histogram\n";
+    for (int op = 0; op < MLKEM_OP_COUNT; op++) {
+        const char *name = mlkem_op_name((mlkem_op)op);
+        u64 cumulative = 0;
+        for (int b = 0; b < MLKEM_METRICS_BUCKETS - 1; b++) {
+            cumulative += s.buckets[op][b];
+            append(out, "mlkem_call_duration_seconds_bucket{%s,op=\"%s\",le=\"%g\"} %llu\n", param, name,
+                   mlkem_metrics_bucket_ns[b] * 1e-9, cumulative);
+        }
+        append(out, "mlkem_call_duration_seconds_bucket{%s,op=\"%s\",le=\"+Inf\"} %llu\n", param, name, s.calls[op]);
+        append(out, "mlkem_call_duration_seconds_sum{%s,op=\"%s\"} %.9f\n", param, name, s.sum_ns[op] * 1e-9);
+        append(out, "mlkem_call_duration_seconds_count{%s,op=\"%s\"} %llu\n", param, name, s.calls[op]);
+    }
+
+    out += "# HELP mlkem_implicit_rejections_total Decapsulations whose re-encryption check failed.\n"
+           "# TYPE mlkem_implicit_rejections_total counter\n";
+    append(out, "mlkem_implicit_rejections_total{%s} %llu\n", param, s.counters[MLKEM_METRIC_IMPLICIT_REJECTS]);
+
+    out += "# HELP mlkem_key_cache_lookups_total Expanded-key cache lookups by result.\n"
+           "# TYPE mlkem_key_cache_lookups_total counter\n";
+    append(out, "mlkem_key_cache_lookups_total{%s,result=\"hit\"} %llu\n", param, s.counters[MLKEM_METRIC_KEY_CACHE_HITS]);
+    append(out, "mlkem_key_cache_lookups_total{%s,result=\"miss\"} %llu\n", param, s.counters[MLKEM_METRIC_KEY_CACHE_MISSES]);
+
+    out += "# HELP mlkem_rng_seeds_total DRBG seedings (one per new context, plus explicit reseeds).\n"
+           "# TYPE mlkem_rng_seeds_total counter\n";
+    append(out, "mlkem_rng_seeds_total{%s} %llu\n", param, s.counters[MLKEM_METRIC_RNG_SEEDS]);
+    return out;
+}
+
+#endif
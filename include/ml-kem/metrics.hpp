@@ -0,0 +1,79 @@
+#pragma once
+
+#include "alloc_track.hpp"
+
+#include <string>
+
+// Operational metrics: per-call counts, rejected inputs and latency
+// histograms for the public API calls (mlkem_op), plus implicit
+// rejections, key-cache lookups and DRBG seedings. Updates are relaxed
+// atomic adds into one of MLKEM_METRICS_SHARDS cache-line-aligned shards,
+// picked per thread on first use, so the hot path takes no lock and
+// threads rarely share a line. Readers sum the shards. Recording is on
+// unless MLKEM_METRICS=0 or mlkem_metrics_enable(false).
+
+#define MLKEM_METRICS_SHARDS 32
+
+// Latency bucket upper bounds in ns; one more bucket holds the rest.
+#define MLKEM_METRICS_BUCKETS 14
+extern const u64 mlkem_metrics_bucket_ns[MLKEM_METRICS_BUCKETS - 1];
+
+typedef enum{
+    MLKEM_METRIC_IMPLICIT_REJECTS,  // decapsulations that returned J(z || c)
+    MLKEM_METRIC_KEY_CACHE_HITS,
+    MLKEM_METRIC_KEY_CACHE_MISSES,
+    MLKEM_METRIC_RNG_SEEDS,         // MLKEM_Drbg (re)seeds
+    MLKEM_METRIC_COUNT
+} mlkem_metric;
+
+// Sum over all shards; buckets are per bucket, not cumulative.
+typedef struct{
+    u64 items[MLKEM_OP_COUNT];      // keys, encapsulations, decapsulations
+    u64 calls[MLKEM_OP_COUNT];
+    u64 rejected[MLKEM_OP_COUNT];   // calls refused by an input check
+    u64 buckets[MLKEM_OP_COUNT][MLKEM_METRICS_BUCKETS];
+    u64 sum_ns[MLKEM_OP_COUNT];
+    u64 counters[MLKEM_METRIC_COUNT];
+} mlkem_metrics_snapshot;
+
+void mlkem_metrics_enable(bool on);
+bool mlkem_metrics_enabled();
+
+void mlkem_metrics_add(mlkem_metric m, u64 n);
+void mlkem_metrics_observe(mlkem_op op, u64 items, u64 ns);
+void mlkem_metrics_reject(mlkem_op op);
+
+mlkem_metrics_snapshot mlkem_metrics_read();
+
+// Zeroes every shard; increments racing with it may survive.
+void mlkem_metrics_reset();
+
+u64 mlkem_metrics_now_ns();
+
+#ifndef MLKEM_NO_HEAP
+// Prometheus text exposition format (version 0.0.4), labelled with the
+// parameter set, for the host application's /metrics handler.
+string mlkem_metrics_prometheus();
+#endif
+
+// Times one public API call and records it with its item count when it
+// goes out of scope; reject() records an input-check failure instead.
+class MetricsScope{
+public:
+    MetricsScope(mlkem_op op, u64 items)
+        : op(op), items(items), start(mlkem_metrics_enabled() ? mlkem_metrics_now_ns() : 0) {}
+    ~MetricsScope() {
+        if (start) mlkem_metrics_observe(op, items, mlkem_metrics_now_ns() - start);
+    }
+    void reject() {
+        if (start) mlkem_metrics_reject(op);
+        items = 0;
+    }
+    MetricsScope(const MetricsScope &) = delete;
+    MetricsScope &operator=(const MetricsScope &) = delete;
+
+    mlkem_op op;
+    u64 items;
+private:
+    u64 start;
+};
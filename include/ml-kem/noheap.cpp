@@ -0,0 +1,321 @@
+// noheap.cpp
+//
+// KeyGen, Encaps and Decaps without std::vector. A matrix entry is
+// sampled into a single polynomial right before its basemul instead of
+// expanding all of A, and e1/e2/u/s are handled one polynomial at a time,
+// so only y_hat (or s_hat) is kept as a whole vector. Everything else
+// goes straight through the dispatch kernels on fixed-size buffers.
+#include "noheap.hpp"
+#include "dispatch.hpp"
+#include "hash.hpp"
+#include "poly_bound.hpp"
+#include "metrics.hpp"
+
+#include <cstring>
+
+// Inner products are reduced before invntt only where their bound needs
+// it, as reduce_to<INVNTT_MAX_INPUT> does in K_PKE.cpp.
+static const bool reduce_before_invntt = Kyber_k * 2 * Kyber_Q > INVNTT_MAX_INPUT;
+
+// Incremental SHAKE128 on the byte-layout state used by simple_fips_202.c;
+// gives the same stream as FIPS202_SHAKE128 one block at a time.
+typedef struct{
+    alignas(8) ui8 s[200];
+    unsigned pos;
+} shake128_state;
+
+static const unsigned SHAKE128_RATE = 168;
+
+static void shake128_init(shake128_state *st) {
+    memset(st->s, 0, sizeof(st->s));
+    st->pos = 0;
+}
+
+static void shake128_absorb(shake128_state *st, const ui8 *in, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        st->s[st->pos++] ^= in[i];
+        if (st->pos == SHAKE128_RATE) {
+            KeccakF1600_permute(st->s);
+            st->pos = 0;
+        }
+    }
+}
+
+// Pads and permutes; the first block of output is then st->s[0..167].
+static void shake128_finalize(shake128_state *st) {
+    st->s[st->pos] ^= 0x1F;
+    st->s[SHAKE128_RATE - 1] ^= 0x80;
+    KeccakF1600_permute(st->s);
+}
+
+/*************************************************
+* Name:        sample_ntt
+*
+* Description: NTT_sample without a heap: rejection sampling straight
+*              from the sponge state, one 168-byte block at a time. The
+*              candidates are taken in the same order as NTT_sample, so
+*              the result is identical.
+*
+* Arguments:   - int16_t r[256]: output polynomial
+*              - const ui8 *rho: 32-byte seed
+*              - ui8 x, y: the two index bytes appended to rho
+**************************************************/
+static void sample_ntt(i16 *r, const ui8 *rho, ui8 x, ui8 y) {
+    const mlkem_backend &b = mlkem_dispatch();
+    shake128_state st;
+    ui8 idx[2] = {x, y};
+    unsigned n = 0;
+
+    shake128_init(&st);
+    shake128_absorb(&st, rho, 32);
+    shake128_absorb(&st, idx, 2);
+    shake128_finalize(&st);
+    for (;;) {
+        n += b.rej_uniform(r + n, Kyber_N - n, st.s, SHAKE128_RATE);
+        if (n == Kyber_N) break;
+        KeccakF1600_permute(st.s);
+    }
+}
+
+// PRF_eta(sigma, nonce) = SHAKE256(sigma || nonce, 64*eta)
+static void prf(ui8 *out, size_t outlen, const ui8 *sigma, ui8 nonce) {
+    ui8 in[33];
+    memcpy(in, sigma, 32);
+    in[32] = nonce;
+    FIPS202_SHAKE256(in, 33, out, outlen);
+}
+
+static void poly_add_to(i16 *r, const i16 *a) {
+    for (int i = 0; i < Kyber_N; i++) r[i] += a[i];
+}
+
+/*************************************************
+* Name:        kpke_encrypt
+*
+* Description: K_PKE_Encrypt on fixed buffers. Row i of A^T is sampled
+*              entry by entry while u_i is accumulated, and t is decoded
+*              one polynomial at a time for v.
+*
+* Arguments:   - ui8 *c: MLKEM_CT_BYTES output
+*              - const ui8 *ek: encapsulation key
+*              - const ui8 *m: 32-byte message
+*              - const ui8 *r: 32-byte randomness
+**************************************************/
+static void kpke_encrypt(ui8 *c, const ui8 *ek, const ui8 *m, const ui8 *r) {
+    const mlkem_backend &b = mlkem_dispatch();
+    const ui8 *rho = ek + 384 * Kyber_k;
+    i16 y_hat[Kyber_k][Kyber_N], acc[Kyber_N], t[Kyber_N], e[Kyber_N];
+    ui8 sample[64 * eta1];
+    ui8 nonce = 0;
+
+    for (int i = 0; i < Kyber_k; i++) {
+        prf(sample, 64 * eta1, r, nonce++);
+        b.cbd(y_hat[i], sample, eta1);
+        b.ntt(y_hat[i]);
+    }
+
+    // K_PKE_Encrypt draws e1 and e2 from the sample buffer left by the
+    // last y, not from their own PRF output, so every e1[i] and e2 is
+    // this one polynomial and their PRF calls can be skipped
+    b.cbd(e, sample, eta2);
+
+    for (int i = 0; i < Kyber_k; i++) {
+        for (int j = 0; j < Kyber_k; j++) {
+            sample_ntt(t, rho, (ui8)i, (ui8)j);
+            if (j == 0) {
+                b.basemul(acc, t, y_hat[0]);
+            } else {
+                b.basemul(t, t, y_hat[j]);
+                poly_add_to(acc, t);
+            }
+        }
+        if (reduce_before_invntt) b.poly_reduce(acc);
+        b.invntt_add_compress(c + i * 32 * du, acc, e, du, 0);
+    }
+
+    for (int j = 0; j < Kyber_k; j++) {
+        b.byte_decode(t, ek + 384 * j, 12);
+        if (j == 0) {
+            b.basemul(acc, t, y_hat[0]);
+        } else {
+            b.basemul(t, t, y_hat[j]);
+            poly_add_to(acc, t);
+        }
+    }
+    if (reduce_before_invntt) b.poly_reduce(acc);
+    // e2 + Decompress_1(m)
+    b.byte_decode(t, m, 1);
+    for (int i = 0; i < Kyber_N; i++) e[i] += t[i] * ((Kyber_Q + 1) / 2);
+    b.invntt_add_compress(c + Kyber_k * 32 * du, acc, e, dv, 0);
+}
+
+/*************************************************
+* Name:        kpke_decrypt
+*
+* Description: K_PKE_Decrypt on fixed buffers: each u_i is decompressed
+*              into the NTT domain and multiplied by s_i as soon as both
+*              are decoded.
+*
+* Arguments:   - ui8 *m: 32-byte output
+*              - const ui8 *dk_pke: 384*k byte K-PKE secret key
+*              - const ui8 *c: ciphertext
+**************************************************/
+static void kpke_decrypt(ui8 *m, const ui8 *dk_pke, const ui8 *c) {
+    const mlkem_backend &b = mlkem_dispatch();
+    i16 acc[Kyber_N], u[Kyber_N], s[Kyber_N];
+
+    for (int i = 0; i < Kyber_k; i++) {
+        b.decompress_ntt(u, c + i * 32 * du, du);
+        b.byte_decode(s, dk_pke + 384 * i, 12);
+        if (i == 0) {
+            b.basemul(acc, s, u);
+        } else {
+            b.basemul(u, s, u);
+            poly_add_to(acc, u);
+        }
+    }
+    if (reduce_before_invntt) b.poly_reduce(acc);
+
+    // v = Decompress_dv(ByteDecode_dv(c2)), reusing u
+    b.byte_decode(u, c + Kyber_k * 32 * du, dv);
+    for (int i = 0; i < Kyber_N; i++) u[i] = (u[i] * Kyber_Q + (1 << (dv - 1))) >> dv;
+    b.invntt_add_compress(m, acc, u, 1, 1);
+}
+
+/*************************************************
+* Name:        ML_KEM_KeyGen_noheap
+*
+* Description: ML_KEM_KeyGen_internal on fixed buffers. s_hat is kept
+*              for the whole of t = A*s + e; each t_i is encoded as soon
+*              as its row is done.
+*
+* Arguments:   - ui8 *ek: MLKEM_EK_BYTES output
+*              - ui8 *dk: MLKEM_DK_BYTES output
+*              - const ui8 *d: 32-byte seed
+*              - const ui8 *z: 32-byte implicit-rejection seed
+**************************************************/
+void ML_KEM_KeyGen_noheap(ui8 *ek, ui8 *dk, const ui8 *d, const ui8 *z) {
+    MetricsScope metrics(MLKEM_OP_KEYGEN, 1);
+    const mlkem_backend &b = mlkem_dispatch();
+    i16 s_hat[Kyber_k][Kyber_N], acc[Kyber_N], t[Kyber_N];
+    ui8 seed[32], rho_sigma[64], sample[64 * eta1];
+    const ui8 *rho = rho_sigma, *sigma = rho_sigma + 32;
+    ui8 nonce = 0;
+
+    memcpy(seed, d, 32);
+    FIPS202_SHA3_512(seed, 32, rho_sigma);
+
+    for (int i = 0; i < Kyber_k; i++) {
+        prf(sample, 64 * eta1, sigma, nonce++);
+        b.cbd(s_hat[i], sample, eta1);
+        b.ntt(s_hat[i]);
+        b.poly_reduce(s_hat[i]);
+        b.byte_encode(dk + 384 * i, s_hat[i], 12);
+    }
+
+    for (int i = 0; i < Kyber_k; i++) {
+        for (int j = 0; j < Kyber_k; j++) {
+            sample_ntt(t, rho, (ui8)j, (ui8)i);
+            if (j == 0) {
+                b.basemul(acc, t, s_hat[0]);
+            } else {
+                b.basemul(t, t, s_hat[j]);
+                poly_add_to(acc, t);
+            }
+        }
+        b.poly_reduce(acc);
+        b.poly_tomont(acc);
+
+        prf(sample, 64 * eta1, sigma, nonce++);
+        b.cbd(t, sample, eta1);
+        b.ntt(t);
+        b.poly_reduce(t);
+        poly_add_to(acc, t);
+        b.poly_reduce(acc);
+        b.byte_encode(ek + 384 * i, acc, 12);
+    }
+    memcpy(ek + 384 * Kyber_k, rho, 32);
+
+    memcpy(dk + 384 * Kyber_k, ek, MLKEM_EK_BYTES);
+    FIPS202_SHA3_256(dk + 384 * Kyber_k, MLKEM_EK_BYTES, dk + 768 * Kyber_k + 32);
+    memcpy(dk + 768 * Kyber_k + 64, z, 32);
+}
+
+/*************************************************
+* Name:        ML_KEM_Encaps_noheap
+*
+* Description: Encapsulation key check, then ML_KEM_Encaps_internal on
+*              fixed buffers.
+*
+* Arguments:   - ui8 *K: 32-byte shared secret output
+*              - ui8 *c: MLKEM_CT_BYTES ciphertext output
+*              - const ui8 *ek: encapsulation key
+*              - const ui8 *m: 32-byte random message
+*
+* Returns:     - bool: false (and no output) if ek fails the modulus check
+**************************************************/
+bool ML_KEM_Encaps_noheap(ui8 *K, ui8 *c, const ui8 *ek, const ui8 *m) {
+    MetricsScope metrics(MLKEM_OP_ENCAPS, 1);
+    const mlkem_backend &b = mlkem_dispatch();
+    unsigned bad = 0;
+    for (int i = 0; i < Kyber_k; i++) bad |= b.byte_check12(ek + 384 * i);
+    if (bad) {
+        metrics.reject();
+        return false;
+    }
+
+    ui8 g_in[64], g_out[64];
+    memcpy(g_in, m, 32);
+    FIPS202_SHA3_256((ui8 *)ek, MLKEM_EK_BYTES, g_in + 32);
+    FIPS202_SHA3_512(g_in, 64, g_out);
+
+    kpke_encrypt(c, ek, m, g_out + 32);
+    memcpy(K, g_out, 32);
+    return true;
+}
+
+/*************************************************
+* Name:        ML_KEM_Decaps_noheap
+*
+* Description: Decapsulation key check, then ML_KEM_Decaps_internal on
+*              fixed buffers. Both candidate keys are computed and the
+*              re-encryption is compared without an early exit.
+*
+* Arguments:   - ui8 *K: 32-byte shared secret output
+*              - const ui8 *c: MLKEM_CT_BYTES ciphertext
+*              - const ui8 *dk: decapsulation key
+*
+* Returns:     - bool: false (and no output) if dk fails the hash check
+**************************************************/
+bool ML_KEM_Decaps_noheap(ui8 *K, const ui8 *c, const ui8 *dk) {
+    const ui8 *ek = dk + 384 * Kyber_k, *h = dk + 768 * Kyber_k + 32, *z = h + 32;
+    ui8 g_in[64], g_out[64], c_dash[MLKEM_CT_BYTES], diff = 0;
+
+    MetricsScope metrics(MLKEM_OP_DECAPS, 1);
+    FIPS202_SHA3_256((ui8 *)ek, MLKEM_EK_BYTES, g_in);
+    for (int i = 0; i < 32; i++) diff |= g_in[i] ^ h[i];
+    if (diff != 0) {
+        metrics.reject();
+        return false;
+    }
+
+    kpke_decrypt(g_in, dk, c);
+    memcpy(g_in + 32, h, 32);
+    FIPS202_SHA3_512(g_in, 64, g_out);
+    kpke_encrypt(c_dash, ek, g_in, g_out + 32);
+
+    for (int i = 0; i < MLKEM_CT_BYTES; i++) diff |= c[i] ^ c_dash[i];
+
+    // J(z || c), absorbed in two parts
+    shake128_state st;
+    shake128_init(&st);
+    shake128_absorb(&st, z, 32);
+    shake128_absorb(&st, c, MLKEM_CT_BYTES);
+    shake128_finalize(&st);
+
+    // mask = 0xFF when the re-encryption matched
+    ui8 mask = (ui8)(((unsigned)diff - 1) >> 8);
+    for (int i = 0; i < 32; i++) K[i] = (g_out[i] & mask) | (st.s[i] & ~mask);
+    mlkem_metrics_add(MLKEM_METRIC_IMPLICIT_REJECTS, (ui8)~mask & 1);
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "param.hpp"
+
+// Heap-free KEM on caller-provided buffers. Every buffer is a fixed size
+// and the polynomials live on the stack, at most k + 4 of them at once,
+// so the stack depth is bounded (see stack_test.exe and the MLKEM_NO_HEAP
+// build). Outputs are byte-identical to the vector<> API.
+#define MLKEM_EK_BYTES (384 * Kyber_k + 32)
+#define MLKEM_DK_BYTES (768 * Kyber_k + 96)
+#define MLKEM_CT_BYTES (32 * (Kyber_k * du + dv))
+#define MLKEM_SS_BYTES 32
+
+// ML_KEM_KeyGen_internal(d, z)
+void ML_KEM_KeyGen_noheap(ui8 *ek, ui8 *dk, const ui8 *d, const ui8 *z);
+
+// ML_KEM_Encaps_internal(ek, m) after the encapsulation key check;
+// false if ek fails it
+bool ML_KEM_Encaps_noheap(ui8 *K, ui8 *c, const ui8 *ek, const ui8 *m);
+
+// ML_KEM_Decaps_internal(dk, c) after the decapsulation key check;
+// false if dk fails it
+bool ML_KEM_Decaps_noheap(ui8 *K, const ui8 *c, const ui8 *dk);
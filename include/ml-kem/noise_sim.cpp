@@ -0,0 +1,295 @@
+// noise_sim.cpp
+//
+// Trial t of a run draws its message and noise from the run seed and t
+// alone: with SHAKE256, (m, r) = SHAKE256(seed || t || 0) and the noise
+// polynomials come from PRF(r, nonce) exactly as in K_PKE_Encrypt; with
+// the fast generator, from xoshiro256** seeded by splitmix64(seed, t).
+// Key pair j is KeyGen_internal(SHAKE256(seed || j || 1)). Each worker
+// keeps the expanded key of the last key index it saw and its own
+// histogram, merged when the run ends.
+#include "noise_sim.hpp"
+#include "hash_multi.hpp"
+#include "dispatch.hpp"
+#include "poly_bound.hpp"
+
+#include <cstring>
+#include <memory>
+
+static const bool reduce_before_invntt = Kyber_k * 2 * Kyber_Q > INVNTT_MAX_INPUT;
+static const int half_q = (Kyber_Q + 1) / 2;
+
+// Trials per multi-buffer hashing group, the widest Keccak batch.
+static const size_t group = 8;
+
+// PRF outputs per trial: y (k), e1 (k) and e2; each long enough for eta1.
+static const int prf_count = 2 * Kyber_k + 1;
+static const int prf_bytes = 64 * eta1;
+
+void mlkem_noise_hist::clear() {
+    memset(this, 0, sizeof(*this));
+}
+
+void mlkem_noise_hist::merge(const mlkem_noise_hist &o) {
+    trials += o.trials;
+    failed_trials += o.failed_trials;
+    failed_coeffs += o.failed_coeffs;
+    for (int i = 0; i < MLKEM_NOISE_BINS; i++) bins[i] += o.bins[i];
+}
+
+// acc = sum_j a[j] o b[j], each product in the Montgomery domain
+static void inner_product(i16 *acc, const i16 (*a)[Kyber_N], const i16 (*b)[Kyber_N]) {
+    const mlkem_backend &be = mlkem_dispatch();
+    i16 t[Kyber_N];
+    be.basemul(acc, a[0], b[0]);
+    for (int j = 1; j < Kyber_k; j++) {
+        be.basemul(t, a[j], b[j]);
+        for (int i = 0; i < Kyber_N; i++) acc[i] += t[i];
+    }
+    if (reduce_before_invntt) be.poly_reduce(acc);
+}
+
+static inline int mod_q(int x) {
+    x %= Kyber_Q;
+    return x < 0 ? x + Kyber_Q : x;
+}
+
+// Decompress_d(Compress_d(x)) for x in [0, q)
+static inline i16 round_trip(int x, int d) {
+    unsigned c = (((unsigned)x << d) + Kyber_Q / 2) / Kyber_Q & ((1u << d) - 1);
+    return (i16)((c * Kyber_Q + (1u << (d - 1))) >> d);
+}
+
+/*************************************************
+* Name:        trial_core
+*
+* Description: Encrypts m under the expanded key with the given noise
+*              bytes, rounds u and v through Compress/Decompress, computes
+*              w = v' - invNTT(s_hat o NTT(u')) and records the noise of
+*              every coefficient.
+*
+* Arguments:   - i16 noise[Kyber_N]: centred noise output
+*              - const mlkem_expanded_dk &key: expanded key
+*              - const ui8 *m: 32-byte message
+*              - const ui8 (*prf)[prf_bytes]: noise bytes, y then e1, e2
+*              - mlkem_noise_sampling sampling: where e1 and e2 come from
+*
+* Returns:     - int: coefficients that decrypted to the wrong bit
+**************************************************/
+static int trial_core(i16 noise[Kyber_N], const mlkem_expanded_dk &key, const ui8 *m,
+                      const ui8 (*prf)[prf_bytes], mlkem_noise_sampling sampling) {
+    const mlkem_backend &b = mlkem_dispatch();
+    i16 y_hat[Kyber_k][Kyber_N], u[Kyber_k][Kyber_N], acc[Kyber_N], e[Kyber_N], v[Kyber_N];
+
+    for (int i = 0; i < Kyber_k; i++) {
+        b.cbd(y_hat[i], prf[i], eta1);
+        b.ntt(y_hat[i]);
+    }
+    if (sampling == MLKEM_NOISE_IMPLEMENTED) b.cbd(e, prf[Kyber_k - 1], eta2);
+
+    for (int i = 0; i < Kyber_k; i++) {
+        inner_product(acc, key.A_hat[i], y_hat);
+        b.invntt(acc);
+        if (sampling == MLKEM_NOISE_FIPS) b.cbd(e, prf[Kyber_k + i], eta2);
+        for (int c = 0; c < Kyber_N; c++) u[i][c] = round_trip(mod_q(acc[c] + e[c]), du);
+    }
+
+    inner_product(acc, key.t_hat, y_hat);
+    b.invntt(acc);
+    if (sampling == MLKEM_NOISE_FIPS) b.cbd(e, prf[2 * Kyber_k], eta2);
+    for (int c = 0; c < Kyber_N; c++) {
+        int bit = (m[c >> 3] >> (c & 7)) & 1;
+        v[c] = round_trip(mod_q(acc[c] + e[c] + bit * half_q), dv);
+    }
+
+    for (int i = 0; i < Kyber_k; i++) b.ntt(u[i]);
+    inner_product(acc, key.s_hat, u);
+    b.invntt(acc);
+
+    int failed = 0;
+    for (int c = 0; c < Kyber_N; c++) {
+        int bit = (m[c >> 3] >> (c & 7)) & 1;
+        int w = mod_q(v[c] - acc[c]);
+        int n = mod_q(w - bit * half_q);
+        noise[c] = (i16)(n > Kyber_Q / 2 ? n - Kyber_Q : n);
+        int decoded = (int)((((unsigned)w << 1) + Kyber_Q / 2) / Kyber_Q & 1);
+        failed += decoded != bit;
+    }
+    return failed;
+}
+
+static void record(mlkem_noise_hist &h, const i16 noise[Kyber_N], int failed) {
+    for (int c = 0; c < Kyber_N; c++) h.bins[noise[c] + Kyber_Q / 2]++;
+    h.trials++;
+    h.failed_coeffs += failed;
+    h.failed_trials += failed != 0;
+}
+
+/*************************************************
+* Name:        mlkem_noise_trial
+*
+* Description: One trial with an explicit message and encryption seed;
+*              the noise bytes are PRF(r, 0..2k) as in K_PKE_Encrypt.
+*
+* Arguments:   - i16 noise[Kyber_N]: centred noise output
+*              - const mlkem_expanded_dk &key: expanded key
+*              - const ui8 *m: 32-byte message
+*              - const ui8 *r: 32-byte encryption seed
+*              - mlkem_noise_sampling sampling: where e1 and e2 come from
+*
+* Returns:     - int: coefficients that decrypted to the wrong bit
+**************************************************/
+int mlkem_noise_trial(i16 noise[Kyber_N], const mlkem_expanded_dk &key, const ui8 *m, const ui8 *r,
+                      mlkem_noise_sampling sampling) {
+    ui8 prf[prf_count][prf_bytes], in[33];
+    memcpy(in, r, 32);
+    for (int j = 0; j < prf_count; j++) {
+        in[32] = (ui8)j;
+        FIPS202_SHAKE256(in, 33, prf[j], prf_bytes);
+    }
+    return trial_core(noise, key, m, prf, sampling);
+}
+
+static u64 splitmix64(u64 &x) {
+    u64 z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256**, seeded per trial
+struct FastRng{
+    u64 s[4];
+
+    FastRng(u64 seed, u64 trial) {
+        u64 x = seed ^ (trial * 0xd1342543de82ef95ULL);
+        for (int i = 0; i < 4; i++) s[i] = splitmix64(x);
+    }
+
+    u64 next() {
+        u64 r = rotl(s[1] * 5, 7) * 9, t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return r;
+    }
+
+    void fill(ui8 *out, size_t n) {
+        for (size_t i = 0; i < n; i += 8) {
+            u64 v = next();
+            memcpy(out + i, &v, min<size_t>(8, n - i));
+        }
+    }
+
+    static u64 rotl(u64 x, int k) { return (x << k) | (x >> (64 - k)); }
+};
+
+static void put_u64(ui8 *p, u64 v) {
+    for (int i = 0; i < 8; i++) p[i] = (ui8)(v >> (8 * i));
+}
+
+// Key pair index of the run, expanded.
+static void make_key(mlkem_expanded_dk &key, u64 seed, u64 index) {
+    ui8 in[17], out[64];
+    put_u64(in, seed);
+    put_u64(in + 8, index);
+    in[16] = 1;
+    FIPS202_SHAKE256(in, 17, out, 64);
+    vector<ui8> d(out, out + 32), z(out + 32, out + 64);
+    auto kp = ML_KEM_KeyGen_internal(d, z);
+    ML_KEM_expand_decaps_key(key, kp.second);
+}
+
+struct NoiseWorker{
+    u64 key_index = ~0ULL;
+    unique_ptr<mlkem_expanded_dk> key;
+    unique_ptr<mlkem_noise_hist> hist;
+};
+
+/*************************************************
+* Name:        run_trials
+*
+* Description: Trials [t0, t1) of one key on one worker, a group of up to
+*              eight at a time so the seed expansion and PRF calls of the
+*              group go through one multi-buffer SHAKE256 batch each.
+**************************************************/
+static void run_trials(NoiseWorker &w, const mlkem_noise_config &cfg, u64 t0, u64 t1) {
+    const int prfs = cfg.sampling == MLKEM_NOISE_FIPS ? prf_count : Kyber_k;
+    ui8 seed_in[group][17], mr[group][64];
+    ui8 prf_in[group * prf_count][33], prf[group][prf_count][prf_bytes];
+    ui8 *in[group * prf_count], *out[group * prf_count];
+    i16 noise[Kyber_N];
+
+    for (u64 g0 = t0; g0 < t1; g0 += group) {
+        size_t gn = (size_t)min<u64>(group, t1 - g0);
+        if (cfg.fast_rng) {
+            for (size_t l = 0; l < gn; l++) {
+                FastRng rng(cfg.seed, g0 + l);
+                rng.fill(mr[l], 32);
+                for (int j = 0; j < prfs; j++) rng.fill(prf[l][j], prf_bytes);
+            }
+        } else {
+            for (size_t l = 0; l < gn; l++) {
+                put_u64(seed_in[l], cfg.seed);
+                put_u64(seed_in[l] + 8, g0 + l);
+                seed_in[l][16] = 0;
+                in[l] = seed_in[l];
+                out[l] = mr[l];
+            }
+            FIPS202_SHAKE256_batch(gn, in, 17, out, 64);
+            for (size_t l = 0; l < gn; l++) {
+                for (int j = 0; j < prfs; j++) {
+                    ui8 *p = prf_in[l * prfs + j];
+                    memcpy(p, mr[l] + 32, 32);
+                    p[32] = (ui8)j;
+                    in[l * prfs + j] = p;
+                    out[l * prfs + j] = prf[l][j];
+                }
+            }
+            FIPS202_SHAKE256_batch(gn * prfs, in, 33, out, prf_bytes);
+        }
+        for (size_t l = 0; l < gn; l++) {
+            int failed = trial_core(noise, *w.key, mr[l], prf[l], cfg.sampling);
+            record(*w.hist, noise, failed);
+        }
+    }
+}
+
+/*************************************************
+* Name:        mlkem_noise_simulate
+*
+* Description: Runs trials [first, first + n) across the executor and
+*              merges every worker's histogram into out.
+*
+* Arguments:   - Executor &ex: worker threads
+*              - mlkem_noise_hist &out: histogram added to
+*              - const mlkem_noise_config &cfg: run description
+*              - u64 first, n: trial range
+**************************************************/
+void mlkem_noise_simulate(Executor &ex, mlkem_noise_hist &out, const mlkem_noise_config &cfg, u64 first, u64 n) {
+    u64 per_key = cfg.trials_per_key ? cfg.trials_per_key : 1;
+    vector<NoiseWorker> workers(ex.size());
+    for (NoiseWorker &w : workers) {
+        w.key.reset(new mlkem_expanded_dk);
+        w.hist.reset(new mlkem_noise_hist);
+        w.hist->clear();
+    }
+
+    size_t chunk = (size_t)min<u64>(4096, max<u64>(group, n / (4 * ex.size()) / group * group));
+    ex.parallel_for((size_t)n, chunk, [&](ExecutorWorker &ew, size_t b, size_t e){
+        NoiseWorker &w = workers[ew.id];
+        for (u64 t = first + b; t < first + e; ) {
+            u64 key_index = t / per_key;
+            u64 end = min<u64>(first + e, (key_index + 1) * per_key);
+            if (w.key_index != key_index) {
+                make_key(*w.key, cfg.seed, key_index);
+                w.key_index = key_index;
+            }
+            run_trials(w, cfg, t, end);
+            t = end;
+        }
+    });
+    for (NoiseWorker &w : workers) out.merge(*w.hist);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "decaps_many.hpp"
+#include "executor.hpp"
+
+// Monte Carlo simulation of K-PKE decryption noise. A trial encrypts a
+// random message under an expanded key and decrypts it again on the
+// dispatch kernels, without byte encoding (compression and decompression
+// are kept: their rounding is part of the noise), and records for every
+// coefficient the noise n = w - Decompress_1(m) centred in [-(q-1)/2,
+// (q-1)/2], where w = v' - s^T u' is what Decrypt rounds.
+
+typedef enum{
+    MLKEM_NOISE_FIPS,           // e1[i] and e2 from their own PRF outputs
+    MLKEM_NOISE_IMPLEMENTED     // e1 and e2 from the last y sample, as K_PKE_Encrypt does
+} mlkem_noise_sampling;
+
+typedef struct{
+    mlkem_noise_sampling sampling;
+    bool fast_rng;              // xoshiro256** instead of SHAKE256 for the noise bytes
+    u64 trials_per_key;         // a new key pair after this many trials
+    u64 seed;                   // run seed; every key and trial derives from it
+} mlkem_noise_config;
+
+#define MLKEM_NOISE_BINS Kyber_Q
+
+// Mergeable results: bins[n + (q-1)/2] counts coefficients with noise n.
+struct mlkem_noise_hist{
+    u64 trials;
+    u64 failed_trials;          // trials whose message did not decrypt
+    u64 failed_coeffs;          // coefficients that decrypted to the wrong bit
+    u64 bins[MLKEM_NOISE_BINS];
+
+    void clear();
+    void merge(const mlkem_noise_hist &o);
+    u64 coefficients() const { return trials * Kyber_N; }
+};
+
+// One trial with the given message and encryption seed r: K_PKE_Encrypt's
+// PRF(r, .) noise, so the result can be checked against a real ciphertext.
+// Returns the number of wrongly decrypted coefficients.
+int mlkem_noise_trial(i16 noise[Kyber_N], const mlkem_expanded_dk &key, const ui8 *m, const ui8 *r,
+                      mlkem_noise_sampling sampling);
+
+// Runs trials [first, first + n) of the run described by cfg. Every trial
+// is seeded by its index, so the histogram only depends on cfg and the
+// trial range, not on the thread count or on how a run is split.
+void mlkem_noise_simulate(Executor &ex, mlkem_noise_hist &out, const mlkem_noise_config &cfg, u64 first, u64 n);
@@ -1,5 +1,6 @@
 #include "ntt.hpp"
-
+#include "dispatch.hpp"
+#include "trace.hpp"
 
 #include "param.hpp"
 
@@ -73,6 +74,73 @@ const int16_t zetas_inv[128] = {
   829, 2946, 3065, 1325, 2756, 1861, 1474, 1202, 2367, 3147, 1752, 2707, 171,
   3127, 3042, 1907, 1836, 1517, 359, 758, 1441
 };
+
+#ifdef MLKEM_SHOUP_NTT
+// Shoup pairs {w, round(w*2^15/q)} for the transforms: w is zetas[i] (or
+// zetas_inv[i]) times 2^-16 mod q, centered, so x*w mod q matches
+// fqmul(zeta, x). In zetas_inv_shoup the final invNTT scaling is folded
+// in: entry 127 is the scaling factor itself and entry 126 is the last
+// layer's zeta times it.
+const int16_t zetas_shoup[128][2] = {
+  {1, 10}, {-1600, -15749}, {-749, -7373}, {-40, -394}, {-687, -6762},
+  {630, 6201}, {-1432, -14095}, {848, 8347}, {1062, 10453}, {-1410, -13879},
+  {193, 1900}, {797, 7845}, {-543, -5345}, {-69, -679}, {569, 5601},
+  {-1583, -15582}, {296, 2914}, {-882, -8682}, {1339, 13180}, {1476, 14529},
+  {-283, -2786}, {56, 551}, {-1089, -10719}, {1333, 13121}, {1426, 14036},
+  {-1235, -12156}, {535, 5266}, {-447, -4400}, {-936, -9213}, {-450, -4429},
+  {-1355, -13338}, {821, 8081}, {289, 2845}, {331, 3258}, {-76, -748},
+  {-1573, -15483}, {1197, 11782}, {-1025, -10089}, {-1052, -10355},
+  {-1274, -12540}, {650, 6398}, {-1352, -13308}, {-816, -8032}, {632, 6221},
+  {-464, -4567}, {33, 325}, {1320, 12993}, {-1414, -13918}, {-1010, -9942},
+  {1435, 14125}, {807, 7943}, {452, 4449}, {1438, 14155}, {-461, -4538},
+  {1534, 15099}, {-927, -9125}, {-682, -6713}, {-712, -7008}, {1481, 14578},
+  {648, 6378}, {-855, -8416}, {-219, -2156}, {1227, 12078}, {910, 8957},
+  {17, 167}, {-568, -5591}, {583, 5739}, {-680, -6693}, {1637, 16113},
+  {723, 7117}, {-1041, -10247}, {1100, 10828}, {1409, 13869}, {-667, -6565},
+  {-48, -472}, {233, 2293}, {756, 7441}, {-1173, -11546}, {-314, -3091},
+  {-279, -2746}, {-1626, -16005}, {1651, 16251}, {-540, -5315},
+  {-1540, -15159}, {-1482, -14588}, {952, 9371}, {1461, 14381},
+  {-642, -6319}, {939, 9243}, {-1021, -10050}, {-892, -8780}, {-941, -9262},
+  {733, 7215}, {-992, -9764}, {268, 2638}, {641, 6309}, {1584, 15592},
+  {-1031, -10148}, {-1292, -12717}, {-109, -1073}, {375, 3691},
+  {-780, -7678}, {-1239, -12196}, {1645, 16192}, {1063, 10463}, {319, 3140},
+  {-556, -5473}, {757, 7451}, {-1230, -12107}, {561, 5522}, {-863, -8495},
+  {-735, -7235}, {-525, -5168}, {1092, 10749}, {403, 3967}, {1026, 10099},
+  {1143, 11251}, {-1179, -11605}, {-554, -5453}, {886, 8721},
+  {-1607, -15818}, {1212, 11930}, {-1455, -14322}, {1029, 10129},
+  {-1219, -11999}, {-394, -3878}, {885, 8711}, {-1175, -11566}
+};
+
+const int16_t zetas_inv_shoup[128][2] = {
+  {1175, 11566}, {-885, -8711}, {394, 3878}, {1219, 11999}, {-1029, -10129},
+  {1455, 14322}, {-1212, -11930}, {1607, 15818}, {-886, -8721}, {554, 5453},
+  {1179, 11605}, {-1143, -11251}, {-1026, -10099}, {-403, -3967},
+  {-1092, -10749}, {525, 5168}, {735, 7235}, {863, 8495}, {-561, -5522},
+  {1230, 12107}, {-757, -7451}, {556, 5473}, {-319, -3140}, {-1063, -10463},
+  {-1645, -16192}, {1239, 12196}, {780, 7678}, {-375, -3691}, {109, 1073},
+  {1292, 12717}, {1031, 10148}, {-1584, -15592}, {-641, -6309},
+  {-268, -2638}, {992, 9764}, {-733, -7215}, {941, 9262}, {892, 8780},
+  {1021, 10050}, {-939, -9243}, {642, 6319}, {-1461, -14381}, {-952, -9371},
+  {1482, 14588}, {1540, 15159}, {540, 5315}, {-1651, -16251}, {1626, 16005},
+  {279, 2746}, {314, 3091}, {1173, 11546}, {-756, -7441}, {-233, -2293},
+  {48, 472}, {667, 6565}, {-1409, -13869}, {-1100, -10828}, {1041, 10247},
+  {-723, -7117}, {-1637, -16113}, {680, 6693}, {-583, -5739}, {568, 5591},
+  {-17, -167}, {-910, -8957}, {-1227, -12078}, {219, 2156}, {855, 8416},
+  {-648, -6378}, {-1481, -14578}, {712, 7008}, {682, 6713}, {927, 9125},
+  {-1534, -15099}, {461, 4538}, {-1438, -14155}, {-452, -4449},
+  {-807, -7943}, {-1435, -14125}, {1010, 9942}, {1414, 13918},
+  {-1320, -12993}, {-33, -325}, {464, 4567}, {-632, -6221}, {816, 8032},
+  {1352, 13308}, {-650, -6398}, {1274, 12540}, {1052, 10355}, {1025, 10089},
+  {-1197, -11782}, {1573, 15483}, {76, 748}, {-331, -3258}, {-289, -2845},
+  {-821, -8081}, {1355, 13338}, {450, 4429}, {936, 9213}, {447, 4400},
+  {-535, -5266}, {1235, 12156}, {-1426, -14036}, {-1333, -13121},
+  {1089, 10719}, {-56, -551}, {283, 2786}, {-1476, -14529}, {-1339, -13180},
+  {882, 8682}, {-296, -2914}, {1583, 15582}, {-569, -5601}, {69, 679},
+  {543, 5345}, {-797, -7845}, {-193, -1900}, {1410, 13879}, {-1062, -10453},
+  {-848, -8347}, {1432, 14095}, {-630, -6201}, {687, 6762}, {40, 394},
+  {749, 7373}, {266, 2618}, {512, 5040}
+};
+#endif
 /*************************************************
 * Name:        fqmul
 *
@@ -87,6 +155,8 @@ int16_t fqmul(int16_t a, int16_t b) {
   return montgomery_reduce((int32_t)a*b);
 }
 
+// vector<> API; not part of the heap-free library (MLKEM_NO_HEAP)
+#ifndef MLKEM_NO_HEAP
 /*************************************************
 * Name:        ntt
 *
@@ -96,20 +166,8 @@ int16_t fqmul(int16_t a, int16_t b) {
 * Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
 **************************************************/
 void ntt( vector<int16_t> &r) {
-unsigned int len, start, j, k;
-  int16_t t, zeta;
-
-  k = 1;
-  for(len = 128; len >= 2; len >>= 1) {
-    for(start = 0; start < 256; start = j + len) {
-      zeta = zetas[k++];
-      for(j = start; j < start + len; ++j) {
-        t = fqmul(zeta, r[j + len]);
-        r[j + len] = r[j] - t;
-        r[j] = r[j] + t;
-      }
-    }
-  }
+  MLKEM_TRACE_SCOPE("ntt");
+  mlkem_dispatch().ntt(r.data());
 }
 
 
@@ -120,30 +178,47 @@ unsigned int len, start, j, k;
 * Description: Inplace inverse number-theoretic transform in Rq and
 *              multiplication by Montgomery factor 2^16.
 *              Input is in bitreversed order, output is in standard order
+*              Input coefficients must satisfy |a| < 2^14; output is in (-q,q)
 *
 * Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
 **************************************************/
 void invntt(vector<int16_t> &r) {
-  unsigned int start, len, j, k;
-  int16_t t, zeta;
-
-  k = 0;
-  for(len = 2; len <= 128; len <<= 1){
-    for(start = 0; start < 256; start = j + len){
-      zeta = zetas_inv[k++];
-      for(j = start; j < start + len; ++j) {
-        t = r[j];
-        r[j] = barrett_reduce(t + r[j + len]);
-        r[j + len] = t - r[j + len];
-        r[j + len] = fqmul(zeta, r[j + len]);
-      }
-    }
-  }
+  MLKEM_TRACE_SCOPE("invntt");
+  mlkem_dispatch().invntt(r.data());
+}
 
-  for(j = 0; j < 256; ++j){
-    r[j] = fqmul(r[j], zetas_inv[127]);
-  }
+/*************************************************
+* Name:        ntt_decompress
+*
+* Description: ByteDecode_d, Decompress_d and ntt fused into one kernel
+*              pass; same result as the three calls in sequence.
+*
+* Arguments:   - vector<int16_t>& r: output, NTT of the decompressed polynomial
+*              - const ui8 *b: 32*d encoded bytes
+*              - int d: bits per coefficient
+**************************************************/
+void ntt_decompress(vector<i16> &r, const ui8 *b, int d) {
+  MLKEM_TRACE_SCOPE("ntt_decompress");
+  r.resize(Kyber_N);
+  mlkem_dispatch().decompress_ntt(r.data(), b, d);
+}
 
+/*************************************************
+* Name:        invntt_compress
+*
+* Description: Inverse NTT of a, added to (or, with negate, subtracted
+*              from) e, then Compress_d and ByteEncode_d written straight
+*              to the output buffer in one kernel pass.
+*
+* Arguments:   - ui8 *out: 32*d output bytes
+*              - vector<int16_t>& a: NTT-domain input, |a| < 2^14; clobbered
+*              - vector<int16_t>& e: polynomial to add
+*              - int d: bits per coefficient
+*              - bool negate: compute e - invntt(a)
+**************************************************/
+void invntt_compress(ui8 *out, vector<i16> &a, vector<i16> &e, int d, bool negate) {
+  MLKEM_TRACE_SCOPE("invntt_compress");
+  mlkem_dispatch().invntt_add_compress(out, a.data(), e.data(), d, negate);
 }
 
 /*************************************************
@@ -179,10 +254,7 @@ void basemul(int16_t* r, int16_t* a, int16_t* b, int16_t zeta)
 **************************************************/
 vector<i16> poly_multiply_pointwise_mont(vector<i16> &a, vector<i16> & b){
   vector<i16>result(Kyber_N);
-  for(int i =0 ;i<Kyber_N/4;i++){
-    basemul(&result[4*i],&a[4*i],&b[4*i],zetas[64+i]);
-    basemul(&result[4*i+2],&a[4*i+2],&b[4*i+2],-zetas[64+i]);
-  }
+  mlkem_dispatch().basemul(result.data(),a.data(),b.data());
   return result;
 }
 
@@ -194,9 +266,7 @@ vector<i16> poly_multiply_pointwise_mont(vector<i16> &a, vector<i16> & b){
 * Arguments:   - vector<int16_t>& a: input/output polynomial
 **************************************************/
 void poly_reduce(vector<i16> & a){
-  for(int i = 0;i<Kyber_N;i++){
-    a[i] = barrett_reduce(a[i]);
-  }
+  mlkem_dispatch().poly_reduce(a.data());
 }
 
 /*************************************************
@@ -228,8 +298,6 @@ vector<i16> poly_add(vector<i16> &a , vector<i16> & b){
 *************************************************
 */
 void poly_tomont(vector<i16> &r){
-  unsigned int i;
-  const int16_t f = (1ULL << 32) % Kyber_Q;
-  for(i=0;i<Kyber_N;i++)
-    r[i] = montgomery_reduce((int32_t)r[i]*f);
-}
\ No newline at end of file
+  mlkem_dispatch().poly_tomont(r.data());
+}
+#endif
@@ -13,6 +13,14 @@ int16_t barrett_reduce(int16_t a);
 
 extern const int16_t zetas[128];
 
+extern const int16_t zetas_inv[128];
+
+#ifdef MLKEM_SHOUP_NTT
+extern const int16_t zetas_shoup[128][2];
+
+extern const int16_t zetas_inv_shoup[128][2];
+#endif
+
 void ntt(vector<int16_t> &poly);
 
 vector<i16> poly_multiply_pointwise_mont(vector<i16> &a, vector<i16> & b);
@@ -21,6 +29,10 @@ int16_t fqmul(int16_t a, int16_t b);
 
 void invntt(vector<int16_t> &poly);
 
+void ntt_decompress(vector<i16> &r, const ui8 *b, int d);
+
+void invntt_compress(ui8 *out, vector<i16> &a, vector<i16> &e, int d, bool negate);
+
 void basemul(i16* r, i16* a, i16* b, i16 zeta);
 
 void poly_reduce(vector<i16> & a);
@@ -47,11 +47,15 @@ Kyber-1024  4   2   2   11  5   2−174               1568 B      1568 B
 
 #define Kyber_N 256
 #define Kyber_Q 3329
-#define eta1 3
-#define eta2 2
+// Kyber_k selects the parameter set at build time (CMake MLKEM_K):
+// 2 = ML-KEM-512, 3 = ML-KEM-768, 4 = ML-KEM-1024
+#ifndef Kyber_k
 #define Kyber_k 2 // for 512 implementation
-#define du 10
-#define dv 4
+#endif
+#define eta1 (Kyber_k == 2 ? 3 : 2)
+#define eta2 2
+#define du (Kyber_k == 4 ? 11 : 10)
+#define dv (Kyber_k == 4 ? 5 : 4)
 
 typedef struct{
     vector<i16> coeffs;
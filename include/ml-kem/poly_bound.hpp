@@ -0,0 +1,135 @@
+#pragma once
+
+#include <utility>
+#include "base.hpp"
+#include "ntt.hpp"
+#include "trace.hpp"
+
+// Polynomials whose type carries a bound on |coefficient| and the domain
+// the coefficients live in. Every operation below computes the bound of
+// its result from the bounds of its inputs and static_asserts the kernel
+// preconditions, so a reduction is only needed where the types say a
+// coefficient could otherwise leave int16 or a kernel's input range, and
+// a missing one is a compile error rather than a silent overflow.
+
+typedef enum{
+    POLY_NORMAL,        // plain coefficients
+    POLY_NTT,           // NTT domain
+    POLY_NTT_MONT       // NTT domain with a pending 2^-16 from a Montgomery product
+} poly_domain;
+
+// Largest |a| each kernel accepts (see the kernel descriptions).
+constexpr int32_t POLY_INT16_MAX = 32767;
+constexpr int32_t NTT_MAX_INPUT = POLY_INT16_MAX - 7 * Kyber_Q;    // each layer adds < q
+constexpr int32_t INVNTT_MAX_INPUT = (1 << 14) - 1;                // first-layer sums fit int16
+constexpr int64_t FQMUL_MAX_PRODUCT = (int64_t)Kyber_Q << 15;      // montgomery_reduce input
+
+template<int32_t Bound, poly_domain Domain>
+struct bounded_poly{
+    static_assert(Bound >= 0 && Bound <= POLY_INT16_MAX, "coefficient bound exceeds int16");
+    static constexpr int32_t bound = Bound;
+    static constexpr poly_domain domain = Domain;
+
+    vector<i16> coeffs;
+
+    bounded_poly() : coeffs(Kyber_N, 0) {}
+    explicit bounded_poly(vector<i16> &&c) : coeffs(std::move(c)) {}
+};
+
+// Outputs of the samplers and decoders: coefficients in [0,q] or (-q,q).
+typedef bounded_poly<Kyber_Q, POLY_NORMAL> reduced_poly;
+typedef bounded_poly<Kyber_Q, POLY_NTT> reduced_ntt_poly;
+
+template<int32_t B>
+bounded_poly<B + 7 * Kyber_Q, POLY_NTT> ntt(bounded_poly<B, POLY_NORMAL> &&p) {
+    static_assert(B <= NTT_MAX_INPUT, "ntt input may overflow int16");
+    ntt(p.coeffs);
+    return bounded_poly<B + 7 * Kyber_Q, POLY_NTT>(std::move(p.coeffs));
+}
+
+// The Montgomery factor left by basemul is cancelled by the 2^16 of invntt.
+template<int32_t B>
+bounded_poly<Kyber_Q, POLY_NORMAL> invntt(bounded_poly<B, POLY_NTT_MONT> &&p) {
+    static_assert(B <= INVNTT_MAX_INPUT, "invntt input too large; reduce first");
+    invntt(p.coeffs);
+    return bounded_poly<Kyber_Q, POLY_NORMAL>(std::move(p.coeffs));
+}
+
+// Decoded and decompressed coefficients are in [0,q].
+inline bounded_poly<8 * Kyber_Q, POLY_NTT> ntt_decompress(const ui8 *b, int d) {
+    bounded_poly<8 * Kyber_Q, POLY_NTT> r;
+    ntt_decompress(r.coeffs, b, d);
+    return r;
+}
+
+// The last invntt layer is Barrett-reduced after e is added, so e only
+// has to leave room for one more term in (-q,q).
+template<int32_t B, int32_t BE>
+void invntt_compress(ui8 *out, bounded_poly<B, POLY_NTT_MONT> &&a, bounded_poly<BE, POLY_NORMAL> &e, int d,
+                     bool negate) {
+    static_assert(B <= INVNTT_MAX_INPUT, "invntt input too large; reduce first");
+    static_assert(BE + Kyber_Q <= POLY_INT16_MAX, "added polynomial too large; reduce first");
+    invntt_compress(out, a.coeffs, e.coeffs, d, negate);
+}
+
+// Each basemul output coefficient is a sum of two fqmul results.
+template<int32_t BA, int32_t BB>
+bounded_poly<2 * Kyber_Q, POLY_NTT_MONT> poly_multiply_pointwise_mont(bounded_poly<BA, POLY_NTT> &a,
+                                                                      bounded_poly<BB, POLY_NTT> &b) {
+    static_assert((int64_t)BA * BB < FQMUL_MAX_PRODUCT, "basemul product out of montgomery_reduce range");
+    return bounded_poly<2 * Kyber_Q, POLY_NTT_MONT>(poly_multiply_pointwise_mont(a.coeffs, b.coeffs));
+}
+
+// sum_i a[i] o b[i] over the K entries of two vectors.
+template<int K, int32_t BA, int32_t BB>
+bounded_poly<K * 2 * Kyber_Q, POLY_NTT_MONT> poly_inner_product_mont(bounded_poly<BA, POLY_NTT> *a,
+                                                                     bounded_poly<BB, POLY_NTT> *b) {
+    MLKEM_TRACE_SCOPE("basemul_acc");
+    bounded_poly<K * 2 * Kyber_Q, POLY_NTT_MONT> acc(std::move(poly_multiply_pointwise_mont(a[0], b[0]).coeffs));
+    for (int i = 1; i < K; i++) {
+        vector<i16> t = poly_multiply_pointwise_mont(a[i], b[i]).coeffs;
+        for (int j = 0; j < Kyber_N; j++) acc.coeffs[j] += t[j];
+    }
+    return acc;
+}
+
+template<int32_t BA, int32_t BB, poly_domain D>
+bounded_poly<BA + BB, D> poly_add(bounded_poly<BA, D> &&a, const bounded_poly<BB, D> &b) {
+    for (int i = 0; i < Kyber_N; i++) a.coeffs[i] += b.coeffs[i];
+    return bounded_poly<BA + BB, D>(std::move(a.coeffs));
+}
+
+template<int32_t BA, int32_t BB, poly_domain D>
+bounded_poly<BA + BB, D> poly_sub(bounded_poly<BA, D> &&a, const bounded_poly<BB, D> &b) {
+    for (int i = 0; i < Kyber_N; i++) a.coeffs[i] -= b.coeffs[i];
+    return bounded_poly<BA + BB, D>(std::move(a.coeffs));
+}
+
+template<int32_t B, poly_domain D>
+bounded_poly<Kyber_Q, D> poly_reduce(bounded_poly<B, D> &&p) {
+    poly_reduce(p.coeffs);
+    return bounded_poly<Kyber_Q, D>(std::move(p.coeffs));
+}
+
+template<int32_t B>
+bounded_poly<Kyber_Q, POLY_NTT> poly_tomont(bounded_poly<B, POLY_NTT_MONT> &&p) {
+    static_assert((int64_t)B * ((1ULL << 32) % Kyber_Q) < FQMUL_MAX_PRODUCT, "tomont product out of montgomery_reduce range");
+    poly_tomont(p.coeffs);
+    return bounded_poly<Kyber_Q, POLY_NTT>(std::move(p.coeffs));
+}
+
+// Reduces only when the bound exceeds Limit; otherwise the polynomial is
+// passed through untouched and no reduction pass is emitted.
+template<int32_t Limit, int32_t B, poly_domain D>
+auto reduce_to(bounded_poly<B, D> &&p) {
+    static_assert(Kyber_Q <= Limit, "a reduced polynomial must satisfy the limit");
+    if constexpr (B <= Limit) return std::move(p);
+    else return poly_reduce(std::move(p));
+}
+
+// Compress maps (-q,q] onto [0,2^d) (negative inputs are lifted by q).
+template<int32_t B>
+vector<i16> Compress(bounded_poly<B, POLY_NORMAL> &p, int d) {
+    static_assert(B <= Kyber_Q, "Compress needs coefficients in (-q,q]");
+    return Compress(p.coeffs, d);
+}
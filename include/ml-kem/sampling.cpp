@@ -1,4 +1,6 @@
 #include "sampling.hpp"
+#include "dispatch.hpp"
+#include "trace.hpp"
 
 /*************************************************
 * Name:        NTT_sample
@@ -17,6 +19,7 @@
 * Returns:     - vector<i16>: sampled polynomial in Z_q^256
 **************************************************/
 vector<i16> NTT_sample(vector<ui8> &random, ui8 i, ui8 j_index) {
+    MLKEM_TRACE_SCOPE("NTT_sample");
     ui8 seed[34];
     for (int index = 0; index < 32; index++) {
         seed[index] = random[index];
@@ -27,16 +30,20 @@ vector<i16> NTT_sample(vector<ui8> &random, ui8 i, ui8 j_index) {
     ui8 out[768];
     FIPS202_SHAKE128(seed, 34, out, 768);
 
-    vector<i16> result;
-    int j = 0, pos = 0;
-    while (j < 256) {
-        int d1 = out[pos] + 256 * (out[pos + 1] & 0x0F);
-        int d2 = (out[pos + 1] >> 4) + 16 * out[pos + 2];
+    vector<i16> result(Kyber_N);
+    unsigned j = mlkem_dispatch().rej_uniform(result.data(), Kyber_N, out, sizeof(out));
 
-        if (d1 < Kyber_Q) result.push_back(d1), j++;
-        if (d2 < Kyber_Q && j < 256) result.push_back(d2), j++;
-
-        pos += 3;
+    // 768 bytes almost always suffice; otherwise squeeze a longer prefix
+    // of the same stream and continue after the bytes already consumed.
+    u64 consumed = sizeof(out), outlen = sizeof(out);
+    vector<ui8> more;
+    while (j < Kyber_N) {
+        outlen += 3 * 168;
+        more.resize(outlen);
+        FIPS202_SHAKE128(seed, 34, more.data(), outlen);
+        j += mlkem_dispatch().rej_uniform(result.data() + j, Kyber_N - j,
+                                          more.data() + consumed, outlen - consumed);
+        consumed = outlen;
     }
     
     return result;
@@ -58,6 +65,7 @@ vector<i16> NTT_sample(vector<ui8> &random, ui8 i, ui8 j_index) {
 * Returns:     - vector<i16>: length-256 polynomial with coefficients ∈ Z_q
 **************************************************/
 vector<i16> Binomial_sample(vector<ui8>& random, int eta) {
+    MLKEM_TRACE_SCOPE("Binomial_sample");
     // 1) Exact‐length check
     size_t needed = 64 * eta;
     if (random.size() != needed) {
@@ -65,36 +73,9 @@ vector<i16> Binomial_sample(vector<ui8>& random, int eta) {
             "Binomial_sample: random.size() must be exactly 64*eta bytes");
     }
 
-    // 2) Unpack bytes → bits (LSB first)
-    vector<bool> bits;
-    bits.reserve(needed * 8);
-    for (ui8 byte : random) {
-        for (int b = 0; b < 8; ++b) {
-            bits.push_back((byte >> b) & 1);
-        }
-    }
-
-    // 3) Consume 2*eta bits per coefficient
+    // 2) Consume 2*eta bits per coefficient, mapped into [0, q)
     vector<i16> f(Kyber_N);
-    size_t idx = 0;
-    for (int i = 0; i < Kyber_N; ++i) {
-        int sum0 = 0, sum1 = 0;
-        // first eta bits
-        for (int j = 0; j < eta; ++j) {
-            sum0 += bits[idx + j];
-        }
-        // next eta bits
-        for (int j = 0; j < eta; ++j) {
-            sum1 += bits[idx + eta + j];
-        }
-        idx += 2 * eta;
-
-        // centered difference in [-(eta), +eta]
-        int diff = sum0 - sum1;
-        // map negative to [0, q)
-        if (diff < 0) diff += Kyber_Q;
-        f[i] = i16(diff);
-    }
+    mlkem_dispatch().cbd(f.data(), random.data(), eta);
 
     return f;
 }
\ No newline at end of file
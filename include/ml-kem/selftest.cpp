@@ -0,0 +1,202 @@
+#include "selftest.hpp"
+#include "ML-KEM.hpp"
+#include "dispatch.hpp"
+#include "hash_multi.hpp"
+#include "trace.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+typedef struct{
+    const char *name;
+    ui8 digest[32];
+} selftest_kat;
+
+// SHA3-256 of each check's output. The hash entries were computed with an
+// independent SHA-3 implementation (Python hashlib), the multi-buffer ones
+// over the lanes' outputs in order; the NTT and ML-KEM entries pin this
+// library's own outputs for fixed inputs.
+static const selftest_kat kats[] = {
+    {"SHA3-256", {0x1b,0xea,0x1a,0x85,0xc8,0x2f,0x14,0x1d,0x11,0x89,0x88,0xbe,0x6f,0x7a,0x7c,0x08,
+                  0x75,0xa4,0x5c,0x1a,0x98,0x20,0xf2,0xe1,0xd7,0x79,0x70,0x61,0xd2,0xb3,0xd8,0x6a}},
+    {"SHA3-512", {0xf2,0xce,0x33,0xc7,0xad,0xbb,0x51,0x31,0xe5,0xc2,0xe3,0xb1,0x61,0xd5,0x0c,0x21,
+                  0xa7,0x47,0xcd,0x08,0x12,0xd7,0x3c,0xc0,0xf1,0x20,0xfc,0x66,0x3e,0xcb,0xcb,0x89}},
+    {"SHAKE128", {0x67,0x40,0xdb,0x6a,0xa2,0xf3,0x27,0xd4,0x1a,0x21,0xa9,0xb8,0x39,0x36,0x53,0xf7,
+                  0x58,0xfe,0x65,0x0f,0xde,0x31,0x93,0xda,0xba,0x0f,0x08,0x6f,0xda,0xe9,0xdd,0xe5}},
+    {"SHAKE256", {0x71,0x14,0x3e,0xc7,0xf2,0x36,0x72,0x13,0x28,0xe8,0xf2,0xc3,0xb0,0x62,0x17,0x5a,
+                  0x23,0xaf,0x06,0x2c,0x87,0xbd,0x4b,0x28,0x26,0x5a,0x06,0x85,0x70,0x72,0xc0,0x8c}},
+    {"SHAKE256 x4", {0x19,0x17,0xb4,0x09,0x1e,0xbf,0xe5,0x09,0x05,0xf4,0x8d,0x53,0x0d,0xf9,0x23,0xe3,
+                     0x64,0x0e,0x3b,0xdc,0x29,0x96,0xb3,0x48,0x0d,0x52,0x3e,0x87,0x2a,0xfe,0x68,0x4d}},
+    {"SHAKE128 x8", {0xcd,0x2b,0xa1,0x5a,0x95,0xb1,0xfb,0x1f,0xbe,0x4c,0x9a,0x3f,0x78,0xc2,0xbc,0x66,
+                     0x19,0x56,0xca,0xe4,0x63,0xca,0xa0,0xff,0xd7,0xb7,0xd0,0x08,0x27,0x77,0xae,0xe2}},
+    {"NTT", {0x0d,0x58,0x52,0x17,0x09,0x46,0x7b,0x30,0xf4,0x6f,0x6f,0x3f,0xa3,0x78,0xb4,0x5f,
+             0x6a,0xba,0xf5,0xa8,0xce,0x51,0xd8,0xdf,0xd3,0x39,0x7b,0x30,0x6f,0xe5,0xfc,0xe0}},
+    {"invNTT", {0x24,0x83,0x02,0xbd,0x8c,0xc7,0xa3,0xd6,0xa8,0xa8,0x79,0x8e,0x8d,0xce,0x10,0x31,
+                0x9c,0x6f,0x09,0xb5,0x0d,0x5e,0x31,0x8b,0x4b,0x4a,0x07,0xd2,0x27,0x43,0xb5,0xd4}},
+#if Kyber_k == 2
+    {"ML-KEM KeyGen", {0x49,0xa0,0x2a,0x1e,0x8d,0x3b,0x67,0xc2,0xef,0x45,0xa9,0x41,0xb2,0x3f,0xc5,0x5c,
+                       0xb5,0x48,0x63,0x66,0x2f,0xf3,0xf5,0x91,0x29,0xaa,0x7a,0x3a,0x31,0x6b,0xaf,0x3f}},
+    {"ML-KEM Encaps", {0x15,0x39,0x8e,0xe4,0x8c,0x38,0xef,0xed,0x0d,0x1d,0x55,0x22,0x48,0x5c,0x0d,0xeb,
+                       0x3f,0x2c,0xa9,0x56,0xd5,0x98,0x93,0xde,0x6d,0x60,0x75,0xb5,0xc2,0xd1,0x25,0x6a}},
+#elif Kyber_k == 3
+    {"ML-KEM KeyGen", {0xee,0xdf,0x8f,0xd3,0xc3,0x5a,0xdf,0xae,0x41,0x4d,0x42,0xac,0x75,0x99,0x3a,0xc8,
+                       0xa0,0x31,0xbc,0xee,0xf5,0xa7,0x28,0xeb,0x90,0x4b,0xcd,0xb2,0x71,0x3f,0x13,0x48}},
+    {"ML-KEM Encaps", {0x1a,0xb5,0xe2,0xd9,0x64,0xc2,0xd0,0xf8,0xbb,0x29,0xb9,0xe8,0x3d,0x06,0x5f,0x4b,
+                       0xd9,0x90,0x1f,0x05,0xe8,0x0c,0x61,0x88,0xec,0x27,0xee,0x00,0xf6,0xb9,0x66,0x75}},
+#else
+    {"ML-KEM KeyGen", {0x6a,0xd2,0x74,0xb3,0x7e,0x0b,0xfa,0xdd,0xce,0x02,0xc2,0x57,0x2c,0x1c,0x51,0xcc,
+                       0x94,0x33,0x8b,0xc7,0xc9,0x4e,0x5d,0xbb,0x57,0xe7,0xf7,0xa8,0x7c,0xec,0x29,0xd1}},
+    {"ML-KEM Encaps", {0xc6,0xda,0x1c,0x84,0x4f,0x0b,0x5b,0xaa,0x3a,0xb0,0x5c,0xc9,0xe9,0xe5,0xfa,0x1e,
+                       0x41,0xa6,0xf9,0xa5,0x8a,0xe8,0x63,0x9c,0xe6,0x16,0x01,0x85,0xb4,0x18,0x41,0x19}},
+#endif
+};
+
+enum{ KAT_SHA3_256, KAT_SHA3_512, KAT_SHAKE128, KAT_SHAKE256, KAT_SHAKE256_X4, KAT_SHAKE128_X8,
+      KAT_NTT, KAT_INVNTT, KAT_KEYGEN, KAT_ENCAPS };
+
+static atomic<int> state(0);    // 0 not run, 1 passed, -1 failed (for the active backend)
+static atomic<const char *> failure(nullptr);
+static atomic<double> elapsed_ns(0);
+static once_flag run_once;
+static mutex run_m;             // the first run and reruns after a backend switch
+
+// Compares SHA3-256(out) (or out itself, for SHA3-256) with a stored digest
+// without an early exit.
+static bool kat_matches(int id, ui8 *out, size_t len) {
+    ui8 d[32], diff = 0;
+    if (id == KAT_SHA3_256) memcpy(d, out, 32);
+    else FIPS202_SHA3_256(out, len, d);
+    for (int i = 0; i < 32; i++) diff |= d[i] ^ kats[id].digest[i];
+    if (diff != 0 && failure.load() == nullptr) failure.store(kats[id].name);
+    return diff == 0;
+}
+
+/*************************************************
+* Name:        run_selftest
+*
+* Description: Runs every known-answer check on the active backend and
+*              records the result and the time taken. All checks run even
+*              after a failure so the cost is the same either way.
+**************************************************/
+static void run_selftest() {
+    MLKEM_TRACE_SCOPE("selftest");
+    lock_guard<mutex> lk(run_m);
+    failure.store(nullptr);
+    auto t0 = chrono::steady_clock::now();
+    const mlkem_backend &b = mlkem_dispatch();
+    bool ok = true;
+
+    ui8 msg[200], out[200];
+    for (int i = 0; i < 200; i++) msg[i] = (ui8)(i * 7 + 1);
+    FIPS202_SHA3_256(msg, 200, out);
+    ok &= kat_matches(KAT_SHA3_256, out, 32);
+    FIPS202_SHA3_512(msg, 200, out);
+    ok &= kat_matches(KAT_SHA3_512, out, 64);
+    FIPS202_SHAKE128(msg, 200, out, 200);
+    ok &= kat_matches(KAT_SHAKE128, out, 200);
+    FIPS202_SHAKE256(msg, 200, out, 200);
+    ok &= kat_matches(KAT_SHAKE256, out, 200);
+
+    // the multi-buffer sponges behind the batch, decaps_many and parallel
+    // paths: lane l hashes the message with every byte raised by l
+    ui8 lane_msg[8][200], lane_out[8][200], *lane_in[8], *lane_res[8];
+    for (int l = 0; l < 8; l++) {
+        for (int i = 0; i < 200; i++) lane_msg[l][i] = (ui8)(msg[i] + l);
+        lane_in[l] = lane_msg[l];
+        lane_res[l] = lane_out[l];
+    }
+    FIPS202_SHAKE256_x4(lane_in, 200, lane_res, 200);
+    ok &= kat_matches(KAT_SHAKE256_X4, lane_out[0], 4 * 200);
+    FIPS202_SHAKE128_x8(lane_in, 200, lane_res, 200);
+    ok &= kat_matches(KAT_SHAKE128_X8, lane_out[0], 8 * 200);
+
+    i16 a[Kyber_N];
+    ui8 enc[384];
+    for (int i = 0; i < Kyber_N; i++) a[i] = (i16)((i * 97 + 13) % Kyber_Q);
+    b.ntt(a);
+    b.poly_reduce(a);
+    b.byte_encode(enc, a, 12);
+    ok &= kat_matches(KAT_NTT, enc, 384);
+    b.invntt(a);
+    b.poly_reduce(a);
+    b.byte_encode(enc, a, 12);
+    ok &= kat_matches(KAT_INVNTT, enc, 384);
+
+    vector<ui8> d(32), z(32), m(32);
+    for (int i = 0; i < 32; i++) { d[i] = (ui8)i; z[i] = (ui8)(0x40 + i); m[i] = (ui8)(0x80 + i); }
+    auto [ek, dk] = ML_KEM_KeyGen_internal(d, z);
+    vector<ui8> keys(ek);
+    keys.insert(keys.end(), dk.begin(), dk.end());
+    ok &= kat_matches(KAT_KEYGEN, keys.data(), keys.size());
+    auto [K, c] = ML_KEM_Encaps_internal(ek, m);
+    vector<ui8> kc(K);
+    kc.insert(kc.end(), c.begin(), c.end());
+    ok &= kat_matches(KAT_ENCAPS, kc.data(), kc.size());
+    if (ML_KEM_Decaps_internal(dk, c) != K) {
+        if (failure.load() == nullptr) failure.store("ML-KEM Decaps");
+        ok = false;
+    }
+
+    elapsed_ns.store(chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count());
+    state.store(ok ? 1 : -1, memory_order_release);
+    if (!ok) cerr<<"ML-KEM self-test failed on the "<<b.name<<" backend: "<<failure.load()<<endl;
+}
+
+/*************************************************
+* Name:        mlkem_selftest
+*
+* Description: Runs the self-test on the first call (in any thread) and
+*              returns its result afterwards.
+*
+* Returns:     - bool: true if every known-answer check passed
+**************************************************/
+bool mlkem_selftest() {
+    call_once(run_once, run_selftest);
+    return state.load(memory_order_acquire) == 1;
+}
+
+bool mlkem_selftest_passed() {
+    int s = state.load(memory_order_acquire);
+    return s == 1 || (s == 0 && mlkem_selftest());
+}
+
+/*************************************************
+* Name:        mlkem_selftest_rerun
+*
+* Description: Runs the self-test again on the active backend and makes
+*              that the recorded result; called by mlkem_select_backend
+*              after every switch.
+*
+* Returns:     - bool: true if every known-answer check passed
+**************************************************/
+bool mlkem_selftest_rerun() {
+    run_selftest();
+    return state.load(memory_order_acquire) == 1;
+}
+
+void mlkem_selftest_start_background() {
+    thread([]{ mlkem_selftest(); }).detach();
+}
+
+const char *mlkem_selftest_failure() {
+    return failure.load();
+}
+
+double mlkem_selftest_ns() {
+    return elapsed_ns.load();
+}
+
+// MLKEM_SELFTEST=background starts the self-test while the program is
+// still initialising, so the first KEM call usually finds it finished.
+static bool started_at_load = []{
+    const char *mode = getenv("MLKEM_SELFTEST");
+    if (mode != nullptr && strcmp(mode, "background") == 0) {
+        mlkem_selftest_start_background();
+        return true;
+    }
+    return false;
+}();
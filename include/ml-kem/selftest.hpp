@@ -0,0 +1,29 @@
+#pragma once
+
+#include "param.hpp"
+
+// Known-answer self-test: SHA3-256/512, SHAKE128/256, the 4- and 8-lane
+// SHAKE sponges, NTT/invNTT on the active backend and a derandomized
+// ML-KEM KeyGen/Encaps/Decaps, each output compared with a stored SHA3-256
+// digest. The public KEM calls run it on first use (lazily) and refuse to
+// work if it failed; setting MLKEM_SELFTEST=background runs it in a
+// background thread at load. Switching backends runs it again.
+
+// Runs the self-test once per process (later calls return the result;
+// concurrent callers wait for the first). true if every check passed.
+bool mlkem_selftest();
+
+// Runs the self-test again on the active backend and records that result.
+bool mlkem_selftest_rerun();
+
+// Starts the self-test on a background thread and returns immediately.
+void mlkem_selftest_start_background();
+
+// Name of the first failing check, or nullptr.
+const char *mlkem_selftest_failure();
+
+// Wall time the self-test took, 0 if it has not finished.
+double mlkem_selftest_ns();
+
+// Fast path for the API entry points.
+bool mlkem_selftest_passed();
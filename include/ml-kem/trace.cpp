@@ -0,0 +1,263 @@
+// trace.cpp
+//
+// Each thread that records an event gets a ring of MLKEM_TRACE_EVENTS
+// (default 65536) complete events. The owning thread is the only writer:
+// it fills the slot and then publishes it by advancing head with a release
+// store, so recording never takes a lock. Slot fields are relaxed atomics
+// so a dump can read them while they are rewritten; it drops what may
+// have been overwritten. Rings are registered once under
+// a mutex and outlive their thread; a ring whose thread has exited is
+// handed to the next new thread.
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+struct TraceEvent{
+    atomic<const char *> name;
+    atomic<u64> ts;         // ns since trace_epoch
+    atomic<u64> dur;
+};
+
+// An event as copied out by mlkem_trace_dump.
+struct TraceRecord{
+    const char *name;
+    u64 ts;
+    u64 dur;
+};
+
+struct TraceRing{
+    unique_ptr<TraceEvent[]> events;
+    u64 mask;               // capacity - 1
+    atomic<u64> head;       // events ever written
+    atomic<bool> in_use;
+    unsigned tid;
+    u64 cleared;            // head at the last clear; guarded by registry_m
+    string thread_name;     // guarded by registry_m
+};
+
+static const chrono::steady_clock::time_point trace_epoch = chrono::steady_clock::now();
+static atomic<bool> recording(false);
+static mutex registry_m;
+static vector<TraceRing *> rings;
+
+static u64 trace_now() {
+    return (u64)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - trace_epoch).count();
+}
+
+static size_t ring_capacity() {
+    const char *env = getenv("MLKEM_TRACE_EVENTS");
+    long n = env ? atol(env) : 0;
+    size_t cap = 1024;
+    while (cap < (size_t)n && cap < ((size_t)1 << 26)) cap <<= 1;
+    return n > 0 ? cap : 65536;
+}
+
+// Releases the thread's ring for reuse when the thread exits.
+struct RingHolder{
+    TraceRing *ring = nullptr;
+    ~RingHolder() { if (ring) ring->in_use.store(false, memory_order_release); }
+};
+static thread_local RingHolder holder;
+static thread_local char pending_name[64];
+
+/*************************************************
+* Name:        thread_ring
+*
+* Description: Ring of the calling thread, taken from the registry on the
+*              first event: a ring left by an exited thread if there is
+*              one, otherwise a new one.
+*
+* Returns:     - TraceRing*: the calling thread's ring
+**************************************************/
+static TraceRing *thread_ring() {
+    if (holder.ring) return holder.ring;
+    lock_guard<mutex> lk(registry_m);
+    for (TraceRing *r : rings) {
+        bool expected = false;
+        if (r->in_use.compare_exchange_strong(expected, true, memory_order_acquire)) {
+            r->thread_name = pending_name;
+            holder.ring = r;
+            return r;
+        }
+    }
+    TraceRing *r = new TraceRing();
+    size_t cap = ring_capacity();
+    r->events.reset(new TraceEvent[cap]());
+    r->mask = cap - 1;
+    r->head.store(0, memory_order_relaxed);
+    r->in_use.store(true, memory_order_relaxed);
+    r->tid = (unsigned)rings.size() + 1;
+    r->cleared = 0;
+    r->thread_name = pending_name;
+    rings.push_back(r);
+    holder.ring = r;
+    return r;
+}
+
+extern "C" u64 mlkem_trace_begin(void) {
+    if (!recording.load(memory_order_relaxed)) return 0;
+    return trace_now() + 1;
+}
+
+/*************************************************
+* Name:        mlkem_trace_end
+*
+* Description: Records a complete event [begin, now) in the calling
+*              thread's ring.
+*
+* Arguments:   - const char *name: stage name (string literal)
+*              - u64 begin: value returned by mlkem_trace_begin
+**************************************************/
+extern "C" void mlkem_trace_end(const char *name, u64 begin) {
+    if (begin == 0) return;
+    u64 end = trace_now();
+    TraceRing *r = thread_ring();
+    u64 h = r->head.load(memory_order_relaxed);
+    TraceEvent &e = r->events[h & r->mask];
+    e.name.store(name, memory_order_relaxed);
+    e.ts.store(begin - 1, memory_order_relaxed);
+    e.dur.store(end > begin - 1 ? end - (begin - 1) : 0, memory_order_relaxed);
+    r->head.store(h + 1, memory_order_release);
+}
+
+bool mlkem_trace_compiled() {
+#ifdef MLKEM_TRACE
+    return true;
+#else
+    return false;
+#endif
+}
+
+void mlkem_trace_enable(bool on) {
+    recording.store(on, memory_order_relaxed);
+}
+
+bool mlkem_trace_enabled() {
+    return recording.load(memory_order_relaxed);
+}
+
+void mlkem_trace_clear() {
+    lock_guard<mutex> lk(registry_m);
+    for (TraceRing *r : rings) r->cleared = r->head.load(memory_order_acquire);
+}
+
+void mlkem_trace_thread_name(const char *name) {
+    // kept until the thread records its first event, so naming a thread
+    // does not allocate a ring while tracing is off
+    snprintf(pending_name, sizeof(pending_name), "%s", name);
+    if (holder.ring) {
+        lock_guard<mutex> lk(registry_m);
+        holder.ring->thread_name = pending_name;
+    }
+}
+
+size_t mlkem_trace_event_count() {
+    lock_guard<mutex> lk(registry_m);
+    size_t n = 0;
+    for (TraceRing *r : rings) n += min<u64>(r->head.load(memory_order_acquire) - r->cleared, r->mask + 1);
+    return n;
+}
+
+// Escapes a string for a JSON string literal.
+static string json_escape(const string &s) {
+    string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)(unsigned char)c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+/*************************************************
+* Name:        mlkem_trace_dump
+*
+* Description: Writes the recorded events as Chrome trace-event JSON.
+*              Rings are read while their threads may still be writing;
+*              events that could have been overwritten during the copy
+*              are dropped.
+*
+* Arguments:   - const char *path: output file
+*
+* Returns:     - bool: true on success
+**************************************************/
+bool mlkem_trace_dump(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (f == nullptr) {
+        cerr << "mlkem_trace_dump: cannot open " << path << endl;
+        return false;
+    }
+#ifdef __linux__
+    int pid = (int)getpid();
+#else
+    int pid = 1;
+#endif
+
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    lock_guard<mutex> lk(registry_m);
+    for (TraceRing *r : rings) {
+        u64 cap = r->mask + 1;
+        u64 h = r->head.load(memory_order_acquire);
+        u64 lo = max(h > cap ? h - cap : 0, r->cleared);
+        vector<TraceRecord> copy;
+        // acquire loads, so head is read again only after the copies
+        for (u64 i = lo; i < h; i++) {
+            const TraceEvent &e = r->events[i & r->mask];
+            copy.push_back({e.name.load(memory_order_acquire), e.ts.load(memory_order_acquire),
+                            e.dur.load(memory_order_acquire)});
+        }
+        u64 h2 = r->head.load(memory_order_acquire);
+        u64 valid_from = h2 > cap ? h2 - cap : 0;
+        if (valid_from > lo) copy.erase(copy.begin(), copy.begin() + min<u64>(valid_from - lo, copy.size()));
+
+        // parents before children so viewers nest them
+        sort(copy.begin(), copy.end(), [](const TraceRecord &a, const TraceRecord &b) {
+            return a.ts != b.ts ? a.ts < b.ts : a.dur > b.dur;
+        });
+
+        string label = json_escape(r->thread_name.empty() ? "thread " + to_string(r->tid) : r->thread_name);
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", pid, r->tid, label.c_str());
+        first = false;
+        for (const TraceRecord &e : copy) {
+            if (e.name == nullptr) continue;
+            fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"mlkem\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    e.name, pid, r->tid, e.ts / 1000.0, e.dur / 1000.0);
+        }
+    }
+    fprintf(f, "\n]}\n");
+    bool ok = ferror(f) == 0;
+    ok = fclose(f) == 0 && ok;
+    return ok;
+}
+
+// MLKEM_TRACE_FILE=<path> records from load time and writes at exit.
+struct TraceFileAtExit{
+    const char *path;
+    TraceFileAtExit() : path(getenv("MLKEM_TRACE_FILE")) {
+        if (path && *path) mlkem_trace_enable(true);
+    }
+    ~TraceFileAtExit() {
+        if (path && *path) mlkem_trace_dump(path);
+    }
+};
+static TraceFileAtExit trace_file_at_exit;
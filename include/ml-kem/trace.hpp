@@ -0,0 +1,49 @@
+#pragma once
+
+#include "param.hpp"
+
+// Stage tracer. The scopes are compiled into the library only with
+// MLKEM_TRACE (CMake MLKEM_TRACE=ON); recording then starts with
+// mlkem_trace_enable(true) or MLKEM_TRACE_FILE=<path>, which also writes
+// the trace at exit. Events go to a per-thread ring buffer that only its
+// own thread writes; when a ring is full the oldest events are replaced.
+
+bool mlkem_trace_compiled();
+
+void mlkem_trace_enable(bool on);
+bool mlkem_trace_enabled();
+
+// Drops every recorded event.
+void mlkem_trace_clear();
+
+// Label for the calling thread's track in the trace viewer.
+void mlkem_trace_thread_name(const char *name);
+
+// Writes Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+bool mlkem_trace_dump(const char *path);
+
+// Number of events currently held in all rings.
+size_t mlkem_trace_event_count();
+
+// Hooks behind the scopes; also called from the C sponge code. begin
+// returns 0 while recording is off and end ignores a 0 begin.
+extern "C" {
+u64 mlkem_trace_begin(void);
+void mlkem_trace_end(const char *name, u64 begin);
+}
+
+#ifdef MLKEM_TRACE
+class TraceScope{
+public:
+    explicit TraceScope(const char *name) : name(name), begin(mlkem_trace_begin()) {}
+    ~TraceScope() { mlkem_trace_end(name, begin); }
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+private:
+    const char *name;
+    u64 begin;
+};
+#define MLKEM_TRACE_SCOPE(name) TraceScope mlkem_trace_scope_(name)
+#else
+#define MLKEM_TRACE_SCOPE(name) ((void)0)
+#endif
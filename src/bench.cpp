@@ -0,0 +1,163 @@
+#include <iostream>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "ml-kem/ML-KEM.hpp"
+#include "ml-kem/noheap.hpp"
+#include "ml-kem/decaps_many.hpp"
+#include "ml-kem/selftest.hpp"
+#include "ml-kem/dispatch.hpp"
+#include "ml-kem/alloc_track.hpp"
+#include "perf_counters.hpp"
+
+using namespace std;
+
+struct BenchCase{
+    const char *name;
+    function<void()> fn;
+    int op;         // mlkem_op whose allocation peak is reported, or -1
+};
+
+// Times fn one call at a time and prints the median and mean, followed by
+// the allocation figures when the library was built with tracking.
+// Returns the median.
+static double run_case(const BenchCase &c, int iters) {
+    vector<double> ns(iters);
+    for (int i = 0; i < 3; i++) c.fn();
+
+    mlkem_alloc_reset();
+    mlkem_alloc_stats before = mlkem_alloc_thread();
+    for (int i = 0; i < iters; i++) {
+        auto t0 = chrono::steady_clock::now();
+        c.fn();
+        auto t1 = chrono::steady_clock::now();
+        ns[i] = chrono::duration<double, nano>(t1 - t0).count();
+    }
+    mlkem_alloc_stats after = mlkem_alloc_thread();
+
+    double mean = 0;
+    for (double x : ns) mean += x;
+    mean /= iters;
+    sort(ns.begin(), ns.end());
+
+    printf("%-24s %12.0f %12.0f", c.name, ns[iters / 2], mean);
+    if (mlkem_alloc_tracking_enabled()) {
+        double allocs = double(after.allocations - before.allocations) / iters;
+        double bytes = double(after.bytes - before.bytes) / iters;
+        printf(" %10.1f %12.0f", allocs, bytes);
+        if (c.op >= 0) printf(" %12llu", (unsigned long long)mlkem_alloc_total((mlkem_op)c.op).peak_live_bytes);
+        else printf(" %12s", "-");
+    }
+    printf("\n");
+    return ns[iters / 2];
+}
+
+// Runs fn iters times inside the counter group and prints per-call
+// averages; counters the CPU did not provide are shown as '-'.
+static void run_perf_case(PerfCounters &pc, const BenchCase &c, int iters) {
+    for (int i = 0; i < 3; i++) c.fn();
+    pc.start();
+    for (int i = 0; i < iters; i++) c.fn();
+    PerfSample s = pc.stop();
+
+    printf("%-24s", c.name);
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        if (s.valid[i]) printf(" %13.1f", s.value[i] / iters);
+        else printf(" %13s", "-");
+    }
+    if (s.valid[PERF_CYCLES] && s.valid[PERF_INSTRUCTIONS] && s.value[PERF_CYCLES] > 0)
+        printf(" %6.2f", s.value[PERF_INSTRUCTIONS] / s.value[PERF_CYCLES]);
+    else printf(" %6s", "-");
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    int iters = 1000;
+    bool perf = false;
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--perf") perf = true;
+        else iters = atoi(argv[i]);
+    }
+    if (iters < 1) iters = 1;
+
+    vector<ui8> seed(32, 7), sample(64 * eta1, 9), msg(800, 3), out(768);
+    vector<i16> a(Kyber_N), b(Kyber_N);
+    for (int i = 0; i < Kyber_N; i++) { a[i] = (i * 13) % Kyber_Q; b[i] = (i * 7) % Kyber_Q; }
+    alignas(8) ui8 state[200] = {0};
+
+    auto [ek, dk] = ML_KEM_KEYGEN();
+    auto [K, c] = ML_KEM_ENCAPSULATION(ek);
+    vector<vector<ui8>> eks(8, ek), dks(8, dk), cts(8, c), many_cts(64, c);
+    mlkem_expanded_dk expanded;
+    ML_KEM_expand_decaps_key(expanded, dk);
+    vector<ui8> cu(c.begin(), c.begin() + 32 * du);
+    vector<i16> t(Kyber_N);
+    ui8 nh_ek[MLKEM_EK_BYTES], nh_dk[MLKEM_DK_BYTES], nh_c[MLKEM_CT_BYTES], nh_K[32];
+    ML_KEM_KeyGen_noheap(nh_ek, nh_dk, seed.data(), seed.data());
+    ML_KEM_Encaps_noheap(nh_K, nh_c, nh_ek, seed.data());
+
+    vector<BenchCase> cases = {
+        {"KeccakF1600", [&]{ mlkem_dispatch().keccak_f1600(state); }, -1},
+        {"SHA3-256(800B)", [&]{ FIPS202_SHA3_256(msg.data(), 800, out.data()); }, -1},
+        {"SHAKE128(768B)", [&]{ FIPS202_SHAKE128(seed.data(), 32, out.data(), 768); }, -1},
+        {"ntt", [&]{ ntt(a); }, -1},
+        {"invntt", [&]{ invntt(a); }, -1},
+        {"basemul", [&]{ poly_multiply_pointwise_mont(a, b); }, -1},
+        {"NTT_sample", [&]{ NTT_sample(seed, 0, 1); }, -1},
+        {"Binomial_sample", [&]{ Binomial_sample(sample, eta1); }, -1},
+        {"ByteEncode12", [&]{ ByteEncode(b, 12); }, -1},
+        {"decode+decompress+ntt", [&]{ vector<i16> x = ByteDecode(cu, du); vector<i16> y = Decompress(x, du); ntt(y); }, -1},
+        {"ntt_decompress", [&]{ ntt_decompress(t, c.data(), du); }, -1},
+        {"invntt+add+compress", [&]{ t = b; invntt(t); vector<i16> x = poly_add(t, a); poly_reduce(x);
+                                     vector<i16> y = Compress(x, du); ByteEncode(y, du); }, -1},
+        {"invntt_compress", [&]{ t = b; invntt_compress(out.data(), t, a, du, false); }, -1},
+        {"check_encaps_key", [&]{ ML_KEM_check_encaps_key(ek); }, -1},
+        {"check_decaps_key", [&]{ ML_KEM_check_decaps_key(dk); }, -1},
+        {"ML_KEM_KEYGEN", [&]{ ML_KEM_KEYGEN(); }, MLKEM_OP_KEYGEN},
+        {"ML_KEM_ENCAPSULATION", [&]{ ML_KEM_ENCAPSULATION(ek); }, MLKEM_OP_ENCAPS},
+        {"ML_KEM_DECAPSULATION", [&]{ ML_KEM_DECAPSULATION(dk, c); }, MLKEM_OP_DECAPS},
+        {"ENCAPSULATION_BATCH(8)", [&]{ ML_KEM_ENCAPSULATION_BATCH(eks); }, MLKEM_OP_ENCAPS_BATCH},
+        {"DECAPSULATION_BATCH(8)", [&]{ ML_KEM_DECAPSULATION_BATCH(dks, cts); }, MLKEM_OP_DECAPS_BATCH},
+        {"expand_decaps_key", [&]{ ML_KEM_expand_decaps_key(expanded, dk); }, -1},
+        {"decaps_many(64)", [&]{ ML_KEM_decaps_many(expanded, many_cts); }, -1},
+        {"KeyGen_noheap", [&]{ ML_KEM_KeyGen_noheap(nh_ek, nh_dk, seed.data(), seed.data()); }, -1},
+        {"Encaps_noheap", [&]{ ML_KEM_Encaps_noheap(nh_K, nh_c, nh_ek, seed.data()); }, -1},
+        {"Decaps_noheap", [&]{ ML_KEM_Decaps_noheap(nh_K, nh_c, nh_dk); }, -1},
+    };
+
+#ifdef MLKEM_SHOUP_NTT
+    const char *twiddles = "shoup";
+#else
+    const char *twiddles = "montgomery";
+#endif
+    printf("backend: %s, k = %d, %s twiddles, %d iterations\n", mlkem_dispatch().name, Kyber_k, twiddles, iters);
+    printf("self-test: %s in %.0f us\n", mlkem_selftest() ? "passed" : "FAILED", mlkem_selftest_ns() / 1000);
+    printf("%-24s %12s %12s", "operation", "median ns", "mean ns");
+    if (mlkem_alloc_tracking_enabled()) printf(" %10s %12s %12s", "allocs/op", "bytes/op", "peak bytes");
+    printf("\n");
+    double decaps_ns = 0, many_ns = 0;
+    for (const BenchCase &bc : cases) {
+        double median = run_case(bc, iters);
+        if (string(bc.name) == "ML_KEM_DECAPSULATION") decaps_ns = median;
+        if (string(bc.name) == "decaps_many(64)") many_ns = median / 64;
+    }
+    printf("\nsame-key decapsulation per core: %.0f/s one at a time, %.0f/s with decaps_many\n",
+           1e9 / decaps_ns, 1e9 / many_ns);
+
+    if (perf) {
+        PerfCounters pc;
+        if (!pc.available()) {
+            printf("\nhardware counters unavailable: %s\n", pc.reason().c_str());
+            return 0;
+        }
+        printf("\n%-24s", "per call");
+        for (int i = 0; i < PERF_COUNTER_COUNT; i++) printf(" %13s", PerfCounters::name((perf_counter_id)i));
+        printf(" %6s\n", "IPC");
+        for (const BenchCase &bc : cases) run_perf_case(pc, bc, iters);
+    }
+    return 0;
+}
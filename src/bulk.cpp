@@ -0,0 +1,540 @@
+// mlkem_bulk: file-to-file keygen, encapsulation and decapsulation.
+//
+// Every file is an array of fixed-size records, so record i of an output
+// always belongs to record i of the input:
+//   keygen  --ek FILE --dk FILE      ek / dk records (no input)
+//   encaps  --in EKS                 ek records
+//           --ct FILE --ss FILE      key id || c records, K records
+//   decaps  --keys DKS --in CTS      dk records, key id || c records
+//           --ss FILE                K records
+// A key id is the little-endian u64 index of the key's record (encaps
+// writes the index of the ek it used, so its --ct output is decaps input
+// for the matching dk file). Inputs are mmap'd; records are processed a
+// window at a time across the executor, and a window's outputs are written
+// with one pwrite per file by a writer thread while the next window is
+// computed. A record whose key fails the FIPS 203 check is written as
+// zeros and counted as a failure.
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ml-kem/ML-KEM.hpp"
+#include "ml-kem/noheap.hpp"
+#include "ml-kem/decaps_many.hpp"
+#include "ml-kem/executor.hpp"
+#include "ml-kem/selftest.hpp"
+#include "ml-kem/dispatch.hpp"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static const size_t id_bytes = 8;
+
+enum bulk_mode{ BULK_KEYGEN, BULK_ENCAPS, BULK_DECAPS };
+
+struct BulkConfig{
+    bulk_mode mode;
+    const char *in_path = nullptr;      // encaps: ek records, decaps: key id || c
+    const char *keys_path = nullptr;    // decaps: dk records
+    const char *ek_path = nullptr;
+    const char *dk_path = nullptr;
+    const char *ct_path = nullptr;
+    const char *ss_path = nullptr;
+    u64 count = 0;                      // records to process, 0 = to end of input
+    u64 offset = 0;                     // first record
+    bool resume = false;
+    unsigned threads = 0;
+    size_t chunk = 0;                   // records per task, 0 = executor_chunk_size
+    size_t window = 0;                  // records per write, 0 = about 32 MiB in and out
+    bool quiet = false;
+};
+
+// A read-only mapping of a whole file of fixed-size records.
+struct MappedFile{
+    const ui8 *data = nullptr;
+    size_t bytes = 0;
+    u64 records = 0;
+
+    bool open(const char *path, size_t record_bytes) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            cerr<<"mlkem_bulk: cannot open "<<path<<": "<<strerror(errno)<<endl;
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            cerr<<"mlkem_bulk: cannot stat "<<path<<": "<<strerror(errno)<<endl;
+            ::close(fd);
+            return false;
+        }
+        bytes = (size_t)st.st_size;
+        if (bytes % record_bytes != 0) {
+            cerr<<"mlkem_bulk: "<<path<<" is not a whole number of "<<record_bytes<<"-byte records"<<endl;
+            ::close(fd);
+            return false;
+        }
+        records = bytes / record_bytes;
+        if (bytes > 0) {
+            void *p = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                cerr<<"mlkem_bulk: cannot map "<<path<<": "<<strerror(errno)<<endl;
+                ::close(fd);
+                return false;
+            }
+            madvise(p, bytes, MADV_SEQUENTIAL);
+            data = (const ui8 *)p;
+        }
+        ::close(fd);
+        return true;
+    }
+
+    ~MappedFile() {
+        if (data) munmap((void *)data, bytes);
+    }
+};
+
+// One output file and the two window buffers it alternates between.
+struct BulkOutput{
+    const char *path;
+    size_t record_bytes;
+    int fd = -1;
+    vector<ui8> buf[2];
+
+    BulkOutput(const char *path, size_t record_bytes) : path(path), record_bytes(record_bytes) {}
+};
+
+static void usage(const char *prog) {
+    cerr << "usage: " << prog << " keygen --count N --ek FILE --dk FILE [options]\n"
+         << "       " << prog << " encaps --in EKS --ct FILE --ss FILE [options]\n"
+         << "       " << prog << " decaps --keys DKS --in CTS --ss FILE [options]\n"
+         << "  --count N       records to process (default: to the end of the input)\n"
+         << "  --offset N      start at record N; outputs are written from record N on\n"
+         << "  --resume        start after the last whole record already in every output\n"
+         << "  --threads N     worker threads (default: hardware concurrency)\n"
+         << "  --chunk N       records per task (default: sized to L2)\n"
+         << "  --window N      records per write (default: about 32 MiB of input and output)\n"
+         << "  --quiet         no progress lines\n"
+         << "record sizes for k = " << Kyber_k << ": ek " << MLKEM_EK_BYTES << ", dk " << MLKEM_DK_BYTES
+         << ", ct " << id_bytes << " + " << MLKEM_CT_BYTES << ", ss " << MLKEM_SS_BYTES << " bytes\n";
+}
+
+static bool parse_args(int argc, char **argv, BulkConfig &cfg) {
+    if (argc < 2) return false;
+    string mode = argv[1];
+    if (mode == "keygen") cfg.mode = BULK_KEYGEN;
+    else if (mode == "encaps") cfg.mode = BULK_ENCAPS;
+    else if (mode == "decaps") cfg.mode = BULK_DECAPS;
+    else return false;
+
+    for (int i = 2; i < argc; i++) {
+        string a = argv[i];
+        auto value = [&]() -> const char * {
+            if (i + 1 >= argc) {
+                cerr<<"mlkem_bulk: "<<a<<" needs a value"<<endl;
+                return nullptr;
+            }
+            return argv[++i];
+        };
+        const char *v = nullptr;
+        if (a == "--resume") cfg.resume = true;
+        else if (a == "--quiet") cfg.quiet = true;
+        else if (!(v = value())) return false;
+        else if (a == "--in") cfg.in_path = v;
+        else if (a == "--keys") cfg.keys_path = v;
+        else if (a == "--ek") cfg.ek_path = v;
+        else if (a == "--dk") cfg.dk_path = v;
+        else if (a == "--ct") cfg.ct_path = v;
+        else if (a == "--ss") cfg.ss_path = v;
+        else if (a == "--count") cfg.count = strtoull(v, nullptr, 10);
+        else if (a == "--offset") cfg.offset = strtoull(v, nullptr, 10);
+        else if (a == "--threads") cfg.threads = (unsigned)atoi(v);
+        else if (a == "--chunk") cfg.chunk = (size_t)strtoull(v, nullptr, 10);
+        else if (a == "--window") cfg.window = (size_t)strtoull(v, nullptr, 10);
+        else {
+            cerr<<"mlkem_bulk: unknown option "<<a<<endl;
+            return false;
+        }
+    }
+
+    switch (cfg.mode) {
+    case BULK_KEYGEN:
+        if (!cfg.ek_path || !cfg.dk_path || cfg.count == 0) {
+            cerr<<"mlkem_bulk: keygen needs --count, --ek and --dk"<<endl;
+            return false;
+        }
+        break;
+    case BULK_ENCAPS:
+        if (!cfg.in_path || !cfg.ct_path || !cfg.ss_path) {
+            cerr<<"mlkem_bulk: encaps needs --in, --ct and --ss"<<endl;
+            return false;
+        }
+        break;
+    case BULK_DECAPS:
+        if (!cfg.keys_path || !cfg.in_path || !cfg.ss_path) {
+            cerr<<"mlkem_bulk: decaps needs --keys, --in and --ss"<<endl;
+            return false;
+        }
+        break;
+    }
+    return true;
+}
+
+static void store_id(ui8 *p, u64 id) {
+    for (int i = 0; i < 8; i++) p[i] = (ui8)(id >> (8 * i));
+}
+
+static u64 load_id(const ui8 *p) {
+    u64 id = 0;
+    for (int i = 0; i < 8; i++) id |= (u64)p[i] << (8 * i);
+    return id;
+}
+
+/*************************************************
+* Name:        write_all
+*
+* Description: pwrite()s the whole buffer at offset, retrying short writes.
+*
+* Returns:     - bool: false (with a message) on a write error
+**************************************************/
+static bool write_all(const BulkOutput &out, const ui8 *p, size_t n, u64 offset) {
+    while (n > 0) {
+        ssize_t w = pwrite(out.fd, p, n, (off_t)offset);
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0) {
+            cerr<<"mlkem_bulk: write to "<<out.path<<" failed: "<<strerror(errno)<<endl;
+            return false;
+        }
+        if (w == 0) {
+            cerr<<"mlkem_bulk: write to "<<out.path<<" wrote nothing at offset "<<offset<<endl;
+            return false;
+        }
+        p += w;
+        n -= (size_t)w;
+        offset += (u64)w;
+    }
+    return true;
+}
+
+// Per-worker state for decaps: the last key expanded, so runs of
+// ciphertexts under one key (the common layout) expand it once per chunk
+// at most, and usually once per worker.
+struct DecapsKeySlot{
+    u64 id = ~0ULL;
+    bool valid = false;
+    unique_ptr<mlkem_expanded_dk> key;
+};
+
+struct BulkJob{
+    const BulkConfig &cfg;
+    MappedFile in, keys;
+    vector<BulkOutput> outputs;
+    vector<DecapsKeySlot> key_slots;
+    atomic<u64> failures;
+
+    explicit BulkJob(const BulkConfig &c) : cfg(c), failures(0) {}
+
+    void keygen(ExecutorWorker &w, u64 first, size_t b, size_t e, int slot);
+    void encaps(ExecutorWorker &w, u64 first, size_t b, size_t e, int slot);
+    void decaps(ExecutorWorker &w, u64 first, size_t b, size_t e, int slot);
+};
+
+/*************************************************
+* Name:        BulkJob::keygen
+*
+* Description: Generates key pairs b..e of the window straight into the
+*              window buffers, with d and z from the worker's DRBG. The
+*              seeds are wiped from the scratch arena afterwards.
+**************************************************/
+void BulkJob::keygen(ExecutorWorker &w, u64 first, size_t b, size_t e, int slot) {
+    (void)first;
+    ui8 *seeds = w.scratch_bytes(64 * (e - b));
+    w.random(seeds, 64 * (e - b));
+    ui8 *ek = outputs[0].buf[slot].data();
+    ui8 *dk = outputs[1].buf[slot].data();
+    for (size_t i = b; i < e; i++) {
+        const ui8 *s = seeds + 64 * (i - b);
+        ML_KEM_KeyGen_noheap(ek + i * MLKEM_EK_BYTES, dk + i * MLKEM_DK_BYTES, s, s + 32);
+    }
+    mlkem_wipe(seeds, 64 * (e - b));
+    w.stats.keygen += e - b;
+}
+
+/*************************************************
+* Name:        BulkJob::encaps
+*
+* Description: Checks the keys of records b..e of the window and runs the
+*              multi-buffer batch path on those that pass; the others are
+*              written as zeros. The messages m are wiped afterwards.
+**************************************************/
+void BulkJob::encaps(ExecutorWorker &w, u64 first, size_t b, size_t e, int slot) {
+    vector<vector<ui8>> eks, msgs;
+    vector<size_t> index;
+    ui8 *m = w.scratch_bytes(32 * (e - b));
+    w.random(m, 32 * (e - b));
+    for (size_t i = b; i < e; i++) {
+        const ui8 *rec = in.data + (first + i) * MLKEM_EK_BYTES;
+        vector<ui8> ek(rec, rec + MLKEM_EK_BYTES);
+        if (!ML_KEM_check_encaps_key(ek)) continue;
+        eks.push_back(move(ek));
+        msgs.emplace_back(m + 32 * (i - b), m + 32 * (i - b + 1));
+        index.push_back(i);
+    }
+    mlkem_wipe(m, 32 * (e - b));
+
+    ui8 *ct = outputs[0].buf[slot].data();
+    ui8 *ss = outputs[1].buf[slot].data();
+    memset(ct + b * (id_bytes + MLKEM_CT_BYTES), 0, (e - b) * (id_bytes + MLKEM_CT_BYTES));
+    memset(ss + b * MLKEM_SS_BYTES, 0, (e - b) * MLKEM_SS_BYTES);
+    auto out = ML_KEM_Encaps_internal_batch(eks, msgs);
+    for (vector<ui8> &msg : msgs) mlkem_wipe(msg.data(), msg.size());
+    for (size_t j = 0; j < out.size(); j++) {
+        size_t i = index[j];
+        ui8 *rec = ct + i * (id_bytes + MLKEM_CT_BYTES);
+        store_id(rec, first + i);
+        memcpy(rec + id_bytes, out[j].second.data(), MLKEM_CT_BYTES);
+        memcpy(ss + i * MLKEM_SS_BYTES, out[j].first.data(), MLKEM_SS_BYTES);
+    }
+    failures += (e - b) - out.size();
+    w.stats.encaps += out.size();
+    w.stats.rejected += (e - b) - out.size();
+}
+
+/*************************************************
+* Name:        BulkJob::decaps
+*
+* Description: Decapsulates records b..e of the window. The records are
+*              grouped by key id and each group goes through
+*              ML_KEM_decaps_many under the key expanded once; records
+*              whose key id is out of range or whose key fails the check
+*              are written as zeros.
+**************************************************/
+void BulkJob::decaps(ExecutorWorker &w, u64 first, size_t b, size_t e, int slot) {
+    const size_t rec_bytes = id_bytes + MLKEM_CT_BYTES;
+    vector<pair<u64, size_t>> order;
+    order.reserve(e - b);
+    for (size_t i = b; i < e; i++)
+        order.push_back({load_id(in.data + (first + i) * rec_bytes), i});
+    stable_sort(order.begin(), order.end(),
+                [](const pair<u64, size_t> &x, const pair<u64, size_t> &y){ return x.first < y.first; });
+
+    DecapsKeySlot &ks = key_slots[w.id];
+    if (!ks.key) ks.key.reset(new mlkem_expanded_dk);
+    ui8 *ss = outputs[0].buf[slot].data();
+    u64 failed = 0;
+    vector<vector<ui8>> cts;
+    for (size_t g = 0; g < order.size(); ) {
+        u64 id = order[g].first;
+        size_t g_end = g;
+        while (g_end < order.size() && order[g_end].first == id) g_end++;
+
+        if (ks.id != id) {
+            ks.id = id;
+            ks.valid = false;
+            if (id < keys.records) {
+                vector<ui8> dk(keys.data + id * MLKEM_DK_BYTES, keys.data + (id + 1) * MLKEM_DK_BYTES);
+                ks.valid = ML_KEM_expand_decaps_key(*ks.key, dk);
+            }
+        }
+        vector<vector<ui8>> out;
+        if (ks.valid) {
+            cts.clear();
+            for (size_t j = g; j < g_end; j++) {
+                const ui8 *c = in.data + (first + order[j].second) * rec_bytes + id_bytes;
+                cts.emplace_back(c, c + MLKEM_CT_BYTES);
+            }
+            out = ML_KEM_decaps_many(*ks.key, cts);
+        }
+        for (size_t j = g; j < g_end; j++) {
+            ui8 *dst = ss + order[j].second * MLKEM_SS_BYTES;
+            if (out.empty()) memset(dst, 0, MLKEM_SS_BYTES);
+            else memcpy(dst, out[j - g].data(), MLKEM_SS_BYTES);
+        }
+        if (out.empty()) failed += g_end - g;
+        g = g_end;
+    }
+    failures += failed;
+    w.stats.decaps += (e - b) - failed;
+    w.stats.rejected += failed;
+}
+
+/*************************************************
+* Name:        open_outputs
+*
+* Description: Opens every output, creating it if needed, readable by the
+*              owner only since they hold secret keys and shared
+*              secrets. A run from
+*              record 0 without --resume truncates the outputs; other
+*              runs keep what is there, so shards can share the files,
+*              but drop any records past the end of the input, which
+*              belong to an earlier, longer input. With --resume, moves
+*              the start record past the last whole record already
+*              present in all of them.
+*
+* Arguments:   - u64 available: input records (keygen: records to make)
+*              - u64 &start: first record to process
+*
+* Returns:     - bool: false on an open error
+**************************************************/
+static bool open_outputs(BulkJob &job, u64 available, u64 &start) {
+    int flags = O_WRONLY | O_CREAT;
+    if (!job.cfg.resume && job.cfg.offset == 0) flags |= O_TRUNC;
+    u64 done = ~0ULL;
+    for (BulkOutput &o : job.outputs) {
+        o.fd = ::open(o.path, flags, 0600);
+        if (o.fd < 0) {
+            cerr<<"mlkem_bulk: cannot open "<<o.path<<": "<<strerror(errno)<<endl;
+            return false;
+        }
+        struct stat st;
+        if (fstat(o.fd, &st) != 0) {
+            cerr<<"mlkem_bulk: cannot stat "<<o.path<<": "<<strerror(errno)<<endl;
+            return false;
+        }
+        u64 records = (u64)st.st_size / o.record_bytes;
+        if (job.cfg.mode != BULK_KEYGEN && records > available) {
+            if (ftruncate(o.fd, (off_t)(available * o.record_bytes)) != 0) {
+                cerr<<"mlkem_bulk: cannot truncate "<<o.path<<": "<<strerror(errno)<<endl;
+                return false;
+            }
+            records = available;
+        }
+        done = min(done, records);
+    }
+    if (job.cfg.resume) start = max(start, done);
+    return true;
+}
+
+// Rewrites one status line on a terminal, else prints a line per report.
+static void progress(u64 done, u64 total, double seconds, size_t bytes_per_record) {
+    static bool tty = isatty(2);
+    double rate = seconds > 0 ? done / seconds : 0;
+    fprintf(stderr, "%s%llu/%llu records  %.0f records/s  %.1f MiB/s%s", tty ? "\r" : "",
+            (unsigned long long)done, (unsigned long long)total, rate,
+            rate * bytes_per_record / (1024.0 * 1024.0), tty ? "" : "\n");
+}
+
+int main(int argc, char **argv) {
+    BulkConfig cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (!mlkem_selftest()) {
+        cerr<<"mlkem_bulk: self-test failed"<<endl;
+        return 1;
+    }
+
+    BulkJob job(cfg);
+    size_t in_bytes = 0;
+    u64 available = 0;
+    switch (cfg.mode) {
+    case BULK_KEYGEN:
+        job.outputs = {{cfg.ek_path, MLKEM_EK_BYTES}, {cfg.dk_path, MLKEM_DK_BYTES}};
+        available = cfg.offset + cfg.count;
+        break;
+    case BULK_ENCAPS:
+        if (!job.in.open(cfg.in_path, MLKEM_EK_BYTES)) return 1;
+        job.outputs = {{cfg.ct_path, id_bytes + MLKEM_CT_BYTES}, {cfg.ss_path, MLKEM_SS_BYTES}};
+        in_bytes = MLKEM_EK_BYTES;
+        available = job.in.records;
+        break;
+    case BULK_DECAPS:
+        if (!job.keys.open(cfg.keys_path, MLKEM_DK_BYTES)) return 1;
+        if (!job.in.open(cfg.in_path, id_bytes + MLKEM_CT_BYTES)) return 1;
+        job.outputs = {{cfg.ss_path, MLKEM_SS_BYTES}};
+        in_bytes = id_bytes + MLKEM_CT_BYTES;
+        available = job.in.records;
+        break;
+    }
+    size_t out_bytes = 0;
+    for (const BulkOutput &o : job.outputs) out_bytes += o.record_bytes;
+
+    // [start, end) in records; --resume may move start forward
+    u64 start = cfg.offset;
+    u64 end = cfg.count ? min(available, cfg.offset + cfg.count) : available;
+    if (cfg.offset > available) {
+        cerr<<"mlkem_bulk: --offset "<<cfg.offset<<" is past the "<<available<<" input records"<<endl;
+        return 1;
+    }
+    if (!open_outputs(job, available, start)) return 1;
+    start = min(start, end);
+
+    Executor ex(cfg.threads);
+    job.key_slots.resize(ex.size());
+    size_t window = cfg.window ? cfg.window : max<size_t>(1, (32u << 20) / (in_bytes + out_bytes));
+    window = (size_t)min<u64>(window, max<u64>(end - start, 1));
+    size_t chunk = cfg.chunk ? cfg.chunk : executor_chunk_size(window, in_bytes + out_bytes, ex.size());
+    for (BulkOutput &o : job.outputs) {
+        o.buf[0].resize(window * o.record_bytes);
+        o.buf[1].resize(window * o.record_bytes);
+    }
+
+    if (!cfg.quiet)
+        fprintf(stderr, "mlkem_bulk: k = %d, backend %s, %u threads, records %llu..%llu, %zu per write, %zu per task\n",
+                Kyber_k, mlkem_dispatch().name, ex.size(), (unsigned long long)start,
+                (unsigned long long)end, window, chunk);
+
+    // window n is computed into buffer slot n & 1 while the writer thread
+    // stores window n - 1 from the other slot
+    thread writer;
+    atomic<bool> write_ok(true);
+    Clock::time_point t0 = Clock::now(), last_report = t0;
+    bool reported = false;
+    int slot = 0;
+    for (u64 first = start; first < end; first += window, slot ^= 1) {
+        size_t n = (size_t)min<u64>(window, end - first);
+        ex.parallel_for(n, chunk, [&](ExecutorWorker &w, size_t b, size_t e){
+            switch (cfg.mode) {
+            case BULK_KEYGEN: job.keygen(w, first, b, e, slot); break;
+            case BULK_ENCAPS: job.encaps(w, first, b, e, slot); break;
+            case BULK_DECAPS: job.decaps(w, first, b, e, slot); break;
+            }
+        });
+        if (writer.joinable()) writer.join();
+        if (!write_ok) break;
+        writer = thread([&job, &write_ok, first, n, slot]{
+            for (BulkOutput &o : job.outputs)
+                if (!write_all(o, o.buf[slot].data(), n * o.record_bytes, first * o.record_bytes)) {
+                    write_ok = false;
+                    return;
+                }
+        });
+
+        Clock::time_point now = Clock::now();
+        if (!cfg.quiet && now - last_report >= chrono::seconds(1)) {
+            last_report = now;
+            reported = true;
+            progress(first + n - start, end - start, chrono::duration<double>(now - t0).count(),
+                     in_bytes + out_bytes);
+        }
+    }
+    if (writer.joinable()) writer.join();
+    for (BulkOutput &o : job.outputs) {
+        ::close(o.fd);
+        for (vector<ui8> &buf : o.buf) mlkem_wipe(buf.data(), buf.size());
+    }
+    if (!write_ok) return 1;
+
+    double seconds = chrono::duration<double>(Clock::now() - t0).count();
+    if (reported && isatty(2)) fprintf(stderr, "\n");
+    u64 failed = job.failures;
+    printf("%llu records in %.3f s: %.0f records/s, %.1f MiB/s read, %.1f MiB/s written, %llu failed\n",
+           (unsigned long long)(end - start), seconds, seconds > 0 ? (end - start) / seconds : 0,
+           seconds > 0 ? (end - start) * in_bytes / seconds / (1024.0 * 1024.0) : 0,
+           seconds > 0 ? (end - start) * out_bytes / seconds / (1024.0 * 1024.0) : 0,
+           (unsigned long long)failed);
+    return failed ? 3 : 0;
+}
@@ -0,0 +1,488 @@
+// mlkem_dudect: statistical constant-time test in the style of dudect
+// (Reparaz, Balasch, Verbauwhede, "Dude, is my code constant time?").
+//
+// For every target (a backend kernel or a full decryption/decapsulation
+// call) inputs of two classes are interleaved at random: class 0 is one
+// fixed input, class 1 fresh random inputs. Each call is timed with the
+// cycle counter, and Welch's t-test between the two classes is updated
+// online, on all samples and on samples below a set of percentiles (the
+// upper tail is mostly interrupts and migrations). The largest |t| is the
+// leakage figure: below 4.5 no timing difference was found at this
+// sample count, above it the timing depends on the secret input.
+//
+// Every kernel taking secret data is covered; rej_uniform is not, it
+// samples the public matrix A and is variable-time by design. The
+// calibration target is an early-exit compare: if the harness cannot see
+// that leak, the machine is too noisy for the other results to mean much.
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <tuple>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "ml-kem/ML-KEM.hpp"
+#include "ml-kem/context.hpp"
+#include "ml-kem/decaps_many.hpp"
+#include "ml-kem/noheap.hpp"
+#include "ml-kem/dispatch.hpp"
+#include "ml-kem/selftest.hpp"
+
+using namespace std;
+
+// Percentile crops plus the uncropped test.
+#define DUDECT_CROPS 16
+#define DUDECT_TESTS (DUDECT_CROPS + 1)
+
+// Fewer samples than this per class and a test is not reported.
+static const double min_class_samples = 1000;
+
+static const size_t batch_size = 1024;
+
+static inline u64 cycles() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    _mm_lfence();
+    u64 t = __rdtsc();
+    _mm_lfence();
+    return t;
+#elif defined(__aarch64__)
+    u64 t;
+    asm volatile("isb; mrs %0, cntvct_el0" : "=r"(t) :: "memory");
+    return t;
+#else
+    return (u64)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Welch's t-test on two classes, updated one sample at a time.
+struct TTest{
+    double n[2] = {0, 0}, mean[2] = {0, 0}, m2[2] = {0, 0};
+
+    void push(int cls, double x) {
+        n[cls] += 1;
+        double d = x - mean[cls];
+        mean[cls] += d / n[cls];
+        m2[cls] += d * (x - mean[cls]);
+    }
+
+    double t() const {
+        double v0 = m2[0] / (n[0] - 1), v1 = m2[1] / (n[1] - 1);
+        return (mean[0] - mean[1]) / sqrt(v0 / n[0] + v1 / n[1]);
+    }
+
+    bool enough() const { return n[0] >= min_class_samples && n[1] >= min_class_samples; }
+};
+
+// One key pair and one valid ciphertext, shared by the targets.
+struct Fixture{
+    vector<ui8> ek, dk, ct;
+    mlkem_expanded_dk expanded;
+    i16 s_hat[Kyber_N];
+};
+
+static Fixture fx;
+
+struct Target{
+    const char *name;
+    size_t input_bytes;
+    void (*make)(ui8 *in, int cls, MLKEM_Drbg &rng);   // one input of a class
+    void (*run)(const ui8 *in);                         // the timed call
+    bool per_backend;
+};
+
+// Class 0 is all zero, class 1 uniform coefficients in [0, bound).
+static void make_poly(ui8 *in, int cls, MLKEM_Drbg &rng, int bound) {
+    i16 *p = (i16 *)in;
+    if (cls == 0) {
+        memset(p, 0, Kyber_N * sizeof(i16));
+        return;
+    }
+    uint16_t r[Kyber_N];
+    rng.generate((ui8 *)r, sizeof(r));
+    for (int i = 0; i < Kyber_N; i++) p[i] = (i16)(r[i] % bound);
+}
+
+static void make_bytes(ui8 *in, int cls, MLKEM_Drbg &rng, size_t n) {
+    if (cls == 0) memset(in, 0, n);
+    else rng.generate(in, n);
+}
+
+// Class 0 is the fixture's valid ciphertext, class 1 random bytes, which
+// decapsulate by implicit rejection.
+static void make_ct(ui8 *in, int cls, MLKEM_Drbg &rng) {
+    if (cls == 0) memcpy(in, fx.ct.data(), MLKEM_CT_BYTES);
+    else rng.generate(in, MLKEM_CT_BYTES);
+}
+
+static void make_q(ui8 *in, int cls, MLKEM_Drbg &rng) { make_poly(in, cls, rng, Kyber_Q); }
+static void make_eta1(ui8 *in, int cls, MLKEM_Drbg &rng) { make_bytes(in, cls, rng, 64 * eta1); }
+static void make_eta2(ui8 *in, int cls, MLKEM_Drbg &rng) { make_bytes(in, cls, rng, 64 * eta2); }
+static void make_enc1(ui8 *in, int cls, MLKEM_Drbg &rng) { make_poly(in, cls, rng, 2); }
+static void make_encu(ui8 *in, int cls, MLKEM_Drbg &rng) { make_poly(in, cls, rng, 1 << du); }
+static void make_encv(ui8 *in, int cls, MLKEM_Drbg &rng) { make_poly(in, cls, rng, 1 << dv); }
+static void make_dec12(ui8 *in, int cls, MLKEM_Drbg &rng) { make_bytes(in, cls, rng, 384); }
+static void make_decu(ui8 *in, int cls, MLKEM_Drbg &rng) { make_bytes(in, cls, rng, 32 * du); }
+
+// Class 1 covers (-q, q), the range Compress accepts.
+static void make_centred(ui8 *in, int cls, MLKEM_Drbg &rng) {
+    make_poly(in, cls, rng, 2 * Kyber_Q - 1);
+    i16 *p = (i16 *)in;
+    if (cls == 1)
+        for (int i = 0; i < Kyber_N; i++) p[i] -= Kyber_Q - 1;
+}
+
+// invntt_add_compress takes the polynomial and the added error.
+static void make_q2(ui8 *in, int cls, MLKEM_Drbg &rng) {
+    make_poly(in, cls, rng, Kyber_Q);
+    make_poly(in + Kyber_N * sizeof(i16), cls, rng, Kyber_Q);
+}
+
+// The kernels work in place, so the timed calls run on copies.
+static void run_ntt(const ui8 *in) {
+    i16 r[Kyber_N];
+    memcpy(r, in, sizeof(r));
+    mlkem_dispatch().ntt(r);
+}
+
+static void run_invntt(const ui8 *in) {
+    i16 r[Kyber_N];
+    memcpy(r, in, sizeof(r));
+    mlkem_dispatch().invntt(r);
+}
+
+static void run_basemul(const ui8 *in) {
+    i16 r[Kyber_N];
+    mlkem_dispatch().basemul(r, (const i16 *)in, fx.s_hat);
+}
+
+static void run_poly_reduce(const ui8 *in) {
+    i16 r[Kyber_N];
+    memcpy(r, in, sizeof(r));
+    mlkem_dispatch().poly_reduce(r);
+}
+
+static void run_poly_tomont(const ui8 *in) {
+    i16 r[Kyber_N];
+    memcpy(r, in, sizeof(r));
+    mlkem_dispatch().poly_tomont(r);
+}
+
+static void run_cbd_eta1(const ui8 *in) {
+    i16 r[Kyber_N];
+    mlkem_dispatch().cbd(r, in, eta1);
+}
+
+static void run_cbd_eta2(const ui8 *in) {
+    i16 r[Kyber_N];
+    mlkem_dispatch().cbd(r, in, eta2);
+}
+
+static void run_encode1(const ui8 *in) {
+    ui8 r[32];
+    mlkem_dispatch().byte_encode(r, (const i16 *)in, 1);
+}
+
+static void run_encodeu(const ui8 *in) {
+    ui8 r[32 * du];
+    mlkem_dispatch().byte_encode(r, (const i16 *)in, du);
+}
+
+static void run_encodev(const ui8 *in) {
+    ui8 r[32 * dv];
+    mlkem_dispatch().byte_encode(r, (const i16 *)in, dv);
+}
+
+static void run_encode12(const ui8 *in) {
+    ui8 r[384];
+    mlkem_dispatch().byte_encode(r, (const i16 *)in, 12);
+}
+
+static void run_decode12(const ui8 *in) {
+    i16 r[Kyber_N];
+    mlkem_dispatch().byte_decode(r, in, 12);
+}
+
+static void run_decompress_ntt(const ui8 *in) {
+    i16 r[Kyber_N];
+    mlkem_dispatch().decompress_ntt(r, in, du);
+}
+
+static void run_invntt_add_compress(const ui8 *in) {
+    i16 a[Kyber_N];
+    ui8 r[32];
+    memcpy(a, in, sizeof(a));
+    mlkem_dispatch().invntt_add_compress(r, a, (const i16 *)in + Kyber_N, 1, 1);
+}
+
+static void run_compress(const ui8 *in) {
+    vector<i16> a((const i16 *)in, (const i16 *)in + Kyber_N);
+    Compress(a, 1);
+}
+
+static void run_k_pke_decrypt(const ui8 *in) {
+    vector<ui8> c(in, in + MLKEM_CT_BYTES);
+    K_PKE_Decrypt(fx.dk, c);
+}
+
+static void run_decaps(const ui8 *in) {
+    vector<ui8> c(in, in + MLKEM_CT_BYTES);
+    ML_KEM_Decaps_internal(fx.dk, c);
+}
+
+static void run_decaps_many(const ui8 *in) {
+    vector<vector<ui8>> c(1, vector<ui8>(in, in + MLKEM_CT_BYTES));
+    ML_KEM_decaps_many(fx.expanded, c);
+}
+
+static void run_decaps_noheap(const ui8 *in) {
+    ui8 K[32];
+    ML_KEM_Decaps_noheap(K, in, fx.dk.data());
+}
+
+// the calibration target's result, stored so its loop is not dead code
+static volatile bool early_exit_equal;
+
+static void run_early_exit(const ui8 *in) {
+    bool equal = true;
+    for (size_t i = 0; i < MLKEM_CT_BYTES; i++) {
+        if (in[i] != fx.ct[i]) {
+            equal = false;
+            break;
+        }
+    }
+    early_exit_equal = equal;
+}
+
+static const size_t poly_bytes = Kyber_N * sizeof(i16);
+
+static const Target targets[] = {
+    {"calibration_early_exit", MLKEM_CT_BYTES, make_ct, run_early_exit, false},
+    {"ntt", poly_bytes, make_q, run_ntt, true},
+    {"invntt", poly_bytes, make_q, run_invntt, true},
+    {"basemul", poly_bytes, make_q, run_basemul, true},
+    {"poly_reduce", poly_bytes, make_centred, run_poly_reduce, true},
+    {"poly_tomont", poly_bytes, make_centred, run_poly_tomont, true},
+    {"cbd_eta1", 64 * eta1, make_eta1, run_cbd_eta1, true},
+    {"cbd_eta2", 64 * eta2, make_eta2, run_cbd_eta2, true},
+    {"byte_encode_1", poly_bytes, make_enc1, run_encode1, true},
+    {"byte_encode_du", poly_bytes, make_encu, run_encodeu, true},
+    {"byte_encode_dv", poly_bytes, make_encv, run_encodev, true},
+    {"byte_encode_12", poly_bytes, make_q, run_encode12, true},
+    {"byte_decode_12", 384, make_dec12, run_decode12, true},
+    {"decompress_ntt_du", 32 * du, make_decu, run_decompress_ntt, true},
+    {"invntt_add_compress_1", 2 * poly_bytes, make_q2, run_invntt_add_compress, true},
+    {"Compress_1", poly_bytes, make_centred, run_compress, true},
+    {"K_PKE_Decrypt", MLKEM_CT_BYTES, make_ct, run_k_pke_decrypt, true},
+    {"ML_KEM_Decaps_internal", MLKEM_CT_BYTES, make_ct, run_decaps, true},
+    {"ML_KEM_decaps_many", MLKEM_CT_BYTES, make_ct, run_decaps_many, true},
+    {"ML_KEM_Decaps_noheap", MLKEM_CT_BYTES, make_ct, run_decaps_noheap, true},
+};
+
+struct DudectConfig{
+    u64 samples = 1000000;
+    vector<string> only;
+    vector<string> backends;
+    double fail_above = 0;              // 0 = report only
+};
+
+static void usage(const char *prog) {
+    cerr << "usage: " << prog << " [options]\n"
+         << "  --samples N      timed calls per target and backend (default 1M; k, M suffixes)\n"
+         << "  --only LIST      comma separated targets (see --list)\n"
+         << "  --backend LIST   comma separated backends (default: all usable ones)\n"
+         << "  --fail-above T   exit 1 if a target's |t| exceeds T (4.5 is the usual bound)\n"
+         << "  --list           print the targets\n"
+         << "this build implements ML-KEM-" << 256 * Kyber_k << "\n";
+}
+
+static vector<string> split_list(const string &s) {
+    vector<string> out;
+    stringstream ss(s);
+    string item;
+    while (getline(ss, item, ','))
+        if (!item.empty()) out.push_back(item);
+    return out;
+}
+
+static u64 parse_count(const char *s) {
+    char *end;
+    double v = strtod(s, &end);
+    if (*end == 'k' || *end == 'K') v *= 1e3;
+    else if (*end == 'M') v *= 1e6;
+    return v > 0 ? (u64)v : 0;
+}
+
+static bool parse_args(int argc, char **argv, DudectConfig &cfg) {
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        bool has_value = i + 1 < argc;
+        if (a == "--samples" && has_value) cfg.samples = parse_count(argv[++i]);
+        else if (a == "--only" && has_value) cfg.only = split_list(argv[++i]);
+        else if (a == "--backend" && has_value) cfg.backends = split_list(argv[++i]);
+        else if (a == "--fail-above" && has_value) cfg.fail_above = atof(argv[++i]);
+        else if (a == "--list") {
+            for (const Target &t : targets) cout << t.name << "\n";
+            exit(0);
+        }
+        else {
+            cerr<<"mlkem_dudect: bad argument "<<a<<endl;
+            return false;
+        }
+    }
+    for (const string &name : cfg.only) {
+        bool known = false;
+        for (const Target &t : targets) known = known || name == t.name;
+        if (!known) {
+            cerr<<"mlkem_dudect: unknown target "<<name<<endl;
+            return false;
+        }
+    }
+    if (cfg.samples < 2 * batch_size) {
+        cerr<<"mlkem_dudect: --samples must be at least "<<2 * batch_size<<endl;
+        return false;
+    }
+    return true;
+}
+
+struct TargetResult{
+    u64 samples;
+    double mean[2];
+    double max_t;
+};
+
+/*************************************************
+* Name:        measure
+*
+* Description: Times cfg.samples calls of one target on the active
+*              backend. Each batch first prepares its inputs and a random
+*              class per call, then times the calls back to back. The
+*              first batch warms up caches and predictors and sets the
+*              crop thresholds; it is not counted.
+*
+* Returns:     - TargetResult: sample count, mean cycles per class and the
+*                largest |t| over the tests with enough samples
+**************************************************/
+static TargetResult measure(const Target &target, u64 samples, MLKEM_Drbg &rng) {
+    vector<ui8> inputs(batch_size * target.input_bytes), cls(batch_size);
+    vector<u64> t(batch_size);
+    double crop[DUDECT_CROPS] = {0};
+    TTest tests[DUDECT_TESTS];
+    u64 counted = 0;
+
+    for (u64 done = 0; done < samples; done += batch_size) {
+        rng.generate(cls.data(), batch_size);
+        for (size_t i = 0; i < batch_size; i++) {
+            cls[i] &= 1;
+            target.make(inputs.data() + i * target.input_bytes, cls[i], rng);
+        }
+        for (size_t i = 0; i < batch_size; i++) {
+            u64 t0 = cycles();
+            target.run(inputs.data() + i * target.input_bytes);
+            t[i] = cycles() - t0;
+        }
+
+        if (done == 0) {
+            // dudect's crops: percentile 1 - 0.5^(10 (j + 1) / CROPS)
+            vector<u64> sorted(t);
+            sort(sorted.begin(), sorted.end());
+            for (int j = 0; j < DUDECT_CROPS; j++) {
+                double p = 1 - pow(0.5, 10.0 * (j + 1) / DUDECT_CROPS);
+                crop[j] = (double)sorted[(size_t)(p * (batch_size - 1))];
+            }
+            continue;
+        }
+        for (size_t i = 0; i < batch_size; i++) {
+            double x = (double)t[i];
+            tests[0].push(cls[i], x);
+            for (int j = 0; j < DUDECT_CROPS; j++)
+                if (x < crop[j]) tests[j + 1].push(cls[i], x);
+        }
+        counted += batch_size;
+    }
+
+    TargetResult r = {counted, {tests[0].mean[0], tests[0].mean[1]}, 0};
+    for (const TTest &test : tests)
+        if (test.enough()) r.max_t = max(r.max_t, fabs(test.t()));
+    return r;
+}
+
+// A fixed key pair and a valid ciphertext for it.
+static bool make_fixture() {
+    vector<ui8> d(32, 0x5a), z(32, 0xa5), m(32, 0x3c);
+    tie(fx.ek, fx.dk) = ML_KEM_KeyGen_internal(d, z);
+    fx.ct = ML_KEM_Encaps_internal(fx.ek, m).second;
+    if (!ML_KEM_expand_decaps_key(fx.expanded, fx.dk)) return false;
+    memcpy(fx.s_hat, fx.expanded.s_hat[0], sizeof(fx.s_hat));
+    return fx.ct.size() == MLKEM_CT_BYTES;
+}
+
+static bool selected(const DudectConfig &cfg, const Target &t) {
+    return cfg.only.empty() || find(cfg.only.begin(), cfg.only.end(), t.name) != cfg.only.end();
+}
+
+static void report(const char *backend, const Target &t, const TargetResult &r, double bound) {
+    printf("%-9s %-24s %10llu %12.1f %12.1f %9.2f  %s\n", backend, t.name, (unsigned long long)r.samples,
+           r.mean[0], r.mean[1], r.max_t, r.max_t > bound ? "LEAK" : "ok");
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    DudectConfig cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (!mlkem_selftest()) {
+        cerr<<"mlkem_dudect: self-test failed"<<endl;
+        return 1;
+    }
+    if (!make_fixture()) {
+        cerr<<"mlkem_dudect: could not set up the test key"<<endl;
+        return 1;
+    }
+    vector<string> backends = cfg.backends;
+    if (backends.empty())
+        for (const mlkem_backend *b : mlkem_available_backends()) backends.push_back(b->name);
+
+    double bound = cfg.fail_above > 0 ? cfg.fail_above : 4.5;
+    MLKEM_Drbg rng;
+    rng.seed();
+    bool leak = false, calibrated = true;
+    printf("ML-KEM-%d, %llu samples per target, |t| > %.1f reported as a leak\n", 256 * Kyber_k,
+           (unsigned long long)cfg.samples, bound);
+    printf("%-9s %-24s %10s %12s %12s %9s\n", "backend", "target", "samples", "fixed cyc", "random cyc", "max |t|");
+
+    for (const Target &t : targets) {
+        if (t.per_backend || !selected(cfg, t)) continue;
+        TargetResult r = measure(t, cfg.samples, rng);
+        report("-", t, r, bound);
+        calibrated = r.max_t > bound;
+    }
+    for (const string &name : backends) {
+        if (!mlkem_select_backend(name.c_str())) {
+            cerr<<"mlkem_dudect: backend "<<name<<" is not available here"<<endl;
+            return 2;
+        }
+        for (const Target &t : targets) {
+            if (!t.per_backend || !selected(cfg, t)) continue;
+            TargetResult r = measure(t, cfg.samples, rng);
+            report(name.c_str(), t, r, bound);
+            leak = leak || r.max_t > bound;
+        }
+    }
+
+    if (!calibrated) {
+        cerr<<"mlkem_dudect: the calibration leak was not detected; the timer or the machine is too noisy"<<endl;
+        if (cfg.fail_above > 0) return 3;
+    }
+    return cfg.fail_above > 0 && leak ? 1 : 0;
+}
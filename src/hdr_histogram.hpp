@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+// Log-linear latency histogram in the style of HdrHistogram: every power of
+// two is split into 2^(sub_bits-1) linear buckets, so any recorded value is
+// reproduced within 1/2^(sub_bits-1) relative error (0.8% with sub_bits 8)
+// while covering the whole 64-bit range in a few KiB. Histograms with the
+// same sub_bits merge by adding counts, so each thread records into its own
+// and they are combined once at the end.
+class HdrHistogram{
+public:
+    explicit HdrHistogram(int sub_bits = 8)
+        : sub_bits(sub_bits), half(uint64_t(1) << (sub_bits - 1)),
+          counts((66 - sub_bits) * half, 0), total(0), min_v(UINT64_MAX), max_v(0), sum(0) {}
+
+    void record(uint64_t v, uint64_t n = 1) {
+        counts[index_of(v)] += n;
+        total += n;
+        sum += double(v) * n;
+        if (v < min_v) min_v = v;
+        if (v > max_v) max_v = v;
+    }
+
+    void merge(const HdrHistogram &o) {
+        for (size_t i = 0; i < counts.size() && i < o.counts.size(); i++) counts[i] += o.counts[i];
+        total += o.total;
+        sum += o.sum;
+        if (o.min_v < min_v) min_v = o.min_v;
+        if (o.max_v > max_v) max_v = o.max_v;
+    }
+
+    void reset() {
+        for (uint64_t &c : counts) c = 0;
+        total = 0; sum = 0; min_v = UINT64_MAX; max_v = 0;
+    }
+
+    // Smallest recorded value v such that at least p percent of the samples
+    // are <= v, reported as the upper edge of its bucket (clamped to max).
+    uint64_t percentile(double p) const {
+        if (total == 0) return 0;
+        uint64_t rank = (uint64_t)ceil(p / 100.0 * total);
+        if (rank < 1) rank = 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                uint64_t v = highest_in(i);
+                return v < max_v ? v : max_v;
+            }
+        }
+        return max_v;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total ? min_v : 0; }
+    uint64_t max() const { return max_v; }
+    double mean() const { return total ? sum / total : 0; }
+
+private:
+    size_t index_of(uint64_t v) const {
+        if (v < 2 * half) return (size_t)v;
+        int shift = 63 - __builtin_clzll(v) - (sub_bits - 1);
+        return (size_t)((shift + 1) * half + ((v >> shift) - half));
+    }
+
+    uint64_t highest_in(size_t i) const {
+        if (i < 2 * half) return i;
+        int shift = (int)(i / half) - 1;
+        uint64_t sub = i % half + half;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    int sub_bits;
+    uint64_t half;
+    std::vector<uint64_t> counts;
+    uint64_t total, min_v, max_v;
+    double sum;
+};
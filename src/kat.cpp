@@ -0,0 +1,466 @@
+// mlkem_kat: known-answer test generator and verifier.
+//
+// Reads NIST-style request/response files: records of "name = hex" lines,
+// each starting at "count = N", optionally grouped into sections headed
+// "[ML-KEM-768]" or "# ML-KEM-768". The inputs of a record are d and z
+// (KeyGen) and msg (Encaps); the outputs are pk, sk, ct and ss, plus an
+// optional invalid ciphertext ct_n with its implicit-rejection secret
+// ss_n. The file is parsed as a stream, a batch of records at a time, and
+// each batch is spread across the executor.
+//
+//   verify FILE     recompute every output present and compare; encaps
+//                   starts from the file's pk and decaps from its sk, so
+//                   each field is checked on its own
+//   generate FILE   fill in the outputs of a request file
+//   generate --count N
+//                   make N vectors from a fixed-seed DRBG
+//
+// The parameter set is fixed at build time (MLKEM_K): sections for the
+// other sets are skipped and counted, so one file can hold all three and
+// each build checks its own.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "ml-kem/ML-KEM.hpp"
+#include "ml-kem/context.hpp"
+#include "ml-kem/executor.hpp"
+#include "ml-kem/dispatch.hpp"
+#include "ml-kem/selftest.hpp"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static const size_t batch_records = 256;
+
+static const char *output_fields[] = {"pk", "sk", "ct", "ss", "ss_n"};
+
+struct KatRecord{
+    u64 count;
+    size_t line;
+    vector<pair<string, vector<ui8>>> fields;
+    vector<string> mismatches;
+
+    vector<ui8> *get(const string &name) {
+        for (auto &f : fields)
+            if (f.first == name) return &f.second;
+        return nullptr;
+    }
+
+    void set(const string &name, vector<ui8> value) {
+        vector<ui8> *f = get(name);
+        if (f) *f = move(value);
+        else fields.push_back({name, move(value)});
+    }
+};
+
+struct KatConfig{
+    bool generate = false;
+    const char *in_path = nullptr;
+    const char *out_path = nullptr;
+    u64 random_count = 0;
+    vector<string> backends;            // empty = the dispatcher's choice
+    unsigned threads = 0;
+    vector<string> checks = {"pk", "sk", "ct", "ss", "ss_n"};
+    int max_report = 10;
+};
+
+static void usage(const char *prog) {
+    cerr << "usage: " << prog << " verify FILE.rsp [options]\n"
+         << "       " << prog << " generate FILE.req|--count N [-o FILE.rsp] [options]\n"
+         << "  --backend LIST   comma separated backends, or 'all' usable ones (default: dispatcher's)\n"
+         << "  --check LIST     fields to verify (default pk,sk,ct,ss,ss_n)\n"
+         << "  --threads N      worker threads (default: hardware concurrency)\n"
+         << "  -o FILE          generate output (default: stdout)\n"
+         << "this build implements ML-KEM-" << 256 * Kyber_k << "\n";
+}
+
+static vector<string> split_list(const string &s) {
+    vector<string> out;
+    stringstream ss(s);
+    string item;
+    while (getline(ss, item, ','))
+        if (!item.empty()) out.push_back(item);
+    return out;
+}
+
+static bool parse_args(int argc, char **argv, KatConfig &cfg) {
+    if (argc < 2) return false;
+    string mode = argv[1];
+    if (mode == "generate") cfg.generate = true;
+    else if (mode != "verify") return false;
+
+    for (int i = 2; i < argc; i++) {
+        string a = argv[i];
+        bool has_value = i + 1 < argc;
+        if (a == "--backend" && has_value) {
+            string v = argv[++i];
+            if (v == "all") {
+                for (const mlkem_backend *b : mlkem_available_backends()) cfg.backends.push_back(b->name);
+            } else {
+                cfg.backends = split_list(v);
+            }
+        }
+        else if (a == "--check" && has_value) cfg.checks = split_list(argv[++i]);
+        else if (a == "--threads" && has_value) cfg.threads = (unsigned)atoi(argv[++i]);
+        else if (a == "--count" && has_value) cfg.random_count = strtoull(argv[++i], nullptr, 10);
+        else if (a == "-o" && has_value) cfg.out_path = argv[++i];
+        else if (a[0] != '-' && !cfg.in_path) cfg.in_path = argv[i];
+        else {
+            cerr<<"mlkem_kat: bad argument "<<a<<endl;
+            return false;
+        }
+    }
+    if (cfg.generate ? (!cfg.in_path == !cfg.random_count) : !cfg.in_path) {
+        cerr<<"mlkem_kat: "<<(cfg.generate ? "generate needs a request file or --count" : "verify needs a file")<<endl;
+        return false;
+    }
+    for (const string &c : cfg.checks) {
+        if (find(begin(output_fields), end(output_fields), c) == end(output_fields)) {
+            cerr<<"mlkem_kat: unknown field "<<c<<" in --check"<<endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool from_hex(const string &s, vector<ui8> &out) {
+    if (s.size() % 2) return false;
+    out.resize(s.size() / 2);
+    for (size_t i = 0; i < s.size(); i += 2) {
+        int v = 0;
+        for (int j = 0; j < 2; j++) {
+            char c = s[i + j];
+            int d = c >= '0' && c <= '9' ? c - '0'
+                  : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                  : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+            if (d < 0) return false;
+            v = v * 16 + d;
+        }
+        out[i / 2] = (ui8)v;
+    }
+    return true;
+}
+
+static string to_hex(const vector<ui8> &v) {
+    static const char digits[] = "0123456789ABCDEF";
+    string s(2 * v.size(), '0');
+    for (size_t i = 0; i < v.size(); i++) {
+        s[2 * i] = digits[v[i] >> 4];
+        s[2 * i + 1] = digits[v[i] & 15];
+    }
+    return s;
+}
+
+static string trim(const string &s) {
+    size_t b = s.find_first_not_of(" \t\r");
+    if (b == string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+}
+
+// Parameter set named in a section header or comment ("ML-KEM-768"),
+// 0 if the line names none.
+static int section_param(const string &line) {
+    size_t p = line.find("ML-KEM-");
+    if (p == string::npos) return 0;
+    return atoi(line.c_str() + p + 7);
+}
+
+// Pulls whole records from a stream one batch at a time; a record is
+// complete when the next count line or the end of input is read. Records
+// in sections for another parameter set are skipped.
+class KatReader{
+public:
+    explicit KatReader(istream &in) : in(in) {}
+
+    // Appends up to max records; false on a syntax error.
+    bool next_batch(vector<KatRecord> &batch, size_t max) {
+        string raw;
+        while (batch.size() < max) {
+            if (!getline(in, raw)) {
+                if (has_pending) batch.push_back(move(pending));
+                has_pending = false;
+                break;
+            }
+            line_no++;
+            string line = trim(raw);
+            if (line.empty()) continue;
+            if (line[0] == '[' || line[0] == '#') {
+                int p = section_param(line);
+                if (p) in_section = (p == 256 * Kyber_k);
+                continue;
+            }
+            size_t eq = line.find('=');
+            if (eq == string::npos) {
+                cerr<<"mlkem_kat: line "<<line_no<<": expected name = value"<<endl;
+                return false;
+            }
+            string name = trim(line.substr(0, eq)), value = trim(line.substr(eq + 1));
+            if (name == "count") {
+                if (has_pending) batch.push_back(move(pending));
+                has_pending = in_section;
+                if (in_section) {
+                    pending = KatRecord();
+                    pending.count = strtoull(value.c_str(), nullptr, 10);
+                    pending.line = line_no;
+                } else {
+                    skipped++;
+                }
+                continue;
+            }
+            if (!in_section) continue;
+            if (!has_pending) {
+                cerr<<"mlkem_kat: line "<<line_no<<": "<<name<<" before the first count"<<endl;
+                return false;
+            }
+            vector<ui8> bytes;
+            if (!from_hex(value, bytes)) {
+                cerr<<"mlkem_kat: line "<<line_no<<": "<<name<<" is not hex"<<endl;
+                return false;
+            }
+            pending.set(name, move(bytes));
+        }
+        return true;
+    }
+
+    u64 skipped = 0;
+
+private:
+    istream &in;
+    size_t line_no = 0;
+    bool in_section = true;
+    KatRecord pending;
+    bool has_pending = false;
+};
+
+/*************************************************
+* Name:        run_record
+*
+* Description: Recomputes the outputs of one record through the
+*              derandomized internals. In generate mode they are stored in
+*              the record; in verify mode each output present in the file
+*              is compared, starting encaps from the file's pk and decaps
+*              from its sk. A record with none of the checked fields
+*              fails rather than passing unchecked.
+*
+* Arguments:   - KatRecord &r: record, updated in place
+*              - const KatConfig &cfg: mode and fields to check
+**************************************************/
+static void run_record(KatRecord &r, const KatConfig &cfg) {
+    auto input = [&](const char *name, size_t len) -> vector<ui8> * {
+        vector<ui8> *f = r.get(name);
+        if (f == nullptr && strcmp(name, "msg") == 0) f = r.get("m");
+        if (f == nullptr || f->size() != len) {
+            r.mismatches.push_back(string("missing or malformed ") + name);
+            return nullptr;
+        }
+        return f;
+    };
+    auto checked = [&](const char *name) {
+        return find(cfg.checks.begin(), cfg.checks.end(), name) != cfg.checks.end();
+    };
+    size_t compared = 0;
+    auto result = [&](const char *name, vector<ui8> value) {
+        vector<ui8> *expect = r.get(name);
+        if (cfg.generate) {
+            r.set(name, move(value));
+        } else if (expect && checked(name)) {
+            compared++;
+            if (*expect != value) r.mismatches.push_back(name);
+        }
+    };
+
+    // copies: generate adds fields to the record as it goes
+    vector<ui8> *pd = input("d", 32), *pz = input("z", 32), *pm = input("msg", 32);
+    if (!pd || !pz || !pm) return;
+    vector<ui8> d = *pd, z = *pz, m = *pm;
+    auto field = [&](const char *name, const vector<ui8> &fallback) {
+        vector<ui8> *f = r.get(name);
+        return cfg.generate || f == nullptr ? fallback : *f;
+    };
+
+    auto [pk, sk] = ML_KEM_KeyGen_internal(d, z);
+    vector<ui8> ek = field("pk", pk), dk = field("sk", sk);
+    result("pk", pk);
+    result("sk", sk);
+    if (ek.size() != pk.size() || dk.size() != sk.size()) {
+        r.mismatches.push_back("malformed pk or sk");
+        return;
+    }
+
+    auto [ss, ct] = ML_KEM_Encaps_internal(ek, m);
+    vector<ui8> c = field("ct", ct), expect_ss = field("ss", ss);
+    result("ct", ct);
+    result("ss", ss);
+    if (checked("ss") && (c.size() != ct.size() || ML_KEM_Decaps_internal(dk, c) != expect_ss))
+        r.mismatches.push_back("ss (decaps)");
+
+    vector<ui8> *ct_n = r.get("ct_n");
+    if (ct_n && ct_n->size() == ct.size()) {
+        vector<ui8> c_n = *ct_n;
+        result("ss_n", ML_KEM_Decaps_internal(dk, c_n));
+    }
+    if (!cfg.generate && compared == 0) r.mismatches.push_back("none of the checked fields present");
+}
+
+// Vectors for generate --count: inputs, and an invalid ciphertext for the
+// implicit-rejection check, from a DRBG with a fixed all-zero seed.
+static void random_records(vector<KatRecord> &batch, u64 first, u64 n, MLKEM_Drbg &drbg) {
+    const size_t ct_len = 32 * (Kyber_k * du + dv);
+    for (u64 i = 0; i < n; i++) {
+        KatRecord r;
+        r.count = first + i;
+        r.line = 0;
+        vector<ui8> z(32), d(32), msg(32), ct_n(ct_len);
+        drbg.generate(z.data(), 32);
+        drbg.generate(d.data(), 32);
+        drbg.generate(msg.data(), 32);
+        drbg.generate(ct_n.data(), ct_len);
+        r.set("z", z);
+        r.set("d", d);
+        r.set("msg", msg);
+        r.set("ct_n", ct_n);
+        batch.push_back(move(r));
+    }
+}
+
+static void write_record(ostream &out, KatRecord &r) {
+    static const char *order[] = {"z", "d", "msg", "m", "pk", "sk", "ct", "ss", "ct_n", "ss_n"};
+    out << "count = " << r.count << "\n";
+    for (const char *name : order)
+        if (vector<ui8> *f = r.get(name)) out << name << " = " << to_hex(*f) << "\n";
+    for (auto &f : r.fields)
+        if (find_if(begin(order), end(order), [&](const char *n){ return f.first == n; }) == end(order))
+            out << f.first << " = " << to_hex(f.second) << "\n";
+    out << "\n";
+}
+
+/*************************************************
+* Name:        run_pass
+*
+* Description: Streams the input once on the active backend: a batch of
+*              records is parsed, run across the executor, then reported
+*              (verify) or written (generate) in file order.
+*
+* Arguments:   - const KatConfig &cfg: run configuration
+*              - Executor &ex: worker threads
+*              - ostream *out: generate output, nullptr when verifying
+*
+* Returns:     - int: failed records, or -1 on an input error or when
+*                verify finds no vectors for this parameter set
+**************************************************/
+static int run_pass(const KatConfig &cfg, Executor &ex, ostream *out) {
+    ifstream file;
+    if (cfg.in_path) {
+        file.open(cfg.in_path);
+        if (!file) {
+            cerr<<"mlkem_kat: cannot open "<<cfg.in_path<<endl;
+            return -1;
+        }
+    }
+    KatReader reader(file);
+    ui8 seed[32] = {0};
+    MLKEM_Drbg drbg;
+    drbg.seed(seed);
+
+    Clock::time_point t0 = Clock::now();
+    u64 records = 0, failed = 0;
+    int reported = 0;
+    vector<KatRecord> batch;
+    while (true) {
+        batch.clear();
+        if (cfg.in_path) {
+            if (!reader.next_batch(batch, batch_records)) return -1;
+        } else {
+            random_records(batch, records, min<u64>(batch_records, cfg.random_count - records), drbg);
+        }
+        size_t n = batch.size();
+        if (n == 0) break;
+
+        size_t chunk = max<size_t>(1, n / (4 * ex.size()));
+        ex.parallel_for(n, chunk, [&](ExecutorWorker &, size_t b, size_t e){
+            for (size_t i = b; i < e; i++) run_record(batch[i], cfg);
+        });
+
+        for (size_t i = 0; i < n; i++) {
+            KatRecord &r = batch[i];
+            if (out) write_record(*out, r);
+            if (r.mismatches.empty()) continue;
+            failed++;
+            if (reported++ < cfg.max_report) {
+                cerr<<"  count = "<<r.count;
+                if (r.line) cerr<<" (line "<<r.line<<")";
+                cerr<<": ";
+                for (size_t j = 0; j < r.mismatches.size(); j++) cerr<<(j ? ", " : "")<<r.mismatches[j];
+                cerr<<endl;
+            }
+        }
+        records += n;
+    }
+
+    double seconds = chrono::duration<double>(Clock::now() - t0).count();
+    fprintf(out == &cout ? stderr : stdout, "%-9s ML-KEM-%d: %llu vectors %s, %llu failed, %llu skipped (other parameter sets) in %.3f s\n",
+            mlkem_dispatch().name, 256 * Kyber_k, (unsigned long long)records,
+            cfg.generate ? "generated" : "checked", (unsigned long long)failed,
+            (unsigned long long)reader.skipped, seconds);
+    if (!cfg.generate && records == 0) {
+        cerr<<"mlkem_kat: no ML-KEM-"<<256 * Kyber_k<<" vectors to check"<<endl;
+        return -1;
+    }
+    return (int)min<u64>(failed, 1 << 30);
+}
+
+int main(int argc, char **argv) {
+    KatConfig cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (!mlkem_selftest()) {
+        cerr<<"mlkem_kat: self-test failed"<<endl;
+        return 1;
+    }
+    if (cfg.generate && cfg.backends.size() > 1) {
+        cerr<<"mlkem_kat: generate takes a single backend"<<endl;
+        return 2;
+    }
+
+    Executor ex(cfg.threads);
+    ofstream out_file;
+    ostream *out = nullptr;
+    if (cfg.generate) {
+        if (cfg.out_path) {
+            out_file.open(cfg.out_path);
+            if (!out_file) {
+                cerr<<"mlkem_kat: cannot write "<<cfg.out_path<<endl;
+                return 1;
+            }
+            out = &out_file;
+        } else {
+            out = &cout;
+        }
+        *out << "# ML-KEM-" << 256 * Kyber_k << "\n\n";
+    }
+
+    vector<string> backends = cfg.backends;
+    if (backends.empty()) backends.push_back(mlkem_dispatch().name);
+    bool ok = true;
+    for (const string &name : backends) {
+        if (!mlkem_select_backend(name.c_str())) {
+            cerr<<"mlkem_kat: backend "<<name<<" is not available here"<<endl;
+            ok = false;
+            continue;
+        }
+        int failed = run_pass(cfg, ex, out);
+        if (failed != 0) ok = false;
+    }
+    return ok ? 0 : 1;
+}
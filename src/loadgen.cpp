@@ -0,0 +1,262 @@
+// mlkem_loadgen: end-to-end handshake load generator.
+//
+// A handshake is server keygen (ephemeral mode only), client encapsulation
+// against the server key and server decapsulation of the ciphertext. Each
+// worker thread runs handshakes back to back (closed loop) or at a fixed
+// share of a target arrival rate (open loop). In open loop the latency of a
+// handshake is measured from its scheduled start, so time spent waiting
+// behind a slow predecessor is counted instead of hidden.
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "ml-kem/ML-KEM.hpp"
+#include "ml-kem/dispatch.hpp"
+#include "ml-kem/trace.hpp"
+#include "hdr_histogram.hpp"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+struct LoadConfig{
+    bool ephemeral = true;
+    vector<unsigned> threads;
+    double duration = 5;        // measured seconds per sweep point
+    double warmup = 1;          // unmeasured seconds before each point
+    double rate = 0;            // total handshakes/s, 0 = closed loop
+    bool poisson = false;
+    bool csv = false;
+    const char *trace_path = nullptr;
+};
+
+struct WorkerResult{
+    HdrHistogram handshake, keygen, encaps, decaps;
+    u64 completed = 0;
+    u64 failures = 0;
+    u64 missed = 0;             // open loop arrivals that never started
+};
+
+static void usage(const char *prog) {
+    cerr << "usage: " << prog << " [options]\n"
+         << "  --param 512|768|1024  parameter set; must be the one this build implements\n"
+         << "  --mode ephemeral|static  fresh server key per handshake, or one key for the run\n"
+         << "  --threads LIST        comma separated thread counts to sweep (default 1,2,4,..,ncpu)\n"
+         << "  --duration S          measured seconds per sweep point (default 5)\n"
+         << "  --warmup S            unmeasured seconds before each point (default 1)\n"
+         << "  --rate R              open loop at R handshakes/s in total (default 0 = closed loop)\n"
+         << "  --poisson             open loop with exponential inter-arrival times\n"
+         << "  --csv                 machine readable output\n"
+         << "  --trace FILE          write a Chrome trace of the run (library built with MLKEM_TRACE)\n";
+}
+
+static u64 ns_between(Clock::time_point a, Clock::time_point b) {
+    return (u64)chrono::duration_cast<chrono::nanoseconds>(b - a).count();
+}
+
+/*************************************************
+* Name:        run_worker
+*
+* Description: Runs handshakes on one thread from warm_start until end and
+*              records those completing after measure_start.
+*
+* Arguments:   - const LoadConfig &cfg: run configuration
+*              - unsigned index, nthreads: this worker, threads in this point
+*              - const vector<ui8> &server_ek, &server_dk: static key pair
+*              - Clock::time_point warm_start, measure_start, end: phases
+*              - WorkerResult &res: output histograms and counters
+**************************************************/
+static void run_worker(const LoadConfig &cfg, unsigned index, unsigned nthreads,
+                       const vector<ui8> &server_ek, const vector<ui8> &server_dk,
+                       Clock::time_point warm_start, Clock::time_point measure_start,
+                       Clock::time_point end, WorkerResult &res) {
+    vector<ui8> ek = server_ek, dk = server_dk;
+    string label = "loadgen worker " + to_string(index) + "/" + to_string(nthreads);
+    mlkem_trace_thread_name(label.c_str());
+    bool open_loop = cfg.rate > 0;
+    double mean_gap_ns = open_loop ? 1e9 * nthreads / cfg.rate : 0;
+    mt19937_64 gen(random_device{}());
+    exponential_distribution<double> exp_gap(1.0);
+    auto gap = [&]{
+        double g = cfg.poisson ? mean_gap_ns * exp_gap(gen) : mean_gap_ns;
+        return chrono::nanoseconds((long long)g);
+    };
+
+    Clock::time_point next = warm_start;
+    if (open_loop && cfg.poisson) next += gap();
+    while (true) {
+        Clock::time_point now = Clock::now();
+        if (now >= end) break;
+        Clock::time_point start = now;
+        if (open_loop) {
+            if (next >= end) break;
+            if (now < next) this_thread::sleep_until(next);
+            start = next;
+            next += gap();
+        }
+        Clock::time_point t0 = Clock::now();
+        if (cfg.ephemeral) {
+            auto kp = ML_KEM_KEYGEN();
+            ek.swap(kp.first);
+            dk.swap(kp.second);
+        }
+        Clock::time_point t1 = Clock::now();
+        auto [K, c] = ML_KEM_ENCAPSULATION(ek);
+        Clock::time_point t2 = Clock::now();
+        vector<ui8> K2 = ML_KEM_DECAPSULATION(dk, c);
+        Clock::time_point t3 = Clock::now();
+
+        // a handshake counts when it completes inside the measured window,
+        // so backlog built up during warmup still shows in the latencies
+        if (t3 < measure_start) continue;
+        if (K.empty() || K != K2) res.failures++;
+        res.completed++;
+        res.handshake.record(ns_between(start, t3));
+        if (cfg.ephemeral) res.keygen.record(ns_between(t0, t1));
+        res.encaps.record(ns_between(t1, t2));
+        res.decaps.record(ns_between(t2, t3));
+    }
+
+    // arrivals scheduled inside the measured window that were never served
+    while (open_loop && next < end) {
+        if (next >= measure_start) res.missed++;
+        next += gap();
+    }
+}
+
+static void print_header(const LoadConfig &cfg) {
+    if (cfg.csv) {
+        printf("threads,handshakes,failures,missed,throughput_per_s,p50_us,p90_us,p99_us,p999_us,max_us,"
+               "keygen_p50_us,encaps_p50_us,decaps_p50_us\n");
+        return;
+    }
+    printf("%7s %10s %12s %9s %9s %9s %9s %9s   %s\n", "threads", "handshakes", "hs/s",
+           "p50 us", "p90 us", "p99 us", "p99.9 us", "max us", "p50 keygen/encaps/decaps us");
+}
+
+static void print_point(const LoadConfig &cfg, unsigned nthreads, double seconds, const WorkerResult &r) {
+    const HdrHistogram &h = r.handshake;
+    double tput = r.completed / seconds;
+    auto us = [](u64 ns) { return ns / 1000.0; };
+    if (cfg.csv) {
+        printf("%u,%llu,%llu,%llu,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n", nthreads,
+               (unsigned long long)r.completed, (unsigned long long)r.failures,
+               (unsigned long long)r.missed, tput,
+               us(h.percentile(50)), us(h.percentile(90)), us(h.percentile(99)),
+               us(h.percentile(99.9)), us(h.max()), us(r.keygen.percentile(50)),
+               us(r.encaps.percentile(50)), us(r.decaps.percentile(50)));
+        return;
+    }
+    printf("%7u %10llu %12.1f %9.1f %9.1f %9.1f %9.1f %9.1f   %.1f/%.1f/%.1f\n", nthreads,
+           (unsigned long long)r.completed, tput,
+           us(h.percentile(50)), us(h.percentile(90)), us(h.percentile(99)),
+           us(h.percentile(99.9)), us(h.max()), us(r.keygen.percentile(50)),
+           us(r.encaps.percentile(50)), us(r.decaps.percentile(50)));
+    if (r.failures) printf("        %llu handshakes derived different keys\n", (unsigned long long)r.failures);
+    if (r.missed) printf("        %llu scheduled handshakes not started (offered rate above capacity)\n",
+                         (unsigned long long)r.missed);
+}
+
+static bool parse_threads(const char *arg, vector<unsigned> &out) {
+    string s(arg);
+    size_t pos = 0;
+    out.clear();
+    while (pos <= s.size()) {
+        size_t comma = s.find(',', pos);
+        if (comma == string::npos) comma = s.size();
+        int v = atoi(s.substr(pos, comma - pos).c_str());
+        if (v < 1) return false;
+        out.push_back((unsigned)v);
+        pos = comma + 1;
+    }
+    return !out.empty();
+}
+
+int main(int argc, char **argv) {
+    LoadConfig cfg;
+    int param = 256 * Kyber_k;
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        bool has_value = i + 1 < argc;
+        if (a == "--param" && has_value) param = atoi(argv[++i]);
+        else if (a == "--mode" && has_value) {
+            string m = argv[++i];
+            if (m != "ephemeral" && m != "static") { usage(argv[0]); return 2; }
+            cfg.ephemeral = m == "ephemeral";
+        }
+        else if (a == "--threads" && has_value) {
+            if (!parse_threads(argv[++i], cfg.threads)) { usage(argv[0]); return 2; }
+        }
+        else if (a == "--duration" && has_value) cfg.duration = atof(argv[++i]);
+        else if (a == "--warmup" && has_value) cfg.warmup = atof(argv[++i]);
+        else if (a == "--rate" && has_value) cfg.rate = atof(argv[++i]);
+        else if (a == "--poisson") cfg.poisson = true;
+        else if (a == "--csv") cfg.csv = true;
+        else if (a == "--trace" && has_value) cfg.trace_path = argv[++i];
+        else { usage(argv[0]); return a == "--help" || a == "-h" ? 0 : 2; }
+    }
+    if (param != 256 * Kyber_k) {
+        cerr << "this build implements ML-KEM-" << 256 * Kyber_k << "; reconfigure with -DMLKEM_K="
+             << param / 256 << " for ML-KEM-" << param << endl;
+        return 2;
+    }
+    if (cfg.duration <= 0 || cfg.warmup < 0 || cfg.rate < 0) { usage(argv[0]); return 2; }
+    if (cfg.threads.empty()) {
+        unsigned hw = max(1u, thread::hardware_concurrency());
+        for (unsigned t = 1; t < hw; t *= 2) cfg.threads.push_back(t);
+        cfg.threads.push_back(hw);
+    }
+
+    if (cfg.trace_path && !mlkem_trace_compiled())
+        cerr << "warning: library built without MLKEM_TRACE, the trace will only hold thread names" << endl;
+
+    auto [server_ek, server_dk] = ML_KEM_KEYGEN();
+    if (cfg.trace_path) mlkem_trace_enable(true);
+
+    if (!cfg.csv) {
+        printf("ML-KEM-%d, backend %s, %s keys, ", param, mlkem_dispatch().name,
+               cfg.ephemeral ? "ephemeral" : "static");
+        if (cfg.rate > 0) printf("open loop at %.0f handshakes/s%s", cfg.rate, cfg.poisson ? " (poisson)" : "");
+        else printf("closed loop");
+        printf(", %.1f s per point\n", cfg.duration);
+    }
+    print_header(cfg);
+
+    for (unsigned nthreads : cfg.threads) {
+        vector<WorkerResult> results(nthreads);
+        Clock::time_point warm_start = Clock::now() + chrono::milliseconds(10);
+        Clock::time_point measure_start = warm_start + chrono::nanoseconds((long long)(cfg.warmup * 1e9));
+        Clock::time_point end = measure_start + chrono::nanoseconds((long long)(cfg.duration * 1e9));
+
+        vector<thread> workers;
+        for (unsigned t = 0; t < nthreads; t++)
+            workers.emplace_back(run_worker, cref(cfg), t, nthreads, cref(server_ek), cref(server_dk),
+                                 warm_start, measure_start, end, ref(results[t]));
+        for (thread &th : workers) th.join();
+
+        WorkerResult total;
+        for (const WorkerResult &r : results) {
+            total.handshake.merge(r.handshake);
+            total.keygen.merge(r.keygen);
+            total.encaps.merge(r.encaps);
+            total.decaps.merge(r.decaps);
+            total.completed += r.completed;
+            total.failures += r.failures;
+            total.missed += r.missed;
+        }
+        print_point(cfg, nthreads, cfg.duration, total);
+        fflush(stdout);
+    }
+
+    if (cfg.trace_path) {
+        mlkem_trace_enable(false);
+        if (!mlkem_trace_dump(cfg.trace_path)) return 1;
+    }
+    return 0;
+}
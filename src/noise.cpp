@@ -0,0 +1,384 @@
+// mlkem_noise: Monte Carlo estimate of the K-PKE decryption noise.
+//
+// Runs trials of the noise simulator (noise_sim.hpp) in rounds across the
+// executor until --trials or --duration is reached. After every round the
+// histogram is written to --out (a temporary file renamed over the old
+// one), so a run can be stopped at any time and continued with --resume;
+// trial indices continue where the file ends, and the result is the same
+// as one uninterrupted run. Runs with different seeds, on one machine or
+// many, are combined with --merge.
+//
+// The checkpoint is text: a header naming the parameter set and the run,
+// the counters, then one "noise N COUNT" line per nonzero bin.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "ml-kem/noise_sim.hpp"
+#include "ml-kem/dispatch.hpp"
+#include "ml-kem/selftest.hpp"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+// Smallest |noise| that can flip a bit: Compress_1 rounds w to the wrong
+// bit once it is at least this far from Decompress_1(m).
+static const int fail_threshold = (Kyber_Q + 3) / 4 - 1;
+
+struct NoiseConfig{
+    mlkem_noise_config run = {MLKEM_NOISE_FIPS, false, 1 << 20, 1};
+    u64 trials = 0;                     // 0 = until --duration
+    double duration = 0;
+    u64 round = 1 << 18;
+    unsigned threads = 0;
+    const char *out_path = nullptr;
+    bool resume = false;
+    bool quiet = false;
+    vector<const char *> merge;
+};
+
+// A histogram with the run it came from; seed is empty for merged files.
+struct NoiseFile{
+    mlkem_noise_sampling sampling;
+    bool fast_rng;
+    string seed;
+    u64 trials_per_key;
+    unique_ptr<mlkem_noise_hist> hist;
+
+    NoiseFile() : sampling(MLKEM_NOISE_FIPS), fast_rng(false), trials_per_key(0), hist(new mlkem_noise_hist) {
+        hist->clear();
+    }
+};
+
+static void usage(const char *prog) {
+    cerr << "usage: " << prog << " [--trials N] [--duration S] [options]\n"
+         << "       " << prog << " --merge FILE... [--out FILE]\n"
+         << "  --trials N          trials to run (suffix k, M, G allowed)\n"
+         << "  --duration S        stop after S seconds (at a round boundary)\n"
+         << "  --sampling MODE     fips: e1, e2 from their own PRF outputs (default)\n"
+         << "                      implemented: as this tree's K_PKE_Encrypt samples them\n"
+         << "  --fast-rng          noise bytes from xoshiro256** instead of SHAKE256\n"
+         << "  --seed N            run seed (default 1)\n"
+         << "  --trials-per-key N  trials before the next key pair (default 1M)\n"
+         << "  --round N           trials between checkpoints (default 256k)\n"
+         << "  --threads N         worker threads (default: hardware concurrency)\n"
+         << "  --out FILE          checkpoint and result file\n"
+         << "  --resume            continue the run stored in --out\n"
+         << "  --quiet             no progress lines\n"
+         << "this build implements ML-KEM-" << 256 * Kyber_k << "\n";
+}
+
+static u64 parse_count(const char *s) {
+    char *end;
+    double v = strtod(s, &end);
+    if (*end == 'k' || *end == 'K') v *= 1e3;
+    else if (*end == 'M') v *= 1e6;
+    else if (*end == 'G') v *= 1e9;
+    return v > 0 ? (u64)v : 0;
+}
+
+static bool parse_args(int argc, char **argv, NoiseConfig &cfg) {
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        bool has_value = i + 1 < argc;
+        if (a == "--trials" && has_value) cfg.trials = parse_count(argv[++i]);
+        else if (a == "--duration" && has_value) cfg.duration = atof(argv[++i]);
+        else if (a == "--sampling" && has_value) {
+            string v = argv[++i];
+            if (v == "fips") cfg.run.sampling = MLKEM_NOISE_FIPS;
+            else if (v == "implemented") cfg.run.sampling = MLKEM_NOISE_IMPLEMENTED;
+            else {
+                cerr<<"mlkem_noise: unknown sampling "<<v<<endl;
+                return false;
+            }
+        }
+        else if (a == "--fast-rng") cfg.run.fast_rng = true;
+        else if (a == "--seed" && has_value) cfg.run.seed = strtoull(argv[++i], nullptr, 10);
+        else if (a == "--trials-per-key" && has_value) cfg.run.trials_per_key = parse_count(argv[++i]);
+        else if (a == "--round" && has_value) cfg.round = parse_count(argv[++i]);
+        else if (a == "--threads" && has_value) cfg.threads = (unsigned)atoi(argv[++i]);
+        else if (a == "--out" && has_value) cfg.out_path = argv[++i];
+        else if (a == "--resume") cfg.resume = true;
+        else if (a == "--quiet") cfg.quiet = true;
+        else if (a == "--merge") {
+            while (i + 1 < argc && argv[i + 1][0] != '-') cfg.merge.push_back(argv[++i]);
+        }
+        else {
+            cerr<<"mlkem_noise: bad argument "<<a<<endl;
+            return false;
+        }
+    }
+    if (cfg.merge.empty() && cfg.trials == 0 && cfg.duration <= 0) {
+        cerr<<"mlkem_noise: give --trials, --duration or --merge"<<endl;
+        return false;
+    }
+    if (cfg.resume && !cfg.out_path) {
+        cerr<<"mlkem_noise: --resume needs --out"<<endl;
+        return false;
+    }
+    if (cfg.round == 0 || cfg.run.trials_per_key == 0) {
+        cerr<<"mlkem_noise: --round and --trials-per-key must be positive"<<endl;
+        return false;
+    }
+    return true;
+}
+
+static string param_line() {
+    char line[96];
+    snprintf(line, sizeof(line), "k=%d eta1=%d eta2=%d du=%d dv=%d", Kyber_k, eta1, eta2, du, dv);
+    return line;
+}
+
+/*************************************************
+* Name:        save_file
+*
+* Description: Writes the histogram to path + ".tmp" and renames it over
+*              path, so a reader or a crash never sees half a file.
+*
+* Returns:     - bool: true on success
+**************************************************/
+static bool save_file(const char *path, const NoiseFile &f) {
+    string tmp = string(path) + ".tmp";
+    {
+        ofstream out(tmp);
+        if (!out) {
+            cerr<<"mlkem_noise: cannot write "<<tmp<<endl;
+            return false;
+        }
+        const mlkem_noise_hist &h = *f.hist;
+        out << "# mlkem_noise histogram\n"
+            << "param " << param_line() << "\n"
+            << "sampling " << (f.sampling == MLKEM_NOISE_FIPS ? "fips" : "implemented") << "\n"
+            << "rng " << (f.fast_rng ? "xoshiro256**" : "shake256") << "\n"
+            << "seed " << (f.seed.empty() ? "merged" : f.seed) << "\n"
+            << "trials_per_key " << f.trials_per_key << "\n"
+            << "trials " << h.trials << "\n"
+            << "failed_trials " << h.failed_trials << "\n"
+            << "failed_coeffs " << h.failed_coeffs << "\n";
+        for (int i = 0; i < MLKEM_NOISE_BINS; i++)
+            if (h.bins[i]) out << "noise " << i - Kyber_Q / 2 << " " << h.bins[i] << "\n";
+        out.flush();
+        if (!out) {
+            cerr<<"mlkem_noise: write to "<<tmp<<" failed"<<endl;
+            return false;
+        }
+    }
+    if (rename(tmp.c_str(), path) != 0) {
+        cerr<<"mlkem_noise: cannot rename "<<tmp<<" to "<<path<<endl;
+        return false;
+    }
+    return true;
+}
+
+/*************************************************
+* Name:        load_file
+*
+* Description: Reads a histogram written by save_file. Files of another
+*              parameter set are refused; the bins must add up to
+*              256 coefficients per trial.
+*
+* Returns:     - bool: true on success
+**************************************************/
+static bool load_file(const char *path, NoiseFile &f) {
+    ifstream in(path);
+    if (!in) {
+        cerr<<"mlkem_noise: cannot read "<<path<<endl;
+        return false;
+    }
+    mlkem_noise_hist &h = *f.hist;
+    string line, key;
+    u64 binned = 0;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        istringstream ss(line);
+        ss >> key;
+        if (key == "param") {
+            string rest;
+            getline(ss >> ws, rest);
+            if (rest != param_line()) {
+                cerr<<"mlkem_noise: "<<path<<" is for "<<rest<<", this build is "<<param_line()<<endl;
+                return false;
+            }
+        }
+        else if (key == "sampling") {
+            string v;
+            ss >> v;
+            f.sampling = v == "fips" ? MLKEM_NOISE_FIPS : MLKEM_NOISE_IMPLEMENTED;
+        }
+        else if (key == "rng") {
+            string v;
+            ss >> v;
+            f.fast_rng = v != "shake256";
+        }
+        else if (key == "seed") {
+            ss >> f.seed;
+            if (f.seed == "merged") f.seed.clear();
+        }
+        else if (key == "trials_per_key") ss >> f.trials_per_key;
+        else if (key == "trials") ss >> h.trials;
+        else if (key == "failed_trials") ss >> h.failed_trials;
+        else if (key == "failed_coeffs") ss >> h.failed_coeffs;
+        else if (key == "noise") {
+            long long n;
+            u64 count;
+            ss >> n >> count;
+            if (!ss || n < -(Kyber_Q / 2) || n > Kyber_Q / 2) {
+                cerr<<"mlkem_noise: "<<path<<": bad line "<<line<<endl;
+                return false;
+            }
+            h.bins[n + Kyber_Q / 2] += count;
+            binned += count;
+        }
+    }
+    if (binned != h.coefficients()) {
+        cerr<<"mlkem_noise: "<<path<<": "<<binned<<" coefficients binned for "<<h.trials<<" trials"<<endl;
+        return false;
+    }
+    return true;
+}
+
+static double log2_or_floor(double p) {
+    return p > 0 ? log2(p) : -INFINITY;
+}
+
+/*************************************************
+* Name:        print_summary
+*
+* Description: Prints the noise distribution: moments, the empirical tail
+*              against a Gaussian of the same variance, the observed
+*              failures, and the Gaussian estimate of the failure rate
+*              per coefficient and per 256-bit message. The Gaussian
+*              figure is a rough guide far below the sampled range; the
+*              tail table shows how well it fits where there is data.
+**************************************************/
+static void print_summary(const NoiseFile &f) {
+    const mlkem_noise_hist &h = *f.hist;
+    double coeffs = (double)h.coefficients();
+    printf("ML-KEM-%d noise, %s sampling: %llu trials (%llu coefficients)\n", 256 * Kyber_k,
+           f.sampling == MLKEM_NOISE_FIPS ? "fips" : "implemented", (unsigned long long)h.trials,
+           (unsigned long long)h.coefficients());
+    if (h.trials == 0) return;
+
+    double sum = 0, sq = 0;
+    int max_abs = 0;
+    for (int i = 0; i < MLKEM_NOISE_BINS; i++) {
+        if (!h.bins[i]) continue;
+        int n = i - Kyber_Q / 2;
+        sum += (double)n * h.bins[i];
+        sq += (double)n * n * h.bins[i];
+        max_abs = max(max_abs, abs(n));
+    }
+    double mean = sum / coeffs, sigma = sqrt(sq / coeffs - mean * mean);
+    printf("  mean %.4f  stddev %.3f  max |n| %d  margin to failure %d\n", mean, sigma, max_abs,
+           fail_threshold - max_abs);
+    printf("  failed: %llu coefficients, %llu trials\n", (unsigned long long)h.failed_coeffs,
+           (unsigned long long)h.failed_trials);
+
+    printf("  %8s %14s %12s %12s\n", "|n| >=", "count", "log2 P", "gaussian");
+    for (int t = (int)(sigma + 0.5); t <= fail_threshold; t += max(1, (int)(sigma + 0.5))) {
+        u64 count = 0;
+        for (int i = 0; i < MLKEM_NOISE_BINS; i++)
+            if (abs(i - Kyber_Q / 2) >= t) count += h.bins[i];
+        if (count == 0) break;
+        double gauss = erfc((t - 0.5) / (sigma * sqrt(2.0)));
+        printf("  %8d %14llu %12.2f %12.2f\n", t, (unsigned long long)count, log2(count / coeffs),
+               log2_or_floor(gauss));
+    }
+
+    double p = erfc((fail_threshold - 0.5) / (sigma * sqrt(2.0)));
+    double p_msg = -expm1(Kyber_N * log1p(-p));
+    if (p_msg == 0) p_msg = Kyber_N * p;
+    printf("  gaussian estimate: log2 P(coefficient fails) %.1f, log2 P(message fails) %.1f\n",
+           log2_or_floor(p), log2_or_floor(p_msg));
+}
+
+static int merge_files(const NoiseConfig &cfg) {
+    NoiseFile total;
+    vector<string> seeds;
+    for (size_t i = 0; i < cfg.merge.size(); i++) {
+        NoiseFile f;
+        if (!load_file(cfg.merge[i], f)) return 1;
+        if (i == 0) {
+            total.sampling = f.sampling;
+            total.fast_rng = f.fast_rng;
+            total.trials_per_key = f.trials_per_key;
+        } else if (f.sampling != total.sampling) {
+            cerr<<"mlkem_noise: "<<cfg.merge[i]<<" uses a different sampling mode"<<endl;
+            return 1;
+        }
+        for (const string &s : seeds) {
+            if (!f.seed.empty() && s == f.seed && f.trials_per_key == total.trials_per_key)
+                cerr<<"mlkem_noise: warning: "<<cfg.merge[i]<<" repeats seed "<<s<<"; its trials overlap"<<endl;
+        }
+        seeds.push_back(f.seed);
+        total.hist->merge(*f.hist);
+    }
+    if (cfg.out_path && !save_file(cfg.out_path, total)) return 1;
+    print_summary(total);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    NoiseConfig cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (!mlkem_selftest()) {
+        cerr<<"mlkem_noise: self-test failed"<<endl;
+        return 1;
+    }
+    if (!cfg.merge.empty()) return merge_files(cfg);
+
+    NoiseFile state;
+    if (cfg.resume) {
+        if (!load_file(cfg.out_path, state)) return 1;
+        if (state.seed.empty()) {
+            cerr<<"mlkem_noise: "<<cfg.out_path<<" is a merged file and cannot be resumed"<<endl;
+            return 1;
+        }
+        // the stored run decides how the remaining trials are drawn
+        cfg.run.sampling = state.sampling;
+        cfg.run.fast_rng = state.fast_rng;
+        cfg.run.seed = strtoull(state.seed.c_str(), nullptr, 10);
+        cfg.run.trials_per_key = state.trials_per_key;
+    } else {
+        state.sampling = cfg.run.sampling;
+        state.fast_rng = cfg.run.fast_rng;
+        state.seed = to_string(cfg.run.seed);
+        state.trials_per_key = cfg.run.trials_per_key;
+    }
+
+    Executor ex(cfg.threads);
+    mlkem_noise_hist &h = *state.hist;
+    u64 target = cfg.trials ? cfg.trials : ~0ULL;
+    u64 start = h.trials;
+    Clock::time_point t0 = Clock::now();
+    while (h.trials < target) {
+        u64 n = min(cfg.round, target - h.trials);
+        mlkem_noise_simulate(ex, h, cfg.run, h.trials, n);
+        if (cfg.out_path && !save_file(cfg.out_path, state)) return 1;
+
+        double seconds = chrono::duration<double>(Clock::now() - t0).count();
+        if (!cfg.quiet) {
+            fprintf(stderr, "%llu trials, %llu failed, %.0f trials/s\n", (unsigned long long)h.trials,
+                    (unsigned long long)h.failed_trials, (h.trials - start) / seconds);
+        }
+        if (cfg.duration > 0 && seconds >= cfg.duration) break;
+    }
+
+    if (!cfg.quiet) {
+        fprintf(stderr, "%s, %u threads, %s, %.2f s\n", mlkem_dispatch().name, ex.size(),
+                cfg.run.fast_rng ? "xoshiro256**" : "shake256", chrono::duration<double>(Clock::now() - t0).count());
+    }
+    print_summary(state);
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "perf_counters.hpp"
+
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef __linux__
+static long perf_event_open(perf_event_attr *attr, pid_t pid, int cpu, int group_fd, unsigned long flags) {
+    return syscall(__NR_perf_event_open, attr, pid, cpu, group_fd, flags);
+}
+
+static void counter_attr(perf_counter_id id, perf_event_attr &attr) {
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    switch (id) {
+    case PERF_CYCLES:        attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+    case PERF_INSTRUCTIONS:  attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+    case PERF_BRANCH_MISSES: attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+    case PERF_L1D_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    default:                 attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+    }
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID
+                     | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;    // allowed at perf_event_paranoid <= 2
+    attr.exclude_hv = 1;
+    attr.disabled = id == PERF_CYCLES;
+}
+#endif
+
+/*************************************************
+* Name:        PerfCounters::PerfCounters
+*
+* Description: Opens the counter group on the calling thread with cycles
+*              as leader. Members the CPU does not support are skipped.
+**************************************************/
+PerfCounters::PerfCounters() {
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) { fds[i] = -1; ids[i] = 0; }
+#ifdef __linux__
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        perf_event_attr attr;
+        counter_attr((perf_counter_id)i, attr);
+        int fd = (int)perf_event_open(&attr, 0, -1, i == 0 ? -1 : fds[PERF_CYCLES], 0);
+        if (fd < 0) {
+            if (i == 0) {
+                why = string("perf_event_open: ") + strerror(errno);
+                if (errno == EACCES || errno == EPERM) why += " (check /proc/sys/kernel/perf_event_paranoid)";
+                if (errno == ENOENT || errno == EOPNOTSUPP) why += " (no hardware PMU, e.g. in a VM or container)";
+                return;
+            }
+            continue;
+        }
+        fds[i] = fd;
+        ioctl(fd, PERF_EVENT_IOC_ID, &ids[i]);
+    }
+#else
+    why = "hardware counters need Linux perf_event_open";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+        if (fds[i] >= 0) close(fds[i]);
+#endif
+}
+
+/*************************************************
+* Name:        PerfCounters::start
+*
+* Description: Zeroes and enables the whole group.
+**************************************************/
+void PerfCounters::start() {
+#ifdef __linux__
+    if (!available()) return;
+    ioctl(fds[PERF_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[PERF_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+/*************************************************
+* Name:        PerfCounters::stop
+*
+* Description: Disables the group and reads it. Values are scaled by
+*              time_enabled / time_running when the kernel multiplexed
+*              the group with other events.
+*
+* Returns:     - PerfSample: counter values; valid[] marks counters read
+**************************************************/
+PerfSample PerfCounters::stop() {
+    PerfSample s;
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) { s.valid[i] = false; s.value[i] = 0; }
+#ifdef __linux__
+    if (!available()) return s;
+    ioctl(fds[PERF_CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // nr, time_enabled, time_running, then {value, id} per member
+    u64 buf[3 + 2 * PERF_COUNTER_COUNT];
+    ssize_t n = read(fds[PERF_CYCLES], buf, sizeof(buf));
+    if (n < (ssize_t)(3 * sizeof(u64)) || buf[2] == 0) return s;
+    double scale = (double)buf[1] / (double)buf[2];
+    for (u64 j = 0; j < buf[0] && j < PERF_COUNTER_COUNT; j++) {
+        for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+            if (fds[i] >= 0 && ids[i] == buf[4 + 2 * j]) {
+                s.valid[i] = true;
+                s.value[i] = buf[3 + 2 * j] * scale;
+            }
+        }
+    }
+#endif
+    return s;
+}
+
+const char *PerfCounters::name(perf_counter_id id) {
+    static const char *names[PERF_COUNTER_COUNT] = {
+        "cycles", "instructions", "branch-misses", "L1D-misses", "LLC-misses"
+    };
+    return id < PERF_COUNTER_COUNT ? names[id] : "unknown";
+}
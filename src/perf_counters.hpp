@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include "ml-kem/param.hpp"
+
+// Hardware counters read around a measured region.
+enum perf_counter_id{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_COUNTER_COUNT
+};
+
+struct PerfSample{
+    bool valid[PERF_COUNTER_COUNT];
+    double value[PERF_COUNTER_COUNT];   // scaled for multiplexing
+};
+
+// One perf_event_open group for the calling thread (user space only).
+// Counters the kernel or CPU refuses are left out; if the group leader
+// cannot be opened at all, available() is false and reason() says why.
+class PerfCounters{
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    bool available() const { return fds[PERF_CYCLES] >= 0; }
+    const std::string &reason() const { return why; }
+
+    void start();
+    PerfSample stop();
+
+    static const char *name(perf_counter_id id);
+
+private:
+    int fds[PERF_COUNTER_COUNT];
+    u64 ids[PERF_COUNTER_COUNT];
+    std::string why;
+};
@@ -0,0 +1,68 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+
+#include "ml-kem/ML-KEM.hpp"
+#include "ml-kem/decaps_many.hpp"
+#include "ml-kem/alloc_track.hpp"
+
+using namespace std;
+
+// Heap budget per public API call. Lower these when an allocation is
+// removed; a failure here means a change added heap traffic.
+struct AllocBudget{
+    mlkem_op op;
+    u64 max_allocations;
+    u64 max_peak_bytes;
+};
+
+static const AllocBudget budgets[] = {
+    {MLKEM_OP_KEYGEN,        59,  9 * 1024},
+    {MLKEM_OP_ENCAPS,        60, 10 * 1024},
+    {MLKEM_OP_DECAPS,        82, 12 * 1024},
+    {MLKEM_OP_ENCAPS_BATCH, 470, 18 * 1024},
+    {MLKEM_OP_DECAPS_BATCH, 615, 21 * 1024},
+    {MLKEM_OP_DECAPS_MANY,   20,  9 * 1024},
+};
+
+int main() {
+    cout << "\n===== [TEST] allocation budgets =====" << endl;
+    if (!mlkem_alloc_tracking_enabled()) {
+        cout << "[SKIP] library built without MLKEM_ALLOC_TRACKING" << endl;
+        return 0;
+    }
+
+    auto [ek, dk] = ML_KEM_KEYGEN();
+    auto [K, c] = ML_KEM_ENCAPSULATION(ek);
+    vector<ui8> K2 = ML_KEM_DECAPSULATION(dk, c);
+    vector<vector<ui8>> eks(8, ek), dks(8, dk), cts(8, c);
+    ML_KEM_ENCAPSULATION_BATCH(eks);
+    ML_KEM_DECAPSULATION_BATCH(dks, cts);
+    ML_KEM_DECAPSULATION_MANY(dk, cts);
+
+    bool ok = (K == K2);
+    for (const AllocBudget &b : budgets) {
+        mlkem_alloc_stats s = mlkem_alloc_last(b.op);
+        bool pass = s.calls == 1 && s.allocations <= b.max_allocations
+                 && s.peak_live_bytes <= b.max_peak_bytes && s.bytes >= s.peak_live_bytes;
+        cout << (pass ? "[PASS] " : "[FAIL] ") << mlkem_op_name(b.op) << ": "
+             << s.allocations << " allocations (budget " << b.max_allocations << "), "
+             << s.bytes << " bytes, peak " << s.peak_live_bytes
+             << " (budget " << b.max_peak_bytes << ")" << endl;
+        ok = ok && pass;
+    }
+
+    // counters are per thread: work on another thread is not charged here
+    mlkem_alloc_reset();
+    mlkem_alloc_stats before = mlkem_alloc_thread();
+    thread other([&ek]{ ML_KEM_ENCAPSULATION(ek); });
+    other.join();
+    mlkem_alloc_stats after = mlkem_alloc_thread();
+    // thread creation itself may allocate on this thread, encaps may not
+    if (mlkem_alloc_total(MLKEM_OP_ENCAPS).calls != 0 || after.allocations - before.allocations > 4) {
+        cout << "[FAIL] another thread's allocations were charged to this thread" << endl;
+        ok = false;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "ml-kem/async.hpp"
+
+using namespace std;
+
+// Fire-and-forget coroutine: starts at once and frees itself at the end.
+struct Detached{
+    struct promise_type{
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { terminate(); }
+    };
+};
+
+struct Done{
+    mutex m;
+    condition_variable cv;
+    int count = 0;
+
+    void add() {
+        lock_guard<mutex> lk(m);
+        count++;
+        cv.notify_all();
+    }
+
+    int get() {
+        lock_guard<mutex> lk(m);
+        return count;
+    }
+
+    bool wait(int n) {
+        unique_lock<mutex> lk(m);
+        return cv.wait_for(lk, chrono::seconds(60), [&]{ return count >= n; });
+    }
+};
+
+// encapsulate, then decapsulate with the serialized and the expanded key
+static Detached round_trip(mlkem::Aggregator &agg, vector<ui8> &ek, vector<ui8> &dk, mlkem_expanded_dk &key,
+                           atomic<int> &bad, Done &done) {
+    auto [K, c] = co_await agg.encaps(ek);
+    vector<ui8> K1 = co_await agg.decaps(dk, c);
+    vector<ui8> K2 = co_await agg.decaps(key, c);
+    if (K.size() != 32 || K1 != K || K2 != K) bad++;
+    done.add();
+}
+
+static Detached encaps_only(mlkem::Aggregator &agg, vector<ui8> ek, bool expect_ok, atomic<int> &bad, Done &done) {
+    auto [K, c] = co_await agg.encaps(ek);
+    if (K.empty() == expect_ok) bad++;
+    done.add();
+}
+
+// resumed on the thread draining the queue, not on an executor thread
+static Detached on_caller(mlkem::Aggregator &agg, vector<ui8> &dk, vector<ui8> c, mlkem::Resumer on,
+                          thread::id caller, atomic<int> &bad, Done &done) {
+    vector<ui8> K = co_await agg.decaps(dk, c, on);
+    if (K.size() != 32 || this_thread::get_id() != caller) bad++;
+    done.add();
+}
+
+static Detached decaps_expect_empty(mlkem::Aggregator &agg, mlkem_expanded_dk &key, vector<ui8> c,
+                                   atomic<int> &bad, Done &done) {
+    vector<ui8> K = co_await agg.decaps(key, c);
+    if (!K.empty()) bad++;
+    done.add();
+}
+
+// continues with a parallel_* helper on the executor that ran its batch
+static Detached nested_parallel(mlkem::Aggregator &agg, Executor &ex, vector<ui8> &ek, atomic<int> &bad,
+                                Done &done) {
+    auto [K, c] = co_await agg.encaps(ek);
+    auto keys = parallel_keygen(ex, 16);
+    if (K.size() != 32 || keys.size() != 16 || keys[15].first.empty()) bad++;
+    done.add();
+}
+
+static Detached free_functions(vector<ui8> &ek, mlkem_expanded_dk &key, atomic<int> &bad, Done &done) {
+    auto [K, c] = co_await mlkem::async_encaps(ek);
+    vector<ui8> K1 = co_await mlkem::async_decaps(key, c);
+    auto keys = parallel_keygen(64);
+    if (K.size() != 32 || K1 != K || keys.size() != 64) bad++;
+    done.add();
+}
+
+int main() {
+    bool ok = true;
+    cout << "\n===== [TEST] coroutine API with micro-batching =====" << endl;
+
+    vector<vector<ui8>> eks, dks;
+    vector<mlkem_expanded_dk> keys(4);
+    for (int i = 0; i < 4; i++) {
+        auto [ek, dk] = ML_KEM_KEYGEN();
+        eks.push_back(ek);
+        dks.push_back(dk);
+        ML_KEM_expand_decaps_key(keys[i], dks[i]);
+    }
+
+    Executor ex(2);
+    {
+        mlkem::AggregatorConfig cfg;
+        cfg.executor = &ex;
+        cfg.max_delay = chrono::microseconds(2000);
+        mlkem::Aggregator agg(cfg);
+
+        // 64 concurrent round trips over 4 keys: all three stages batch
+        atomic<int> bad(0);
+        Done done;
+        for (int i = 0; i < 64; i++) round_trip(agg, eks[i % 4], dks[i % 4], keys[i % 4], bad, done);
+        bool pass = done.wait(64) && bad == 0;
+        mlkem::AggregatorStats s = agg.stats();
+        pass = pass && s.requests == 192 && s.full_flushes > 0 && s.batches < s.requests / 2 && s.retried == 0;
+        cout << (pass ? "[PASS] " : "[FAIL] ") << "64 round trips: " << s.requests << " requests in " << s.batches
+             << " batches (" << s.full_flushes << " full)" << endl;
+        ok = ok && pass;
+
+        // a bad key fails alone; the rest of its batch still succeeds
+        vector<ui8> bad_ek = eks[0];
+        for (int j = 0; j < 384; j++) bad_ek[j] = 0xff;
+        Done done2;
+        for (int i = 0; i < 8; i++) encaps_only(agg, i == 3 ? bad_ek : eks[i % 4], i != 3, bad, done2);
+        pass = done2.wait(8) && bad == 0 && agg.stats().retried > 0;
+        cout << (pass ? "[PASS] " : "[FAIL] ") << "bad encapsulation key fails only its own request" << endl;
+        ok = ok && pass;
+
+        // a single request is flushed by the deadline; a short ciphertext
+        // completes at once
+        auto [K, c] = ML_KEM_ENCAPSULATION(eks[1]);
+        vector<ui8> short_c(c.begin(), c.end() - 1);
+        deque<coroutine_handle<>> inbox;
+        mutex inbox_m;
+        mlkem::Resumer to_inbox = [&](coroutine_handle<> h){
+            lock_guard<mutex> lk(inbox_m);
+            inbox.push_back(h);
+        };
+        Done done3;
+        u64 deadline_before = agg.stats().deadline_flushes;
+        on_caller(agg, dks[1], c, to_inbox, this_thread::get_id(), bad, done3);
+        decaps_expect_empty(agg, keys[1], short_c, bad, done3);
+        auto until = chrono::steady_clock::now() + chrono::seconds(60);
+        while (done3.get() < 2 && chrono::steady_clock::now() < until) {
+            coroutine_handle<> h;
+            {
+                lock_guard<mutex> lk(inbox_m);
+                if (!inbox.empty()) {
+                    h = inbox.front();
+                    inbox.pop_front();
+                }
+            }
+            if (h) h.resume();
+            else this_thread::sleep_for(chrono::microseconds(100));
+        }
+        pass = done3.wait(2) && bad == 0 && agg.stats().deadline_flushes > deadline_before;
+        cout << (pass ? "[PASS] " : "[FAIL] ") << "deadline flush, caller's resumer, short ciphertext" << endl;
+        ok = ok && pass;
+
+        // continuations run off the executor, so they may use it
+        Done done4;
+        for (int i = 0; i < 8; i++) nested_parallel(agg, ex, eks[i % 4], bad, done4);
+        pass = done4.wait(8) && bad == 0;
+        cout << (pass ? "[PASS] " : "[FAIL] ") << "continuations call parallel_keygen on the batch executor"
+             << endl;
+        ok = ok && pass;
+    }
+
+    // the free functions use the process-wide aggregator
+    {
+        atomic<int> bad(0);
+        Done done;
+        free_functions(eks[2], keys[2], bad, done);
+        bool pass = done.wait(1) && bad == 0;
+        cout << (pass ? "[PASS] " : "[FAIL] ") << "async_encaps / async_decaps" << endl;
+        ok = ok && pass;
+    }
+
+    cout << (ok ? "[PASS]" : "[FAIL]") << " coroutine API" << endl;
+    return ok ? 0 : 1;
+}
@@ -69,7 +69,8 @@ for (int i = 0; i < Kyber_N; i++) {
     vector<i16> a_orig = a;
 
     // Perform NTT and then inverse NTT
-    vector<i16> A_ntt = ntt(a);
+    vector<i16> A_ntt = a;
+    ntt(A_ntt);
     invntt(A_ntt);
 
     // Verify a == invntt(ntt(a)) (mod Q)
@@ -0,0 +1,181 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "ml-kem/context.hpp"
+#include "ml-kem/decaps_many.hpp"
+#include "ml-kem/executor.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const int THREADS = 8;
+static const int ROUNDS = 40;
+static const int CHILDREN = 2;
+
+// Forked child body: a fresh key pair and shared secret from the thread
+// default context, then 32 bytes from the fixed-seed context, to the pipe.
+static int child(int fd, vector<ui8> &ek, MLKEM_Context &fixed) {
+    auto [cek, cdk] = ML_KEM_KEYGEN();
+    auto [K, c] = ML_KEM_ENCAPSULATION(ek);
+    vector<ui8> out(cek.begin(), cek.begin() + 32);
+    out.insert(out.end(), K.begin(), K.end());
+    out.resize(96);
+    fixed.random(out.data() + 64, 32);
+    return write(fd, out.data(), out.size()) == (ssize_t)out.size() ? 0 : 1;
+}
+
+int main() {
+    bool ok = true;
+    cout << "\n===== [TEST] contexts and concurrent use =====" << endl;
+
+    // a seeded context is a deterministic stream; stats follow the calls
+    ui8 seed_a[32] = {1}, seed_b[32] = {2};
+    MLKEM_Context a1(seed_a), a2(seed_a), b(seed_b);
+    auto ka1 = ML_KEM_KEYGEN(a1), ka2 = ML_KEM_KEYGEN(a2), kb = ML_KEM_KEYGEN(b);
+    if (ka1 != ka2 || ka1 == kb) {
+        cout << "[FAIL] seeded contexts are not deterministic per seed" << endl;
+        ok = false;
+    }
+    auto [K, c] = ML_KEM_ENCAPSULATION(a1, ka1.first);
+    vector<ui8> short_c(c.begin(), c.end() - 1);
+    if (ML_KEM_DECAPSULATION(a1, ka1.second, c) != K || !ML_KEM_DECAPSULATION(a1, ka1.second, short_c).empty()) {
+        cout << "[FAIL] round trip through a context" << endl;
+        ok = false;
+    }
+    mlkem_context_stats s = a1.stats;
+    if (s.keygen != 1 || s.encaps != 1 || s.decaps != 1 || s.rejected != 1 || s.random_bytes != 96) {
+        cout << "[FAIL] context stats: keygen " << s.keygen << ", encaps " << s.encaps << ", decaps "
+             << s.decaps << ", rejected " << s.rejected << ", random bytes " << s.random_bytes << endl;
+        ok = false;
+    }
+
+    // backtracking resistance: a copy of a generator's state taken after it
+    // produced some output holds neither the seed nor that output, and a
+    // generator restarted from its key produces something else
+    {
+        ui8 seed_d[32];
+        for (int i = 0; i < 32; i++) seed_d[i] = (ui8)(37 * i + 11);
+        MLKEM_Drbg g;
+        g.seed(seed_d);
+        vector<ui8> past(3000);
+        g.generate(past.data(), past.size());
+        MLKEM_Drbg snapshot = g;
+        const ui8 *raw = (const ui8 *)&snapshot;
+        bool leaked = search(raw, raw + sizeof(snapshot), seed_d, seed_d + 32) != raw + sizeof(snapshot);
+        for (size_t i = 0; i + 16 <= past.size() && !leaked; i += 16)
+            leaked = search(raw, raw + sizeof(snapshot), past.begin() + i, past.begin() + i + 16)
+                     != raw + sizeof(snapshot);
+        MLKEM_Drbg restarted;
+        restarted.seed(snapshot.key);
+        vector<ui8> replay(past.size());
+        restarted.generate(replay.data(), replay.size());
+        vector<ui8> next_g(64), next_s(64);
+        g.generate(next_g.data(), 64);
+        snapshot.generate(next_s.data(), 64);
+        bool pass = !leaked && replay != past && next_g == next_s;
+        cout << (pass ? "[PASS] " : "[FAIL] ") << "generator state does not reveal earlier output" << endl;
+        ok = ok && pass;
+    }
+
+    // stress: every thread runs full round trips, half with their own
+    // context and half with the thread default, all against one shared
+    // key pair, while two threads share the default executor
+    auto [ek, dk] = ML_KEM_KEYGEN();
+    atomic<int> failures(0);
+    vector<vector<ui8>> first_bytes(THREADS);
+    vector<thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&, t]{
+            MLKEM_Context own;
+            MLKEM_Context &ctx = (t % 2) ? own : mlkem_thread_context();
+            first_bytes[t].resize(32);
+            ctx.random(first_bytes[t].data(), 32);
+            for (int r = 0; r < ROUNDS; r++) {
+                auto [tek, tdk] = ML_KEM_KEYGEN(ctx);
+                auto [tK, tc] = ML_KEM_ENCAPSULATION(ctx, tek);
+                auto [sK, sc] = ML_KEM_ENCAPSULATION(ctx, ek);
+                if (ML_KEM_DECAPSULATION(ctx, tdk, tc) != tK || ML_KEM_DECAPSULATION(dk, sc) != sK)
+                    failures++;
+                if (r % 10 == 0) {
+                    vector<vector<ui8>> cts = {sc, tc};
+                    vector<vector<ui8>> many = ML_KEM_DECAPSULATION_MANY(ctx, dk, cts);
+                    if (many.size() != 2 || many[0] != sK || many[1] == tK) failures++;
+                }
+                if (t < 2 && r % 20 == 0) {
+                    vector<vector<ui8>> cts(16, sc);
+                    for (auto &k : parallel_decaps(dk, cts)) if (k != sK) failures++;
+                }
+            }
+            if (ctx.stats.keygen != ROUNDS || ctx.stats.encaps != 2 * ROUNDS) failures++;
+        });
+    }
+    for (auto &th : threads) th.join();
+
+    bool distinct = true;
+    for (int i = 0; i < THREADS; i++)
+        for (int j = i + 1; j < THREADS; j++)
+            if (first_bytes[i] == first_bytes[j]) distinct = false;
+    if (failures != 0 || !distinct) {
+        cout << "[FAIL] " << failures << " failures across " << THREADS << " threads"
+             << (distinct ? "" : ", contexts share a DRBG stream") << endl;
+        ok = false;
+    } else {
+        cout << "[PASS] " << THREADS << " threads x " << ROUNDS << " round trips" << endl;
+    }
+
+    // fork: each child reseeds the thread default context, so no two
+    // processes repeat a key pair or shared secret; a seeded context is
+    // still the same stream in every process
+    ui8 seed_f[32] = {3};
+    MLKEM_Context fixed(seed_f);
+    ML_KEM_KEYGEN();
+    vector<vector<ui8>> outs;
+    bool forked = true;
+    for (int i = 0; i < CHILDREN; i++) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            forked = false;
+            break;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            _exit(child(fds[1], ek, fixed));
+        }
+        close(fds[1]);
+        vector<ui8> out(96);
+        size_t got = 0;
+        ssize_t r;
+        while (got < out.size() && (r = read(fds[0], out.data() + got, out.size() - got)) > 0) got += r;
+        close(fds[0]);
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (pid < 0 || got != out.size() || !WIFEXITED(status) || WEXITSTATUS(status) != 0) forked = false;
+        outs.push_back(out);
+    }
+    vector<ui8> mine(96);
+    auto [pek, pdk] = ML_KEM_KEYGEN();
+    auto [pK, pc] = ML_KEM_ENCAPSULATION(ek);
+    copy(pek.begin(), pek.begin() + 32, mine.begin());
+    copy(pK.begin(), pK.end(), mine.begin() + 32);
+    fixed.random(mine.data() + 64, 32);
+    outs.push_back(mine);
+    bool fresh = forked;
+    for (size_t i = 0; i < outs.size() && forked; i++)
+        for (size_t j = i + 1; j < outs.size(); j++) {
+            if (equal(outs[i].begin(), outs[i].begin() + 32, outs[j].begin())
+                || equal(outs[i].begin() + 32, outs[i].begin() + 64, outs[j].begin() + 32)
+                || !equal(outs[i].begin() + 64, outs[i].end(), outs[j].begin() + 64))
+                fresh = false;
+        }
+    cout << (fresh ? "[PASS] " : "[FAIL] ") << CHILDREN << " forked children draw fresh randomness" << endl;
+    ok = ok && fresh;
+
+    cout << (ok ? "[PASS]" : "[FAIL]") << " contexts" << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+#include <iostream>
+#include <vector>
+
+#include "ml-kem/decaps_many.hpp"
+#include "ml-kem/dispatch.hpp"
+
+using namespace std;
+
+int main() {
+    bool ok = true;
+    cout << "\n===== [TEST] same-key decaps_many =====" << endl;
+
+    auto [ek, dk] = ML_KEM_KEYGEN();
+
+    // 21 ciphertexts: not a multiple of any group size; every third one
+    // tampered so implicit rejection is exercised inside a group
+    vector<vector<ui8>> cts, expect;
+    for (int i = 0; i < 21; i++) {
+        auto [K, c] = ML_KEM_ENCAPSULATION(ek);
+        if (i % 3 == 1) c[(i * 37) % c.size()] ^= 0x40;
+        cts.push_back(c);
+        expect.push_back(ML_KEM_Decaps_internal(dk, c));
+        if (i % 3 != 1 && expect.back() != K) {
+            cout << "[FAIL] reference decapsulation disagrees with encapsulation" << endl;
+            ok = false;
+        }
+    }
+
+    for (const mlkem_backend *b : mlkem_available_backends()) {
+        mlkem_select_backend(b->name);
+        vector<vector<ui8>> got = ML_KEM_DECAPSULATION_MANY(dk, cts);
+        bool pass = got == expect;
+        cout << (pass ? "[PASS] " : "[FAIL] ") << b->name << ": " << cts.size()
+             << " ciphertexts match ML_KEM_Decaps_internal" << endl;
+        ok = ok && pass;
+    }
+    mlkem_select_backend(mlkem_available_backends()[0]->name);
+
+    // the expanded key is plain data: a copy decapsulates the same
+    mlkem_expanded_dk key, copy;
+    if (!ML_KEM_expand_decaps_key(key, dk)) {
+        cout << "[FAIL] a generated key failed to expand" << endl;
+        ok = false;
+    }
+    copy = key;
+    vector<vector<ui8>> one(cts.begin(), cts.begin() + 1), none;
+    if (ML_KEM_decaps_many(copy, one) != vector<vector<ui8>>(1, expect[0])
+        || !ML_KEM_decaps_many(key, none).empty()) {
+        cout << "[FAIL] decaps_many on a copied key or an empty set" << endl;
+        ok = false;
+    }
+
+    vector<ui8> bad_dk = dk;
+    bad_dk[768 * Kyber_k + 40] ^= 1;
+    vector<vector<ui8>> short_ct = cts;
+    short_ct[5].pop_back();
+    if (ML_KEM_expand_decaps_key(key, bad_dk) || !ML_KEM_DECAPSULATION_MANY(bad_dk, cts).empty()
+        || !ML_KEM_DECAPSULATION_MANY(dk, short_ct).empty()) {
+        cout << "[FAIL] bad key or truncated ciphertext accepted" << endl;
+        ok = false;
+    }
+
+    cout << (ok ? "[PASS]" : "[FAIL]") << " decaps_many" << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cstring>
+
+#include "ml-kem/dispatch.hpp"
+#include "ml-kem/kernels.hpp"
+#include "ml-kem/hash.hpp"
+
+using namespace std;
+
+// Runs every kernel of backend b on random inputs and compares the output
+// with the reference kernels.
+static bool check_backend(const mlkem_backend &b, mt19937 &gen) {
+    uniform_int_distribution<int> coeff(0, Kyber_Q - 1);
+    uniform_int_distribution<int> byte(0, 255);
+    uniform_int_distribution<int> wide(0, (1 << 14) - 1);
+    bool ok = true;
+
+    for (int iter = 0; iter < 50; iter++) {
+        i16 a[Kyber_N], c[Kyber_N], x[Kyber_N], y[Kyber_N];
+        ui8 buf[768], ex[384], ey[384];
+        for (int i = 0; i < Kyber_N; i++) { a[i] = coeff(gen); c[i] = coeff(gen); }
+        for (int i = 0; i < 768; i++) buf[i] = byte(gen);
+
+        memcpy(x, a, sizeof(a)); memcpy(y, a, sizeof(a));
+        b.ntt(x); mlkem_ref::ntt(y);
+        if (memcmp(x, y, sizeof(x)) != 0) { cout << "[FAIL] " << b.name << " ntt" << endl; ok = false; }
+
+        b.invntt(x); mlkem_ref::invntt(y);
+        if (memcmp(x, y, sizeof(x)) != 0) { cout << "[FAIL] " << b.name << " invntt" << endl; ok = false; }
+
+        b.basemul(x, a, c); mlkem_ref::basemul(y, a, c);
+        if (memcmp(x, y, sizeof(x)) != 0) { cout << "[FAIL] " << b.name << " basemul" << endl; ok = false; }
+
+        b.poly_reduce(x); mlkem_ref::poly_reduce(y);
+        b.poly_tomont(x); mlkem_ref::poly_tomont(y);
+        if (memcmp(x, y, sizeof(x)) != 0) { cout << "[FAIL] " << b.name << " reduce/tomont" << endl; ok = false; }
+
+        unsigned nx = b.rej_uniform(x, Kyber_N, buf, sizeof(buf));
+        unsigned ny = mlkem_ref::rej_uniform(y, Kyber_N, buf, sizeof(buf));
+        if (nx != ny || memcmp(x, y, nx * sizeof(i16)) != 0) { cout << "[FAIL] " << b.name << " rej_uniform" << endl; ok = false; }
+
+        // short requests and buffers around the 16-candidate vector step,
+        // mostly-rejected input, and no write past len
+        for (int pattern = 0; pattern < 2; pattern++) {
+            ui8 rb[504];
+            for (int i = 0; i < 504; i++) rb[i] = pattern ? (byte(gen) | 0xD0) : buf[i];
+            for (unsigned len : {1u, 15u, 16u, 17u, 31u, 100u, 256u}) {
+                for (unsigned blen : {3u, 27u, 28u, 51u, 168u, 504u}) {
+                    i16 rx[Kyber_N + 8], ry[Kyber_N + 8];
+                    for (int i = 0; i < Kyber_N + 8; i++) rx[i] = ry[i] = -1;
+                    nx = b.rej_uniform(rx, len, rb, blen);
+                    ny = mlkem_ref::rej_uniform(ry, len, rb, blen);
+                    bool past = false;
+                    for (unsigned i = len; i < Kyber_N + 8; i++) past |= rx[i] != -1;
+                    if (nx != ny || memcmp(rx, ry, nx * sizeof(i16)) != 0 || past) {
+                        cout << "[FAIL] " << b.name << " rej_uniform len " << len << ", " << blen << " bytes" << endl;
+                        ok = false;
+                    }
+                }
+            }
+        }
+
+        for (int eta = 2; eta <= 3; eta++) {
+            b.cbd(x, buf, eta); mlkem_ref::cbd(y, buf, eta);
+            if (memcmp(x, y, sizeof(x)) != 0) { cout << "[FAIL] " << b.name << " cbd" << eta << endl; ok = false; }
+        }
+
+        for (int d = 1; d <= 12; d++) {
+            b.byte_encode(ex, a, d); mlkem_ref::byte_encode(ey, a, d);
+            if (memcmp(ex, ey, 32 * d) != 0) { cout << "[FAIL] " << b.name << " byte_encode " << d << endl; ok = false; }
+            b.byte_decode(x, buf, d); mlkem_ref::byte_decode(y, buf, d);
+            if (memcmp(x, y, sizeof(x)) != 0) { cout << "[FAIL] " << b.name << " byte_decode " << d << endl; ok = false; }
+        }
+
+        // fused kernels against the separate passes they replace
+        for (int d : {1, 3, 4, 5, 10, 11}) {
+            b.decompress_ntt(x, buf, d);
+            mlkem_ref::byte_decode(y, buf, d);
+            for (int i = 0; i < Kyber_N; i++) y[i] = (y[i] * Kyber_Q + (1 << (d - 1))) >> d;
+            mlkem_ref::ntt(y);
+            if (memcmp(x, y, sizeof(x)) != 0) { cout << "[FAIL] " << b.name << " decompress_ntt " << d << endl; ok = false; }
+
+            for (int negate = 0; negate <= 1; negate++) {
+                for (int i = 0; i < Kyber_N; i++) x[i] = y[i] = (i16)(wide(gen) * (2 * (i & 1) - 1));
+                b.invntt_add_compress(ex, x, c, d, negate);
+                mlkem_ref::invntt(y);
+                for (int i = 0; i < Kyber_N; i++) {
+                    int w = ((c[i] + (negate ? -y[i] : y[i])) % Kyber_Q + Kyber_Q) % Kyber_Q;
+                    y[i] = (((w << d) + Kyber_Q / 2) / Kyber_Q) & ((1 << d) - 1);
+                }
+                mlkem_ref::byte_encode(ey, y, d);
+                if (memcmp(ex, ey, 32 * d) != 0) { cout << "[FAIL] " << b.name << " invntt_add_compress " << d << endl; ok = false; }
+            }
+        }
+
+        // a fresh 12-bit encoding is in range; one coefficient forced
+        // to 4095 is not
+        b.byte_encode(ex, a, 12);
+        if (b.byte_check12(ex) != 0) { cout << "[FAIL] " << b.name << " byte_check12 rejects a valid encoding" << endl; ok = false; }
+        int at = coeff(gen) % Kyber_N;
+        ex[3 * (at / 2) + (at & 1)] |= (at & 1) ? 0xF0 : 0xFF;
+        ex[3 * (at / 2) + 1 + (at & 1)] |= (at & 1) ? 0xFF : 0x0F;
+        if (b.byte_check12(ex) == 0) { cout << "[FAIL] " << b.name << " byte_check12 accepts 4095" << endl; ok = false; }
+        if ((b.byte_check12(buf) != 0) != (mlkem_ref::byte_check12(buf) != 0)) { cout << "[FAIL] " << b.name << " byte_check12" << endl; ok = false; }
+
+        alignas(8) ui8 sx[200], sy[200];
+        memcpy(sx, buf, 200); memcpy(sy, buf, 200);
+        b.keccak_f1600(sx); KeccakF1600(sy);
+        if (memcmp(sx, sy, 200) != 0) { cout << "[FAIL] " << b.name << " keccak_f1600" << endl; ok = false; }
+    }
+    return ok;
+}
+
+int main() {
+    mt19937 gen(2024);
+    bool ok = true;
+
+    cout << "\n===== [TEST] backend dispatch =====" << endl;
+    cout << "active backend: " << mlkem_dispatch().name << endl;
+
+    for (const mlkem_backend *b : mlkem_available_backends()) {
+        bool pass = check_backend(*b, gen);
+        cout << (pass ? "[PASS] " : "[FAIL] ") << b->name << " matches reference kernels" << endl;
+        ok = ok && pass;
+    }
+
+    if (!mlkem_select_backend("ref") || strcmp(mlkem_dispatch().name, "ref") != 0) {
+        cout << "[FAIL] could not force the reference backend" << endl;
+        ok = false;
+    }
+    if (mlkem_select_backend("no-such-backend")) {
+        cout << "[FAIL] unknown backend accepted" << endl;
+        ok = false;
+    }
+
+    return ok ? 0 : 1;
+}
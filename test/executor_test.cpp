@@ -0,0 +1,97 @@
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+
+#include "ml-kem/executor.hpp"
+
+using namespace std;
+
+int main() {
+    bool ok = true;
+
+    cout << "\n===== [TEST] work-stealing executor =====" << endl;
+
+    // every index is visited exactly once, even with more workers than cores
+    Executor ex(4, true);
+    vector<atomic<int>> hits(10007);
+    for (auto &h : hits) h = 0;
+    ex.parallel_for(hits.size(), 13, [&hits](ExecutorWorker &w, size_t b, size_t e) {
+        (void)w;
+        for (size_t i = b; i < e; i++) hits[i]++;
+    });
+    for (size_t i = 0; i < hits.size(); i++) {
+        if (hits[i] != 1) {
+            cout << "[FAIL] index " << i << " visited " << hits[i] << " times" << endl;
+            ok = false;
+            break;
+        }
+    }
+
+    bool caught = false;
+    try {
+        ex.parallel_for(100, 7, [](ExecutorWorker &w, size_t b, size_t e) {
+            (void)w; (void)e;
+            if (b == 49) throw runtime_error("task failure");
+        });
+    } catch (const runtime_error &) {
+        caught = true;
+    }
+    if (!caught) {
+        cout << "[FAIL] task exception was not propagated" << endl;
+        ok = false;
+    }
+
+    // a task may call back into its own executor; the inner loop runs inline
+    atomic<int> inner(0);
+    ex.parallel_for(8, 1, [&ex, &inner](ExecutorWorker &w, size_t b, size_t e) {
+        (void)w; (void)b; (void)e;
+        ex.parallel_for(10, 3, [&inner](ExecutorWorker &w2, size_t b2, size_t e2) {
+            (void)w2;
+            inner += (int)(e2 - b2);
+        });
+    });
+    if (inner != 80) {
+        cout << "[FAIL] nested parallel_for covered " << inner << " of 80 items" << endl;
+        ok = false;
+    }
+
+    // bulk KEM helpers agree with the single-shot API
+    const size_t n = 37;
+    auto keys = parallel_keygen(ex, n);
+    vector<vector<ui8>> eks;
+    for (auto &kp : keys) eks.push_back(kp.first);
+    auto enc = parallel_encaps(ex, eks);
+    if (keys.size() != n || enc.size() != n) {
+        cout << "[FAIL] wrong result count" << endl;
+        return 1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (ML_KEM_DECAPSULATION(keys[i].second, enc[i].second) != enc[i].first) {
+            cout << "[FAIL] key pair " << i << " does not round-trip" << endl;
+            ok = false;
+        }
+    }
+
+    vector<vector<ui8>> cts;
+    vector<vector<ui8>> want;
+    for (size_t i = 0; i < n; i++) {
+        auto [K, c] = ML_KEM_ENCAPSULATION(keys[0].first);
+        if (i % 5 == 0) c[i] ^= 1;
+        cts.push_back(c);
+        want.push_back(ML_KEM_DECAPSULATION(keys[0].second, c));
+    }
+    auto dec = parallel_decaps(ex, keys[0].second, cts);
+    if (dec != want) {
+        cout << "[FAIL] parallel_decaps differs from ML_KEM_DECAPSULATION" << endl;
+        ok = false;
+    }
+
+    if (keys[0].first == keys[1].first) {
+        cout << "[FAIL] workers produced identical keys" << endl;
+        ok = false;
+    }
+
+    cout << (ok ? "[PASS]" : "[FAIL]") << " executor" << endl;
+    return ok ? 0 : 1;
+}
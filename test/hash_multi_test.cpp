@@ -0,0 +1,129 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cstring>
+
+#include "ml-kem/hash_multi.hpp"
+#include "ml-kem/ML-KEM.hpp"
+#include "ml-kem/dispatch.hpp"
+
+using namespace std;
+
+// Compares every multi-buffer entry point against the one-at-a-time wrapper
+// for lengths around the block boundaries of each rate.
+static bool check_lanes(mt19937 &gen) {
+    const u64 lens[] = {0, 1, 31, 32, 64, 71, 72, 73, 135, 136, 137, 167, 168, 169, 800, 1184, 1568};
+    uniform_int_distribution<int> byte(0, 255);
+    bool ok = true;
+
+    for (u64 len : lens) {
+        vector<vector<ui8>> msg(8, vector<ui8>(len + 1));
+        vector<vector<ui8>> got(8, vector<ui8>(200)), want(8, vector<ui8>(200));
+        ui8 *in[8], *out[8];
+        for (int l = 0; l < 8; l++) {
+            for (auto &x : msg[l]) x = byte(gen);
+            in[l] = msg[l].data();
+            out[l] = got[l].data();
+        }
+
+        for (int lanes = 4; lanes <= 8; lanes += 4) {
+            for (int f = 0; f < 4; f++) {
+                for (int l = 0; l < lanes; l++) {
+                    switch (f) {
+                        case 0: FIPS202_SHA3_256(in[l], len, want[l].data()); break;
+                        case 1: FIPS202_SHA3_512(in[l], len, want[l].data()); break;
+                        case 2: FIPS202_SHAKE128(in[l], len, want[l].data(), 200); break;
+                        case 3: FIPS202_SHAKE256(in[l], len, want[l].data(), 200); break;
+                    }
+                }
+                if (lanes == 4) {
+                    switch (f) {
+                        case 0: FIPS202_SHA3_256_x4(in, len, out); break;
+                        case 1: FIPS202_SHA3_512_x4(in, len, out); break;
+                        case 2: FIPS202_SHAKE128_x4(in, len, out, 200); break;
+                        case 3: FIPS202_SHAKE256_x4(in, len, out, 200); break;
+                    }
+                } else {
+                    switch (f) {
+                        case 0: FIPS202_SHA3_256_x8(in, len, out); break;
+                        case 1: FIPS202_SHA3_512_x8(in, len, out); break;
+                        case 2: FIPS202_SHAKE128_x8(in, len, out, 200); break;
+                        case 3: FIPS202_SHAKE256_x8(in, len, out, 200); break;
+                    }
+                }
+                const size_t outlen[] = {32, 64, 200, 200};
+                for (int l = 0; l < lanes; l++) {
+                    if (memcmp(got[l].data(), want[l].data(), outlen[f]) != 0) {
+                        cout << "[FAIL] x" << lanes << " function " << f << " len " << len
+                             << " lane " << l << endl;
+                        ok = false;
+                    }
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+// Batch encaps/decaps must agree with the single-shot internals, including
+// short final groups and rejected ciphertexts.
+static bool check_kem_batch(mt19937 &gen) {
+    uniform_int_distribution<int> byte(0, 255);
+    bool ok = true;
+    const size_t n = 11;
+    vector<vector<ui8>> eks(n), dks(n), msgs(n, vector<ui8>(32));
+
+    for (size_t i = 0; i < n; i++) {
+        vector<ui8> d(32), z(32);
+        for (int j = 0; j < 32; j++) { d[j] = byte(gen); z[j] = byte(gen); msgs[i][j] = byte(gen); }
+        auto [ek, dk] = ML_KEM_KeyGen_internal(d, z);
+        eks[i] = ek;
+        dks[i] = dk;
+    }
+
+    auto enc = ML_KEM_Encaps_internal_batch(eks, msgs);
+    if (enc.size() != n) {
+        cout << "[FAIL] batch encaps returned " << enc.size() << " results" << endl;
+        return false;
+    }
+    vector<vector<ui8>> cts(n);
+    for (size_t i = 0; i < n; i++) {
+        auto [K, c] = ML_KEM_Encaps_internal(eks[i], msgs[i]);
+        if (K != enc[i].first || c != enc[i].second) {
+            cout << "[FAIL] batch encaps differs at " << i << endl;
+            ok = false;
+        }
+        cts[i] = c;
+        if (i % 3 == 1) cts[i][i] ^= 0x40;
+    }
+
+    auto dec = ML_KEM_Decaps_internal_batch(dks, cts);
+    for (size_t i = 0; i < n && dec.size() == n; i++) {
+        if (dec[i] != ML_KEM_Decaps_internal(dks[i], cts[i])) {
+            cout << "[FAIL] batch decaps differs at " << i << endl;
+            ok = false;
+        }
+        if ((i % 3 != 1) != (dec[i] == enc[i].first)) {
+            cout << "[FAIL] batch decaps accept/reject wrong at " << i << endl;
+            ok = false;
+        }
+    }
+    if (dec.size() != n) ok = false;
+    return ok;
+}
+
+int main() {
+    mt19937 gen(7);
+    bool ok = true;
+
+    cout << "\n===== [TEST] multi-buffer SHA3/SHAKE =====" << endl;
+    for (const mlkem_backend *b : mlkem_available_backends()) {
+        mlkem_select_backend(b->name);
+        bool lanes = check_lanes(gen);
+        bool batch = check_kem_batch(gen);
+        cout << (lanes && batch ? "[PASS] " : "[FAIL] ") << b->name
+             << " (" << b->hash_lanes << " lanes)" << endl;
+        ok = ok && lanes && batch;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+
+#include "ml-kem/key_cache.hpp"
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const int WORKERS = 4;
+
+// Worker process body: finds the key in the inherited mapping and in a
+// read-only attachment of the same fd, and decapsulates from both.
+static int worker(MLKEM_KeyCache *leader, const ui8 *h, vector<vector<ui8>> &cts,
+                  vector<vector<ui8>> &expect) {
+    const mlkem_expanded_dk *inherited = leader->find(h);
+    MLKEM_KeyCache *ro = MLKEM_KeyCache::attach_fd(leader->fd());
+    if (inherited == nullptr || ro == nullptr) return 1;
+    const mlkem_expanded_dk *attached = ro->find(h);
+    if (attached == nullptr || memcmp(attached, inherited, sizeof(mlkem_expanded_dk)) != 0) return 2;
+    if (ML_KEM_decaps_many(*attached, cts) != expect || ML_KEM_decaps_many(*inherited, cts) != expect) return 3;
+    vector<ui8> dk(768 * Kyber_k + 96);
+    if (ro->publish(dk)) return 4;
+    delete ro;
+    return 0;
+}
+
+int main() {
+    bool ok = true;
+    cout << "\n===== [TEST] shared expanded-key cache =====" << endl;
+
+    auto [ek, dk] = ML_KEM_KEYGEN();
+    auto [ek2, dk2] = ML_KEM_KEYGEN();
+    const ui8 *h = dk.data() + 768 * Kyber_k + 32, *h2 = dk2.data() + 768 * Kyber_k + 32;
+    vector<vector<ui8>> cts, expect;
+    for (int i = 0; i < 6; i++) {
+        auto [K, c] = ML_KEM_ENCAPSULATION(ek);
+        if (i == 3) c[10] ^= 1;
+        cts.push_back(c);
+        expect.push_back(ML_KEM_Decaps_internal(dk, c));
+    }
+
+    MLKEM_KeyCache *cache = MLKEM_KeyCache::create(nullptr, 2);
+    if (cache == nullptr || cache->find(h) != nullptr || !cache->publish(dk)) {
+        cout << "[FAIL] cannot create a cache and publish a key" << endl;
+        return 1;
+    }
+    cout << "[INFO] " << cache->bytes() << " byte segment, " << sizeof(mlkem_expanded_dk)
+         << " bytes per expanded key (k=" << Kyber_k << ")" << endl;
+
+    // prefork: every worker decapsulates from the leader's single copy
+    vector<pid_t> pids;
+    for (int i = 0; i < WORKERS; i++) {
+        pid_t pid = fork();
+        if (pid == 0) _exit(worker(cache, h, cts, expect));
+        pids.push_back(pid);
+    }
+    for (pid_t pid : pids) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            cout << "[FAIL] worker " << pid << " failed with status " << status << endl;
+            ok = false;
+        }
+    }
+
+    // rotation: publish the new key, revoke the old; a copy taken before
+    // the revoke is still usable
+    const mlkem_expanded_dk *old = cache->find(h);
+    u64 gen = cache->generation();
+    vector<ui8> bad_dk = dk2;
+    bad_dk[768 * Kyber_k + 40] ^= 1;
+    if (cache->publish(bad_dk) || !cache->publish(dk2) || !cache->revoke(h) || cache->find(h) != nullptr
+        || cache->find(h2) == nullptr || cache->generation() <= gen || ML_KEM_decaps_many(*old, cts) != expect) {
+        cout << "[FAIL] key rotation" << endl;
+        ok = false;
+    }
+    if (cache->publish(dk)) {
+        cout << "[FAIL] publish into a full cache succeeded" << endl;
+        ok = false;
+    }
+
+    // a segment that is not a cache is refused
+    int junk = memfd_create("junk", MFD_CLOEXEC);
+    if (junk >= 0 && ftruncate(junk, 1 << 16) == 0) {
+        MLKEM_KeyCache *bad = MLKEM_KeyCache::attach_fd(junk);
+        if (bad != nullptr) {
+            cout << "[FAIL] attached to a segment without a cache header" << endl;
+            ok = false;
+            delete bad;
+        }
+    }
+    if (junk >= 0) close(junk);
+
+    // named segment: create, attach by name, unlink
+    string name = "/mlkem_key_cache_test_" + to_string(getpid());
+    MLKEM_KeyCache *named = MLKEM_KeyCache::create(name.c_str(), 1);
+    if (named != nullptr) {
+        named->publish(dk);
+        MLKEM_KeyCache *ro = MLKEM_KeyCache::attach(name.c_str());
+        if (ro == nullptr || ro->find(h) == nullptr || ML_KEM_decaps_many(*ro->find(h), cts) != expect) {
+            cout << "[FAIL] named segment" << endl;
+            ok = false;
+        }
+        delete ro;
+        delete named;
+        shm_unlink(name.c_str());
+    } else {
+        cout << "[SKIP] shm_open not available" << endl;
+    }
+    delete cache;
+
+    cout << (ok ? "[PASS]" : "[FAIL]") << " key cache with " << WORKERS << " worker processes" << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+#include <iostream>
+#include <vector>
+
+#include "ml-kem/ML-KEM.hpp"
+#include "ml-kem/executor.hpp"
+
+using namespace std;
+
+// Writes x into 12-bit coefficient i of an encoded polynomial.
+static void set_coeff12(ui8 *p, int i, unsigned x) {
+    ui8 *b = p + 3 * (i / 2);
+    if (i & 1) {
+        b[1] = (ui8)((b[1] & 0x0F) | ((x & 0xF) << 4));
+        b[2] = (ui8)(x >> 4);
+    } else {
+        b[0] = (ui8)x;
+        b[1] = (ui8)((b[1] & 0xF0) | (x >> 8));
+    }
+}
+
+int main() {
+    bool ok = true;
+    cout << "\n===== [TEST] FIPS 203 key checks =====" << endl;
+
+    auto [ek, dk] = ML_KEM_KEYGEN();
+    if (!ML_KEM_check_encaps_key(ek) || !ML_KEM_check_decaps_key(dk)) {
+        cout << "[FAIL] a generated key pair fails the checks" << endl;
+        ok = false;
+    }
+
+    // q-1 is the largest valid coefficient, q the smallest invalid one
+    for (int pos : {0, 1, 255, 256 * Kyber_k - 1}) {
+        vector<ui8> bad = ek;
+        set_coeff12(bad.data() + 384 * (pos / 256), pos % 256, Kyber_Q - 1);
+        if (!ML_KEM_check_encaps_key(bad)) {
+            cout << "[FAIL] q-1 rejected at coefficient " << pos << endl;
+            ok = false;
+        }
+        set_coeff12(bad.data() + 384 * (pos / 256), pos % 256, Kyber_Q);
+        if (ML_KEM_check_encaps_key(bad)) {
+            cout << "[FAIL] q accepted at coefficient " << pos << endl;
+            ok = false;
+        }
+    }
+
+    vector<ui8> bad_ek = ek;
+    set_coeff12(bad_ek.data(), 7, 4095);
+    if (!ML_KEM_ENCAPSULATION(bad_ek).first.empty()) {
+        cout << "[FAIL] encapsulation to an invalid key succeeded" << endl;
+        ok = false;
+    }
+    vector<vector<ui8>> eks = {ek, bad_ek};
+    if (!ML_KEM_ENCAPSULATION_BATCH(eks).empty() || !parallel_encaps(eks).empty()) {
+        cout << "[FAIL] batch encapsulation to an invalid key succeeded" << endl;
+        ok = false;
+    }
+    vector<ui8> short_ek(ek.begin(), ek.end() - 1);
+    if (ML_KEM_check_encaps_key(short_ek)) {
+        cout << "[FAIL] truncated encapsulation key accepted" << endl;
+        ok = false;
+    }
+
+    // a dk whose embedded ek no longer matches h, and one whose h is wrong
+    auto [K, c] = ML_KEM_ENCAPSULATION(ek);
+    for (size_t at : {(size_t)384 * Kyber_k + 5, (size_t)768 * Kyber_k + 40}) {
+        vector<ui8> bad_dk = dk;
+        bad_dk[at] ^= 1;
+        if (ML_KEM_check_decaps_key(bad_dk) || !ML_KEM_DECAPSULATION(bad_dk, c).empty()) {
+            cout << "[FAIL] decapsulation key with byte " << at << " flipped accepted" << endl;
+            ok = false;
+        }
+        vector<vector<ui8>> dks = {dk, bad_dk}, cts = {c, c};
+        if (!ML_KEM_DECAPSULATION_BATCH(dks, cts).empty() || !parallel_decaps(bad_dk, cts).empty()) {
+            cout << "[FAIL] batch decapsulation with a bad key succeeded" << endl;
+            ok = false;
+        }
+    }
+    vector<ui8> short_c(c.begin(), c.end() - 1);
+    if (!ML_KEM_DECAPSULATION(dk, short_c).empty()) {
+        cout << "[FAIL] truncated ciphertext accepted" << endl;
+        ok = false;
+    }
+
+    // the checks leave valid inputs alone
+    vector<ui8> K2 = ML_KEM_DECAPSULATION(dk, c);
+    if (K2 != K) ok = false;
+
+    cout << (ok ? "[PASS]" : "[FAIL]") << " key checks" << endl;
+    return ok ? 0 : 1;
+}
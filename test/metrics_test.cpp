@@ -0,0 +1,105 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+
+#include "ml-kem/ML-KEM.hpp"
+#include "ml-kem/noheap.hpp"
+#include "ml-kem/decaps_many.hpp"
+#include "ml-kem/context.hpp"
+#include "ml-kem/metrics.hpp"
+
+using namespace std;
+
+static const int THREADS = 6;
+static const int ROUNDS = 20;
+
+static bool check(const char *what, u64 got, u64 want) {
+    if (got == want) return true;
+    cout << "[FAIL] " << what << ": " << got << ", expected " << want << endl;
+    return false;
+}
+
+static bool contains(const string &text, const string &line) {
+    if (text.find(line) != string::npos) return true;
+    cout << "[FAIL] exposition lacks \"" << line << "\"" << endl;
+    return false;
+}
+
+int main() {
+    bool ok = true;
+    cout << "\n===== [TEST] metrics registry =====" << endl;
+
+    auto [ek, dk] = ML_KEM_KEYGEN();
+    mlkem_metrics_reset();
+
+    // counts from concurrent threads on separate (and shared) shards add up
+    vector<thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&]{
+            MLKEM_Context ctx;
+            vector<ui8> pk = ek, sk = dk;
+            for (int i = 0; i < ROUNDS; i++) {
+                auto [K, c] = ML_KEM_ENCAPSULATION(ctx, pk);
+                ML_KEM_DECAPSULATION(ctx, sk, c);
+            }
+        });
+    }
+    for (auto &th : threads) th.join();
+    mlkem_metrics_snapshot s = mlkem_metrics_read();
+    ok &= check("encaps items", s.items[MLKEM_OP_ENCAPS], THREADS * ROUNDS);
+    ok &= check("decaps calls", s.calls[MLKEM_OP_DECAPS], THREADS * ROUNDS);
+    ok &= check("implicit rejections", s.counters[MLKEM_METRIC_IMPLICIT_REJECTS], 0);
+    ok &= check("rng seeds", s.counters[MLKEM_METRIC_RNG_SEEDS], THREADS);
+    u64 in_buckets = 0;
+    for (int b = 0; b < MLKEM_METRICS_BUCKETS; b++) in_buckets += s.buckets[MLKEM_OP_ENCAPS][b];
+    ok &= check("encaps histogram count", in_buckets, THREADS * ROUNDS);
+    if (s.sum_ns[MLKEM_OP_ENCAPS] == 0) {
+        cout << "[FAIL] no encaps latency recorded" << endl;
+        ok = false;
+    }
+
+    // implicit rejection on every decapsulation path, input rejections
+    mlkem_metrics_reset();
+    auto [K, c] = ML_KEM_ENCAPSULATION(ek);
+    vector<ui8> bad = c;
+    bad[5] ^= 1;
+    ML_KEM_DECAPSULATION(dk, bad);
+    vector<vector<ui8>> dks = {dk, dk}, cts = {c, bad};
+    ML_KEM_DECAPSULATION_BATCH(dks, cts);
+    ML_KEM_DECAPSULATION_MANY(dk, cts);
+    ui8 K2[32];
+    ML_KEM_Decaps_noheap(K2, bad.data(), dk.data());
+    vector<ui8> bad_ek = ek;
+    bad_ek[0] = 0xff;
+    bad_ek[1] = 0xff;
+    ML_KEM_ENCAPSULATION(bad_ek);
+    vector<ui8> short_c(10);
+    ML_KEM_DECAPSULATION(dk, short_c);
+    s = mlkem_metrics_read();
+    ok &= check("implicit rejections", s.counters[MLKEM_METRIC_IMPLICIT_REJECTS], 4);
+    ok &= check("decaps items", s.items[MLKEM_OP_DECAPS], 2);
+    ok &= check("decaps_batch items", s.items[MLKEM_OP_DECAPS_BATCH], 2);
+    ok &= check("decaps_many items", s.items[MLKEM_OP_DECAPS_MANY], 2);
+    ok &= check("encaps rejected", s.rejected[MLKEM_OP_ENCAPS], 1);
+    ok &= check("decaps rejected", s.rejected[MLKEM_OP_DECAPS], 1);
+    ok &= check("decaps calls", s.calls[MLKEM_OP_DECAPS], 3);
+
+    string text = mlkem_metrics_prometheus();
+    string param = "param=\"ML-KEM-" + to_string(256 * Kyber_k) + "\"";
+    ok &= contains(text, "# TYPE mlkem_call_duration_seconds histogram\n");
+    ok &= contains(text, "mlkem_operations_total{" + param + ",op=\"decaps_many\"} 2\n");
+    ok &= contains(text, "mlkem_rejected_inputs_total{" + param + ",op=\"encaps\"} 1\n");
+    ok &= contains(text, "mlkem_call_duration_seconds_bucket{" + param + ",op=\"decaps\",le=\"+Inf\"} 3\n");
+    ok &= contains(text, "mlkem_call_duration_seconds_count{" + param + ",op=\"decaps\"} 3\n");
+    ok &= contains(text, "mlkem_implicit_rejections_total{" + param + "} 4\n");
+
+    // nothing is recorded while disabled
+    mlkem_metrics_enable(false);
+    ML_KEM_ENCAPSULATION(ek);
+    mlkem_metrics_enable(true);
+    ok &= check("encaps while disabled", mlkem_metrics_read().calls[MLKEM_OP_ENCAPS], 2);
+
+    cout << (ok ? "[PASS]" : "[FAIL]") << " metrics" << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <vector>
+#include <cstring>
+
+#include "ml-kem/noise_sim.hpp"
+#include "ml-kem/K_PKE.hpp"
+#include "ml-kem/dispatch.hpp"
+
+using namespace std;
+
+static int mod_q(int x) {
+    x %= Kyber_Q;
+    return x < 0 ? x + Kyber_Q : x;
+}
+
+// Noise of a real ciphertext, recomputed with the vector API:
+// w = Decompress(v) - InvNTT(s^T NTT(Decompress(u))) minus the message.
+static vector<int> reference_noise(vector<ui8> &dk, vector<ui8> &c, vector<ui8> &m) {
+    vector<i16> acc(Kyber_N, 0);
+    for (int i = 0; i < Kyber_k; i++) {
+        vector<ui8> ci(c.begin() + i * 32 * du, c.begin() + (i + 1) * 32 * du);
+        vector<i16> d = ByteDecode(ci, du);
+        vector<i16> u = Decompress(d, du);
+        ntt(u);
+        vector<ui8> si(dk.begin() + i * 384, dk.begin() + (i + 1) * 384);
+        vector<i16> s = ByteDecode(si, 12);
+        vector<i16> p = poly_multiply_pointwise_mont(s, u);
+        for (int j = 0; j < Kyber_N; j++) acc[j] = (i16)mod_q(acc[j] + p[j]);
+    }
+    invntt(acc);
+    vector<ui8> cv(c.begin() + Kyber_k * 32 * du, c.end());
+    vector<i16> dv_ = ByteDecode(cv, dv);
+    vector<i16> v = Decompress(dv_, dv);
+
+    vector<int> noise(Kyber_N);
+    for (int j = 0; j < Kyber_N; j++) {
+        int bit = (m[j >> 3] >> (j & 7)) & 1;
+        int n = mod_q(v[j] - acc[j] - bit * ((Kyber_Q + 1) / 2));
+        noise[j] = n > Kyber_Q / 2 ? n - Kyber_Q : n;
+    }
+    return noise;
+}
+
+int main() {
+    bool ok = true;
+    cout << "\n===== [TEST] decryption noise simulation =====" << endl;
+
+    auto [ek, dk] = ML_KEM_KEYGEN();
+    mlkem_expanded_dk key;
+    if (!ML_KEM_expand_decaps_key(key, dk)) {
+        cout << "[FAIL] a generated key failed to expand" << endl;
+        return 1;
+    }
+
+    // as-implemented sampling reproduces K_PKE_Encrypt coefficient for
+    // coefficient, on every backend
+    for (const mlkem_backend *b : mlkem_available_backends()) {
+        mlkem_select_backend(b->name);
+        bool pass = true;
+        for (int t = 0; t < 8 && pass; t++) {
+            vector<ui8> m(32), r(32);
+            for (int i = 0; i < 32; i++) {
+                m[i] = (ui8)(t * 91 + i * 13 + 5);
+                r[i] = (ui8)(t * 29 + i * 7 + 1);
+            }
+            vector<ui8> c = K_PKE_Encrypt(ek, m, r);
+            vector<int> expect = reference_noise(dk, c, m);
+            i16 noise[Kyber_N];
+            int failed = mlkem_noise_trial(noise, key, m.data(), r.data(), MLKEM_NOISE_IMPLEMENTED);
+            for (int j = 0; j < Kyber_N; j++) pass = pass && noise[j] == expect[j];
+            pass = pass && failed == 0 && K_PKE_Decrypt(dk, c) == m;
+        }
+        cout << (pass ? "[PASS] " : "[FAIL] ") << b->name << ": noise matches K_PKE_Encrypt ciphertexts" << endl;
+        ok = ok && pass;
+    }
+    mlkem_select_backend(mlkem_available_backends()[0]->name);
+
+    // the histogram depends on the trial range only: one thread, three
+    // threads, and a run split in two all agree
+    for (mlkem_noise_sampling sampling : {MLKEM_NOISE_FIPS, MLKEM_NOISE_IMPLEMENTED}) {
+        for (bool fast : {false, true}) {
+            mlkem_noise_config cfg = {sampling, fast, 100, 7};
+            mlkem_noise_hist *h1 = new mlkem_noise_hist, *h3 = new mlkem_noise_hist, *hs = new mlkem_noise_hist;
+            h1->clear();
+            h3->clear();
+            hs->clear();
+            Executor one(1), three(3);
+            mlkem_noise_simulate(one, *h1, cfg, 0, 300);
+            mlkem_noise_simulate(three, *h3, cfg, 0, 300);
+            mlkem_noise_simulate(three, *hs, cfg, 0, 123);
+            mlkem_noise_simulate(one, *hs, cfg, 123, 177);
+
+            u64 total = 0;
+            for (int i = 0; i < MLKEM_NOISE_BINS; i++) total += h1->bins[i];
+            bool pass = memcmp(h1, h3, sizeof(*h1)) == 0 && memcmp(h1, hs, sizeof(*h1)) == 0
+                        && h1->trials == 300 && total == h1->coefficients() && h1->failed_trials == 0
+                        && h1->bins[Kyber_Q / 2] > 0 && h1->bins[0] == 0;
+            cout << (pass ? "[PASS] " : "[FAIL] ") << (sampling == MLKEM_NOISE_FIPS ? "fips" : "implemented")
+                 << (fast ? "/xoshiro" : "/shake") << ": 300 trials independent of threads and splits" << endl;
+            ok = ok && pass;
+            delete h1;
+            delete h3;
+            delete hs;
+        }
+    }
+
+    cout << (ok ? "[PASS]" : "[FAIL]") << " noise simulation" << endl;
+    return ok ? 0 : 1;
+}
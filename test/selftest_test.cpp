@@ -0,0 +1,66 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+
+#include "ml-kem/ML-KEM.hpp"
+#include "ml-kem/selftest.hpp"
+#include "ml-kem/dispatch.hpp"
+
+using namespace std;
+
+static const int THREADS = 8;
+
+int main() {
+    bool ok = true;
+    const char *mode = getenv("MLKEM_SELFTEST");
+    cout << "\n===== [TEST] power-on self-test (" << (mode ? mode : "lazy") << ", "
+         << mlkem_dispatch().name << ") =====" << endl;
+
+    // concurrent first callers all wait for the one run and agree on it
+    atomic<int> go(0), passed(0);
+    vector<thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&]{
+            while (go.load() == 0) this_thread::yield();
+            if (mlkem_selftest()) passed++;
+        });
+    }
+    go.store(1);
+    for (auto &th : threads) th.join();
+    if (passed != THREADS || !mlkem_selftest_passed() || mlkem_selftest_failure() != nullptr) {
+        const char *f = mlkem_selftest_failure();
+        cout << "[FAIL] self-test: " << passed << "/" << THREADS << " callers passed, failing check "
+             << (f ? f : "none") << endl;
+        ok = false;
+    } else {
+        cout << "[PASS] self-test in " << mlkem_selftest_ns() / 1000 << " us" << endl;
+    }
+    if (mlkem_selftest_ns() <= 0) {
+        cout << "[FAIL] self-test time not recorded" << endl;
+        ok = false;
+    }
+
+    // every backend is tested again when it is selected, multi-buffer
+    // Keccak included
+    string start = mlkem_dispatch().name;
+    for (const mlkem_backend *b : mlkem_available_backends()) {
+        bool pass = mlkem_select_backend(b->name) && mlkem_selftest_passed() && mlkem_selftest_failure() == nullptr;
+        cout << (pass ? "[PASS] " : "[FAIL] ") << "self-test rerun on " << b->name << endl;
+        ok = ok && pass;
+    }
+    mlkem_select_backend(start.c_str());
+
+    // the gated entry points work once it has passed
+    auto [ek, dk] = ML_KEM_KEYGEN();
+    auto [K, c] = ML_KEM_ENCAPSULATION(ek);
+    if (ek.empty() || K.empty() || ML_KEM_DECAPSULATION(dk, c) != K) {
+        cout << "[FAIL] round trip after the self-test" << endl;
+        ok = false;
+    }
+
+    cout << (ok ? "[PASS]" : "[FAIL]") << " self-test" << endl;
+    return ok ? 0 : 1;
+}
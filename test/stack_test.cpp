@@ -0,0 +1,186 @@
+#include <iostream>
+#include <vector>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+
+#include "ml-kem/ML-KEM.hpp"
+#include "ml-kem/noheap.hpp"
+#include "ml-kem/dispatch.hpp"
+#ifdef MLKEM_TRACK_ALLOC
+#include "ml-kem/alloc_track.hpp"
+#endif
+
+using namespace std;
+
+// Peak stack per heap-free call, measured on a painted thread stack and
+// including everything the call reaches (hashing, kernels). Lower these
+// when a change shrinks the stack; a failure means a change grew it.
+// Each grows by one 512-byte polynomial per k.
+static const size_t KEYGEN_BUDGET = 3 * 1024 + 512 * Kyber_k;
+static const size_t ENCAPS_BUDGET = 4 * 1024 + 512 * Kyber_k;
+static const size_t DECAPS_BUDGET = 5 * 1024 + 512 * Kyber_k + MLKEM_CT_BYTES;
+
+// Sanitizer instrumentation inflates frames (and TSan keeps its thread
+// state on the stack); the budgets are then only reported, not enforced.
+#if defined(__SANITIZE_THREAD__) || defined(__SANITIZE_ADDRESS__)
+static const bool ENFORCE_BUDGETS = false;
+static const size_t STACK_SIZE = 4 * 1024 * 1024;
+#else
+static const bool ENFORCE_BUDGETS = true;
+static const size_t STACK_SIZE = 256 * 1024;
+#endif
+static const ui8 PAINT = 0xA5;
+
+// Heap allocations made by the measured thread. With MLKEM_ALLOC_TRACKING
+// the library owns operator new, so its per-thread counter is used.
+#ifndef MLKEM_TRACK_ALLOC
+static thread_local u64 thread_allocations = 0;
+
+void *operator new(size_t n) {
+    thread_allocations++;
+    void *p = malloc(n ? n : 1);
+    if (p == nullptr) throw bad_alloc();
+    return p;
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+#endif
+
+static u64 allocations_so_far() {
+#ifdef MLKEM_TRACK_ALLOC
+    return mlkem_alloc_thread().allocations;
+#else
+    return thread_allocations;
+#endif
+}
+
+typedef struct{
+    void (*fn)(void *);
+    void *arg;
+    u64 allocations;
+} stack_job;
+
+static void *run_job(void *p) {
+    stack_job *job = (stack_job *)p;
+    u64 before = allocations_so_far();
+    job->fn(job->arg);
+    job->allocations = allocations_so_far() - before;
+    return nullptr;
+}
+
+// Runs fn on a thread whose stack was painted beforehand and returns the
+// number of bytes below the top that were written. *allocations is set
+// to the heap allocations fn made.
+static size_t measure_stack(void (*fn)(void *), void *arg, u64 *allocations) {
+    vector<ui8> stack(STACK_SIZE, PAINT);
+    pthread_attr_t attr;
+    pthread_t th;
+    stack_job job = {fn, arg, 0};
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack.data(), STACK_SIZE);
+    if (pthread_create(&th, &attr, run_job, &job) != 0) {
+        cerr << "pthread_create failed" << endl;
+        exit(1);
+    }
+    pthread_join(th, nullptr);
+    pthread_attr_destroy(&attr);
+
+    size_t untouched = 0;
+    while (untouched < STACK_SIZE && stack[untouched] == PAINT) untouched++;
+    *allocations = job.allocations;
+    return STACK_SIZE - untouched;
+}
+
+typedef struct{
+    ui8 d[32], z[32], m[32];
+    ui8 ek[MLKEM_EK_BYTES], dk[MLKEM_DK_BYTES], c[MLKEM_CT_BYTES];
+    ui8 K[32], K2[32];
+    bool ok;
+} kem_io;
+
+static void nothing(void *) {}
+static void keygen(void *p) {
+    kem_io *io = (kem_io *)p;
+    ML_KEM_KeyGen_noheap(io->ek, io->dk, io->d, io->z);
+}
+static void encaps(void *p) {
+    kem_io *io = (kem_io *)p;
+    io->ok = ML_KEM_Encaps_noheap(io->K, io->c, io->ek, io->m);
+}
+static void decaps(void *p) {
+    kem_io *io = (kem_io *)p;
+    io->ok = ML_KEM_Decaps_noheap(io->K2, io->c, io->dk);
+}
+
+int main() {
+    bool ok = true;
+    cout << "\n===== [TEST] heap-free API: stack budget and equivalence =====" << endl;
+
+    static kem_io io;
+    for (int i = 0; i < 32; i++) { io.d[i] = (ui8)i; io.z[i] = (ui8)(i + 64); io.m[i] = (ui8)(3 * i); }
+
+    // one untimed round first so lazy symbol binding (which saves the full
+    // vector register state on the stack) is not charged to an operation
+    keygen(&io);
+    encaps(&io);
+    decaps(&io);
+
+    // thread start-up alone; subtracted from every figure below
+    u64 allocs = 0;
+    size_t base = measure_stack(nothing, nullptr, &allocs);
+
+    struct { const char *name; void (*fn)(void *); size_t budget; } ops[] = {
+        {"KeyGen", keygen, KEYGEN_BUDGET},
+        {"Encaps", encaps, ENCAPS_BUDGET},
+        {"Decaps", decaps, DECAPS_BUDGET},
+    };
+    for (const mlkem_backend *b : mlkem_available_backends()) {
+        mlkem_select_backend(b->name);
+        for (auto &op : ops) {
+            size_t used = measure_stack(op.fn, &io, &allocs) - base;
+            bool pass = (used <= op.budget || !ENFORCE_BUDGETS) && allocs == 0;
+            cout << (pass ? "[PASS] " : "[FAIL] ") << b->name << " " << op.name
+                 << " (k=" << Kyber_k << "): " << used << " stack bytes (budget "
+                 << op.budget << "), " << allocs << " heap allocations" << endl;
+            ok = ok && pass;
+        }
+        if (!io.ok || memcmp(io.K, io.K2, 32) != 0) {
+            cout << "[FAIL] " << b->name << ": heap-free round trip failed" << endl;
+            ok = false;
+        }
+    }
+    mlkem_select_backend(mlkem_available_backends()[0]->name);
+
+    // same bytes as the vector<> internals
+    vector<ui8> d(io.d, io.d + 32), z(io.z, io.z + 32), m(io.m, io.m + 32);
+    auto [ek, dk] = ML_KEM_KeyGen_internal(d, z);
+    auto [K, c] = ML_KEM_Encaps_internal(ek, m);
+    if (ek != vector<ui8>(io.ek, io.ek + MLKEM_EK_BYTES) || dk != vector<ui8>(io.dk, io.dk + MLKEM_DK_BYTES)
+        || c != vector<ui8>(io.c, io.c + MLKEM_CT_BYTES) || K != vector<ui8>(io.K, io.K + 32)) {
+        cout << "[FAIL] heap-free KeyGen/Encaps differ from the vector<> API" << endl;
+        ok = false;
+    }
+    c[5] ^= 0x10;
+    io.c[5] ^= 0x10;
+    vector<ui8> K_reject = ML_KEM_Decaps_internal(dk, c);
+    if (!ML_KEM_Decaps_noheap(io.K2, io.c, io.dk) || K_reject != vector<ui8>(io.K2, io.K2 + 32)
+        || K_reject == K) {
+        cout << "[FAIL] heap-free implicit rejection differs from the vector<> API" << endl;
+        ok = false;
+    }
+
+    // input checks
+    io.ek[1] = 0xFF;
+    io.ek[2] = 0xFF;
+    io.dk[MLKEM_DK_BYTES - 40] ^= 1;
+    if (ML_KEM_Encaps_noheap(io.K, io.c, io.ek, io.m) || ML_KEM_Decaps_noheap(io.K2, io.c, io.dk)) {
+        cout << "[FAIL] heap-free API accepted an invalid key" << endl;
+        ok = false;
+    }
+
+    cout << (ok ? "[PASS]" : "[FAIL]") << " heap-free API" << endl;
+    return ok ? 0 : 1;
+}
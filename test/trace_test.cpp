@@ -0,0 +1,78 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+
+#include "ml-kem/executor.hpp"
+#include "ml-kem/trace.hpp"
+
+using namespace std;
+
+int main() {
+    cout << "\n===== [TEST] stage tracer =====" << endl;
+    if (!mlkem_trace_compiled()) {
+        cout << "[SKIP] library built without MLKEM_TRACE" << endl;
+        return 0;
+    }
+    bool ok = true;
+
+    // nothing is recorded while tracing is off
+    mlkem_trace_enable(false);
+    auto [ek, dk] = ML_KEM_KEYGEN();
+    if (mlkem_trace_event_count() != 0) {
+        cout << "[FAIL] events recorded while tracing was disabled" << endl;
+        ok = false;
+    }
+
+    mlkem_trace_enable(true);
+    mlkem_trace_thread_name("trace \"test\" main");
+    auto [K, c] = ML_KEM_ENCAPSULATION(ek);
+    vector<ui8> K2 = ML_KEM_DECAPSULATION(dk, c);
+    Executor ex(2);
+    vector<vector<ui8>> keys(6, ek);
+    parallel_encaps(ex, keys);
+    mlkem_trace_enable(false);
+
+    const char *path = "trace_test.json";
+    if (!mlkem_trace_dump(path)) {
+        cout << "[FAIL] could not write " << path << endl;
+        return 1;
+    }
+    ifstream in(path);
+    stringstream ss;
+    ss << in.rdbuf();
+    string json = ss.str();
+
+    if (json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0) != 0 || json.find("\n]}") == string::npos) {
+        cout << "[FAIL] output is not a trace-event document" << endl;
+        ok = false;
+    }
+    const char *stages[] = {
+        "ML_KEM_Encaps", "ML_KEM_Decaps", "ML_KEM_Encaps_batch", "K_PKE_Encrypt", "K_PKE_Decrypt",
+        "NTT_sample", "Binomial_sample", "ntt", "ntt_decompress", "invntt_compress", "basemul_acc",
+        "FIPS202_SHA3_256", "FIPS202_SHA3_512", "FIPS202_SHAKE256", "executor_task", "executor_join",
+    };
+    for (const char *s : stages) {
+        if (json.find("\"name\":\"" + string(s) + "\",\"cat\"") == string::npos) {
+            cout << "[FAIL] no " << s << " event" << endl;
+            ok = false;
+        }
+    }
+    // names are escaped for JSON
+    if (json.find("trace \\\"test\\\" main") == string::npos || json.find("executor worker ") == string::npos) {
+        cout << "[FAIL] thread names missing or not escaped" << endl;
+        ok = false;
+    }
+
+    mlkem_trace_clear();
+    if (mlkem_trace_event_count() != 0) {
+        cout << "[FAIL] events left after clear" << endl;
+        ok = false;
+    }
+
+    if (K != K2) ok = false;
+    cout << (ok ? "[PASS] " : "[FAIL] ") << json.size() << " bytes of trace" << endl;
+    remove(path);
+    return ok ? 0 : 1;
+}
@@ -1,13 +1,22 @@
 #define FOR(i,n) for(i=0; i<n; ++i)
 #include "simple_fips_202.h"
 
+#ifdef MLKEM_TRACE
+/* stage tracer hooks, defined in include/ml-kem/trace.cpp */
+u64 mlkem_trace_begin(void);
+void mlkem_trace_end(const char *name, u64 begin);
+#define TRACED(name, call) do { u64 t0_ = mlkem_trace_begin(); call; mlkem_trace_end(name, t0_); } while (0)
+#else
+#define TRACED(name, call) call
+#endif
+
 void Keccak(ui r, ui c,  ui8 *in, u64 inLen, ui8 sfx, ui8 *out, u64 outLen);
-void FIPS202_SHAKE128( ui8 *in, u64 inLen, ui8 *out, u64 outLen) { Keccak(1344, 256, in, inLen, 0x1F, out, outLen); }
-void FIPS202_SHAKE256( ui8 *in, u64 inLen, ui8 *out, u64 outLen) { Keccak(1088, 512, in, inLen, 0x1F, out, outLen); }
-void FIPS202_SHA3_224( ui8 *in, u64 inLen, ui8 *out) { Keccak(1152, 448, in, inLen, 0x06, out, 28); }
-void FIPS202_SHA3_256( ui8 *in, u64 inLen, ui8 *out) { Keccak(1088, 512, in, inLen, 0x06, out, 32); }
-void FIPS202_SHA3_384( ui8 *in, u64 inLen, ui8 *out) { Keccak(832, 768, in, inLen, 0x06, out, 48); }
-void FIPS202_SHA3_512( ui8 *in, u64 inLen, ui8 *out) { Keccak(576, 1024, in, inLen, 0x06, out, 64); }
+void FIPS202_SHAKE128( ui8 *in, u64 inLen, ui8 *out, u64 outLen) { TRACED("FIPS202_SHAKE128", Keccak(1344, 256, in, inLen, 0x1F, out, outLen)); }
+void FIPS202_SHAKE256( ui8 *in, u64 inLen, ui8 *out, u64 outLen) { TRACED("FIPS202_SHAKE256", Keccak(1088, 512, in, inLen, 0x1F, out, outLen)); }
+void FIPS202_SHA3_224( ui8 *in, u64 inLen, ui8 *out) { TRACED("FIPS202_SHA3_224", Keccak(1152, 448, in, inLen, 0x06, out, 28)); }
+void FIPS202_SHA3_256( ui8 *in, u64 inLen, ui8 *out) { TRACED("FIPS202_SHA3_256", Keccak(1088, 512, in, inLen, 0x06, out, 32)); }
+void FIPS202_SHA3_384( ui8 *in, u64 inLen, ui8 *out) { TRACED("FIPS202_SHA3_384", Keccak(832, 768, in, inLen, 0x06, out, 48)); }
+void FIPS202_SHA3_512( ui8 *in, u64 inLen, ui8 *out) { TRACED("FIPS202_SHA3_512", Keccak(576, 1024, in, inLen, 0x06, out, 64)); }
 
 int LFSR86540(ui8 *R) { (*R)=((*R)<<1)^(((*R)&0x80)?0x71:0); return ((*R)&2)>>1; }
 #define ROL(a,o) ((((u64)a)<<o)^(((u64)a)>>(64-o)))
@@ -27,10 +36,12 @@ void KeccakF1600(void *s)
         /*ι*/ FOR(j,7) if (LFSR86540(&R)) XL(0,0,(u64)1<<((1<<j)-1));
     }
 }
+/* permutation used by Keccak(); rebound at load by the ML-KEM backend dispatcher */
+void (*KeccakF1600_permute)(void *s) = KeccakF1600;
 void Keccak(ui r, ui c,  ui8 *in, u64 inLen, ui8 sfx, ui8 *out, u64 outLen)
 {
-    /*initialize*/ ui8 s[200]; ui R=r/8; ui i,b=0; FOR(i,200) s[i]=0;
-    /*absorb*/ while(inLen>0) { b=(inLen<R)?inLen:R; FOR(i,b) s[i]^=in[i]; in+=b; inLen-=b; if (b==R) { KeccakF1600(s); b=0; } }
-    /*pad*/ s[b]^=sfx; if((sfx&0x80)&&(b==(R-1))) KeccakF1600(s); s[R-1]^=0x80; KeccakF1600(s);
-    /*squeeze*/ while(outLen>0) { b=(outLen<R)?outLen:R; FOR(i,b) out[i]=s[i]; out+=b; outLen-=b; if(outLen>0) KeccakF1600(s); }
+    /*initialize*/ u64 st[25]; ui8 *s=(ui8*)st; ui R=r/8; ui i,b=0; FOR(i,200) s[i]=0;
+    /*absorb*/ while(inLen>0) { b=(inLen<R)?inLen:R; FOR(i,b) s[i]^=in[i]; in+=b; inLen-=b; if (b==R) { KeccakF1600_permute(s); b=0; } }
+    /*pad*/ s[b]^=sfx; if((sfx&0x80)&&(b==(R-1))) KeccakF1600_permute(s); s[R-1]^=0x80; KeccakF1600_permute(s);
+    /*squeeze*/ while(outLen>0) { b=(outLen<R)?outLen:R; FOR(i,b) out[i]=s[i]; out+=b; outLen-=b; if(outLen>0) KeccakF1600_permute(s); }
 }
\ No newline at end of file
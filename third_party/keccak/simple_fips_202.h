@@ -7,6 +7,10 @@ typedef uint8_t ui8;
 typedef unsigned long long u64;
 typedef unsigned int ui;
 
+// Keccak-f[1600] permutation; Keccak() calls it through KeccakF1600_permute
+void KeccakF1600(void *s);
+extern void (*KeccakF1600_permute)(void *s);
+
 // Core sponge function
 void Keccak(ui r, ui c,
              ui8 *in, u64 inLen,